@@ -0,0 +1,79 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:05:51
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:05:51
+ * @FilePath: \ele_sti\bench\BenchBackend.h
+ * @Description: 基准用后端：不碰硬件，只负责把构造好的上行包发出去
+ */
+#pragma once
+
+#include "common/LatencyTracer.h"
+#include "hal/IBackend.h"
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+class BenchBackend : public IBackend
+{
+    Q_OBJECT
+public:
+    explicit BenchBackend(QObject *parent = nullptr) : IBackend(parent) {}
+
+    void startStimulation(const StimulationParam &) override {}
+    void stopStimulation() override {}
+    void updateParameters(const StimulationParam &) override { m_updates.fetch_add(1); }
+    void setPIDParameters(const PIDParam &) override {}
+    void uploadProgram(const QVector<ProgramChunkPacket> &) override {}
+    void startProgram(uint8_t) override {}
+    void abortProgram() override {}
+    void startArbitrary(IArbSampleSource *, int) override {}
+    void stopArbitrary() override {}
+
+    void injectWave(const WaveformPacket &packet) { emit waveDataReceived(packet); }
+    void injectStatus(const StatusPacket &packet) { emit statusDataReceived(packet); }
+
+    // updateParameters 被调用的次数 (旋钮通道用它判断控制包已发出)
+    int updates() const { return m_updates.load(); }
+
+    // burstWaves 记录的每包发出时刻 (ns)，接收端收到包后按 tick_us 查
+    const QVector<qint64> &sentNs() const { return m_sentNs; }
+
+public slots:
+    // 在后端线程上连续发 count 个波形包，tick_us 写入序号供接收端对账
+    // 调用前需先 prepareBurst(count)，避免在发送循环里扩容
+    void burstWaves(int count)
+    {
+        WaveformPacket packet = {};
+        packet.head = HEAD_WAVEFORM_EX;
+        for (int i = 0; i < count; i++) {
+            packet.tick_us = (uint32_t)i;
+            m_sentNs[i] = LatencyTracer::nowNs();
+            emit waveDataReceived(packet);
+        }
+    }
+
+public:
+    void prepareBurst(int count) { m_sentNs.fill(0, count); }
+
+    /**
+     * @brief 在后端线程上限速发包：等 go 置位后开始，在途包数 (已发 - consumed) 不超过 window
+     * @note  模拟 M0 按固定节奏出包，不会把接收端的预分配槽位灌满
+     */
+    void streamWaves(int count, int window, const std::atomic<bool> &go, const std::atomic<int> &consumed)
+    {
+        while (!go.load()) QThread::yieldCurrentThread();
+        WaveformPacket packet = {};
+        packet.head = HEAD_WAVEFORM_EX;
+        const int base = consumed.load();
+        for (int i = 0; i < count; i++) {
+            while (i - (consumed.load() - base) >= window) QThread::yieldCurrentThread();
+            packet.tick_us = (uint32_t)i * 5000;
+            emit waveDataReceived(packet);
+        }
+    }
+
+private:
+    QVector<qint64> m_sentNs;
+    std::atomic<int> m_updates{0};
+};
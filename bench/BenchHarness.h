@@ -0,0 +1,129 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:05:51
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:05:51
+ * @FilePath: \ele_sti\bench\BenchHarness.h
+ * @Description: 微基准框架：自动标定循环次数，多轮取中位数，结果输出 JSON
+ */
+#pragma once
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include <algorithm>
+
+// 防止编译器把被测代码当成无用代码删掉
+template <typename T>
+inline void benchKeep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const T *sink;
+    sink = &value;
+#endif
+}
+
+class BenchRunner
+{
+public:
+    /**
+     * @param minTimeMs 每轮最短运行时间
+     * @param repeats   轮数，报告取中位数和最小值
+     */
+    explicit BenchRunner(int minTimeMs = 200, int repeats = 5)
+        : m_minTimeMs(minTimeMs), m_repeats(repeats) {}
+
+    void setFilter(const QString &filter) { m_filter = filter; }
+
+    /**
+     * @brief 运行一个用例
+     * @param fn        被测函数，调用一次算 opsPerCall 次操作
+     * @param opsPerCall 一次调用包含的操作数 (如一次喂 100 帧)
+     */
+    template <typename Fn>
+    void run(const QString &name, Fn &&fn, qint64 opsPerCall = 1)
+    {
+        if (!m_filter.isEmpty() && !name.contains(m_filter)) return;
+
+        // 1. 预热 + 标定：找到一轮至少跑 minTime/10 的调用次数
+        qint64 calls = 1;
+        for (;;) {
+            QElapsedTimer t;
+            t.start();
+            for (qint64 i = 0; i < calls; i++) fn();
+            if (t.nsecsElapsed() >= (qint64)m_minTimeMs * 100000 || calls >= (qint64(1) << 40)) break;
+            calls *= 2;
+        }
+        // 按比例放大到一轮 minTime
+        calls = qMax<qint64>(1, calls * 10);
+
+        // 2. 正式多轮
+        QVector<double> nsPerOp;
+        for (int r = 0; r < m_repeats; r++) {
+            QElapsedTimer t;
+            t.start();
+            for (qint64 i = 0; i < calls; i++) fn();
+            nsPerOp.append((double)t.nsecsElapsed() / (double)(calls * opsPerCall));
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        QJsonObject result;
+        result["name"] = name;
+        result["ops"] = (double)(calls * opsPerCall);
+        result["ns_per_op_median"] = nsPerOp.at(nsPerOp.size() / 2);
+        result["ns_per_op_min"] = nsPerOp.first();
+        result["ns_per_op_max"] = nsPerOp.last();
+        m_results.append(result);
+    }
+
+    /**
+     * @brief 运行一个只计部分耗时的用例
+     * @param fn 每次调用自己计时，返回计入的纳秒数 (准备/收尾放在计时之外)
+     * @note  标定和多轮统计与 run() 相同，只是按 fn 返回的耗时累计
+     */
+    template <typename Fn>
+    void runManual(const QString &name, Fn &&fn, qint64 opsPerCall = 1)
+    {
+        if (!m_filter.isEmpty() && !name.contains(m_filter)) return;
+
+        qint64 calls = 1;
+        for (;;) {
+            qint64 ns = 0;
+            for (qint64 i = 0; i < calls; i++) ns += fn();
+            if (ns >= (qint64)m_minTimeMs * 100000 || calls >= (qint64(1) << 40)) break;
+            calls *= 2;
+        }
+        calls = qMax<qint64>(1, calls * 10);
+
+        QVector<double> nsPerOp;
+        for (int r = 0; r < m_repeats; r++) {
+            qint64 ns = 0;
+            for (qint64 i = 0; i < calls; i++) ns += fn();
+            nsPerOp.append((double)ns / (double)(calls * opsPerCall));
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        QJsonObject result;
+        result["name"] = name;
+        result["ops"] = (double)(calls * opsPerCall);
+        result["ns_per_op_median"] = nsPerOp.at(nsPerOp.size() / 2);
+        result["ns_per_op_min"] = nsPerOp.first();
+        result["ns_per_op_max"] = nsPerOp.last();
+        m_results.append(result);
+    }
+
+    // 直接登记外部测得的结果 (如跨线程延迟分布)
+    void addResult(const QJsonObject &result) { m_results.append(result); }
+
+    QJsonArray results() const { return m_results; }
+
+private:
+    int m_minTimeMs;
+    int m_repeats;
+    QString m_filter;
+    QJsonArray m_results;
+};
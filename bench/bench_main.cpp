@@ -0,0 +1,841 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:05:51
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:05:51
+ * @FilePath: \ele_sti\bench\bench_main.cpp
+ * @Description: 协议/分帧/业务处理热路径微基准，结果以 JSON 输出
+ *
+ * 用法: ele_sti_bench [--filter 名称片段] [--min-time 毫秒] [--repeats 轮数] [--out 文件]
+ * 不带 --out 时输出到标准输出，便于 CI 直接保存后对比
+ * alloc/steady_state_pipeline 在稳态出现堆分配、check/* 检查不通过时进程返回 2
+ */
+#include "BenchBackend.h"
+#include "BenchHarness.h"
+#include "common/AllocCounter.h"
+#include "common/LatencyTracer.h"
+#include "common/LiveStream.h"
+#include "common/Logging.h"
+#include "common/PacketCodec.h"
+#include "common/TraceRecorder.h"
+#include "core/KnobInputHandler.h"
+#include "core/PidTuner.h"
+#include "core/SessionAnalyzer.h"
+#include "core/SessionRecorder.h"
+#include "core/StimulationProgram.h"
+#include "core/TaskExecutor.h"
+#include "core/TreatmentService.h"
+#include "core/TriggerEngine.h"
+#include "controllers/TreatmentManager.h"
+#include "hal/ButtonBackend.h"
+#include "hal/DeviceManager.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+WaveformPacket makeWave(uint32_t tick)
+{
+    WaveformPacket packet = {};
+    packet.tick_us = tick;
+    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) {
+        packet.adc_batch[i] = 0.5f * (float)i;
+    }
+    encodePacket(packet);
+    return packet;
+}
+
+StatusPacket makeStatus()
+{
+    StatusPacket packet = {};
+    packet.impedance = 120;
+    packet.battery_pct = 80;
+    packet.real_freq = 100;
+    encodePacket(packet);
+    return packet;
+}
+
+QByteArray makeButtonFrame(uint8_t cmd, uint8_t value)
+{
+    ButtonPacket packet = { FRAME_HEAD, cmd, value, 0, FRAME_TAIL };
+    packet.checksum = calculateChecksum(&packet, sizeof(packet) - 2);
+    return QByteArray(reinterpret_cast<const char *>(&packet), sizeof(packet));
+}
+
+// 旧的 if 链判头 + 校验 + 分发，作为查表分发的对照组
+struct UplinkCounters {
+    quint64 waves = 0;
+    quint64 status = 0;
+    quint64 progress = 0;
+    quint64 bad = 0;
+};
+
+void dispatchUplink(const uint8_t *rx, UplinkCounters &c)
+{
+    const uint8_t head = rx[0];
+    if (head == HEAD_WAVEFORM_EX) {
+        const WaveformPacket *packet = reinterpret_cast<const WaveformPacket *>(rx);
+        if (calculateChecksum(packet, sizeof(WaveformPacket) - 1) == packet->checksum) c.waves++;
+        else c.bad++;
+    }
+    if (head == HEAD_STATUS) {
+        const StatusPacket *packet = reinterpret_cast<const StatusPacket *>(rx);
+        if (calculateChecksum(packet, sizeof(StatusPacket) - 1) == packet->checksum) c.status++;
+        else c.bad++;
+    }
+    if (head == HEAD_PROG_STATUS) {
+        const ProgramStatusPacket *packet = reinterpret_cast<const ProgramStatusPacket *>(rx);
+        if (calculateChecksum(packet, sizeof(ProgramStatusPacket) - 1) == packet->checksum) c.progress++;
+        else c.bad++;
+    }
+}
+
+// 查表分发的处理端，与 RK3568Backend 用同一个 PacketDispatcher
+struct UplinkSink {
+    UplinkCounters c;
+    void onPacket(const WaveformPacket &) { c.waves++; }
+    void onPacket(const StatusPacket &) { c.status++; }
+    void onPacket(const ProgramStatusPacket &) { c.progress++; }
+};
+typedef PacketDispatcher<UplinkSink, WaveformPacket, StatusPacket, ProgramStatusPacket> BenchUplink;
+
+// 1. 校验和 (名字里是参与校验的字节数，跟着包结构走)
+void benchChecksum(BenchRunner &runner)
+{
+    const WaveformPacket wave = makeWave(0);
+    runner.run(QString("checksum/waveform_%1B").arg(sizeof(wave) - 1), [&] {
+        uint8_t sum = calculateChecksum(&wave, sizeof(wave) - 1);
+        benchKeep(sum);
+    });
+    const StatusPacket status = makeStatus();
+    runner.run(QString("checksum/status_%1B").arg(sizeof(status) - 1), [&] {
+        uint8_t sum = calculateChecksum(&status, sizeof(status) - 1);
+        benchKeep(sum);
+    });
+}
+
+// 2. 上行包判头、校验、分发：按 SPI 帧长度排好的混合流，约 1/20 是状态包、1/50 校验错
+void benchDispatch(BenchRunner &runner)
+{
+    const int frames = 1000;
+    QByteArray stream(frames * (int)sizeof(WaveformPacket), '\0');
+    for (int i = 0; i < frames; i++) {
+        uint8_t *slot = reinterpret_cast<uint8_t *>(stream.data()) + i * sizeof(WaveformPacket);
+        if (i % 20 == 0) {
+            const StatusPacket status = makeStatus();
+            memcpy(slot, &status, sizeof(status));
+        } else {
+            WaveformPacket wave = makeWave((uint32_t)i * 5000);
+            if (i % 50 == 1) wave.checksum ^= 0x5A;
+            memcpy(slot, &wave, sizeof(wave));
+        }
+    }
+    UplinkCounters counters;
+    runner.run("uplink/validate_dispatch_if_chain", [&] {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(stream.constData());
+        for (int i = 0; i < frames; i++) {
+            dispatchUplink(p + i * sizeof(WaveformPacket), counters);
+        }
+        benchKeep(counters);
+    }, frames);
+
+    // 查表分发：包含 memcpy 到对齐结构体的解码开销
+    UplinkSink sink;
+    runner.run("uplink/validate_dispatch_table", [&] {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(stream.constData());
+        for (int i = 0; i < frames; i++) {
+            BenchUplink::dispatch(sink, p + i * sizeof(WaveformPacket), sizeof(WaveformPacket));
+        }
+        benchKeep(sink.c);
+    }, frames);
+
+    // 只测分发本身：全部是未知帧头，排除校验和拷贝
+    QByteArray unknown(frames * (int)sizeof(WaveformPacket), '\x5A');
+    runner.run("uplink/dispatch_jump_only", [&] {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(unknown.constData());
+        int misses = 0;
+        for (int i = 0; i < frames; i++) {
+            misses += BenchUplink::dispatch(sink, p + i * sizeof(WaveformPacket), sizeof(WaveformPacket))
+                      == DispatchResult::UnknownHead;
+        }
+        benchKeep(misses);
+    }, frames);
+}
+
+// 3. 按键串口分帧：整帧、碎片化 (1~3 字节一段)、夹杂噪声
+void benchButtonFraming(BenchRunner &runner)
+{
+    const int frames = 200;
+    QByteArray clean;
+    for (int i = 0; i < frames; i++) clean += makeButtonFrame(i % 3 == 0 ? BTN_CMD_START : BTN_CMD_KNOB, (uint8_t)i);
+
+    QRandomGenerator rng(1234);
+    QByteArray noisy;
+    for (int i = 0; i < frames; i++) {
+        // 随机垃圾里故意混入帧头，逼分帧器走重同步
+        const int junk = rng.bounded(0, 6);
+        for (int j = 0; j < junk; j++) {
+            noisy.append(rng.bounded(0, 4) == 0 ? (char)FRAME_HEAD : (char)rng.bounded(0, 256));
+        }
+        noisy += makeButtonFrame(BTN_CMD_KNOB, (uint8_t)i);
+    }
+
+    QVector<QByteArray> fragments;
+    for (int pos = 0; pos < clean.size();) {
+        const int len = qMin(clean.size() - pos, (int)rng.bounded(1, 4));
+        fragments.append(clean.mid(pos, len));
+        pos += len;
+    }
+
+    ButtonBackend button;
+    runner.run("button/framing_whole", [&] { button.processBytes(clean); }, frames);
+    runner.run("button/framing_fragmented", [&] {
+        for (const QByteArray &f : fragments) button.processBytes(f);
+    }, frames);
+    runner.run("button/framing_noisy", [&] { button.processBytes(noisy); }, frames);
+}
+
+// 4. TreatmentService::handleWaveformPacket 转换 (同线程直连，含 emit 到空槽)
+//    服务起步是空闲，相同的批次会被省电策略压掉；handle_waveform 量治疗中的全速路径，
+//    idle_* 专门量空闲过滤：相同批次逐点比较后丢弃 / 两种批次交替，每包比较、保存并推送
+void benchServiceConversion(BenchRunner &runner)
+{
+    BenchBackend backend;
+    TreatmentService service(&backend);
+    service.power()->setActive(true);
+    quint64 received = 0;
+    QObject::connect(&service, &TreatmentService::waveformReceived, &service,
+                     [&received](const QVector<float> &data) { received += data.size(); });
+    const WaveformPacket wave = makeWave(0);
+    uint32_t tick = 0;
+    runner.run("service/handle_waveform", [&] {
+        WaveformPacket packet = wave;
+        packet.tick_us = (tick += 5000);
+        backend.injectWave(packet);
+    });
+
+    service.power()->setActive(false);
+    runner.run("service/handle_waveform_idle_same", [&] {
+        WaveformPacket packet = wave;
+        packet.tick_us = (tick += 5000);
+        backend.injectWave(packet);
+    });
+    WaveformPacket shifted = wave;
+    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) shifted.adc_batch[i] += 1.0f;
+    encodePacket(shifted);
+    bool flip = false;
+    runner.run("service/handle_waveform_idle_changed", [&] {
+        WaveformPacket packet = (flip = !flip) ? shifted : wave;
+        packet.tick_us = (tick += 5000);
+        backend.injectWave(packet);
+    });
+    benchKeep(received);
+}
+
+// 5. 跨线程投递：后端线程发波形包，主线程事件循环接收
+//    吞吐按整批耗时算；单包延迟 = 主线程收到时刻 - 后端线程 emit 时刻
+void benchCrossThread(BenchRunner &runner, int repeats)
+{
+    const int count = 20000;
+    QThread thread;
+    thread.setObjectName("bench-backend");
+    BenchBackend backend;
+    backend.moveToThread(&thread);
+    thread.start();
+
+    QObject receiver;
+    int received = 0;
+    LatencyStats latency(count);
+    QObject::connect(&backend, &IBackend::waveDataReceived, &receiver,
+                     [&](const WaveformPacket &packet) {
+                         received++;
+                         // emit 先于投递入队，读 sentNs 不需要额外同步
+                         latency.add(LatencyTracer::nowNs() - backend.sentNs().at(packet.tick_us));
+                     }, Qt::QueuedConnection);
+
+    QVector<double> nsPerPacket;
+    for (int r = 0; r < repeats; r++) {
+        received = 0;
+        backend.prepareBurst(count);
+        const qint64 burstStart = LatencyTracer::nowNs();
+        QMetaObject::invokeMethod(&backend, "burstWaves", Qt::QueuedConnection, Q_ARG(int, count));
+        while (received < count) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        nsPerPacket.append((double)(LatencyTracer::nowNs() - burstStart) / count);
+    }
+    thread.quit();
+    thread.wait();
+    std::sort(nsPerPacket.begin(), nsPerPacket.end());
+
+    const LatencyStats::Summary s = latency.summary();
+    QJsonObject result;
+    result["name"] = "signal/cross_thread_waveform";
+    result["ops"] = (double)count * repeats;
+    result["ns_per_op_median"] = nsPerPacket.at(nsPerPacket.size() / 2);
+    result["ns_per_op_min"] = nsPerPacket.first();
+    result["ns_per_op_max"] = nsPerPacket.last();
+    result["latency_p50_ns"] = (double)s.p50;
+    result["latency_p99_ns"] = (double)s.p99;
+    result["latency_max_ns"] = (double)s.max;
+    runner.addResult(result);
+}
+
+// 6. 旋钮：面板帧 -> KnobInputHandler (后端线程) -> updateParameters
+//    逐帧等控制包发出再喂下一帧，测的是单帧延迟而不是合并后的吞吐
+void benchKnob(BenchRunner &runner)
+{
+    const int frames = 2000;
+    QThread thread;
+    thread.setObjectName("bench-backend");
+    BenchBackend backend;
+    KnobInputHandler knob(&backend);
+    backend.moveToThread(&thread);
+    knob.moveToThread(&thread);
+    thread.start();
+    QMetaObject::invokeMethod(&knob, [&knob]() { knob.setMode(KnobInputHandler::Fixed); }, Qt::BlockingQueuedConnection);
+
+    ButtonBackend button;
+    QObject::connect(&button, &ButtonBackend::knobRotated, &button,
+                     [&knob](int detents, qint64 rxNs) { knob.addDelta(detents, rxNs); }, Qt::DirectConnection);
+
+    // 先让分帧器记住初始计数
+    button.processBytes(makeButtonFrame(BTN_CMD_KNOB, 0));
+    int timeouts = 0;
+    for (int i = 1; i <= frames; i++) {
+        const int before = backend.updates();
+        // 来回拧，避免幅值被夹在上下限
+        const uint8_t value = (uint8_t)((i / 50) % 2 == 0 ? (i % 50) : 50 - (i % 50));
+        button.processBytes(makeButtonFrame(BTN_CMD_KNOB, value));
+        QDeadlineTimer deadline(100);
+        while (backend.updates() == before && !deadline.hasExpired()) {
+            QThread::yieldCurrentThread();
+        }
+        if (backend.updates() == before) timeouts++;
+    }
+    thread.quit();
+    thread.wait();
+
+    const LatencyStats::Summary s = knob.latency();
+    QJsonObject result;
+    result["name"] = "knob/frame_to_control";
+    result["ops"] = (double)s.count;
+    result["latency_p50_ns"] = (double)s.p50;
+    result["latency_p99_ns"] = (double)s.p99;
+    result["latency_max_ns"] = (double)s.max;
+    result["bound_ns"] = (double)KNOB_LATENCY_BOUND_US * 1000;
+    result["within_bound"] = s.max <= (qint64)KNOB_LATENCY_BOUND_US * 1000 && timeouts == 0;
+    result["timeouts"] = timeouts;
+    runner.addResult(result);
+}
+
+// 7. 多通道扩展：N 个后端各占一个采集线程同时发包，在通道线程上做校验
+//    总吞吐 / (N × 单通道吞吐) 即扩展效率，核数以内应接近 1
+void benchDevices(BenchRunner &runner, int repeats)
+{
+    const int count = 20000;
+    double singleRate = 0.0;
+    for (int n = 1; n <= QThread::idealThreadCount(); n *= 2) {
+        DeviceManager devices(n);
+        QVector<BenchBackend *> backends;
+        for (int i = 0; i < n; i++) {
+            BenchBackend *backend = new BenchBackend();
+            backends.append(backend);
+            devices.addDevice(backend, []() { return true; });
+        }
+        // 各通道线程各算各的，不共享计数，避免伪共享拖累扩展性
+        QObject::connect(&devices, &DeviceManager::channelWaveReceived, &devices,
+                         [](int, const WaveformPacket &packet) {
+                             bool valid = packetValid(packet);
+                             benchKeep(valid);
+                         }, Qt::DirectConnection);
+        devices.start();
+
+        QVector<double> rates;
+        for (int r = 0; r < repeats; r++) {
+            quint64 target = 0;
+            for (int i = 0; i < n; i++) {
+                backends[i]->prepareBurst(count);
+                target += devices.channelWavePackets(i) + count;
+            }
+            const qint64 t0 = LatencyTracer::nowNs();
+            for (BenchBackend *backend : backends) {
+                QMetaObject::invokeMethod(backend, "burstWaves", Qt::QueuedConnection, Q_ARG(int, count));
+            }
+            for (;;) {
+                quint64 got = 0;
+                for (int i = 0; i < n; i++) got += devices.channelWavePackets(i);
+                if (got >= target) break;
+                QThread::yieldCurrentThread();
+            }
+            rates.append((double)count * n * 1e9 / (double)(LatencyTracer::nowNs() - t0));
+        }
+        devices.shutdown();
+        std::sort(rates.begin(), rates.end());
+        const double rate = rates.at(rates.size() / 2);
+        if (n == 1) singleRate = rate;
+
+        QJsonObject result;
+        result["name"] = QString("devices/fanout_%1").arg(n);
+        result["ops"] = (double)count * n * repeats;
+        result["ns_per_op_median"] = 1e9 / rate;
+        result["packets_per_sec"] = rate;
+        result["scaling_efficiency"] = singleRate > 0.0 ? rate / (n * singleRate) : 1.0;
+        runner.addResult(result);
+    }
+}
+
+// 8. 稳态零分配：后端线程发包 -> UplinkPipe -> TreatmentService -> TreatmentManager 发出
+//    先跑一轮预热 (线程本地缓冲、指标槽位、惰性初始化)，再开计数跑一轮，期间任何线程分配一次即失败
+bool benchAllocations(BenchRunner &runner)
+{
+    const int warmup = 2000;
+    const int count = 20000;
+    const int window = 64;
+    QThread thread;
+    thread.setObjectName("bench-backend");
+    BenchBackend backend;
+    backend.moveToThread(&thread);
+    thread.start();
+
+    TreatmentService service(&backend);
+    // BenchBackend 发的是相同的零批次，空闲时会被省电策略整包压掉，消费计数永远到不了
+    service.power()->setActive(true);
+    TreatmentManager manager(&service);
+    std::atomic<int> consumed(0);
+    QObject::connect(&manager, &TreatmentManager::waveformReceived, &manager,
+                     [&consumed](const QList<float> &data) {
+                         benchKeep(data.constData()[0]);
+                         consumed.fetch_add(1);
+                     });
+
+    quint64 allocations = 0;
+    for (int round = 0; round < 2; round++) {
+        const int n = round == 0 ? warmup : count;
+        const int target = consumed.load() + n;
+        std::atomic<bool> go(false);
+        // 投递本身会分配，放在开始计数之前
+        QMetaObject::invokeMethod(&backend, [&backend, n, window, &go, &consumed]() {
+            backend.streamWaves(n, window, go, consumed);
+        }, Qt::QueuedConnection);
+        if (round == 1) AllocCounter::arm();
+        go.store(true);
+        while (consumed.load() < target) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        if (round == 1) allocations = AllocCounter::disarm();
+    }
+    thread.quit();
+    thread.wait();
+
+    QJsonObject result;
+    result["name"] = "alloc/steady_state_pipeline";
+    result["ops"] = count;
+    result["allocations"] = (double)allocations;
+    result["allocated_bytes"] = (double)AllocCounter::bytes();
+    result["first_alloc_tid"] = (double)AllocCounter::firstThreadId();
+    result["passed"] = allocations == 0;
+    runner.addResult(result);
+    if (allocations > 0) {
+        qWarning().noquote() << QString("[alloc] %1 allocation(s) (%2 bytes) in steady state, first on tid %3")
+                                    .arg(allocations).arg(AllocCounter::bytes()).arg(AllocCounter::firstThreadId());
+    }
+    return allocations == 0;
+}
+
+// 16. 程序表幅值检查 (不计时)：四个幅值 (正相起止、负相起止) 各试 NaN / 负值 / 超上限，
+//     每一例都必须被 appendChecked 拒绝；0 和上限本身必须能通过
+bool checkProgramLimits(BenchRunner &runner)
+{
+    StimulationParam base;
+    base.freq = 100;
+    base.posAmp = 10.0f;
+    base.negAmp = 10.0f;
+    base.posW = 200;
+    base.negW = 200;
+    base.dead = 50;
+    const float bad[3] = { std::numeric_limits<float>::quiet_NaN(), -1.0f, KNOB_AMP_MAX_MA + 1.0f };
+    const char *const fields[4] = { "pos_start", "pos_end", "neg_start", "neg_end" };
+
+    int cases = 0;
+    QJsonArray failed;
+    for (int field = 0; field < 4; field++) {
+        for (float value : bad) {
+            StimulationParam param = base;
+            float endPos = base.posAmp;
+            float endNeg = base.negAmp;
+            if (field == 0) param.posAmp = value;
+            if (field == 1) endPos = value;
+            if (field == 2) param.negAmp = value;
+            if (field == 3) endNeg = value;
+            StimulationProgram program;
+            cases++;
+            if (program.appendRamp(param, endPos, endNeg, 1000)) {
+                failed.append(QString("%1=%2 accepted").arg(fields[field]).arg(value));
+            }
+        }
+    }
+    StimulationParam edge = base;
+    edge.posAmp = 0.0f;
+    edge.negAmp = KNOB_AMP_MAX_MA;
+    StimulationProgram program;
+    cases++;
+    if (!program.appendRamp(edge, KNOB_AMP_MAX_MA, 0.0f, 1000)) {
+        failed.append(QString("limits rejected: %1").arg(program.lastError()));
+    }
+
+    QJsonObject result;
+    result["name"] = "check/program_amplitude_limits";
+    result["cases"] = cases;
+    result["failed"] = failed;
+    result["passed"] = failed.isEmpty();
+    runner.addResult(result);
+    for (const QJsonValue &f : failed) qWarning().noquote() << "[check] program amplitude:" << f.toString();
+    return failed.isEmpty();
+}
+
+// 9. 触发扫描：100Hz 双相脉冲，每包 50 点
+//    no_fire 电平高于峰值，只走块内 min/max 快速跳过；firing 每个周期触发一次，含拼帧和 emit
+void benchTrigger(BenchRunner &runner)
+{
+    const int blocks = 64;
+    QVector<float> stream(blocks * WAVEFORM_BATCH_SIZE);
+    for (int i = 0; i < stream.size(); i++) {
+        const int phase = i % 100;
+        stream[i] = phase < 5 ? 20.0f : (phase < 10 ? -20.0f : 0.05f * (float)(i % 7));
+    }
+    TriggerEngine engine;
+    quint64 captured = 0;
+    QObject::connect(&engine, &TriggerEngine::captured, &engine,
+                     [&captured](const QVector<float> &samples, int, bool) { captured += samples.size(); });
+
+    TriggerEngine::Config config;
+    config.mode = TriggerEngine::Normal;
+    config.type = TriggerEngine::Rising;
+    config.level = 30.0f;
+    config.preSamples = 20;
+    config.postSamples = 60;
+    engine.setConfig(config);
+    runner.run("trigger/scan_no_fire", [&] {
+        for (int b = 0; b < blocks; b++) engine.process(stream.constData() + b * WAVEFORM_BATCH_SIZE, WAVEFORM_BATCH_SIZE);
+    }, blocks);
+
+    config.level = 10.0f;
+    engine.setConfig(config);
+    runner.run("trigger/scan_firing", [&] {
+        for (int b = 0; b < blocks; b++) engine.process(stream.constData() + b * WAVEFORM_BATCH_SIZE, WAVEFORM_BATCH_SIZE);
+    }, blocks);
+    benchKeep(captured);
+}
+
+// 10. PID 调谐：单个候选的恒流环仿真 (3 个 100Hz 脉冲)，以及 256 个候选的并行评估
+void benchTuner(BenchRunner &runner)
+{
+    PidTuner tuner;
+    CurrentLoopModel model;
+    PIDParam pid;
+    pid.kp = 0.75f;
+    pid.ki = 100000.0f;
+    pid.limit = 30.0f;
+    model.setPid(pid);
+    float peak = 0.0f;
+    runner.run("tuner/model_candidate", [&] {
+        peak += model.runPulses(tuner.pulse(), 3).peakMa;
+    });
+    benchKeep(peak);
+
+    const QVector<PIDParam> grid = PidTuner::grid(PidTuner::Range(0.05f, 20.0f, 16, true),
+                                                  PidTuner::Range(100.0f, 1e6f, 16, true),
+                                                  PidTuner::Range(0.0f, 0.0f, 1), 30.0f);
+    double best = 0.0;
+    runner.run("tuner/evaluate_256", [&] {
+        best += PidTuner::rank(tuner.evaluate(grid), 1).first().score;
+    }, grid.size());
+    benchKeep(best);
+}
+
+// 11. 下行命令队列：主线程提交 -> 采集线程执行 -> 完成回报的往返，
+//     以及积压一串参数更新后再发停止：更新被合并/取消，停止的等待不随积压增长
+void benchCommands(BenchRunner &runner)
+{
+    DeviceManager devices(1);
+    devices.addDevice(new BenchBackend(), []() { return true; });
+    std::atomic<quint64> finished{0};
+    QObject::connect(&devices, &IBackend::commandFinished, &devices,
+                     [&finished](const CommandResult &result) { finished.store(result.id); }, Qt::DirectConnection);
+    devices.start();
+
+    StimulationParam param;
+    auto waitFor = [&](quint64 id) {
+        while (finished.load() < id) QThread::yieldCurrentThread();
+    };
+    runner.run("command/update_roundtrip", [&] {
+        devices.updateParameters(param);
+        waitFor(devices.lastCommandId());
+    });
+    runner.run("command/stop_behind_100_updates", [&] {
+        for (int i = 0; i < 100; i++) {
+            param.posAmp = (float)i;
+            devices.updateChannelParameters(0, param);
+        }
+        devices.stopStimulation();
+        waitFor(devices.lastCommandId());
+    });
+    devices.shutdown();
+}
+
+// 12. 离线分析：4 个各 20000 条记录的合成治疗记录 (100Hz 双相 10mA，每 20 包一个状态包)，
+//     映射 + 建索引 + 分块分析 + 合并的整体吞吐，按记录数计
+void benchAnalyze(BenchRunner &runner)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) return;
+    StimulationParam param;
+    param.freq = 100;
+    param.posAmp = 10.0f;
+    param.negAmp = 10.0f;
+    param.posW = 200;
+    param.negW = 200;
+    param.dead = 50;
+    const int sessions = 4;
+    const int records = 20000;
+    QStringList files;
+    for (int n = 0; n < sessions; n++) {
+        SessionRecorder recorder;
+        recorder.setDirectory(dir.filePath(QString::number(n)));
+        recorder.begin(ESES_MODE_STIM, param, 0);
+        WaveformPacket wave = {};
+        StatusPacket status = {};
+        status.impedance = 50;
+        for (int i = 0; i < records; i++) {
+            if (i % 20 == 19) {
+                recorder.record(status);
+                continue;
+            }
+            wave.tick_us += 50000;
+            for (int k = 0; k < WAVEFORM_BATCH_SIZE; k++) {
+                wave.adc_batch[k] = k >= 5 && k < 15 ? 10.0f : (k >= 18 && k < 28 ? -10.0f : 0.0f);
+            }
+            recorder.record(wave);
+        }
+        files.append(recorder.currentPath());
+        recorder.end();
+        recorder.waitWritten();
+    }
+
+    SessionAnalyzer analyzer;
+    double conformity = 0.0;
+    runner.run("analyze/sessions_4x20k", [&] {
+        for (const SessionAnalyzer::Report &r : analyzer.analyze(files)) conformity += r.conformityPct();
+    }, sessions * records);
+    benchKeep(conformity);
+}
+
+// 13. 共享执行器：单个任务提交到完成的往返，以及 1024 个元素按 16 切块的 parallelFor 开销
+void benchExecutor(BenchRunner &runner)
+{
+    TaskExecutor &executor = TaskExecutor::instance();
+    std::atomic<quint64> sink{0};
+    runner.run("exec/submit_wait", [&] {
+        executor.submit([&sink](TaskExecutor::Context &) { sink.fetch_add(1, std::memory_order_relaxed); }).wait();
+    });
+    runner.run("exec/parallel_for_1k", [&] {
+        executor.parallelFor(1024, 16, [&sink](int begin, int end) {
+            sink.fetch_add(end - begin, std::memory_order_relaxed);
+        });
+    }, 1024);
+    benchKeep((double)sink.load());
+}
+
+// 14. 二进制日志：调用点开销 (只计生产端写环；环比一批大，计时外排空，不会因环满走丢弃路径)，
+//     以及被级别过滤掉的调用
+void benchLogging(BenchRunner &runner)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) return;
+    BinLog &log = BinLog::instance();
+    BinLog::setLevel(BinLog::Info);
+    log.setDirectory(dir.path());
+    const int batch = BinLog::RING_ENTRIES / 2;
+    float amp = 10.0f;
+    runner.runManual("log/binlog_3args", [&]() -> qint64 {
+        log.flush();
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < batch; i++) LOG_INFO("bench", "tick {} amp {.2} state {}", i, amp, "RUNNING");
+        return timer.nsecsElapsed();
+    }, batch);
+    runner.run("log/binlog_filtered", [&] {
+        for (int i = 0; i < batch; i++) LOG_DEBUG("bench", "tick {} amp {.2}", i, amp);
+    }, batch);
+    log.setDirectory(QString());
+    benchKeep(log.dropped());
+}
+
+// 15. 实时数据外发：写端连续写 N 条波形，同时 0/1/2/4 个订阅线程读同一段共享内存
+//    写端每条耗时应与订阅端数量无关；订阅端跟不上时记丢失，不拖慢写端
+void benchLiveStream(BenchRunner &runner)
+{
+#ifdef Q_OS_LINUX
+    const int count = 200000;
+    const QString name = QString("ele_sti_bench_live_%1").arg(QCoreApplication::applicationPid());
+    WaveformPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) packet.adc_batch[i] = (float)i;
+
+    for (int readers : { 0, 1, 2, 4 }) {
+        LiveStreamWriter writer;
+        if (!writer.create(name)) return;
+        std::atomic<bool> done{false};
+        std::atomic<int> ready{0};
+        QVector<quint64> reads(readers, 0);
+        QVector<quint64> losts(readers, 0);
+        QVector<QThread *> threads;
+        for (int r = 0; r < readers; r++) {
+            threads.append(QThread::create([&, r]() {
+                LiveStreamReader reader;
+                const bool opened = reader.open(name);
+                ready.fetch_add(1);
+                if (!opened) return;
+                LiveWaveRecord record;
+                quint64 got = 0;
+                for (;;) {
+                    if (reader.nextWave(record)) {
+                        got++;
+                        continue;
+                    }
+                    if (done.load(std::memory_order_acquire) && reader.waveBacklog() == 0) break;
+                    QThread::yieldCurrentThread();
+                }
+                reads[r] = got;
+                losts[r] = reader.waveLost();
+            }));
+            threads.last()->start();
+        }
+        while (ready.load() < readers) QThread::yieldCurrentThread();
+
+        const qint64 t0 = LatencyTracer::nowNs();
+        for (int i = 0; i < count; i++) {
+            packet.tick_us = (uint32_t)i;
+            writer.writeWave(0, packet, t0);
+        }
+        const qint64 elapsed = LatencyTracer::nowNs() - t0;
+        done.store(true, std::memory_order_release);
+        for (QThread *thread : threads) {
+            thread->wait();
+            delete thread;
+        }
+        writer.close();
+
+        QJsonObject result;
+        result["name"] = QString("live/fanout_%1").arg(readers);
+        result["ops"] = (double)count;
+        // 每种订阅数只跑一轮 (订阅线程要跟写端同时起停)，给的是这一轮的均值，不是多轮中位数
+        result["ns_per_op_mean"] = (double)elapsed / count;
+        result["records_per_sec"] = count * 1e9 / (double)qMax<qint64>(1, elapsed);
+        QJsonArray perReader;
+        for (int r = 0; r < readers; r++) {
+            QJsonObject o;
+            o["read"] = (double)reads[r];
+            o["lost"] = (double)losts[r];
+            perReader.append(o);
+        }
+        result["readers"] = perReader;
+        runner.addResult(result);
+    }
+#else
+    Q_UNUSED(runner);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ele_sti_bench");
+    // 基准只关心被测代码本身，关掉事件记录
+    TraceRecorder::instance().setEnabled(false);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption filterOpt("filter", "Only run cases whose name contains <text>.", "text");
+    QCommandLineOption minTimeOpt("min-time", "Minimum time per repeat in ms.", "ms", "200");
+    QCommandLineOption repeatsOpt("repeats", "Number of timed repeats.", "n", "5");
+    QCommandLineOption outOpt("out", "Write JSON to <file> instead of stdout.", "file");
+    parser.addOptions({ filterOpt, minTimeOpt, repeatsOpt, outOpt });
+    parser.process(app);
+
+    const int repeats = qMax(1, parser.value(repeatsOpt).toInt());
+    BenchRunner runner(qMax(1, parser.value(minTimeOpt).toInt()), repeats);
+    runner.setFilter(parser.value(filterOpt));
+
+    // 每项列出它产出的用例名，过滤串命中任意一个才跑；cases 为空的由 runner 逐个用例过滤
+    // fn 返回 false 表示稳态分配或 check/* 检查失败
+    struct BenchEntry {
+        QStringList cases;
+        bool (*fn)(BenchRunner &runner, int repeats);
+    };
+    const BenchEntry entries[] = {
+        { {}, [](BenchRunner &r, int) { benchChecksum(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchDispatch(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchButtonFraming(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchServiceConversion(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchTrigger(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchTuner(r); return true; } },
+        { {}, [](BenchRunner &r, int) { benchExecutor(r); return true; } },
+        { { "log/binlog_3args", "log/binlog_filtered" }, [](BenchRunner &r, int) { benchLogging(r); return true; } },
+        { { "analyze/sessions_4x20k" }, [](BenchRunner &r, int) { benchAnalyze(r); return true; } },
+        { { "command/update_roundtrip", "command/stop_behind_100_updates" },
+          [](BenchRunner &r, int) { benchCommands(r); return true; } },
+        { { "signal/cross_thread_waveform" }, [](BenchRunner &r, int n) { benchCrossThread(r, n); return true; } },
+        { { "knob/frame_to_control" }, [](BenchRunner &r, int) { benchKnob(r); return true; } },
+        { { "devices/fanout" }, [](BenchRunner &r, int n) { benchDevices(r, n); return true; } },
+        { { "live/fanout" }, [](BenchRunner &r, int) { benchLiveStream(r); return true; } },
+        { { "alloc/steady_state_pipeline" }, [](BenchRunner &r, int) { return benchAllocations(r); } },
+        { { "check/program_amplitude_limits" }, [](BenchRunner &r, int) { return checkProgramLimits(r); } },
+    };
+
+    const QString filter = parser.value(filterOpt);
+    bool allOk = true;
+    for (const BenchEntry &entry : entries) {
+        bool selected = filter.isEmpty() || entry.cases.isEmpty();
+        for (const QString &name : entry.cases) selected = selected || name.contains(filter);
+        if (selected) allOk = entry.fn(runner, repeats) && allOk;
+    }
+
+    QJsonObject host;
+    host["cpu_arch"] = QSysInfo::currentCpuArchitecture();
+    host["kernel"] = QSysInfo::kernelType() + " " + QSysInfo::kernelVersion();
+    host["product"] = QSysInfo::prettyProductName();
+    host["cores"] = QThread::idealThreadCount();
+    host["qt"] = QString(qVersion());
+
+    QJsonObject root;
+    root["tool"] = "ele_sti_bench";
+    root["host"] = host;
+    root["results"] = runner.results();
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outOpt)) {
+        QFile file(parser.value(outOpt));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "Cannot write" << parser.value(outOpt);
+            return 1;
+        }
+        file.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    // 稳态分配检查或 check/* 失败时返回非零，CI 直接据此判失败
+    return allOk ? 0 : 2;
+}
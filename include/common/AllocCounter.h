@@ -0,0 +1,34 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:30:06
+ * @FilePath: \ele_sti\include\common\AllocCounter.h
+ * @Description: 堆分配计数：用于检查稳态采集链路是否零分配
+ */
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * @brief 全局分配计数器
+ * @note  AllocCounter.cpp 不在 ele_sti_core 里，只作为源文件编进基准和无界面守护进程
+ *        (CMakeLists.txt 的 ALLOC_COUNTER_SOURCES)，GUI 程序的链接行上根本没有替换版分配函数。
+ *        glibc 下接管 malloc/calloc/realloc/memalign，Qt 容器的分配也能计到；
+ *        其他平台只替换 operator new，直接 malloc 的不计。
+ *        arm() 之后所有线程的分配都计数；计数本身不分配内存，可以在任何线程调用。
+ */
+namespace AllocCounter {
+
+// 开始计数 (清零)
+void arm();
+// 停止计数，返回 arm 以来的分配次数
+quint64 disarm();
+bool isArmed();
+// arm 以来的分配次数 / 字节数
+quint64 count();
+quint64 bytes();
+// arm 以来第一次分配发生的线程号 (Linux gettid)，没有分配时为 0
+long firstThreadId();
+
+} // namespace AllocCounter
@@ -0,0 +1,44 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 02:05:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 02:05:31
+ * @FilePath: \ele_sti\include\common\CpuPlan.h
+ * @Description: CPU 核规划：界面渲染 / 采集 / 后台分析各用哪些核，以及线程绑核
+ */
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 核规划
+ * @note  默认 (N 个在线核)：
+ *          N >= 3：核 0 留给界面和渲染，最后 a 个核给采集 (a = 采集线程数，最多 N-2)，中间的给后台；
+ *          N == 2：核 0 界面，核 1 采集，后台与界面共用核 0 (绝不占采集核)；
+ *          N == 1：全部共用。
+ *        RK3568 单通道：渲染 {0}，后台 {1,2}，采集 {3}。
+ *        环境变量 ELE_STI_CPU_PLAN 可覆盖，格式 "render=0;rt=3;bg=1,2"。
+ *        离线工具不跑采集和界面，用 offline() 把全部核给后台。
+ *        绑核只在 Linux 上生效，其他平台 pinCurrentThread 返回 false，线程照常由系统调度。
+ */
+struct CpuPlan {
+    QVector<int> render;     // 界面线程 + 场景图渲染线程
+    QVector<int> realtime;   // 采集线程
+    QVector<int> background; // 共享任务执行器
+
+    static int onlineCores();
+    static CpuPlan detect(int acquisitionThreads);
+    static CpuPlan offline();
+    // "render=0;rt=3;bg=1,2"，缺的项保持 out 原值
+    static bool parse(const QString &spec, CpuPlan &out);
+
+    // 进程级当前规划，启动时设置一次；没设置时为 detect(1)
+    static CpuPlan current();
+    static void setCurrent(const CpuPlan &plan);
+
+    // 把调用线程绑到 cores 上，cores 为空时不动
+    static bool pinCurrentThread(const QVector<int> &cores);
+
+    QString toString() const;
+};
@@ -0,0 +1,33 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 17:52:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 17:52:18
+ * @FilePath: \ele_sti\include\common\EimgFormat.h
+ * @Description: 预缩放图片格式 (.eimg)：文件头 + zlib 压缩的原始像素，解码只需解压和拷贝
+ */
+#pragma once
+
+#include <cstdint>
+
+#define EIMG_MAGIC   0x474D4945u  // "EIMG" (小端)
+#define EIMG_VERSION 1
+
+// 像素格式，取值与 QImage::Format 相同，解码端可以直接构造 QImage
+#define EIMG_FORMAT_RGB32        4  // QImage::Format_RGB32，不透明图
+#define EIMG_FORMAT_ARGB32_PREMUL 6 // QImage::Format_ARGB32_Premultiplied，带透明通道
+
+#pragma pack(push,1)
+struct EimgHeader {
+    uint32_t magic;          // EIMG_MAGIC
+    uint16_t version;        // EIMG_VERSION
+    uint16_t format;         // EIMG_FORMAT_*
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_line;
+    uint32_t raw_size;       // 解压后的像素字节数 = bytes_per_line * height
+};
+#pragma pack(pop)
+
+// 构建期生成的清单在资源里的位置，变体文件与清单同目录
+#define EIMG_MANIFEST_PATH ":/assets/manifest.json"
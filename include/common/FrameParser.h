@@ -0,0 +1,182 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 18:30:44
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 18:30:44
+ * @FilePath: \ele_sti\include\common\FrameParser.h
+ * @Description: 字节流分帧器：定长环形缓冲 + 帧格式策略，负责重同步、校验和计数
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "common/protocol_data.h"
+
+// ---------------- 校验策略 ----------------
+
+// 不校验
+struct NoChecksum {
+    static bool verify(const uint8_t *, size_t) { return true; }
+};
+
+// 累加和：frame[Offset] == 前 Offset 个字节之和 (与 calculateChecksum 一致)
+template <size_t Offset>
+struct SumChecksumAt {
+    static bool verify(const uint8_t *frame, size_t len)
+    {
+        return Offset < len && calculateChecksum(frame, (int)Offset) == frame[Offset];
+    }
+};
+
+// ---------------- 帧格式策略 ----------------
+
+/**
+ * @brief 定长帧：固定帧头、可选帧尾 (Tail < 0 表示没有)、校验策略
+ * @note  策略需要提供：
+ *        Frame            解出的帧类型 (按字节拷贝)
+ *        MAX_FRAME        最长帧字节数
+ *        HEADER_BYTES     判断帧长需要的字节数
+ *        isHead(b)        是否是帧头字节
+ *        frameLength(p)   由前 HEADER_BYTES 个字节得到帧长，0 表示非法
+ *        validate(p, len) 整帧校验 (帧尾 + 校验和)
+ *        变长协议只需换一个 frameLength 从长度字段取值的策略
+ */
+template <typename FrameT, uint8_t Head, int Tail, typename Checksum>
+struct FixedFramePolicy {
+    using Frame = FrameT;
+    static const size_t MAX_FRAME = sizeof(FrameT);
+    static const size_t HEADER_BYTES = 1;
+
+    static bool isHead(uint8_t b) { return b == Head; }
+    static size_t frameLength(const uint8_t *) { return sizeof(FrameT); }
+    static bool validate(const uint8_t *frame, size_t len)
+    {
+        if (Tail >= 0 && frame[len - 1] != (uint8_t)Tail) return false;
+        return Checksum::verify(frame, len);
+    }
+};
+
+/**
+ * @brief 环形缓冲分帧器
+ * @note  Capacity 必须是 2 的幂且不小于最长帧；读写位置只做加法，
+ *        不从缓冲前端删除数据，也不按帧分配内存。
+ *        缓冲满之前一定能解出一帧或丢掉坏字节，所以不会因溢出丢掉合法帧。
+ *        非线程安全，由所属后端的线程独占使用。
+ */
+template <typename Policy, size_t Capacity = 256>
+class FrameParser
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(Capacity >= Policy::MAX_FRAME, "Capacity must hold at least one frame");
+
+public:
+    using Frame = typename Policy::Frame;
+
+    struct Counters {
+        uint64_t frames = 0;       // 校验通过的帧
+        uint64_t resyncs = 0;      // 从失步到重新对齐帧头的次数
+        uint64_t badFrames = 0;    // 帧头对但帧长/帧尾/校验不对
+        uint64_t droppedBytes = 0; // 重同步时丢掉的字节
+    };
+
+    FrameParser() : m_read(0), m_write(0), m_inSync(true) {}
+
+    /**
+     * @brief 喂入一段字节，每解出一帧调用一次 onFrame(const Frame &)
+     */
+    template <typename Fn>
+    void feed(const uint8_t *data, size_t len, Fn &&onFrame)
+    {
+        while (len > 0) {
+            const size_t room = Capacity - (m_write - m_read);
+            const size_t n = len < room ? len : room;
+            copyIn(data, n);
+            data += n;
+            len -= n;
+            parse(onFrame);
+        }
+    }
+
+    const Counters &counters() const { return m_counters; }
+    size_t buffered() const { return m_write - m_read; }
+
+    void reset()
+    {
+        m_read = m_write = 0;
+        m_inSync = true;
+    }
+
+private:
+    void copyIn(const uint8_t *data, size_t n)
+    {
+        const size_t pos = m_write & (Capacity - 1);
+        const size_t first = n < Capacity - pos ? n : Capacity - pos;
+        memcpy(m_buf + pos, data, first);
+        memcpy(m_buf, data + first, n - first);
+        m_write += n;
+    }
+
+    void copyOut(size_t offset, uint8_t *out, size_t n) const
+    {
+        const size_t pos = (m_read + offset) & (Capacity - 1);
+        const size_t first = n < Capacity - pos ? n : Capacity - pos;
+        memcpy(out, m_buf + pos, first);
+        memcpy(out + first, m_buf, n - first);
+    }
+
+    uint8_t at(size_t offset) const { return m_buf[(m_read + offset) & (Capacity - 1)]; }
+
+    void dropByte()
+    {
+        if (m_inSync) {
+            m_inSync = false;
+            m_counters.resyncs++;
+        }
+        m_counters.droppedBytes++;
+        m_read++;
+    }
+
+    template <typename Fn>
+    void parse(Fn &onFrame)
+    {
+        uint8_t frame[Policy::MAX_FRAME];
+        for (;;) {
+            // 1. 对齐帧头
+            while (buffered() > 0 && !Policy::isHead(at(0))) dropByte();
+            if (buffered() < Policy::HEADER_BYTES) return;
+
+            // 2. 帧长
+            uint8_t header[Policy::HEADER_BYTES];
+            copyOut(0, header, Policy::HEADER_BYTES);
+            const size_t len = Policy::frameLength(header);
+            if (len < Policy::HEADER_BYTES || len > Policy::MAX_FRAME) {
+                m_counters.badFrames++;
+                dropByte();
+                continue;
+            }
+            if (buffered() < len) return;
+
+            // 3. 校验：失败只丢掉这个帧头，从下一个字节重新找
+            copyOut(0, frame, len);
+            if (!Policy::validate(frame, len)) {
+                m_counters.badFrames++;
+                dropByte();
+                continue;
+            }
+            m_read += len;
+            m_inSync = true;
+            m_counters.frames++;
+
+            Frame out = Frame();
+            memcpy(&out, frame, sizeof(Frame) < len ? sizeof(Frame) : len);
+            onFrame(out);
+        }
+    }
+
+    uint8_t m_buf[Capacity];
+    size_t m_read;   // 只增不减，取模得到下标
+    size_t m_write;
+    bool m_inSync;
+    Counters m_counters;
+};
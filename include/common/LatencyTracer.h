@@ -0,0 +1,149 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 13:05:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 13:05:18
+ * @FilePath: \ele_sti\include\common\LatencyTracer.h
+ * @Description: 端到端延迟追踪：各环节打时间戳，M0 时钟映射，滚动分位数统计
+ */
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief 滚动窗口延迟统计
+ * @note  保留最近 window 个样本，读取时现算 p50/p99/max，写入只是一次数组赋值
+ */
+class LatencyStats
+{
+public:
+    struct Summary {
+        qint64 count = 0; // 累计样本数
+        qint64 p50 = 0;   // ns
+        qint64 p99 = 0;   // ns
+        qint64 max = 0;   // ns (窗口内)
+    };
+
+    explicit LatencyStats(int window = 1024);
+    void add(qint64 ns);
+    Summary summary() const;
+    void reset();
+
+private:
+    mutable QMutex m_mutex;
+    QVector<qint64> m_samples;
+    int m_next;
+    qint64 m_count;
+};
+
+/**
+ * @brief M0 时钟 -> 上位机单调时钟 映射
+ * @note  offset = 接收时刻 - M0 时间戳，每个窗口取最小值 (排队最少的一次最接近真实偏移)，
+ *        再对最近几个窗口的最小值做最小二乘拟合，得到偏移和漂移。
+ *        映射结果包含固定的批采集时长，所以是"最早可能收到"的时刻。
+ */
+class ClockSync
+{
+public:
+    ClockSync();
+    void observe(uint32_t tickUs, qint64 hostNs);
+    bool isValid() const;
+    qint64 toHostNs(uint32_t tickUs) const;
+    double driftPpm() const;
+    void reset();
+
+private:
+    struct Point { qint64 tickNs; qint64 offsetNs; };
+    static const int WINDOW_US = 1000000; // 每 1 秒取一个最小偏移
+    static const int MAX_POINTS = 8;
+
+    mutable QMutex m_mutex;
+    bool m_hasTick;
+    uint32_t m_lastRaw;
+    qint64 m_lastTick64;     // 展开后的 M0 时间 (us)
+    qint64 m_windowStart;    // 当前窗口起点 (us)
+    Point m_windowMin;
+    QVector<Point> m_points;
+    double m_slope;          // 偏移随 M0 时间的变化率 (漂移)
+    double m_intercept;      // tickNs = m_refTickNs 时的偏移
+    qint64 m_refTickNs;
+    bool m_fitted;
+
+    void refit();
+};
+
+/**
+ * @brief 全链路延迟追踪 (单例)
+ * @note  采集链路：SPI 完成 -> 业务层 -> 控制器发射 -> QML 绘制
+ *        命令链路：业务层下发 -> SPI 写完 -> 下一个上行包 (视为 M0 已应答)
+ */
+class LatencyTracer
+{
+public:
+    enum Hop {
+        HopSpiToService,     // 后端收包 -> TreatmentService 处理
+        HopServiceToManager, // TreatmentService 处理 -> TreatmentManager 发射
+        HopManagerToPaint,   // TreatmentManager 发射 -> QML 绘制完成
+        HopSampleToPaint,    // M0 采样 -> QML 绘制完成 (全链路)
+        HopCmdIssueToSent,   // 命令下发 -> SPI 写完
+        HopCmdSentToAck,     // SPI 写完 -> 下一个上行包
+        HopCmdIssueToAck,    // 命令下发 -> 应答 (全链路)
+        HopCount
+    };
+
+    struct HopReport {
+        Hop hop;
+        const char *name;
+        LatencyStats::Summary stats;
+    };
+
+    static LatencyTracer &instance();
+    static qint64 nowNs();
+    static const char *hopName(Hop hop);
+
+    // --- 采集链路 ---
+    void markReceived(uint32_t tickUs, qint64 rxNs); // 后端线程
+    qint64 takeReceived(uint32_t tickUs);            // 找不到返回 0
+    void serviceHandled(uint32_t tickUs, qint64 handleNs);
+    void frameEmitted();
+    void framePainted();
+
+    // --- 命令链路 ---
+    void commandIssued(uint8_t cmd);
+    void commandSent();
+    void uplinkReceived();
+
+    void record(Hop hop, qint64 ns);
+    ClockSync &clock() { return m_clock; }
+    QVector<HopReport> report() const;
+    QString formatReport() const;
+    void reset();
+
+private:
+    LatencyTracer();
+
+    static const int RX_SLOTS = 64;
+    struct RxStamp {
+        std::atomic<uint32_t> tick;
+        std::atomic<qint64> ns;
+    };
+
+    LatencyStats m_stats[HopCount];
+    ClockSync m_clock;
+
+    RxStamp m_rx[RX_SLOTS];
+    std::atomic<uint32_t> m_rxNext;
+
+    // 当前帧 (GUI 线程)
+    qint64 m_frameOriginNs;
+    qint64 m_frameHandleNs;
+    qint64 m_frameEmitNs;
+
+    // 当前命令
+    std::atomic<qint64> m_cmdIssueNs;
+    std::atomic<qint64> m_cmdSentNs;
+};
@@ -0,0 +1,88 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\include\common\LiveFormat.h
+ * @Description: 实时数据共享内存布局：文件头 + 波形环 + 状态环，外部工具 (Python/MATLAB) 直接映射读取
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "common/protocol_data.h"
+
+#define ELIV_MAGIC   0x56494C45u  // "ELIV" (小端)
+#define ELIV_VERSION 1
+
+// 槽数必须是 2 的幂 (下标取模用掩码)
+#define ELIV_DEFAULT_WAVE_SLOTS   4096  // 20Hz 单通道约 200 秒，多通道/高速率时相应变短
+#define ELIV_DEFAULT_STATUS_SLOTS 1024
+
+/**
+ * @brief 共享内存文件头 (/dev/shm/<name>，偏移 0)
+ * @note  所有字段小端；发布方建好两段环后最后写 magic，读取方看到 magic 才开始读。
+ *        wave_head/status_head：已开始写入的记录总数 (单调递增，不回绕)，第 n 条在槽 n % slots。
+ *        publisher_pid + start_mono_ns 标识一次发布：发布方重启会重建共享内存，旧映射不再更新，
+ *        读取方在控制套接字断开时重新映射。
+ */
+struct LiveHeader {
+    uint32_t magic;            // ELIV_MAGIC
+    uint16_t version;          // ELIV_VERSION
+    uint16_t header_size;      // sizeof(LiveHeader)
+    uint32_t wave_offset;      // 波形环起始偏移
+    uint32_t wave_slots;
+    uint32_t wave_slot_size;   // sizeof(LiveWaveSlot)
+    uint32_t status_offset;
+    uint32_t status_slots;
+    uint32_t status_slot_size; // sizeof(LiveStatusSlot)
+    uint32_t samples_per_wave; // WAVEFORM_BATCH_SIZE
+    uint32_t publisher_pid;
+    int64_t  start_mono_ns;    // 发布开始时的 CLOCK_MONOTONIC
+    int64_t  start_epoch_ms;   // 同一时刻的墙钟
+    uint8_t  reserved[8];
+    alignas(64) std::atomic<uint64_t> wave_head;
+    alignas(64) std::atomic<uint64_t> status_head;
+};
+
+/**
+ * @brief 波形槽 (256 字节)
+ * @note  每槽一个序号锁 seq：写第 n 条时先置 2n+1，写完置 2n+2。
+ *        读第 n 条：读 seq == 2n+2 -> 拷出数据 -> 再读 seq 仍相等才有效；
+ *        seq < 2n+1 表示还没写到，== 2n+1 正在写，> 2n+2 表示已被套圈 (读得太慢)，这时跳到最新位置并记丢失数。
+ *        host_ns 为主机收到该包时的 CLOCK_MONOTONIC (与 tick_us 对照可以估计链路延迟)。
+ */
+struct alignas(64) LiveWaveSlot {
+    std::atomic<uint64_t> seq;
+    int64_t  host_ns;
+    uint32_t tick_us;          // M0 时间戳 (WaveformPacket::tick_us)
+    uint16_t channel;          // 通道号 (DeviceManager)
+    uint16_t count;            // 有效采样点数
+    float    samples[WAVEFORM_BATCH_SIZE]; // mA
+};
+
+/**
+ * @brief 状态槽 (32 字节)，序号锁规则同波形槽
+ */
+struct alignas(32) LiveStatusSlot {
+    std::atomic<uint64_t> seq;
+    int64_t  host_ns;
+    uint16_t channel;
+    uint8_t  impedance;
+    uint8_t  battery_pct;
+    uint16_t real_freq;
+    uint8_t  error_code;
+    uint8_t  reserved;
+};
+
+// 布局是对外协议，改动要升 ELIV_VERSION
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory ring needs lock-free 64-bit atomics");
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "atomic<uint64_t> must be a plain 8-byte word");
+static_assert(sizeof(LiveHeader) == 192, "LiveHeader layout changed, bump ELIV_VERSION");
+static_assert(offsetof(LiveHeader, wave_head) == 64 && offsetof(LiveHeader, status_head) == 128,
+              "LiveHeader head counters moved, bump ELIV_VERSION");
+static_assert(sizeof(LiveWaveSlot) == 256 && offsetof(LiveWaveSlot, samples) == 24,
+              "LiveWaveSlot layout changed, bump ELIV_VERSION");
+static_assert(sizeof(LiveStatusSlot) == 32 && offsetof(LiveStatusSlot, real_freq) == 20,
+              "LiveStatusSlot layout changed, bump ELIV_VERSION");
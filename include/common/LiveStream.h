@@ -0,0 +1,128 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\include\common\LiveStream.h
+ * @Description: 实时数据共享内存环：发布端 (采集线程直接写，不阻塞) 与订阅端 (任意个，只读映射)
+ */
+#pragma once
+
+#include <QString>
+#include <cstdint>
+#include "common/LiveFormat.h"
+
+// 订阅端拷出的一条记录 (不含序号锁)
+struct LiveWaveRecord {
+    uint64_t index;            // 记录序号
+    int64_t  hostNs;
+    uint32_t tickUs;
+    uint16_t channel;
+    uint16_t count;
+    float    samples[WAVEFORM_BATCH_SIZE];
+};
+
+struct LiveStatusRecord {
+    uint64_t index;
+    int64_t  hostNs;
+    uint16_t channel;
+    uint8_t  impedance;
+    uint8_t  batteryPct;
+    uint16_t realFreq;
+    uint8_t  errorCode;
+};
+
+/**
+ * @brief 发布端
+ * @note  多生产者：每个采集线程直接调用 writeWave/writeStatus，用原子加占一个序号再按序号锁写槽，
+ *        不加锁、不分配、不碰套接字；订阅端读得慢只会被套圈 (自己记丢失)，不会反压到写端。
+ *        共享内存只在 Linux 下可用，其他平台 create 返回 false，写调用为空操作。
+ */
+class LiveStreamWriter
+{
+public:
+    LiveStreamWriter();
+    ~LiveStreamWriter();
+
+    /**
+     * @brief 建共享内存 (/dev/shm/<name>)，同名的旧段 (上次异常退出留下的) 先删掉
+     * @param waveSlots/statusSlots 向上取 2 的幂
+     */
+    bool create(const QString &name, int waveSlots = ELIV_DEFAULT_WAVE_SLOTS, int statusSlots = ELIV_DEFAULT_STATUS_SLOTS);
+    // 解除映射并删除共享内存，已映射的订阅端仍能读到最后的数据；调用方保证已经没有线程在写
+    void close();
+    // 只删除名字，映射保留 (采集线程还可能在写)：退出时用，新的订阅端不会再连到这一段
+    void unlink();
+
+    bool isOpen() const { return m_header != nullptr; }
+    QString name() const { return m_name; }
+    const LiveHeader *header() const { return m_header; }
+    qint64 sizeBytes() const { return m_size; }
+
+    // --- 热路径 (任意线程) ---
+    void writeWave(int channel, const WaveformPacket &packet, int64_t hostNs);
+    void writeStatus(int channel, const StatusPacket &packet, int64_t hostNs);
+
+private:
+    LiveStreamWriter(const LiveStreamWriter &) = delete;
+    LiveStreamWriter &operator=(const LiveStreamWriter &) = delete;
+
+    QString m_name;
+    LiveHeader *m_header;
+    LiveWaveSlot *m_waves;
+    LiveStatusSlot *m_statuses;
+    uint64_t m_waveMask;
+    uint64_t m_statusMask;
+    qint64 m_size;
+};
+
+/**
+ * @brief 订阅端
+ * @note  只读映射，数量不限，彼此之间和与发布端之间都没有共享的可写状态。
+ *        nextWave/nextStatus 每次取一条，没有新数据时返回 false；
+ *        被套圈时跳到离最新位置半个环的地方继续，跳过的条数累计到 waveLost/statusLost。
+ *        默认从打开时的最新位置开始读；fromOldest 为 true 时先读环里还保留的历史数据。
+ */
+class LiveStreamReader
+{
+public:
+    LiveStreamReader();
+    ~LiveStreamReader();
+
+    bool open(const QString &name, bool fromOldest = false);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+    QString errorString() const { return m_error; }
+    const LiveHeader *header() const { return m_header; }
+
+    bool nextWave(LiveWaveRecord &out);
+    bool nextStatus(LiveStatusRecord &out);
+
+    // 已写入但还没读到的条数
+    uint64_t waveBacklog() const;
+    uint64_t statusBacklog() const;
+
+    quint64 waveLost() const { return m_waveLost; }
+    quint64 statusLost() const { return m_statusLost; }
+    quint64 overruns() const { return m_overruns; }
+
+private:
+    LiveStreamReader(const LiveStreamReader &) = delete;
+    LiveStreamReader &operator=(const LiveStreamReader &) = delete;
+
+    // 被套圈后的新读位置
+    uint64_t resync(const std::atomic<uint64_t> &head, uint64_t slots, uint64_t next, quint64 &lost);
+
+    QString m_error;
+    const LiveHeader *m_header;
+    const LiveWaveSlot *m_waves;
+    const LiveStatusSlot *m_statuses;
+    uint64_t m_waveMask;
+    uint64_t m_statusMask;
+    uint64_t m_waveNext;
+    uint64_t m_statusNext;
+    quint64 m_waveLost;
+    quint64 m_statusLost;
+    quint64 m_overruns;
+    qint64 m_size;
+};
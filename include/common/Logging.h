@@ -0,0 +1,224 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 03:12:44
+ * @FilePath: \ele_sti\include\common\Logging.h
+ * @Description: 异步二进制日志：调用点只把格式编号和原始参数写进本线程的无锁环，格式化和写文件在后台线程
+ */
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @brief 二进制日志 (单例)
+ * @note  调用点：LOG_INFO("WinBackend", "freq {} Hz, amp {.2} mA", freq, amp);
+ *          1) 级别低于阈值时只有一次原子读，参数都不求值；
+ *          2) 格式串在第一次执行到这里时登记成 16 位编号 (与 TRACE_SCOPE 同样的函数内 static)；
+ *          3) 条目 64 字节：时间戳 + 编号 + 最多 6 个参数的原始值，写进本线程的 SPSC 环，不加锁不分配。
+ *        环满时丢弃新条目并计数 (绝不阻塞采集线程)，后台线程下次输出时补一行丢弃数。
+ *        每线程的环 (512KB) 不释放：线程退出时交还给池，下一个新线程直接接着用 (环里没输出完的条目
+ *        照常输出)；同时存活的线程超过 MAX_THREADS 时多出来的线程共用一个只计丢弃的环。
+ *        后台线程 "binlog" 每 LOG_FLUSH_MS 排空一次所有环，格式化成文本写文件，超过 maxFileBytes 轮转，
+ *        保留 maxFiles 个旧文件；没设目录时写 stderr。
+ *        崩溃 (SIGSEGV/SIGABRT/SIGBUS/SIGFPE/SIGILL) 时信号处理函数用不分配的格式化把环里剩下的条目
+ *        直接 write 到日志文件再交回默认处理，最后几条不会丢。
+ *        占位符：{} 默认格式，{.N} 浮点固定 N 位小数，{x} 无符号十六进制。
+ *        字符串参数只存指针，只能传字符串字面量或进程内常驻的 const char*，不要传 QString。
+ *        阈值：环境变量 ELE_STI_LOG_LEVEL=debug|info|warn|error (默认 info)；目录：ELE_STI_LOG_DIR。
+ */
+class BinLog
+{
+public:
+    enum Level : uint8_t { Debug = 0, Info, Warn, Error };
+    enum ArgType : uint8_t { ArgInt = 0, ArgUInt, ArgDouble, ArgStr };
+
+    static const int MAX_ARGS = 6;
+    static const int RING_ENTRIES = 8192; // 每线程条目数，2 的幂 (512KB)
+    static const int MAX_THREADS = 64;
+    static const int MAX_FORMATS = 4096;
+    static const int LOG_FLUSH_MS = 20;
+
+    struct Entry {
+        qint64   tsNs;
+        uint16_t formatId;
+        uint8_t  argc;
+        uint8_t  types[5];    // 每个参数 4 位
+        uint64_t args[MAX_ARGS];
+    };
+    static_assert(sizeof(Entry) == 64, "BinLog::Entry must stay one cache line");
+
+    static BinLog &instance();
+
+    static bool enabled(Level level) { return level >= s_minLevel.load(std::memory_order_relaxed); }
+    static void setLevel(Level level) { s_minLevel.store(level, std::memory_order_relaxed); }
+
+    // 在调用点的函数内 static 里调用一次
+    uint16_t registerFormat(Level level, const char *tag, const char *format);
+
+    // 目录为空时写 stderr；切换目录会先把已有条目写完
+    void setDirectory(const QString &dir);
+    QString currentPath() const;
+    void setRotation(qint64 maxFileBytes, int maxFiles);
+
+    // 在调用线程同步排空所有环并写出
+    void flush();
+
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // --- 热路径 ---
+    // 参数按值传，类内 static const 常量也能直接传 (不 odr-use)
+    template <typename... Args>
+    inline void write(uint16_t formatId, Args... args);
+
+private:
+    // 单例不析构 (退出时还可能有静态对象在写日志)，进程退出时由 atexit 停后台线程并写完剩余条目
+    BinLog();
+    static void shutdown();
+
+    struct ThreadRing {
+        std::atomic<quint32> head;    // 生产者：已写入条目总数
+        std::atomic<quint32> tail;    // 消费者：已输出条目总数
+        std::atomic<quint32> dropped; // 环满丢弃的条目数
+        quint32 droppedReported;      // 只由消费者访问
+        bool inUse;                   // 有线程在写；持 m_registerLock 读写
+        Entry entries[RING_ENTRIES];
+    };
+    // 线程退出时析构，把本线程的环交还给池
+    struct RingOwner {
+        ~RingOwner();
+    };
+    struct Format {
+        Level level;
+        const char *tag;
+        const char *format;
+    };
+
+    ThreadRing *localRing();
+    ThreadRing *createRing();
+
+    template <typename T>
+    static inline void encode(Entry &e, int index, T value);
+
+    void writerLoop();
+    // 排空所有环；调用方持有 m_drainLock
+    void drainLocked();
+    void writeOut(const char *data, int size);
+    void openFileLocked();
+    void rotateLocked();
+
+    // 不分配、不加锁的格式化，崩溃处理也用它；返回写入字节数
+    int formatEntry(const Entry &e, char *out, int cap) const;
+    static void crashHandler(int sig);
+    void crashFlush();
+
+    static std::atomic<int> s_minLevel;
+    static thread_local ThreadRing *t_ring;
+    static thread_local RingOwner t_owner;
+
+    QMutex m_registerLock; // 保护登记 (格式表与线程环表只追加，读端无锁)
+    Format m_formats[MAX_FORMATS];
+    std::atomic<int> m_formatCount;
+    ThreadRing *m_rings[MAX_THREADS];
+    std::atomic<int> m_ringCount;
+    ThreadRing *m_overflow; // 存活线程数超过 MAX_THREADS 时共用，永远是满的，只计丢弃
+    std::atomic<quint64> m_dropped;
+
+    // 墙钟锚点：启动时的单调时间和本地时间 (ms)，格式化时换算成 HH:mm:ss.zzz
+    qint64 m_monoAnchorNs;
+    qint64 m_localAnchorMs;
+
+    mutable std::mutex m_drainLock; // 保护下面的输出状态
+    QString m_dir;
+    QString m_path;
+    int m_fd;               // -1 时写 stderr
+    qint64 m_fileBytes;
+    qint64 m_maxFileBytes;
+    int m_maxFiles;
+
+    std::mutex m_wakeLock;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_crashing;
+    class QThread *m_writer;
+    static BinLog *s_instance;
+};
+
+template <typename T>
+inline void BinLog::encode(Entry &e, int index, T value)
+{
+    using V = T;
+    ArgType type;
+    if constexpr (std::is_same<V, bool>::value) {
+        type = ArgUInt;
+        e.args[index] = value ? 1 : 0;
+    } else if constexpr (std::is_enum<V>::value || (std::is_integral<V>::value && std::is_signed<V>::value)) {
+        type = ArgInt;
+        const int64_t v = (int64_t)value;
+        e.args[index] = (uint64_t)v;
+    } else if constexpr (std::is_integral<V>::value) {
+        type = ArgUInt;
+        e.args[index] = (uint64_t)value;
+    } else if constexpr (std::is_floating_point<V>::value) {
+        type = ArgDouble;
+        const double d = (double)value;
+        static_assert(sizeof(d) == sizeof(uint64_t), "double must be 64-bit");
+        memcpy(&e.args[index], &d, sizeof(d));
+    } else {
+        static_assert(std::is_convertible<V, const char *>::value,
+                      "BinLog arguments must be numbers, enums or string literals");
+        type = ArgStr;
+        e.args[index] = (uint64_t)(uintptr_t)static_cast<const char *>(value);
+    }
+    uint8_t &slot = e.types[index / 2];
+    slot = (index & 1) ? (uint8_t)((slot & 0x0F) | (type << 4)) : (uint8_t)((slot & 0xF0) | type);
+}
+
+template <typename... Args>
+inline void BinLog::write(uint16_t formatId, Args... args)
+{
+    static_assert(sizeof...(Args) <= MAX_ARGS, "BinLog supports at most 6 arguments");
+    ThreadRing *ring = localRing();
+    const quint32 head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= (quint32)RING_ENTRIES) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Entry &e = ring->entries[head & (RING_ENTRIES - 1)];
+    e.tsNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch()).count();
+    e.formatId = formatId;
+    e.argc = (uint8_t)sizeof...(Args);
+    int index = 0;
+    (void)index;
+    (encode(e, index++, args), ...);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+inline BinLog::ThreadRing *BinLog::localRing()
+{
+    ThreadRing *ring = t_ring;
+    return ring ? ring : createRing();
+}
+
+// 级别、模块名、格式串都必须是字面量
+#define BINLOG(level, tag, format, ...) \
+    do { \
+        if (BinLog::enabled(level)) { \
+            static const uint16_t binlogFormatId_ = BinLog::instance().registerFormat(level, tag, format); \
+            BinLog::instance().write(binlogFormatId_, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(tag, format, ...) BINLOG(BinLog::Debug, tag, format, ##__VA_ARGS__)
+#define LOG_INFO(tag, format, ...)  BINLOG(BinLog::Info, tag, format, ##__VA_ARGS__)
+#define LOG_WARN(tag, format, ...)  BINLOG(BinLog::Warn, tag, format, ##__VA_ARGS__)
+#define LOG_ERROR(tag, format, ...) BINLOG(BinLog::Error, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,152 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 14:02:44
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 14:02:44
+ * @FilePath: \ele_sti\include\common\Metrics.h
+ * @Description: 运行指标：计数器、仪表、对数线性直方图；热路径按线程写，读取时汇总
+ */
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief 指标注册表 (单例)
+ * @note  每个线程第一次写指标时分配一块按 cache line 对齐的私有存储，
+ *        之后计数器/直方图的写入都只碰本线程的存储，不加锁、不做原子读改写；
+ *        读取 (QML 刷新、抓取接口) 时遍历所有线程的存储求和。
+ *        仪表 (gauge) 是"最新值"语义，直接用全局原子变量。
+ */
+class MetricsRegistry
+{
+public:
+    enum Type { Counter, Gauge, Histogram };
+
+    // 直方图分桶：1us ~ 17s，每个 2 的幂区间再线性分 4 份
+    static const int HIST_MIN_EXP = 10;   // 2^10 ns ≈ 1us
+    static const int HIST_MAX_EXP = 34;   // 2^34 ns ≈ 17s
+    static const int HIST_SUB = 4;
+    static const int HIST_BUCKETS = (HIST_MAX_EXP - HIST_MIN_EXP + 1) * HIST_SUB + 2; // 含下溢/上溢
+
+    static const int MAX_COUNTERS = 128;
+    static const int MAX_GAUGES = 64;
+    static const int MAX_HISTOGRAMS = 32;
+
+    struct Value {
+        QString name;
+        QString help;
+        Type type;
+        double value;                 // 计数器/仪表的值，直方图为样本数
+        double sum;                   // 直方图：样本和 (ns)
+        double p50, p99, max;         // 直方图：分位数 (ns)
+        QVector<quint64> buckets;     // 直方图：各桶计数
+    };
+
+    static MetricsRegistry &instance();
+
+    int registerMetric(Type type, const char *name, const char *help);
+
+    // --- 热路径 ---
+    inline void add(int id, quint64 n);
+    inline void set(int id, qint64 v) { m_gauges[id].store(v, std::memory_order_relaxed); }
+    inline void observe(int id, qint64 ns);
+
+    // --- 读取 ---
+    QVector<Value> snapshot() const;
+    QString exposition() const; // Prometheus 文本格式
+
+    static int bucketIndex(qint64 ns);
+    static qint64 bucketUpperBound(int index);
+
+private:
+    MetricsRegistry() = default;
+
+    struct alignas(64) ThreadSlab {
+        std::atomic<quint64> counters[MAX_COUNTERS];
+        std::atomic<quint64> histCount[MAX_HISTOGRAMS][HIST_BUCKETS];
+        std::atomic<qint64>  histSum[MAX_HISTOGRAMS];
+        std::atomic<qint64>  histMax[MAX_HISTOGRAMS];
+        ThreadSlab();
+    };
+
+    struct Meta {
+        QString name;
+        QString help;
+        Type type;
+        int slot; // 在对应类型数组里的下标
+    };
+
+    ThreadSlab *localSlab();
+    ThreadSlab *createSlab();
+
+    mutable QMutex m_mutex;            // 只保护注册和线程存储列表
+    QVector<Meta> m_meta;
+    QVector<ThreadSlab *> m_slabs;     // 线程退出后存储保留，计数不丢
+    int m_counterCount = 0;
+    int m_gaugeCount = 0;
+    int m_histCount = 0;
+    std::atomic<qint64> m_gauges[MAX_GAUGES] = {};
+
+    static thread_local ThreadSlab *t_slab;
+};
+
+// 单线程写：relaxed load + store，编译成普通的读写
+inline void MetricsRegistry::add(int id, quint64 n)
+{
+    std::atomic<quint64> &c = localSlab()->counters[id];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void MetricsRegistry::observe(int id, qint64 ns)
+{
+    ThreadSlab *slab = localSlab();
+    std::atomic<quint64> &b = slab->histCount[id][bucketIndex(ns)];
+    b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slab->histSum[id].store(slab->histSum[id].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > slab->histMax[id].load(std::memory_order_relaxed)) {
+        slab->histMax[id].store(ns, std::memory_order_relaxed);
+    }
+}
+
+inline MetricsRegistry::ThreadSlab *MetricsRegistry::localSlab()
+{
+    ThreadSlab *slab = t_slab;
+    return slab ? slab : createSlab();
+}
+
+// ==========================================
+// 指标句柄：在文件作用域定义为 static 对象，注册只发生一次
+// ==========================================
+
+class MetricCounter
+{
+public:
+    MetricCounter(const char *name, const char *help)
+        : m_id(MetricsRegistry::instance().registerMetric(MetricsRegistry::Counter, name, help)) {}
+    void inc(quint64 n = 1) { if (m_id >= 0) MetricsRegistry::instance().add(m_id, n); }
+private:
+    int m_id;
+};
+
+class MetricGauge
+{
+public:
+    MetricGauge(const char *name, const char *help)
+        : m_id(MetricsRegistry::instance().registerMetric(MetricsRegistry::Gauge, name, help)) {}
+    void set(qint64 v) { if (m_id >= 0) MetricsRegistry::instance().set(m_id, v); }
+private:
+    int m_id;
+};
+
+class MetricHistogram
+{
+public:
+    MetricHistogram(const char *name, const char *help)
+        : m_id(MetricsRegistry::instance().registerMetric(MetricsRegistry::Histogram, name, help)) {}
+    void observe(qint64 ns) { if (m_id >= 0) MetricsRegistry::instance().observe(m_id, ns); }
+private:
+    int m_id;
+};
@@ -0,0 +1,153 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 19:40:27
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 19:40:27
+ * @FilePath: \ele_sti\include\common\PacketCodec.h
+ * @Description: 编译期包编解码：每种包一个 traits 特化 (帧头/长度/校验范围/方向)，按帧头查表分发
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "common/protocol_data.h"
+
+enum class PacketDir { Downlink, Uplink }; // Downlink: RK3568 -> M0
+
+/**
+ * @brief 包特征，每种包特化一次
+ * @note  head         帧头字节
+ *        size         整包字节数 (同时锁定结构体布局，改字段会编译失败)
+ *        checksumAt   校验字节的偏移，校验范围是 [0, checksumAt)
+ *        dir          传输方向
+ *        新增包类型：在 protocol_data.h 定义结构体，再在这里加一个 PACKET_TRAITS 即可
+ */
+template <typename T>
+struct PacketTraits;
+
+#define PACKET_TRAITS(Type, Head, Size, Dir)                                                   \
+    template <>                                                                                \
+    struct PacketTraits<Type> {                                                                \
+        static constexpr uint8_t head = Head;                                                  \
+        static constexpr size_t size = Size;                                                   \
+        static constexpr size_t checksumAt = offsetof(Type, checksum);                         \
+        static constexpr PacketDir dir = PacketDir::Dir;                                       \
+    };                                                                                         \
+    static_assert(sizeof(Type) == Size, #Type " layout changed, update the M0 side too");     \
+    static_assert(offsetof(Type, head) == 0, #Type " must start with the head byte");         \
+    static_assert(offsetof(Type, checksum) == Size - 1, #Type " checksum must be the last byte"); \
+    static_assert(std::is_trivially_copyable<Type>::value, #Type " must be trivially copyable")
+
+PACKET_TRAITS(ControlPacket,       HEAD_CONTROL,     29,  Downlink);
+PACKET_TRAITS(PIDPacket,           HEAD_PID,         19,  Downlink);
+PACKET_TRAITS(ProgramChunkPacket,  HEAD_PROGRAM,     121, Downlink);
+PACKET_TRAITS(ArbWavePacket,       HEAD_ARB_WAVE,    133, Downlink);
+PACKET_TRAITS(LegacyWaveformPacket, HEAD_WAVEFORM,   202, Uplink);
+PACKET_TRAITS(WaveformPacket,      HEAD_WAVEFORM_EX, 207, Uplink);
+PACKET_TRAITS(StatusPacket,        HEAD_STATUS,      7,   Uplink);
+PACKET_TRAITS(ProgramStatusPacket, HEAD_PROG_STATUS, 9,   Uplink);
+
+// ---------------- 编解码 ----------------
+
+/**
+ * @brief 填帧头和校验和，发送前调用
+ */
+template <typename T>
+inline void encodePacket(T &packet)
+{
+    packet.head = PacketTraits<T>::head;
+    packet.checksum = calculateChecksum(&packet, (int)PacketTraits<T>::checksumAt);
+}
+
+/**
+ * @brief 校验一段原始字节 (不要求对齐)
+ */
+template <typename T>
+inline bool packetValid(const uint8_t *buf, size_t len)
+{
+    typedef PacketTraits<T> Tr;
+    return len >= Tr::size && buf[0] == Tr::head &&
+           calculateChecksum(buf, (int)Tr::checksumAt) == buf[Tr::checksumAt];
+}
+
+// 已经在结构体里的包 (如刚从队列取出) 直接校验
+template <typename T>
+inline bool packetValid(const T &packet)
+{
+    return packetValid<T>(reinterpret_cast<const uint8_t *>(&packet), sizeof(T));
+}
+
+/**
+ * @brief 从接收缓冲解码：先校验再 memcpy 到对齐的结构体，不对接收缓冲做强转
+ */
+template <typename T>
+inline bool decodePacket(const uint8_t *buf, size_t len, T &out)
+{
+    if (!packetValid<T>(buf, len)) return false;
+    memcpy(&out, buf, sizeof(T));
+    return true;
+}
+
+// ---------------- 按帧头查表分发 ----------------
+
+enum class DispatchResult { Ok, BadPacket, UnknownHead };
+
+/**
+ * @brief 上行包分发器
+ * @note  Handler 需要为每种包提供 onPacket(const T &)。
+ *        256 项函数表在编译期生成，运行时只有一次按帧头的下标跳转；
+ *        帧头重复或混入下行包会在编译期报错。
+ */
+template <typename Handler, typename... Packets>
+class PacketDispatcher
+{
+    typedef DispatchResult (*Entry)(Handler &, const uint8_t *, size_t);
+
+    template <typename T>
+    static DispatchResult decodeAndHandle(Handler &handler, const uint8_t *buf, size_t len)
+    {
+        T packet;
+        if (!decodePacket(buf, len, packet)) return DispatchResult::BadPacket;
+        handler.onPacket(packet);
+        return DispatchResult::Ok;
+    }
+
+    static DispatchResult unknown(Handler &, const uint8_t *, size_t) { return DispatchResult::UnknownHead; }
+
+    static constexpr bool headsUnique()
+    {
+        const uint8_t heads[] = { PacketTraits<Packets>::head... };
+        for (size_t i = 0; i < sizeof...(Packets); i++)
+            for (size_t j = i + 1; j < sizeof...(Packets); j++)
+                if (heads[i] == heads[j]) return false;
+        return true;
+    }
+    static_assert(headsUnique(), "two packet types share a head byte");
+    static_assert(((PacketTraits<Packets>::dir == PacketDir::Uplink) && ...), "only uplink packets can be dispatched");
+
+    static constexpr std::array<Entry, 256> buildTable()
+    {
+        std::array<Entry, 256> table{};
+        for (size_t i = 0; i < table.size(); i++) table[i] = &unknown;
+        ((table[PacketTraits<Packets>::head] = &decodeAndHandle<Packets>), ...);
+        return table;
+    }
+
+    static constexpr std::array<Entry, 256> s_table = buildTable();
+
+public:
+    // 最长包的字节数，接收缓冲按这个开
+    static constexpr size_t MAX_SIZE = std::max({ PacketTraits<Packets>::size... });
+
+    static constexpr bool knows(uint8_t head) { return s_table[head] != &unknown; }
+
+    static DispatchResult dispatch(Handler &handler, const uint8_t *buf, size_t len)
+    {
+        if (len == 0) return DispatchResult::UnknownHead;
+        return s_table[buf[0]](handler, buf, len);
+    }
+};
@@ -0,0 +1,88 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 20:52:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 20:52:18
+ * @FilePath: \ele_sti\include\common\ProcSampler.h
+ * @Description: /proc 采样：整机/每核 CPU、内存、进程 RSS、每线程 CPU 和唤醒次数
+ */
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 低开销 /proc 采样器
+ * @note  文件只在 open() 时打开一次，之后每次采样用 pread 从偏移 0 重读，
+ *        数字用手写的解析器取，不经过 QFile/QString/正则。
+ *        线程列表每 TASK_RESCAN 次采样重新扫描一遍 /proc/self/task，新线程按需打开。
+ *        非 Linux 平台 open() 返回 false。非线程安全，由采样线程独占。
+ */
+class ProcSampler
+{
+public:
+    static const int TASK_RESCAN = 10;
+
+    struct ThreadLoad {
+        int tid;
+        QString name;   // 线程名，主线程标成 UI、Qt 渲染线程标成 render
+        double cpuPct;  // 占一个核的百分比
+        int lastCore;   // 最近一次运行在哪个核上
+        double wakeupsPerSec; // 每秒被调度上 CPU 的次数 (schedstat 第 3 项，约等于唤醒次数)
+    };
+
+    struct Snapshot {
+        double cpuTotal = 0.0;     // 整机 CPU 使用率 0~1
+        QVector<double> cores;     // 每核使用率 0~1
+        quint64 memTotalKb = 0;
+        quint64 memAvailableKb = 0;
+        quint64 rssBytes = 0;      // 本进程常驻内存
+        double processCpuPct = 0.0; // 本进程所有线程之和 (占一个核的百分比)
+        double wakeupsPerSec = 0.0; // 本进程所有线程之和；内核没开 schedstat 时为 0
+        QVector<ThreadLoad> threads; // 按 CPU 从高到低
+    };
+
+    ProcSampler();
+    ~ProcSampler();
+
+    bool open();
+    void close();
+    bool isOpen() const { return m_statFd >= 0; }
+
+    // 采一次，和上一次的差值算使用率；第一次调用只建立基线
+    bool sample(Snapshot &out);
+
+private:
+    struct CpuTimes {
+        quint64 busy = 0;
+        quint64 total = 0;
+    };
+    struct Task {
+        int fd = -1;
+        int schedFd = -1; // /proc/self/task/<tid>/schedstat
+        QString name;
+        quint64 ticks = 0;
+        quint64 switches = 0;
+        bool seen = false;
+    };
+
+    int readFile(int fd);
+    bool readCpu(Snapshot &out);
+    void readMemory(Snapshot &out);
+    void readThreads(Snapshot &out, double elapsedSec);
+    void rescanTasks();
+    void closeTask(const Task &task);
+
+    int m_statFd;
+    int m_meminfoFd;
+    int m_statmFd;
+    int m_pid;
+    long m_clockTicks;
+    long m_pageSize;
+    int m_samples;
+    qint64 m_lastNs;
+    QVector<CpuTimes> m_lastCpu; // [0] 整机，[i+1] 第 i 核
+    QHash<int, Task> m_tasks;
+    char m_buf[4096];
+};
@@ -0,0 +1,84 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 00:48:25
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 00:48:25
+ * @FilePath: \ele_sti\include\common\SessionFormat.h
+ * @Description: 治疗记录格式 (.eses)：文件头 + 定长记录，离线分析可以直接映射后按记录下标切块
+ */
+#pragma once
+
+#include <cstdint>
+#include "common/protocol_data.h"
+
+#define ESES_MAGIC   0x53455345u  // "ESES" (小端)
+#define ESES_VERSION 1
+#define ESES_SUFFIX  "eses"
+
+// 治疗方式 (SessionHeader.mode)
+#define ESES_MODE_STIM     0  // 固定参数刺激，可按 SessionParam 检查脉冲
+#define ESES_MODE_PROGRAM  1  // M0 刺激程序
+#define ESES_MODE_ARB      2  // 任意波形
+
+// 记录类型 (SessionRecord.type)
+#define ESES_REC_WAVE        0x01  // payload = WaveformPacket
+#define ESES_REC_STATUS      0x02  // payload = StatusPacket
+#define ESES_REC_PARAM       0x03  // payload = SessionParam，治疗中参数被修改 (界面或旋钮)
+#define ESES_REC_PROG_STATUS 0x04  // payload = ProgramStatusPacket
+
+#define ESES_PAYLOAD_SIZE 216
+
+#pragma pack(push,1)
+/**
+ * @brief 刺激参数 (与 StimulationParam 同义，定宽落盘)
+ */
+struct SessionParam {
+    uint16_t freq;           // Hz
+    uint16_t reserved;
+    uint32_t positive_width; // us
+    uint32_t negative_width; // us
+    uint32_t dead_pulse;     // us
+    float    amp_pos;        // mA
+    float    amp_neg;        // mA
+};
+
+/**
+ * @brief 文件头
+ * @note  开始治疗时写入，elapsed_ms/record_count 在结束时回写；
+ *        异常退出的文件 record_count 为 0，读取方按文件长度推算记录数
+ */
+struct SessionHeader {
+    uint32_t magic;          // ESES_MAGIC
+    uint16_t version;        // ESES_VERSION
+    uint16_t header_size;    // sizeof(SessionHeader)
+    uint16_t record_size;    // sizeof(SessionRecord)
+    uint8_t  mode;           // ESES_MODE_*
+    uint8_t  reserved0;
+    int64_t  start_epoch_ms; // 开始时刻
+    uint32_t planned_s;      // 设定的治疗时长
+    uint32_t elapsed_ms;     // 实际时长 (结束时回写)
+    uint32_t record_count;   // 记录数 (结束时回写)
+    SessionParam param;      // 开始时的刺激参数
+    uint8_t  reserved[8];
+};
+
+/**
+ * @brief 定长记录
+ * @note  所有记录同长，第 i 条在 header_size + i * record_size，切块不需要先扫一遍
+ */
+struct SessionRecord {
+    uint8_t  type;           // ESES_REC_*
+    uint8_t  reserved[3];
+    uint32_t host_ms;        // 相对 start_epoch_ms 的主机时间
+    union {
+        WaveformPacket wave;
+        StatusPacket status;
+        SessionParam param;
+        ProgramStatusPacket program;
+        uint8_t raw[ESES_PAYLOAD_SIZE];
+    };
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SessionHeader) == 64, "SessionHeader layout changed");
+static_assert(sizeof(SessionRecord) == 8 + ESES_PAYLOAD_SIZE, "payload larger than ESES_PAYLOAD_SIZE");
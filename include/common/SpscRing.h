@@ -0,0 +1,67 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 11:20:05
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 11:20:05
+ * @FilePath: \ele_sti\include\common\SpscRing.h
+ * @Description: 单生产者/单消费者无锁环形队列，用于跨线程传递定长数据块
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief 单生产者/单消费者环形队列
+ * @note  Capacity 必须是 2 的幂；push 只能在一个线程调用，pop 只能在另一个线程调用
+ *        读写索引各占一条 cache line，避免生产者/消费者伪共享
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : m_head(0), m_tail(0) {}
+
+    bool push(const T &item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+            return false; // 满
+        }
+        m_slots[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &out)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false; // 空
+        }
+        out = m_slots[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    // 仅在两端都停止时调用
+    void reset()
+    {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> m_head; // 生产者写
+    alignas(64) std::atomic<size_t> m_tail; // 消费者写
+    alignas(64) T m_slots[Capacity];
+};
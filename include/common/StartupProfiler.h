@@ -0,0 +1,55 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 17:20:36
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 17:20:36
+ * @FilePath: \ele_sti\include\common\StartupProfiler.h
+ * @Description: 启动耗时剖析：记录引擎创建、组件实例化、后端初始化、首帧等阶段的时间线
+ */
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 启动剖析器 (单例)
+ * @note  时间零点是第一次调用 instance() 的时刻，main 第一行就调用。
+ *        任何线程都可以 mark；QML 通过上下文属性 startupProfiler 调用。
+ *        finish() 时打印到首帧为止的时间线，之后的阶段逐条打印；ELE_STI_STARTUP_PROFILE=0 时不打印。
+ */
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    struct Mark {
+        QString phase;
+        QString thread;
+        qint64 ns; // 距零点
+    };
+
+    static StartupProfiler &instance();
+
+    // 记录一个阶段完成的时刻
+    Q_INVOKABLE void mark(const QString &phase);
+    // 记录最后一个阶段并打印时间线
+    Q_INVOKABLE void finish(const QString &phase);
+
+    bool isFinished() const;
+    QVector<Mark> marks() const;
+    QString formatReport() const;
+
+signals:
+    void marked(const QString &phase);
+    void finished(qint64 totalNs);
+
+private:
+    StartupProfiler();
+
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QVector<Mark> m_marks;
+    bool m_finished;
+};
@@ -0,0 +1,156 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 15:20:37
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 15:20:37
+ * @FilePath: \ele_sti\include\common\TraceRecorder.h
+ * @Description: 时间线追踪：每线程定长无锁环，记录开始/结束/计数事件，按需导出 Chrome trace JSON
+ */
+#pragma once
+
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief 追踪记录器 (单例)
+ * @note  名字在第一次使用时 intern 成 16 位编号，事件里只存编号；
+ *        每个线程只写自己的环，不加锁，环满后覆盖最旧的事件；
+ *        导出时把各线程的环拷出来转换成 chrome://tracing / Perfetto 能打开的 JSON。
+ */
+class TraceRecorder
+{
+public:
+    enum EventType : uint8_t {
+        Begin   = 'B',
+        End     = 'E',
+        Counter = 'C',
+        Complete = 'X' // 已知时长的事件 (value 为时长 ns)
+    };
+
+    struct Event {
+        qint64   tsNs;
+        qint64   value;
+        uint16_t nameId;
+        uint8_t  type;
+    };
+
+    static const int RING_EVENTS = 16384; // 每线程事件数，2 的幂
+
+    static TraceRecorder &instance();
+
+    uint16_t intern(const char *name);
+    void setEnabled(bool on) { m_enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // --- 热路径 ---
+    inline void record(uint8_t type, uint16_t nameId, qint64 value = 0);
+    inline void recordAt(uint8_t type, uint16_t nameId, qint64 tsNs, qint64 value);
+
+    // 各线程环在某一时刻的拷贝：拷贝只是 memcpy，格式化和写文件可以交给别的线程
+    struct Snapshot {
+        struct Thread {
+            qint64 tid;
+            QString name;
+            QVector<Event> events; // 按时间顺序
+        };
+        QDateTime taken;
+        QStringList names;
+        QVector<Thread> threads;
+    };
+    Snapshot snapshot() const;
+
+    /**
+     * @brief 导出 Chrome trace-event JSON
+     * @param path 为空时写到 ELE_STI_TRACE_DIR (默认系统临时目录)
+     * @param reason 附在文件名里，如 "manual"、"err2"
+     * @return 实际写入的文件路径，失败返回空串
+     */
+    QString dumpChromeJson(const QString &path = QString(), const QString &reason = "manual");
+    // 同上，只做格式化和写文件，可在任意线程调用
+    static QString writeChromeJson(const Snapshot &snap, const QString &path, const QString &reason);
+
+    static qint64 nowNs();
+
+private:
+    TraceRecorder();
+
+    struct ThreadRing {
+        std::atomic<quint64> head; // 已写入事件总数
+        qint64 tid;
+        QString threadName;
+        Event events[RING_EVENTS];
+    };
+
+    ThreadRing *localRing();
+    ThreadRing *createRing();
+
+    std::atomic<bool> m_enabled;
+    mutable QMutex m_mutex;      // 保护 intern 表和线程环列表
+    QStringList m_names;
+    QVector<ThreadRing *> m_rings;
+
+    static thread_local ThreadRing *t_ring;
+};
+
+inline TraceRecorder::ThreadRing *TraceRecorder::localRing()
+{
+    ThreadRing *ring = t_ring;
+    return ring ? ring : createRing();
+}
+
+inline void TraceRecorder::recordAt(uint8_t type, uint16_t nameId, qint64 tsNs, qint64 value)
+{
+    if (!m_enabled.load(std::memory_order_relaxed)) return;
+    ThreadRing *ring = localRing();
+    const quint64 head = ring->head.load(std::memory_order_relaxed);
+    Event &ev = ring->events[head & (RING_EVENTS - 1)];
+    ev.tsNs = tsNs;
+    ev.value = value;
+    ev.nameId = nameId;
+    ev.type = type;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+inline void TraceRecorder::record(uint8_t type, uint16_t nameId, qint64 value)
+{
+    if (!m_enabled.load(std::memory_order_relaxed)) return;
+    recordAt(type, nameId, nowNs(), value);
+}
+
+// 作用域事件：构造时 Begin，析构时 End
+class TraceScope
+{
+public:
+    explicit TraceScope(uint16_t nameId) : m_id(nameId)
+    {
+        TraceRecorder::instance().record(TraceRecorder::Begin, m_id);
+    }
+    ~TraceScope()
+    {
+        TraceRecorder::instance().record(TraceRecorder::End, m_id);
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    uint16_t m_id;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// 名字必须是字符串字面量，intern 只在第一次执行到这里时发生
+#define TRACE_SCOPE(name) \
+    static const uint16_t TRACE_CONCAT(traceId_, __LINE__) = TraceRecorder::instance().intern(name); \
+    TraceScope TRACE_CONCAT(traceScope_, __LINE__)(TRACE_CONCAT(traceId_, __LINE__))
+
+#define TRACE_COUNTER(name, value) \
+    do { \
+        static const uint16_t traceCounterId_ = TraceRecorder::instance().intern(name); \
+        TraceRecorder::instance().record(TraceRecorder::Counter, traceCounterId_, (qint64)(value)); \
+    } while (0)
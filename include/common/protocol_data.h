@@ -16,24 +16,61 @@
 // --- 帧头定义 ---
 #define HEAD_CONTROL  0xAA  // [下行] 控制包
 #define HEAD_PID      0xDD  // [下行] PID配置包
-#define HEAD_WAVEFORM 0xBB  // [上行] ADC波形包
+#define HEAD_WAVEFORM 0xBB  // [上行] ADC波形包 (老固件：只有采样，202 字节)
+#define HEAD_WAVEFORM_EX  0xBC  // [上行] 扩展波形包：采样 + M0 时间戳 + 任意波形 credits (207 字节)
 #define HEAD_STATUS   0xCC  // [上行] 状态包
+#define HEAD_PROGRAM      0xEE  // [下行] 刺激程序分块包
+#define HEAD_PROG_STATUS  0xCE  // [上行] 程序执行进度包
+#define HEAD_ARB_WAVE     0xAD  // [下行] 任意波形采样块
 
 // --- 指令类型(用于ControlPacket.cmd) ---
 #define CMD_START     0x01  // 开始治疗
 #define CMD_STOP      0x02  // 停止治疗
 #define CMD_UPDATE    0x03  // 更新参数
+#define CMD_PROG_START 0x04 // 执行已下载的刺激程序 (freq 字段携带 program_id)
+#define CMD_PROG_ABORT 0x05 // 中止刺激程序，输出立即关闭
+#define CMD_ARB_START  0x06 // 进入任意波形模式 (freq 字段为采样率 Hz)
+#define CMD_ARB_STOP   0x07 // 退出任意波形模式，输出立即关闭
 
 // --- 错误码 ---
 #define ERR_NONE      0x00  // 正常
 #define ERR_ELECTRODE 0x01  // 电极脱落
 #define ERR_OVER_CURR 0x02  // 过流保护
 #define ERR_TIMEOUT   0x03  // 通信超时
+#define ERR_PROGRAM   0x04  // 程序表校验失败
+
+// --- 刺激程序 ---
+#define PROGRAM_MAX_SEGMENTS   32  // M0 端程序表容量 (段)
+#define PROGRAM_SEGS_PER_CHUNK 4   // 每个分块包携带的段数
+
+// --- 任意波形 ---
+#define ARB_BATCH_SIZE     64      // 每个采样块的点数
+#define ARB_BUFFER_BLOCKS  16      // M0 端环形缓冲容量 (块)
+#define ARB_SAMPLE_LSB_MA  0.002f  // 采样值 1 LSB 对应的电流 (mA)，量程约 ±65mA
+#define ARB_MAX_RATE_HZ    20000   // M0 DAC 最高更新率
+
+// 程序状态 (用于ProgramStatusPacket.state)
+#define PROG_STATE_EMPTY    0x00  // 无程序
+#define PROG_STATE_LOADING  0x01  // 正在接收分块
+#define PROG_STATE_READY    0x02  // 程序表完整且校验通过
+#define PROG_STATE_RUNNING  0x03  // 正在执行
+#define PROG_STATE_DONE     0x04  // 执行完毕，输出已关闭
+#define PROG_STATE_ERROR    0x05  // 校验失败或被中止
 
 // --串口通信--
 #define FRAME_HEAD      0xAA
 #define FRAME_TAIL      0xFF
 #define MAX_BUFFER_SIZE 4096
+
+// 面板串口命令 (ButtonPacket.cmd)
+#define BTN_CMD_KNOB    0x01  // 旋钮转动，value = 编码器计数 (0~255 回绕)
+#define BTN_CMD_CLICK   0x02  // 旋钮单击 (Encoder Mode 4 -> Single Click)
+#define BTN_CMD_START   0xBB  // 启动/停止切换键
+
+// 旋钮调幅
+#define KNOB_STEP_MA          0.5f   // 每格调节量
+#define KNOB_AMP_MAX_MA       100.0f // 与参数页滑块上限一致
+#define KNOB_LATENCY_BOUND_US 5000   // 旋钮帧到控制包发出的延迟上限
 // =============================================================
 // 数据结构定义
 // 使用 pack(1)  1 字节对齐
@@ -82,14 +119,32 @@ struct PIDPacket {
 };
 
 /**
- * @brief 3. 高速波形包
- * @note 批量传输 ADC 数据，用于 Qt Charts 画图和上位机算法分析
+ * @brief 3. 高速波形包 (老固件)
+ * @note 批量传输 ADC 数据，用于 Qt Charts 画图和上位机算法分析。
+ *       现有 M0 固件发的都是这个布局，不能改；后端收到后补上时间戳转成 WaveformPacket
  */
-struct WaveformPacket {
+struct LegacyWaveformPacket {
     uint8_t  head;           // HEAD_WAVEFORM (0xBB)
+    float    adc_batch[WAVEFORM_BATCH_SIZE];
+    uint8_t  checksum;       // 校验和
+};
+
+/**
+ * @brief 3.1 扩展波形包
+ * @note 在老布局上加了 M0 时间戳和任意波形流控，用新帧头区分，与老固件互不影响。
+ *       依赖 M0 固件支持：固件发 0xBC 才有真实的 M0 时间戳 (链路延迟统计) 和 credits (任意波形模式)；
+ *       老固件继续发 0xBB，上位机用接收时刻代替时间戳，任意波形模式不可用。
+ *       上位机内部 (界面、记录文件、外发) 统一用这个结构
+ */
+struct WaveformPacket {
+    uint8_t  head;           // HEAD_WAVEFORM_EX (0xBC)
+    uint32_t tick_us;        // M0 时间戳 (us)：本批第一个采样点的采集时刻，32 位回绕
     
     // --- 批量采样数据  ---
     float    adc_batch[WAVEFORM_BATCH_SIZE]; 
+
+    // --- 任意波形流控 (非任意波形模式为 0) ---
+    uint8_t  arb_credits;    // M0 缓冲空闲块数，上位机据此补发采样块
     
     uint8_t  checksum;       // 校验和
 };
@@ -107,6 +162,66 @@ struct StatusPacket {
     uint8_t  checksum;       // 校验和
 };
 
+/**
+ * @brief 5. 刺激程序段
+ * @note  一段内频率/脉宽固定，幅值从 start 线性过渡到 end
+ *        M0 按 duration_ms 依次执行，不依赖上位机定时
+ */
+struct ProgramSegment {
+    uint32_t duration_ms;    // 段时长 (ms)
+    uint16_t freq;           // 频率 (Hz)
+    uint16_t positive_width; // 正向脉宽 (us)
+    uint16_t negative_width; // 反向脉宽 (us)
+    uint16_t dead_pulse;     // 脉间死区 (us)
+    float    amp_pos_start;  // 段起点正向幅值 (mA)
+    float    amp_pos_end;    // 段终点正向幅值 (mA)
+    float    amp_neg_start;  // 段起点反向幅值 (mA)
+    float    amp_neg_end;    // 段终点反向幅值 (mA)
+};
+
+/**
+ * @brief 6. 刺激程序分块包
+ * @note  rk3568->M0，一个程序拆成 chunk_count 个分块连续发送
+ *        每块有独立校验和，整张程序表另有 CRC16，M0 收齐并校验通过后进入 READY
+ */
+struct ProgramChunkPacket {
+    uint8_t  head;           // HEAD_PROGRAM (0xEE)
+    uint8_t  program_id;     // 程序编号，用于区分新旧程序
+    uint8_t  chunk_index;    // 当前块序号 (从 0 开始)
+    uint8_t  chunk_count;    // 总块数
+    uint8_t  segment_total;  // 程序总段数
+    uint8_t  segment_count;  // 本块有效段数
+    uint16_t program_crc;    // 整张程序表的 CRC16
+    ProgramSegment segments[PROGRAM_SEGS_PER_CHUNK];
+
+    uint8_t  checksum;       // 校验和
+};
+
+/**
+ * @brief 7. 程序执行进度包
+ * @note  M0->rk3568，程序状态变化时以及执行期间周期发送
+ */
+struct ProgramStatusPacket {
+    uint8_t  head;           // HEAD_PROG_STATUS (0xCE)
+    uint8_t  program_id;
+    uint8_t  state;          // PROG_STATE_*
+    uint8_t  segment_index;  // 当前执行的段
+    uint32_t elapsed_ms;     // 程序已执行时长 (ms)
+    uint8_t  checksum;       // 校验和
+};
+
+/**
+ * @brief 8. 任意波形采样块
+ * @note  rk3568->M0，按 M0 回传的 credits 补发，M0 用双缓冲/环形缓冲连续播放
+ */
+struct ArbWavePacket {
+    uint8_t  head;           // HEAD_ARB_WAVE (0xAD)
+    uint8_t  reserved;       // 保留字节
+    uint16_t seq;            // 块序号，M0 据此发现丢块
+    int16_t  samples[ARB_BATCH_SIZE]; // 电流采样 (单位 ARB_SAMPLE_LSB_MA)
+    uint8_t  checksum;       // 校验和
+};
+
 struct ButtonPacket {
     uint8_t  head;
     uint8_t  cmd;
@@ -130,3 +245,19 @@ static inline uint8_t calculateChecksum(const void* data, int len) {
     }
     return sum;
 }
+
+/**
+ * @brief 计算 CRC16-CCITT (多项式 0x1021，初值 0xFFFF)
+ * @note  用于大块数据 (如程序表) 的整体校验，比累加和更能发现错位
+ */
+static inline uint16_t calculateCrc16(const void* data, int len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < len; i++) {
+        crc ^= (uint16_t)p[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,105 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 04:02:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 04:02:18
+ * @FilePath: \ele_sti\include\controllers\FrameBench.h
+ * @Description: 界面帧时间基准：在软件场景图下驱动真实页面，逐帧记录同步/渲染/JS 耗时，输出分位数和掉帧数
+ */
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QQuickWindow;
+class TreatmentManager;
+
+/**
+ * @brief 帧时间基准 (ele_sti --frame-bench)
+ * @note  用法：QT_QPA_PLATFORM=offscreen ele_sti --frame-bench --pages monitor,param --seconds 10 --wave-hz 200
+ *        main 在建 QGuiApplication 之前调用 requested()：切到软件场景图 (与 RK3568 上没有 GPU 时一致)，
+ *        渲染循环固定为 basic (同步/渲染都在界面线程上，逐帧时间不受线程调度干扰)。
+ *        数据由 SyntheticBackend 按 --wave-hz / --status-hz 产生，经 DeviceManager/TreatmentService/TreatmentManager
+ *        的正常链路送到 QML，基准只负责切页、启动治疗和计时。
+ *        每帧记录 (QQuickWindow 信号直连，界面线程上取时间)：
+ *          polish  afterAnimating -> beforeSynchronizing (含 Canvas onPaint 等 JS)
+ *          sync    beforeSynchronizing -> afterSynchronizing
+ *          render  beforeRendering -> afterRendering
+ *          frame   afterAnimating -> frameSwapped，interval 为相邻两次 frameSwapped 的间隔
+ *        另外统计每包波形的 QML 处理函数耗时 (handler)、Canvas 绘制耗时 (paint)，
+ *        以及波形到达到画出它的那一帧上屏的延迟 (latency，只有画波形的页面有)。
+ *        掉帧：frame 超过预算记一次 overBudget；latency 超过两个预算周期时，多出的整周期数记为 missed。
+ */
+class FrameBench : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QStringList pages;      // monitor / param / system，按顺序测
+        int warmupMs = 2000;    // 切页后先等页面加载和过渡动画结束
+        int measureMs = 10000;  // 每页测量时长
+        int waveHz = 50;
+        int statusHz = 10;
+        double budgetMs = 16.7; // 帧预算 (60Hz)
+        int maxMissed = -1;     // 任一页 missed 超过它时退出码为 3 (< 0 不检查)
+        QString outPath;        // JSON 结果，空则只打印表格
+
+        Options() : pages({ "monitor", "param" }) {}
+    };
+
+    // argv 里有 --frame-bench 时切换图形后端并返回 true；必须在 QGuiApplication 之前调用
+    static bool requested(int argc, char *argv[]);
+    static Options parse(const QStringList &arguments);
+
+    FrameBench(const Options &options, TreatmentManager *manager, QObject *parent = nullptr);
+
+    // 挂到主窗口并开始按页测量，全部完成后发 finished
+    void attach(QQuickWindow *window);
+
+signals:
+    void finished(int exitCode);
+
+private:
+    struct PageStats {
+        QString page;
+        qint64 durationNs = 0;
+        QVector<qint64> frame, polish, sync, render, interval, handler, paint, latency;
+        qint64 overBudget = 0;
+        qint64 missed = 0;
+        qint64 wavesDelivered = 0;
+        qint64 wavesPainted = 0;
+    };
+
+    void runPage(int index);
+    void beginMeasure();
+    void endMeasure();
+    void finish();
+
+    void onFrameSwapped();
+    void onWaveformHandled(qint64 handlerNs);
+    void onFramePainted(double paintMs);
+
+    QString formatTable() const;
+    bool writeJson(const QString &path) const;
+
+    Options m_options;
+    TreatmentManager *m_manager;
+    QQuickWindow *m_window;
+    int m_pageIndex;
+    bool m_measuring;
+    qint64 m_measureStartNs;
+    PageStats m_current;
+    QVector<PageStats> m_results;
+
+    // 当前帧的时间点
+    qint64 m_frameStartNs;
+    qint64 m_syncStartNs;
+    qint64 m_syncNs;
+    qint64 m_renderStartNs;
+    qint64 m_renderNs;
+    qint64 m_lastSwapNs;
+    // 最早一包还没画出来的波形的到达时间；Canvas 画完后转到 m_paintedWaveNs，等本帧上屏时结算延迟
+    qint64 m_pendingWaveNs;
+    qint64 m_paintedWaveNs;
+};
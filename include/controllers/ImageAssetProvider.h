@@ -0,0 +1,68 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 17:52:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 17:52:18
+ * @FilePath: \ele_sti\include\controllers\ImageAssetProvider.h
+ * @Description: ui交互层：image://assets/<名字> 图片提供者，按显示尺寸选预缩放变体，异步解码，按内存预算 LRU 淘汰
+ */
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QVector>
+
+/**
+ * @brief 图片资源提供者
+ * @note  QML 用法: Image { source: "image://assets/3.jpg"; sourceSize: Qt.size(w, h) }
+ *        按 sourceSize 选能铺满的最小变体 (构建期 ele_sti_imgprep 生成)；
+ *        清单里没有的图片退回到原图，用 QImageReader 按目标尺寸缩放解码。
+ *        解码交给共享执行器 (高优先级道)，结果放进按字节计费的 LRU 缓存。
+ */
+class ImageAssetProvider : public QQuickAsyncImageProvider
+{
+public:
+    /**
+     * @param budgetBytes 解码后图片缓存 (QImage，CPU 内存) 的预算，不含 GPU 纹理
+     * @param fallbackRoot 原图所在的资源目录
+     */
+    explicit ImageAssetProvider(qint64 budgetBytes,
+                                const QString &fallbackRoot = ":/ELE_Sti/resources/fonts/pic/");
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+    // 在解码线程上调用
+    QImage load(const QString &id, const QSize &requestedSize, QString *error);
+
+    // 节省的内存、本机解码时间、缓存命中等
+    QString formatReport() const;
+
+private:
+    struct Variant {
+        QString path;
+        QSize size;
+    };
+    struct Asset {
+        QSize size;          // 原图尺寸
+        QVector<Variant> variants; // 按面积从小到大
+    };
+
+    void loadManifest();
+    static QImage decodeEimg(const QByteArray &data, QString *error);
+
+    QHash<QString, Asset> m_assets;
+    QString m_fallbackRoot;
+
+    mutable QMutex m_mutex;  // 保护下面所有成员
+    QCache<QString, QImage> m_cache; // 计费单位 KB
+    qint64 m_budgetBytes;
+    quint64 m_hits;
+    quint64 m_misses;
+    quint64 m_inserted;
+    qint64 m_decodedBytes;   // 实际解码出的字节数 (累计)
+    qint64 m_sourceBytes;    // 同样这些图按原尺寸解码需要的字节数 (累计)
+    double m_decodeMs;       // 实际解码耗时 (累计，本机)
+};
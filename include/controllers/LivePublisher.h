@@ -0,0 +1,79 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\include\controllers\LivePublisher.h
+ * @Description: 实时数据外发：采集线程写共享内存环，本地套接字负责握手和新数据通知
+ */
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include "common/LiveStream.h"
+
+class DeviceManager;
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+/**
+ * @brief 实时数据发布 (外部 Python/MATLAB 工具订阅)
+ * @note  数据面：DeviceManager 各通道的上行信号直连到 LiveStreamWriter，在采集线程上写 /dev/shm/<name>，
+ *        订阅端自己映射读取，订阅端数量、快慢都不影响采集线程。
+ *        控制面：本地套接字 <name> (与无界面守护进程同样的一行一条文本协议)：
+ *          info                   共享内存名和布局 (key value 每行一项)
+ *          subscribe [wave|status|all]   之后每 NOTIFY_INTERVAL_MS 有新数据时推一行 "wave <head>" / "status <head>"
+ *          unsubscribe            停止通知
+ *          lost <wave> <status>   订阅端上报自己累计的丢失条数 (进指标，方便发现读得慢的工具)
+ *          ping
+ *        回复：若干行正文，最后一行是 "ok" 或 "err <原因>"。
+ *        通知只是提示，发送缓冲积压超过 MAX_PENDING_BYTES 的订阅端这一轮跳过 (读共享内存的进度不受影响)；
+ *        订阅端也可以不订阅通知，直接轮询 wave_head。
+ */
+class LivePublisher : public QObject
+{
+    Q_OBJECT
+public:
+    static const int NOTIFY_INTERVAL_MS = 20;
+    static const int MAX_PENDING_BYTES = 4096;
+
+    explicit LivePublisher(QObject *parent = nullptr);
+    // 析构会解除共享内存映射：先停掉 devices 的采集线程再析构
+    ~LivePublisher() override;
+
+    // 建共享内存和控制套接字，并直连各通道的上行信号
+    bool start(const QString &name, DeviceManager *devices);
+    // 退出时调用：关闭控制套接字并删除共享内存的名字 (映射保留，采集线程可能还在写)
+    void unpublish();
+
+    int subscriberCount() const;
+    const LiveStreamWriter &writer() const { return m_writer; }
+
+private slots:
+    void onNewConnection();
+    void onNotifyTimer();
+
+private:
+    struct Client {
+        QLocalSocket *socket;
+        bool wave;
+        bool status;
+        quint64 lostWave;   // 订阅端最近一次上报的累计丢失数
+        quint64 lostStatus;
+    };
+
+    QString execute(Client &client, const QString &line);
+    QString infoText() const;
+    Client *findClient(QLocalSocket *socket);
+    void updateGauge();
+
+    LiveStreamWriter m_writer;
+    DeviceManager *m_devices;
+    QLocalServer *m_server;
+    QTimer *m_notifyTimer;
+    QList<Client> m_clients;
+    quint64 m_notifiedWave;
+    quint64 m_notifiedStatus;
+};
@@ -0,0 +1,47 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 14:40:09
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 14:40:09
+ * @FilePath: \ele_sti\include\controllers\MetricsController.h
+ * @Description: ui交互层：把运行指标定时汇总给 QML，并提供本机文本抓取接口
+ */
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QVariantList>
+#include <QTcpServer>
+
+class MetricsController : public QObject
+{
+    Q_OBJECT
+    // [{name, value, rate, unit}]，每秒刷新一次
+    Q_PROPERTY(QVariantList metrics READ metrics NOTIFY metricsChanged)
+
+public:
+    explicit MetricsController(QObject *parent = nullptr);
+
+    QVariantList metrics() const { return m_metrics; }
+
+    /**
+     * @brief 开启抓取接口
+     * @param port 只监听 127.0.0.1
+     */
+    bool startScrapeServer(quint16 port);
+
+signals:
+    void metricsChanged();
+
+private slots:
+    void refresh();
+    void onNewConnection();
+
+private:
+    QTimer *m_timer;
+    QTcpServer *m_server;
+    QVariantList m_metrics;
+    QHash<QString, double> m_lastCounters; // 上一次的计数器值，用于算速率
+    qint64 m_lastRefreshMs;
+};
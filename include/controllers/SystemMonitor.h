@@ -1,78 +1,106 @@
-// /*
-//  * @Author: takuyasaya 1754944616@qq.com
-//  * @Date: 2025-12-22 20:57:09
-//  * @LastEditors: takuyasaya 1754944616@qq.com
-//  * @LastEditTime: 2025-12-22 21:04:09
-//  * @FilePath: \ele_sti\include\controllers\SystemMonitor.h
-//  * @Description: 这是默认设置,请设置`customMade`, 打开koroFileHeader查看配置 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
-//  */
-// #pragma once
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2025-12-22 20:57:09
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 00:21:37
+ * @FilePath: \ele_sti\include\controllers\SystemMonitor.h
+ * @Description: ui交互层：系统资源监控，后台线程采样 /proc，每秒把 CPU/内存/线程负载交给 QML
+ */
+#pragma once
 
-// #include <QObject>
-// #include <QThread>
+#include <QObject>
+#include <QThread>
+#include <QVariantList>
+#include "common/ProcSampler.h"
 
-// // ==========================================
-// // Worker 类：负责在后台线程干脏活累活
-// // ==========================================
-// class HardwareWorker : public QObject {
-//     Q_OBJECT
-// public:
-//     explicit HardwareWorker(QObject *parent = nullptr);
+// ==========================================
+// Worker 类：在低优先级线程上采样
+// ==========================================
+class HardwareWorker : public QObject {
+    Q_OBJECT
+public:
+    explicit HardwareWorker(QObject *parent = nullptr);
 
-// public slots:
-//     // 执行一次读取任务 (被定时器触发)
-//     void readStats();
+public slots:
+    // 执行一次读取任务 (被定时器触发)
+    void readStats();
 
-// signals:
-//     // 数据准备好后，发送给主线程
-//     void dataReady(int cpu, int mem, int bat, bool charging);
+signals:
+    // 数据准备好后，发送给主线程
+    void dataReady(const ProcSampler::Snapshot &snapshot);
 
-// private:
-//     // 上一次的 CPU 计数 (用于计算瞬间使用率)
-//     long m_prevTotal = 0;
-//     long m_prevIdle = 0;
+private:
+    ProcSampler m_sampler;
+    bool m_opened = false;
+};
 
-//     // 具体的读取逻辑
-//     int readCpuUsage();
-//     int readMemUsage();
-//     std::pair<int, bool> readBatteryInfo();
-// };
+// ==========================================
+// Controller 类：负责对接 QML UI
+// ==========================================
+class SystemMonitor : public QObject {
+    Q_OBJECT
+    // 暴露给 QML 的属性，使用率均为 0.0~1.0
+    Q_PROPERTY(bool available READ available NOTIFY statsChanged)
+    Q_PROPERTY(double cpuUsage READ cpuUsage NOTIFY statsChanged)
+    Q_PROPERTY(double memUsage READ memUsage NOTIFY statsChanged)
+    Q_PROPERTY(double rssMb READ rssMb NOTIFY statsChanged)
+    Q_PROPERTY(double processCpu READ processCpu NOTIFY statsChanged)
+    // [0.0~1.0, ...] 每核一个
+    Q_PROPERTY(QVariantList cores READ cores NOTIFY statsChanged)
+    // [{name, tid, cpu (占一个核的百分比), core, wakeups}]，按 CPU 从高到低
+    Q_PROPERTY(QVariantList threads READ threads NOTIFY statsChanged)
+    // 本进程每秒唤醒次数 (所有线程之和)
+    Q_PROPERTY(double wakeupsPerSec READ wakeupsPerSec NOTIFY statsChanged)
+    // 空闲省电模式下的累计平均：进入空闲时清零，只在空闲期间累加
+    Q_PROPERTY(bool idle READ idle NOTIFY statsChanged)
+    Q_PROPERTY(double idleCpuAvg READ idleCpuAvg NOTIFY statsChanged)
+    Q_PROPERTY(double idleWakeupsAvg READ idleWakeupsAvg NOTIFY statsChanged)
 
-// // ==========================================
-// // Controller 类：负责对接 QML UI
-// // ==========================================
-// class SystemMonitor : public QObject {
-//     Q_OBJECT
-//     // 暴露给 QML 的属性
-//     Q_PROPERTY(int cpuUsage READ cpuUsage NOTIFY statsChanged)
-//     Q_PROPERTY(int memUsage READ memUsage NOTIFY statsChanged)
-//     Q_PROPERTY(int batteryLevel READ batteryLevel NOTIFY statsChanged)
-//     Q_PROPERTY(bool isCharging READ isCharging NOTIFY statsChanged)
+public:
+    explicit SystemMonitor(QObject *parent = nullptr);
+    ~SystemMonitor();
 
-// public:
-//     explicit SystemMonitor(QObject *parent = nullptr);
-//     ~SystemMonitor();
+    // Getters
+    bool available() const { return m_available; }
+    double cpuUsage() const { return m_cpu; }
+    double memUsage() const { return m_mem; }
+    double rssMb() const { return m_rssMb; }
+    double processCpu() const { return m_processCpu; }
+    QVariantList cores() const { return m_cores; }
+    QVariantList threads() const { return m_threads; }
+    double wakeupsPerSec() const { return m_wakeups; }
+    bool idle() const { return m_idle; }
+    double idleCpuAvg() const { return m_idleSamples > 0 ? m_idleCpuSum / m_idleSamples : 0.0; }
+    double idleWakeupsAvg() const { return m_idleSamples > 0 ? m_idleWakeupsSum / m_idleSamples : 0.0; }
 
-//     // Getters
-//     int cpuUsage() const { return m_cpu; }
-//     int memUsage() const { return m_mem; }
-//     int batteryLevel() const { return m_bat; }
-//     bool isCharging() const { return m_charging; }
+public slots:
+    // 由 PowerPolicy::modeChanged 驱动
+    void setIdle(bool idle);
 
-// signals:
-//     void statsChanged();
+signals:
+    void statsChanged();
 
-// private slots:
-//     // 接收 Worker 传来的数据
-//     void onDataReceived(int cpu, int mem, int bat, bool charging);
+private slots:
+    // 接收 Worker 传来的数据
+    void onDataReceived(const ProcSampler::Snapshot &snapshot);
 
-// private:
-//     QThread *m_thread;
-//     HardwareWorker *m_worker;
-    
-//     // 缓存的数据
-//     int m_cpu = 0;
-//     int m_mem = 0;
-//     int m_bat = 80; // 默认值
-//     bool m_charging = false;
-// };
+private:
+    QThread *m_thread;
+    HardwareWorker *m_worker;
+
+    // 缓存的数据
+    bool m_available = false;
+    double m_cpu = 0.0;
+    double m_mem = 0.0;
+    double m_rssMb = 0.0;
+    double m_processCpu = 0.0;
+    QVariantList m_cores;
+    QVariantList m_threads;
+    double m_wakeups = 0.0;
+
+    bool m_idle = false;
+    bool m_skipNextIdleSample = false;
+    int m_idleSamples = 0;
+    double m_idleCpuSum = 0.0;
+    double m_idleWakeupsSum = 0.0;
+};
@@ -18,6 +18,8 @@ class TreatmentManager : public QObject
     // 属性定义
     Q_PROPERTY(Runstate currentState READ currentState NOTIFY stateChanged)
     Q_PROPERTY(int remainingTime READ remainingTime NOTIFY timeUpdated)
+    // 触发模式 (TriggerEngine::Mode)，非 Off 时界面只收采到的窗口
+    Q_PROPERTY(int triggerMode READ triggerMode NOTIFY triggerChanged)
 
 public:
     // 枚举类型注册
@@ -38,8 +40,20 @@ public:
     Q_INVOKABLE void updateParameters(int freq, float posAmp, float negAmp, int posW, int dead, int negW);
     Q_INVOKABLE void setPIDParameters(float kp, float ki, float kd);
 
+    // 触发采集：mode/type 取 Trigger.Auto/Trigger.Rising 等，电平单位 mA，深度单位为采样点
+    Q_INVOKABLE void setTrigger(int mode, int type, float level, float low, float high, int preSamples, int postSamples);
+    // Single 模式采完一帧后重新装填
+    Q_INVOKABLE void armTrigger();
+
+    // 延迟追踪：波形画完后由 QML 调用 (paintMs 为本次绘制耗时)；报告为 [{name, count, p50Us, p99Us, maxUs}]
+    Q_INVOKABLE void markFramePainted(double paintMs);
+    Q_INVOKABLE QVariantList latencyReport() const;
+    // 导出时间线 (Chrome trace JSON)，返回文件路径
+    Q_INVOKABLE QString dumpTrace();
+
     int remainingTime() const;
     Runstate currentState() const;
+    int triggerMode() const;
 private:
     TreatmentService *m_service;
     int m_remainingTime = 0;
@@ -49,5 +63,13 @@ signals:
     void serialTriggerReceived();
     void monitorDataUpdated(float impedance, int battery, int error);
     void waveformReceived(const QList<float> &data);
+    // 触发采到的一帧，triggerIndex 为触发点下标，forced 为 Auto 超时强制采的
+    void captureReady(const QList<float> &data, int triggerIndex, bool forced);
+    void triggerChanged();
+    // 旋钮调了幅值，参数页据此刷新滑块
+    void amplitudeAdjusted(float posAmp, float negAmp);
+    // 帧时间基准用：一包波形的 QML 处理函数总耗时 / 监测页 Canvas 一次绘制的耗时
+    void waveformHandled(qint64 handlerNs);
+    void framePainted(double paintMs);
 
 };
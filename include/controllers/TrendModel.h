@@ -0,0 +1,83 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:40:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:40:06
+ * @FilePath: \ele_sti\include\controllers\TrendModel.h
+ * @Description: ui交互层：把 TrendStore 的一个分辨率暴露给 QML 的列表模型
+ */
+#pragma once
+
+#include <QAbstractListModel>
+#include <QtQml>
+#include "core/TreatmentService.h"
+
+/**
+ * @brief 趋势模型
+ * @note  数据留在 TrendStore 的环里，模型不复制；只发增量通知：
+ *        开新桶 -> rowsInserted，环满覆盖 -> rowsRemoved(0)，当前桶累计 -> dataChanged(最后一行)。
+ *        Canvas 每次重绘只调一次 snapshot()，按像素列合并好的数组一次带回，
+ *        不在 JS 里逐行跨 C++ 取数。
+ */
+class TrendModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int capacity READ capacity CONSTANT)
+    Q_PROPERTY(int spanMs READ spanMs CONSTANT)
+
+public:
+    // 与 TrendStore::Series / Stat 对应，供 QML 调 value()
+    enum Series {
+        Impedance = TrendStore::Impedance,
+        Battery   = TrendStore::Battery,
+        RealFreq  = TrendStore::RealFreq,
+        ErrorCode = TrendStore::ErrorCode
+    };
+    Q_ENUM(Series)
+    enum Stat {
+        Min  = TrendStore::Min,
+        Max  = TrendStore::Max,
+        Mean = TrendStore::Mean
+    };
+    Q_ENUM(Stat)
+
+    enum Roles {
+        TimeRole = Qt::UserRole + 1,
+        CountRole,
+        ImpedanceMinRole, ImpedanceMaxRole, ImpedanceMeanRole,
+        BatteryMinRole, BatteryMaxRole, BatteryMeanRole,
+        RealFreqMinRole, RealFreqMaxRole, RealFreqMeanRole,
+        ErrorCodeMaxRole
+    };
+
+    TrendModel(TreatmentService *service, TrendStore::Level level, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_store.size(m_level); }
+    int capacity() const { return TrendStore::capacity(m_level); }
+    int spanMs() const { return (int)TrendStore::spanMs(m_level); }
+
+    // 画图用：越界返回 0
+    Q_INVOKABLE double value(int row, int series, int stat) const;
+    Q_INVOKABLE double timeAt(int row) const;
+    // 整个窗口内某序列的范围 {min, max}，用于定纵轴
+    Q_INVOKABLE QVariantMap range(int series) const;
+    // 画图快照：行按 columns 列合并，一次返回
+    // {step, min, max, last, points: [t0, min0, max0, mean0, t1, ...]}
+    Q_INVOKABLE QVariantMap snapshot(int series, int columns) const;
+
+signals:
+    void countChanged();
+
+private slots:
+    void onTrendUpdated(const TrendStore::Update &update);
+
+private:
+    const TrendStore &m_store;
+    const TrendStore::Level m_level;
+    int m_rows; // 已通知给视图的行数
+};
@@ -0,0 +1,79 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 11:26:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 11:26:31
+ * @FilePath: \ele_sti\include\core\ArbWaveformStreamer.h
+ * @Description: 任意波形流：工作线程预先生成采样块，后端线程按 M0 流控拉取
+ */
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+#include "hal/IBackend.h"
+#include "common/SpscRing.h"
+
+class ArbWaveformStreamer : public QObject, public IArbSampleSource
+{
+    Q_OBJECT
+public:
+    explicit ArbWaveformStreamer(QObject *parent = nullptr);
+    ~ArbWaveformStreamer() override;
+
+    /**
+     * @brief 启动生成线程
+     * @param table 采样表 (mA)，按 sampleRateHz 播放
+     * @param loop  true 时循环播放，false 时播完一遍后结束
+     */
+    bool start(const QVector<float> &table, int sampleRateHz, bool loop = true);
+    void stop();
+    bool isRunning() const { return m_running.load(); }
+    int sampleRate() const { return m_rate; }
+
+    // 后端线程调用，无锁
+    bool takeBlock(ArbWavePacket &out) override;
+
+    // 统计
+    quint64 underruns() const { return m_underruns.load(); }
+    quint64 producedBlocks() const { return m_produced.load(); }
+    quint64 consumedBlocks() const { return m_consumed.load(); }
+    int bufferedBlocks() const { return (int)m_queue.size(); }
+
+    // 常用波形
+    static QVector<float> exponentialDecay(float peakMa, float tauMs, int durationMs, int sampleRateHz);
+    static QVector<float> burst(float ampMa, float carrierHz, int pulses, int gapMs, int sampleRateHz);
+
+signals:
+    // 欠载：后端要块时队列为空 (每次连续欠载只发一次)
+    void underrunDetected(quint64 total);
+    // 非循环模式下全部采样已被取走
+    void finished();
+
+private:
+    // 上位机预生成深度：64 块，10kHz 下约 400ms 余量
+    static const size_t QUEUE_BLOCKS = 64;
+
+    SpscRing<ArbWavePacket, QUEUE_BLOCKS> m_queue;
+    QSemaphore m_freeSlots;        // 队列空闲块数，生成线程据此阻塞
+    QThread *m_thread;
+
+    QVector<float> m_table;
+    int m_rate;
+    bool m_loop;
+    int m_cursor;                  // 生成线程私有
+    uint16_t m_seq;                // 生成线程私有
+
+    std::atomic<bool> m_running;
+    std::atomic<int> m_taking;     // 正在 takeBlock 里的消费端 (stop 等它退出后才复位队列)
+    std::atomic<bool> m_exhausted; // 非循环模式下采样表已生成完
+    std::atomic<bool> m_inUnderrun;
+    std::atomic<quint64> m_underruns;
+    std::atomic<quint64> m_produced;
+    std::atomic<quint64> m_consumed;
+
+    bool popBlock(ArbWavePacket &out);
+    void generatorLoop();
+    void fillBlock(ArbWavePacket &pkt);
+};
@@ -0,0 +1,80 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:31:50
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:31:50
+ * @FilePath: \ele_sti\include\core\CurrentLoopModel.h
+ * @Description: M0 恒流环仿真：PID + 输出级 + 电极负载 (Rs 串 Rct//Cdl)
+ */
+#pragma once
+#include "hal/IBackend.h"
+
+/**
+ * @brief 恒流环离散仿真
+ * @note  与 M0 固件同结构：每个控制周期采一次电流，位置式 PID，积分按 limit 限幅，
+ *        输出电压按电极的顺从电压限幅。输出级按一阶惯性处理，负载为
+ *        串联电阻 Rs + (电荷转移电阻 Rct // 双电层电容 Cdl)，每个控制周期内细分积分。
+ *        单位：电流 mA、电压 V、电阻 kΩ、电容 uF、时间 us；PID 的误差为 mA、输出为 V、
+ *        ki 按每秒累计、kd 按每秒变化率。
+ *        纯计算、无 Qt 对象，调谐器的工作线程各自持有一份。
+ */
+class CurrentLoopModel
+{
+public:
+    static const int CONTROL_PERIOD_US = 5; // M0 控制环 200kHz
+    static const int PLANT_SUBSTEPS = 5;    // 负载每个控制周期细分 5 步
+    static const int MAX_GAP_US = 1000;     // 脉冲间隔最多仿真 1ms，够看出积分残留
+
+    struct Load {
+        float seriesKohm;  // Rs：皮肤/引线电阻
+        float chargeKohm;  // Rct：电荷转移电阻
+        float cdlUf;       // Cdl：双电层电容
+        float complianceV; // 顺从电压
+        float driverTauUs; // 输出级时间常数
+
+        // 默认值对应模拟器上报的 500Ω 左右的表面电极
+        Load() : seriesKohm(0.5f), chargeKohm(2.0f), cdlUf(1.0f), complianceV(60.0f), driverTauUs(10.0f) {}
+    };
+
+    // 一串双相脉冲的跟踪指标
+    struct Metrics {
+        float overshootPct = 0.0f;  // 相对目标幅值的最大超调 (两相取大)
+        float settlingUs = 0.0f;    // 进入 ±5% 后不再出来的时刻 (相起点算起，两相取大；没稳住为整相宽)
+        float settledFrac = 1.0f;   // 稳住的相占比
+        float residualPct = 0.0f;   // 目标为 0 的区间里残留电荷，相对一相电荷的百分比 (积分饱和的表现)
+        float saturationPct = 0.0f; // 积分器顶在限幅上的时间占比
+        float iaePct = 0.0f;        // 有效相内的平均绝对误差，相对目标幅值
+        float peakMa = 0.0f;        // 正相峰值电流
+        bool stable = true;         // 电流发散/非数值时为 false
+    };
+
+    explicit CurrentLoopModel(const Load &load = Load());
+
+    void setLoad(const Load &load) { m_load = load; }
+    const Load &load() const { return m_load; }
+    void setPid(const PIDParam &pid) { m_pid = pid; }
+    const PIDParam &pid() const { return m_pid; }
+    void reset();
+
+    // 走一个控制周期，返回周期末的电流
+    float step(float targetMa);
+
+    /**
+     * @brief 仿真 pulses 个双相脉冲 (正相 -> 死区 -> 负相 -> 间隔)
+     * @param trace    非空时写入最后一个脉冲周期的电流波形，均匀抽取 traceLen 点
+     */
+    Metrics runPulses(const StimulationParam &pulse, int pulses, float *trace = nullptr, int traceLen = 0);
+
+    // 一个脉冲周期实际仿真的时长 (间隔按 MAX_GAP_US 截断)
+    static int pulseWindowUs(const StimulationParam &pulse);
+
+private:
+    Load m_load;
+    PIDParam m_pid;
+    float m_current;  // mA
+    float m_drive;    // 输出级实际电压
+    float m_cap;      // Cdl 上的电压
+    float m_integ;
+    float m_prevErr;
+    bool m_saturated; // 本周期积分器是否顶在限幅上
+};
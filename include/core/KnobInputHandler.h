@@ -0,0 +1,68 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 19:05:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 19:05:12
+ * @FilePath: \ele_sti\include\core\KnobInputHandler.h
+ * @Description: 旋钮输入：在后端线程上合并旋钮增量并直接下发参数，不经过 UI 线程
+ */
+#pragma once
+
+#include <QObject>
+#include <atomic>
+#include "hal/IBackend.h"
+#include "common/LatencyTracer.h"
+
+/**
+ * @brief 旋钮 -> 控制包 的快速通道
+ * @note  对象放在后端所在线程。addDelta/click 可以在任何线程 (串口线程) 直接调用：
+ *        增量先累加到原子变量里，只有第一格会投递一次处理，后端线程忙时
+ *        多帧会自动合并成一次 updateParameters。
+ *        参数改动通过 parametersAdjusted 通知服务层同步界面，界面卡顿不影响下发。
+ *        旋钮调幅只在固定参数治疗中生效：程序和任意波形的幅值不由缓存的固定参数决定，
+ *        这时旋钮增量直接丢弃，不发 CMD_UPDATE；单击停止在任何治疗中都有效 (程序用 CMD_PROG_ABORT)。
+ */
+class KnobInputHandler : public QObject
+{
+    Q_OBJECT
+public:
+    // 当前治疗方式，由服务层状态换算 (TreatmentService::mode)
+    enum Mode { Stopped, Fixed, Program, Arbitrary };
+
+    explicit KnobInputHandler(IBackend *backend, QObject *parent = nullptr);
+
+    // 任意线程：累加旋钮格数，rxNs 为收到该帧的时刻
+    void addDelta(int detents, qint64 rxNs);
+    // 任意线程：单击停止
+    void click(qint64 rxNs);
+
+    void setStep(float stepMa) { m_stepMa = stepMa; }
+    // 旋钮帧到控制包发出的延迟
+    LatencyStats::Summary latency() const { return m_latency.summary(); }
+
+public slots:
+    // 服务层参数变化时同步过来 (排队到本线程)
+    void setParameters(const StimulationParam &param);
+    void setMode(int mode);
+
+signals:
+    void parametersAdjusted(const StimulationParam &param);
+    // 停止命令已经下发，服务层只需收尾 (TreatmentService::applyKnobStop)
+    void stopRequested();
+
+private:
+    void applyPending();
+    void applyClick();
+    void recordLatency(qint64 rxNs);
+
+    IBackend *m_backend;
+    StimulationParam m_param;
+    Mode m_mode;
+    float m_stepMa;
+
+    std::atomic<int> m_pending;       // 尚未下发的格数
+    std::atomic<bool> m_posted;       // 已投递处理、尚未执行
+    std::atomic<qint64> m_firstRxNs;  // 本批最早一帧的接收时刻
+    std::atomic<qint64> m_clickRxNs;
+    LatencyStats m_latency;
+};
@@ -0,0 +1,80 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:31:50
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:31:50
+ * @FilePath: \ele_sti\include\core\PidTuner.h
+ * @Description: PID 参数离线调谐：在恒流环仿真上并行评估候选参数并排序
+ */
+#pragma once
+#include <QVector>
+#include "core/CurrentLoopModel.h"
+
+/**
+ * @brief PID 调谐器
+ * @note  候选参数按块交给共享执行器 (普通道)，每块自带一份 CurrentLoopModel，互不共享状态；
+ *        结果按输入顺序写回，排序在调用线程做。评分越低越好，发散的候选记为不稳定并排到最后。
+ *        支持网格搜索和交叉熵式的迭代优化 (每轮在上一轮前几名附近按收缩的方差采样一批)。
+ */
+class PidTuner
+{
+public:
+    // 评分权重：各项先归一到大致同量级再加权
+    struct Weights {
+        float overshoot;  // 每 10% 超调
+        float settling;   // 建立时间占相宽的比例，没稳住的相额外加 1
+        float residual;   // 每 10% 残留电荷
+        float saturation; // 每 10% 积分饱和时间
+        float tracking;   // 每 10% 平均跟踪误差
+
+        Weights() : overshoot(1.0f), settling(1.0f), residual(1.0f), saturation(0.5f), tracking(1.0f) {}
+    };
+
+    struct Result {
+        PIDParam pid;
+        double score;
+        CurrentLoopModel::Metrics metrics;
+    };
+
+    // 一维搜索范围，log 为 true 时按对数均匀取点 (min 需大于 0)
+    struct Range {
+        float min;
+        float max;
+        int steps;
+        bool log;
+
+        Range() : min(0.0f), max(0.0f), steps(1), log(false) {}
+        Range(float lo, float hi, int n, bool logScale = false) : min(lo), max(hi), steps(n), log(logScale) {}
+    };
+
+    static const int CHUNK = 32; // 每个任务评估的候选数
+
+    explicit PidTuner(const CurrentLoopModel::Load &load = CurrentLoopModel::Load(), int threads = 0);
+
+    void setLoad(const CurrentLoopModel::Load &load) { m_load = load; }
+    const CurrentLoopModel::Load &load() const { return m_load; }
+    // 目标脉冲；pulses 为每个候选仿真的连续脉冲数 (看积分在脉冲间的残留)
+    void setPulse(const StimulationParam &pulse, int pulses = 3);
+    const StimulationParam &pulse() const { return m_pulse; }
+    void setWeights(const Weights &weights) { m_weights = weights; }
+    // 最多占用的执行器线程数
+    int threadCount() const { return m_threads; }
+
+    // 并行评估，结果与输入同序
+    QVector<Result> evaluate(const QVector<PIDParam> &candidates);
+    // 交叉熵迭代：从 seeds 的前 elite 个出发，每轮采样 batch 个，返回所有轮次评估过的结果
+    QVector<Result> optimise(const QVector<Result> &seeds, int rounds, int batch, int elite = 8, quint32 seed = 1);
+
+    double score(const CurrentLoopModel::Metrics &metrics) const;
+
+    static QVector<PIDParam> grid(const Range &kp, const Range &ki, const Range &kd, float limit);
+    // 按评分升序取前 topN 个
+    static QVector<Result> rank(QVector<Result> results, int topN);
+
+private:
+    CurrentLoopModel::Load m_load;
+    StimulationParam m_pulse;
+    int m_pulses;
+    Weights m_weights;
+    int m_threads;
+};
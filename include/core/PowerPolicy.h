@@ -0,0 +1,58 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 23:52:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 23:52:40
+ * @FilePath: \ele_sti\include\core\PowerPolicy.h
+ * @Description: 电源策略：空闲时降低采集节拍，压掉没有变化的波形/状态推送
+ */
+#pragma once
+#include <QObject>
+#include "hal/IBackend.h"
+
+/**
+ * @brief 空闲省电策略 (由 TreatmentService 持有)
+ * @note  Idle：后端采集降到 IDLE_POLL_MS 的心跳 (仍能收到状态包，故障照样急停)；
+ *        波形只有和上次推送的相比有明显变化才往上送，界面不再重画一条平线；
+ *        状态包合并：故障立即推送，电量/频率变化或阻抗变化超过 IMPEDANCE_DELTA 才推送，
+ *        否则最多每 STATUS_KEEPALIVE_MS 推送一次。
+ *        Active：节拍恢复全速，推送不过滤。服务在下发启动命令之前切到 Active，
+ *        节拍命令与启动命令在同一个命令队列里先后执行，启动后第一帧就是全速。
+ */
+class PowerPolicy : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode { Active, Idle };
+    Q_ENUM(Mode)
+
+    static const int IDLE_POLL_MS = 500;
+    static const int STATUS_KEEPALIVE_MS = 5000;
+    static constexpr float WAVE_DELTA_MA = 0.2f;    // 逐点差超过它才算波形有变化 (模拟底噪 ±0.05mA)
+    static constexpr float IMPEDANCE_DELTA = 0.05f; // 阻抗相对变化
+
+    explicit PowerPolicy(IBackend *backend, QObject *parent = nullptr);
+
+    Mode mode() const { return m_mode; }
+    void setActive(bool active);
+
+    // 是否把这一包推送给界面；Active 时恒为 true
+    bool passWaveform(const float *samples, int count);
+    bool passStatus(const StatusPacket &packet, qint64 nowMs);
+
+signals:
+    void modeChanged(PowerPolicy::Mode mode);
+
+private:
+    IBackend *m_backend;
+    Mode m_mode;
+
+    float m_lastWave[WAVEFORM_BATCH_SIZE];
+    bool m_haveWave;
+
+    bool m_haveStatus;
+    float m_lastImpedance;
+    int m_lastBattery;
+    int m_lastFreq;
+    qint64 m_lastStatusMs;
+};
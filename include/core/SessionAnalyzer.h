@@ -0,0 +1,123 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 01:12:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 01:12:40
+ * @FilePath: \ele_sti\include\core\SessionAnalyzer.h
+ * @Description: 治疗记录离线分析：实际电荷量、脉冲与设定参数的符合度、阻抗趋势、故障事件
+ */
+#pragma once
+#include <QStringList>
+#include <QVector>
+#include "common/SessionFormat.h"
+
+/**
+ * @brief 治疗记录分析器
+ * @note  文件用 QFile::map 映射，不整块读进内存。分两步并行：
+ *        1) 每个文件一个任务：校验文件头，顺序扫一遍记录，收集参数变更点，
+ *           状态包送进 TrendStore (与服务同一份趋势累计) 得到阻抗趋势，故障码按跳变记事件；
+ *        2) 所有文件的波形按 chunkRecords 条切块，块交给共享执行器，各写各的结果槽，
+ *           块起点的参数按第 1 步的变更点二分查出，块内遇到参数记录再切换；
+ *        最后在调用线程按块顺序合并。块大小固定，线程多少只影响调度，结果与线程数无关。
+ *
+ *        每包波形的判定 (仅固定参数刺激)：超过设定幅值一半的采样视为该相的平台，
+ *        平台均值与设定幅值的偏差、峰值超调都在容限内才算符合；设定有脉冲而包里没有平台记为缺失。
+ *        电荷量按 平台电流 x 相宽 x 包间隔内的脉冲数 (频率 x M0 时间戳差) 估算，正负相分开累计。
+ */
+class SessionAnalyzer
+{
+public:
+    struct Options {
+        float ampTolerance;   // 平台电流相对设定幅值的允许偏差
+        float overshootLimit; // 峰值相对设定幅值的允许超调
+        float minAmpMa;       // 设定幅值低于它的相不检查 (落在采样噪声里)
+        int chunkRecords;     // 每个块任务的记录数
+
+        Options() : ampTolerance(0.15f), overshootLimit(0.25f), minAmpMa(0.2f), chunkRecords(8192) {}
+    };
+
+    struct ErrorEvent {
+        quint32 hostMs; // 相对治疗开始
+        int code;       // ERR_*
+    };
+
+    // 阻抗每分钟一点 (TrendStore::PerMinute)
+    struct TrendPoint {
+        qint64 startMs;
+        float min;
+        float max;
+        float mean;
+    };
+
+    struct Report {
+        QString path;
+        bool ok = false;
+        QString error;
+        qint64 bytes = 0;
+
+        int mode = ESES_MODE_STIM;
+        qint64 startEpochMs = 0;
+        quint32 plannedS = 0;
+        quint32 elapsedMs = 0;   // 文件头没回写 (异常结束) 时取最后一条记录的时间
+        bool closed = false;     // 文件头是否已回写
+        quint32 records = 0;
+        SessionParam param = {}; // 开始时的参数
+        int paramChanges = 0;
+
+        // 波形
+        quint64 waveforms = 0;
+        quint64 pulseBatches = 0;     // 应当有脉冲的包
+        quint64 conformingBatches = 0;
+        quint64 missingPulses = 0;    // 设定有脉冲但包里没有平台
+        double pulses = 0.0;          // 估算的已输出脉冲数
+        double posChargeUc = 0.0;
+        double negChargeUc = 0.0;
+        double posAmpMean = 0.0;      // 平台电流均值 (mA)
+        double negAmpMean = 0.0;
+        float posAmpErrMaxPct = 0.0f;
+        float negAmpErrMaxPct = 0.0f;
+        float overshootMaxPct = 0.0f;
+
+        // 状态
+        quint64 statuses = 0;
+        float impedanceMin = 0.0f;
+        float impedanceMax = 0.0f;
+        float impedanceMean = 0.0f;
+        QVector<TrendPoint> impedanceTrend;
+        QVector<ErrorEvent> errors;
+
+        double conformityPct() const { return pulseBatches > 0 ? 100.0 * conformingBatches / pulseBatches : 100.0; }
+        double chargeImbalancePct() const;
+    };
+
+    struct Summary {
+        int sessions = 0;
+        int failed = 0;
+        int threads = 0;
+        int chunks = 0;
+        quint64 records = 0;
+        qint64 bytes = 0;
+        qint64 indexNs = 0;   // 第 1 步墙钟时间
+        qint64 chunkNs = 0;   // 第 2 步墙钟时间
+        qint64 elapsedNs = 0; // 总墙钟时间 (含映射与合并)
+
+        double mbPerSec() const { return elapsedNs > 0 ? bytes / 1048576.0 / (elapsedNs / 1e9) : 0.0; }
+        double recordsPerSec() const { return elapsedNs > 0 ? records / (elapsedNs / 1e9) : 0.0; }
+    };
+
+    explicit SessionAnalyzer(const Options &options = Options(), int threads = 0);
+
+    // 最多占用的执行器线程数；设置时 <= 0 为执行器全部线程
+    int threadCount() const { return m_threads; }
+    void setThreadCount(int threads);
+
+    // 结果与 paths 同序；打不开/格式不对的文件 ok 为 false 并带原因
+    QVector<Report> analyze(const QStringList &paths, Summary *summary = nullptr);
+
+    // 展开目录 (递归找 *.eses)，文件原样保留，结果排序去重
+    static QStringList collect(const QStringList &inputs);
+
+private:
+    Options m_options;
+    int m_threads;
+};
@@ -0,0 +1,68 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 00:48:25
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 00:48:25
+ * @FilePath: \ele_sti\include\core\SessionRecorder.h
+ * @Description: 治疗记录：每次治疗一个 .eses 文件，供 ele_sti_analyze 离线审计
+ */
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <memory>
+#include "common/SessionFormat.h"
+#include "core/TaskExecutor.h"
+#include "hal/IBackend.h"
+
+/**
+ * @brief 治疗记录器 (由 TreatmentService 持有，服务线程独占)
+ * @note  没设目录时不记录。服务线程上只把记录拷进预分配的缓冲，攒满 BUFFER_RECORDS 条整块交给
+ *        共享执行器的后台道写出；建目录、打开文件 (无缓冲)、写块、回写文件头都在后台，服务线程不碰磁盘。
+ *        交块时拷贝一次缓冲并提交一个任务 (每 BUFFER_RECORDS 条一次小分配)，逐包路径不分配。
+ *        故障状态包会立即交块，停止时回写文件头里的时长和记录数。
+ */
+class SessionRecorder
+{
+public:
+    static const int BUFFER_RECORDS = 64;
+
+    SessionRecorder();
+    ~SessionRecorder();
+
+    // 记录目录，空字符串关闭记录
+    void setDirectory(const QString &dir) { m_dir = dir; }
+    const QString &directory() const { return m_dir; }
+    bool isRecording() const { return (bool)m_writer; }
+    const QString &currentPath() const { return m_path; }
+
+    // 打开文件在后台进行，失败只打日志，本次记录的数据随后丢弃
+    bool begin(int mode, const StimulationParam &param, int plannedSeconds);
+    void end();
+    // 等已提交的写入全部落盘 (离线工具/基准在读文件之前调用)
+    bool waitWritten(int timeoutMs = -1);
+
+    void record(const WaveformPacket &packet);
+    void record(const StatusPacket &packet);
+    void record(const ProgramStatusPacket &packet);
+    void recordParam(const StimulationParam &param);
+
+    static SessionParam toSessionParam(const StimulationParam &param);
+
+private:
+    struct Writer;
+
+    SessionRecord *next(uint8_t type);
+    void enqueueBuffer();
+    void submit();
+    void flush();
+
+    QString m_dir;
+    QString m_path;
+    SessionHeader m_header;
+    QElapsedTimer m_clock;
+    SessionRecord m_buffer[BUFFER_RECORDS];
+    int m_buffered;
+    std::shared_ptr<Writer> m_writer; // 本次记录的写者，后台任务各持一份引用
+    TaskExecutor::Handle m_lastWrite;
+};
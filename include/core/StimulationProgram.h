@@ -0,0 +1,45 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 10:12:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 10:12:40
+ * @FilePath: \ele_sti\include\core\StimulationProgram.h
+ * @Description: 刺激程序：由多个参数段组成的程序表，整体下载到 M0 后由 M0 定时执行
+ */
+#pragma once
+#include <QVector>
+#include <QString>
+#include "hal/IBackend.h"
+
+class StimulationProgram
+{
+public:
+    StimulationProgram() = default;
+
+    // 恒定段：幅值保持 param 中的值
+    bool appendSegment(const StimulationParam &param, int durationMs);
+    // 斜坡段：频率/脉宽取 from，幅值从 from 线性过渡到 toPosAmp/toNegAmp
+    bool appendRamp(const StimulationParam &from, float toPosAmp, float toNegAmp, int durationMs);
+
+    // 常用程序：缓升 -> 保持 -> 缓降
+    static StimulationProgram softStart(const StimulationParam &target,
+                                        int rampUpMs, int holdMs, int rampDownMs);
+
+    void clear();
+    bool isEmpty() const { return m_segments.isEmpty(); }
+    int segmentCount() const { return m_segments.size(); }
+    int totalDurationMs() const;
+    const QVector<ProgramSegment> &segments() const { return m_segments; }
+    QString lastError() const { return m_lastError; }
+
+    // 整张程序表的 CRC16，与 M0 端校验算法一致
+    uint16_t crc() const;
+    // 拆分成带校验的分块包
+    QVector<ProgramChunkPacket> encodeChunks(uint8_t programId) const;
+
+private:
+    QVector<ProgramSegment> m_segments;
+    QString m_lastError;
+
+    bool appendChecked(const StimulationParam &param, float endPos, float endNeg, int durationMs);
+};
@@ -0,0 +1,137 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 02:05:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 02:05:31
+ * @FilePath: \ele_sti\include\core\TaskExecutor.h
+ * @Description: 共享任务执行器：非实时的分析/导出/解码任务统一在后台核上的工作窃取线程池里跑
+ */
+#pragma once
+
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 工作窃取执行器
+ * @note  每个工作线程一组按优先级分道的双端队列：自己从队头取，空闲的线程从别人的队尾偷；
+ *        取任务时先看所有线程的高优先级道，再看普通、后台道。外部提交轮转分到各线程，
+ *        工作线程里提交的子任务放进自己队列的队头，先于外部任务执行 (fork-join 时更快收尾)。
+ *        工作线程绑在 CpuPlan 的后台核上，不会跑到采集核和渲染核上；线程数默认等于后台核数。
+ *        取消：还没开始的任务直接跳过；已经开始的任务自己检查 Context::cancelled() 提前返回。
+ *        让出：长任务在循环里调用 Context::yield()，有更高优先级的任务在排队时就地执行完再继续。
+ *        每个道的排队时间、执行时间和排队深度进指标 (ele_sti_exec_*)。
+ */
+class TaskExecutor
+{
+public:
+    enum Lane {
+        High = 0,   // 界面在等的结果 (图片解码等)
+        Normal,     // 交互发起的分析 (调谐、离线分析)
+        Background, // 导出、压缩、汇总
+        LANE_COUNT
+    };
+    enum Status { Pending, Running, Done, Cancelled };
+
+    class Context;
+    using Task = std::function<void(Context &)>;
+
+    struct TaskState {
+        std::atomic<int> status{Pending};
+        std::atomic<bool> cancelRequested{false};
+        std::mutex lock;
+        std::condition_variable finished;
+    };
+
+    // 任务句柄：可取消、可等待；丢掉句柄不影响任务执行
+    class Handle
+    {
+    public:
+        Handle() = default;
+        bool isValid() const { return (bool)m_state; }
+        void cancel();
+        Status status() const;
+        // 等到完成或取消；在本执行器的工作线程上等待时会先帮忙执行别的任务，不会占着线程干等
+        bool wait(int timeoutMs = -1);
+
+    private:
+        friend class TaskExecutor;
+        Handle(TaskExecutor *executor, std::shared_ptr<TaskState> state) : m_executor(executor), m_state(std::move(state)) {}
+        TaskExecutor *m_executor = nullptr;
+        std::shared_ptr<TaskState> m_state;
+    };
+
+    class Context
+    {
+    public:
+        bool cancelled() const;
+        // 有更高优先级的任务排队时就地执行它们再返回；返回值同 cancelled()
+        bool yield();
+        Lane lane() const { return m_lane; }
+
+    private:
+        friend class TaskExecutor;
+        Context(TaskExecutor *executor, TaskState *state, Lane lane) : m_executor(executor), m_state(state), m_lane(lane) {}
+        TaskExecutor *m_executor;
+        TaskState *m_state;
+        Lane m_lane;
+    };
+
+    // 进程共享的执行器，首次使用时按 CpuPlan::current().background 创建
+    static TaskExecutor &instance();
+
+    // threads <= 0 时取 cores 的个数 (cores 为空时取 CPU 核数)
+    explicit TaskExecutor(const QVector<int> &cores, int threads = 0, const QString &name = "exec");
+    ~TaskExecutor();
+
+    Handle submit(Task task, Lane lane = Normal);
+
+    /**
+     * @brief 把 [0, count) 按 grain 切块并行执行 fn(begin, end)，返回时全部完成
+     * @param maxParallel 最多占几个工作线程 (<= 0 不限)；在工作线程上调用时调用方也参与
+     */
+    void parallelFor(int count, int grain, const std::function<void(int, int)> &fn, Lane lane = Normal,
+                     int maxParallel = 0);
+
+    int threadCount() const { return (int)m_workers.size(); }
+    int pending() const { return m_queued.load(std::memory_order_relaxed); }
+    const QVector<int> &cores() const { return m_cores; }
+    bool isWorkerThread() const;
+
+private:
+    struct Item {
+        Task task;
+        std::shared_ptr<TaskState> state;
+        Lane lane;
+        qint64 submitNs;
+    };
+    struct Worker {
+        QThread *thread = nullptr;
+        QMutex lock;
+        std::deque<Item> lanes[LANE_COUNT];
+    };
+
+    void workerLoop(int index);
+    // 按优先级取一个任务：先自己队头，再偷别人队尾；只看比 belowLane 高的道
+    bool take(int self, int belowLane, Item &out);
+    void run(Item &item);
+    static void finish(TaskState *state, Status status);
+    // 取不到任务时短暂让出，用于工作线程上的等待
+    bool helpOnce(int belowLane = LANE_COUNT);
+
+    QVector<int> m_cores;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_queued;
+    std::atomic<int> m_laneQueued[LANE_COUNT];
+    std::atomic<unsigned> m_nextWorker;
+    std::atomic<bool> m_stopping;
+    std::mutex m_sleepLock;
+    std::condition_variable m_wake;
+};
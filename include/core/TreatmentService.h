@@ -11,6 +11,13 @@
 #include <QTimer>
 #include <QList>
 #include "hal/IBackend.h"
+#include "core/StimulationProgram.h"
+#include "core/ArbWaveformStreamer.h"
+#include "core/UplinkPipe.h"
+#include "core/TrendStore.h"
+#include "core/TriggerEngine.h"
+#include "core/PowerPolicy.h"
+#include "core/SessionRecorder.h"
 
 class TreatmentService : public QObject
 {
@@ -24,6 +31,13 @@ public:
         Error
     };
     Q_ENUM(Runstate)
+    // 治疗方式：固定参数 / M0 上执行的程序 / 任意波形；只有固定参数可以在运行中调幅
+    enum class Mode {
+        Fixed,
+        Program,
+        Arbitrary
+    };
+    Q_ENUM(Mode)
     explicit TreatmentService(IBackend *backend, QObject *parent = nullptr);
 
     // 纯业务接口
@@ -32,10 +46,36 @@ public:
     // 接收结构体参数
     void updateParameters(const StimulationParam &param);
     void setPIDParameters(const PIDParam &pid);
+    // 旋钮快速通道已经下发过的参数，只同步状态，不再发给后端
+    void applyKnobParameters(const StimulationParam &param);
+    // 旋钮快速通道已经下发过停止命令，只收尾
+    void applyKnobStop();
+
+    // 刺激程序：定义 -> 下载 -> 启动，执行由 M0 完成，这里只跟踪进度
+    bool defineProgram(const StimulationProgram &program);
+    bool uploadProgram();
+    bool startProgram();
+    // 中止程序 (CMD_PROG_ABORT)；停止治疗、急停在程序执行中也走中止
+    bool abortProgram();
+
+    // 任意波形：table 为采样表 (mA)，循环播放 duration 秒
+    bool startArbitraryWaveform(const QVector<float> &table, int sampleRateHz, int duration);
+    const ArbWaveformStreamer *arbStreamer() const { return m_arbStreamer; }
 
     // Getter
     Runstate currentState() const { return m_state; }
+    Mode mode() const { return m_programActive ? Mode::Program : (m_arbActive ? Mode::Arbitrary : Mode::Fixed); }
     int remainingTime() const { return m_remaining_seconds; }
+    const StimulationProgram &program() const { return m_program; }
+    int programState() const { return m_programState; }
+    // 状态趋势 (阻抗/电量/实际频率/错误码)，跨治疗连续累计
+    const TrendStore &trends() const { return m_trends; }
+    // 触发采集：开启后每个波形包都过一遍触发扫描，采到的窗口由 captured 信号给出
+    TriggerEngine *trigger() const { return m_trigger; }
+    // 电源策略：不在治疗时降低采集节拍、过滤没有变化的推送
+    PowerPolicy *power() const { return m_power; }
+    // 治疗记录：设了目录后每次治疗写一个 .eses 文件 (ele_sti_analyze 离线分析)
+    SessionRecorder &recorder() { return m_recorder; }
     StimulationParam m_currentParam;
 
 signals:
@@ -47,17 +87,56 @@ signals:
     void monitoringDataReady(float impedance, int battery, int error);
     // 波形数据就绪
     void waveformReceived(const QVector<float> &data);
+    // 参数被界面/命令修改 (不含旋钮)
+    void parametersChanged(const StimulationParam &param);
+    // 参数被旋钮修改，界面据此刷新
+    void parametersAdjusted(const StimulationParam &param);
+    // 程序状态变化 (PROG_STATE_*)
+    void programStateChanged(int state);
+    // 程序执行进度
+    void programProgress(int segmentIndex, int elapsedMs, int totalMs);
+    // 趋势有变化：各分辨率是否新开了桶/覆盖了最旧的桶 (同线程直连，接收方据此只刷新变化的行)
+    void trendUpdated(const TrendStore::Update &update);
+    // 任意波形预填完成：启动后 M0 第一次回报缓冲已填满 (启动不在本线程上等待)
+    void arbitraryReady();
+    // 下行命令的完成回报 (已下发/被合并/被取消/失败，带排队和执行时间)
+    void commandFinished(const CommandResult &result);
 
 
 private:
     IBackend *m_backend;
+    UplinkPipe *m_uplink;
+    QVector<float> m_waveBuffer; // 每包复用
+    TrendStore m_trends;
+    TriggerEngine *m_trigger;
+    PowerPolicy *m_power;
+    SessionRecorder m_recorder;
     QTimer *m_timer;
     Runstate m_state;
     int m_remaining_seconds;
 
+    StimulationProgram m_program;
+    uint8_t m_programId;
+    int m_programState;
+    bool m_programActive; // 当前治疗是否由程序驱动
+
+    ArbWaveformStreamer *m_arbStreamer;
+    bool m_arbActive;     // 当前治疗是否为任意波形模式
+    bool m_arbPriming;    // 已启动，还没收到缓冲填满的回报
+
+    // 丢帧估计
+    bool m_hasTick;
+    uint32_t m_lastTick;
+    double m_avgTickDelta;
+
     // 内部处理逻辑
+    // fault 非空时 (急停) 在关闭本次记录之前补记这个故障包
+    void finishTreatment(bool sendStop, const StatusPacket *fault = nullptr);
     void onTimerTick();
     void handleStatusPacket(const StatusPacket &packet);
     void handleWaveformPacket(const WaveformPacket &packet);
+    void handleProgramStatus(const ProgramStatusPacket &packet);
+    void handleCommandResult(const CommandResult &result);
+    void trackTickGap(uint32_t tickUs);
 
 };
@@ -0,0 +1,85 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:40:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:40:06
+ * @FilePath: \ele_sti\include\core\TrendStore.h
+ * @Description: 状态趋势存储：固定容量的多分辨率环形缓冲 (每秒/每 10 秒/每分钟 min/max/mean)
+ */
+#pragma once
+
+#include <QtGlobal>
+#include <vector>
+#include "common/protocol_data.h"
+
+/**
+ * @brief 状态包趋势
+ * @note  每个分辨率一个环，容量在构造时一次分配，之后不再增长；
+ *        每来一个样本只更新各分辨率当前桶 (O(1))，跨桶时关闭旧桶、开新桶，环满覆盖最旧的。
+ *        三个分辨率都直接从原始样本累计，粗分辨率的 min/max 不会因二次平均而失真。
+ *        非线程安全，由服务所在线程独占。
+ */
+class TrendStore
+{
+public:
+    enum Series {
+        Impedance = 0,
+        Battery,
+        RealFreq,
+        ErrorCode,
+        SERIES_COUNT
+    };
+    enum Level {
+        PerSecond = 0,
+        Per10Seconds,
+        PerMinute,
+        LEVEL_COUNT
+    };
+    enum Stat {
+        Min = 0,
+        Max,
+        Mean
+    };
+
+    struct Accum {
+        float min;
+        float max;
+        double sum;
+    };
+    struct Bucket {
+        qint64 startMs;  // 桶起点 (epoch ms，按分辨率对齐)
+        int count;       // 样本数
+        Accum series[SERIES_COUNT];
+    };
+
+    // 本次样本对各分辨率的影响，供模型只通知变化的行
+    struct Update {
+        bool opened[LEVEL_COUNT];  // 新开了一个桶 (模型追加一行)
+        bool evicted[LEVEL_COUNT]; // 环满，最旧的桶被覆盖 (模型删掉第一行)
+    };
+
+    TrendStore();
+
+    static qint64 spanMs(Level level);
+    static int capacity(Level level);
+
+    Update addSample(qint64 epochMs, const StatusPacket &packet);
+    Update addSample(qint64 epochMs, const float values[SERIES_COUNT]);
+    void clear();
+
+    // 行 0 最旧，最后一行是正在累计的桶
+    int size(Level level) const { return m_rings[level].size; }
+    const Bucket &at(Level level, int row) const;
+    double value(Level level, int row, Series series, Stat stat) const;
+    quint64 samples() const { return m_samples; }
+
+private:
+    struct Ring {
+        std::vector<Bucket> buckets;
+        int head = 0; // 最旧的桶
+        int size = 0;
+    };
+
+    Ring m_rings[LEVEL_COUNT];
+    quint64 m_samples;
+};
@@ -0,0 +1,109 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:05:44
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:05:44
+ * @FilePath: \ele_sti\include\core\TriggerEngine.h
+ * @Description: 示波器式触发采集：上升沿/下降沿/窗口触发，预触发环形缓冲，自动/常规/单次
+ */
+#pragma once
+#include <QObject>
+#include <QVector>
+#include <vector>
+
+/**
+ * @brief 触发引擎
+ * @note  在全速采样流上逐块扫描，只把采到的窗口交给显示。
+ *        每块先做一次 min/max 归约 (分 LANES 路累计，编译器能向量化)，
+ *        块内不可能触发时直接跳过，逐点扫描只发生在候选块上；
+ *        迟滞：越过 level 之前必须先回到 level 另一侧 hysteresis 以外，抑制噪声抖动。
+ *        预触发历史一直写进环形缓冲，触发后拼上预触发段再收后触发段。
+ *        所有缓冲在 setConfig 时按最大深度分配，采集过程中不分配。非线程安全，由服务线程调用。
+ */
+class TriggerEngine : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        Off = 0,  // 不触发，显示实时批次
+        Auto,     // 有触发按触发采，超时没触发也强制采一帧
+        Normal,   // 只在触发时采，采完自动重新装填
+        Single    // 采一帧后停住，arm() 重新装填
+    };
+    Q_ENUM(Mode)
+    enum Type {
+        Rising = 0,
+        Falling,
+        Window    // 离开 [low, high] 时触发
+    };
+    Q_ENUM(Type)
+
+    struct Config {
+        Mode mode = Off;
+        Type type = Rising;
+        float level = 0.0f;      // 沿触发电平 (mA)
+        float low = -1.0f;       // 窗口下限 (mA)
+        float high = 1.0f;       // 窗口上限 (mA)
+        float hysteresis = 0.2f; // 迟滞 (mA)
+        int preSamples = 200;    // 触发点之前的采样数
+        int postSamples = 800;   // 触发点及之后的采样数
+    };
+
+    static const int MAX_DEPTH = 8192; // 预/后触发各自的最大深度
+    static const int LANES = 8;        // min/max 归约的并行路数
+
+    explicit TriggerEngine(QObject *parent = nullptr);
+
+    void setConfig(const Config &config);
+    const Config &config() const { return m_config; }
+    bool isActive() const { return m_config.mode != Off; }
+    bool isArmed() const { return m_state != State::Idle; }
+    // Single 模式采完后重新装填；其他模式下清空已采的部分重新开始
+    void arm();
+
+    // 喂一块采样 (一般是一个波形包的 adc_batch)
+    void process(const float *samples, int count);
+
+    // 统计
+    quint64 captures() const { return m_captures; }
+    quint64 scannedBlocks() const { return m_scannedBlocks; }
+    quint64 skippedBlocks() const { return m_skippedBlocks; }
+
+    // 块内 min/max，供扫描和基准使用
+    static void blockMinMax(const float *samples, int count, float &minOut, float &maxOut);
+
+signals:
+    // 采到一帧：samples 复用内部缓冲，接收方要保留就自己拷贝；
+    // triggerIndex 为触发点在 samples 中的下标，forced 为 Auto 超时强制采的
+    void captured(const QVector<float> &samples, int triggerIndex, bool forced);
+
+private:
+    enum class State {
+        Idle,       // 未装填
+        Armed,      // 找触发点
+        Collecting  // 收后触发段
+    };
+
+    int scan(const float *samples, int count);
+    void pushHistory(const float *samples, int count);
+    void beginCapture(bool forced);
+    void finishCapture();
+
+    Config m_config;
+    State m_state;
+    bool m_ready;             // 迟滞已满足，下一次越过电平即触发
+
+    std::vector<float> m_history; // 预触发环形缓冲
+    int m_historyHead;            // 下一个写入位置
+    int m_historyFill;
+
+    QVector<float> m_capture;     // 采集结果，每帧复用
+    int m_triggerIndex;
+    int m_collected;              // 已收的后触发采样数
+    bool m_forced;
+    qint64 m_sinceArm;            // 装填后经过的采样数，Auto 超时用
+
+    quint64 m_captures;
+    quint64 m_scannedBlocks;
+    quint64 m_skippedBlocks;
+};
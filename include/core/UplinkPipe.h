@@ -0,0 +1,74 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:30:06
+ * @FilePath: \ele_sti\include\core\UplinkPipe.h
+ * @Description: 上行包跨线程交接：预分配环形槽 + eventfd 唤醒，稳态不分配内存
+ */
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <atomic>
+#include "common/SpscRing.h"
+#include "common/protocol_data.h"
+
+class QSocketNotifier;
+
+/**
+ * @brief 后端线程 -> 业务线程 的上行包通道
+ * @note  取代排队信号：排队信号每个包都要 new 一个事件并拷贝参数。
+ *        这里包直接拷进预分配的槽位；只有消费端处于空闲 (已取空) 时才写一次 eventfd 唤醒，
+ *        消费端在自己线程的事件循环里由 QSocketNotifier 触发，一次取空并逐个发 *Ready 信号。
+ *        push 可在任意线程调用 (多通道时故障状态包可能来自别的采集线程，用一把几乎不竞争的锁串行化)。
+ *        槽位满时丢包并计数；带错误码的状态包不丢，放进单独的故障槽，下次取包时最先处理。
+ *        非 Linux 平台没有 eventfd，退回到每次唤醒投递一个排队调用 (会分配)。
+ */
+class UplinkPipe : public QObject
+{
+    Q_OBJECT
+public:
+    static const size_t CAPACITY = 256;
+
+    explicit UplinkPipe(QObject *parent = nullptr);
+    ~UplinkPipe() override;
+
+    // 生产端 (任意线程)
+    void push(const WaveformPacket &packet);
+    void push(const StatusPacket &packet);
+    void push(const ProgramStatusPacket &packet);
+
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+signals:
+    // 消费端线程上发出
+    void waveformReady(const WaveformPacket &packet);
+    void statusReady(const StatusPacket &packet);
+    void programStatusReady(const ProgramStatusPacket &packet);
+
+private:
+    enum Kind : uint8_t { KindWave, KindStatus, KindProgramStatus };
+    struct Record {
+        Kind kind;
+        union {
+            WaveformPacket wave;
+            StatusPacket status;
+            ProgramStatusPacket program;
+        };
+        Record() : kind(KindWave) {}
+    };
+
+    void enqueue(const Record &record);
+    void wake();
+    void drain();
+
+    SpscRing<Record, CAPACITY> m_ring;
+    QMutex m_pushMutex;
+    std::atomic<bool> m_armed;       // 已唤醒、消费端尚未开始取
+    std::atomic<bool> m_hasFault;    // 故障槽有包
+    StatusPacket m_fault;            // 受 m_pushMutex 保护
+    std::atomic<quint64> m_dropped;
+    int m_eventFd;
+    QSocketNotifier *m_notifier;
+};
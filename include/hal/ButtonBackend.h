@@ -13,6 +13,12 @@
 #include <QTimer>
 #include <QByteArray>
 #include "common/protocol_data.h"
+#include "common/FrameParser.h"
+#include <cstddef>
+
+// 面板串口帧：AA cmd value checksum FF，checksum 为前 3 字节累加和
+using ButtonFramePolicy = FixedFramePolicy<ButtonPacket, FRAME_HEAD, FRAME_TAIL,
+                                           SumChecksumAt<offsetof(ButtonPacket, checksum)>>;
 
 class ButtonBackend : public QObject
 {
@@ -28,21 +34,45 @@ public:
      */
     bool openSerial(const QString &portName);
 
+    /**
+     * @brief 处理一段接收到的字节流 (分帧 + 分发)
+     * @note  onReadyRead 读到数据后调用；也供基准测试直接喂数据
+     */
+    void processBytes(const QByteArray &data);
+
+    // 分帧统计 (帧数、重同步、坏帧、丢弃字节)
+    const FrameParser<ButtonFramePolicy>::Counters &frameCounters() const { return m_parser.counters(); }
+
 signals:
     void startFromSerial();
 
     /**
      * @brief 信号：旋钮被单击（停止/暂停，如有需要）
      * 对应屏幕配置：Encoder Mode 4 -> Single Click
+     * @param rxNs 收到该帧的时刻 (LatencyTracer::nowNs)
      */
-    void sigSingleClickStop();
+    void sigSingleClickStop(qint64 rxNs);
+
+    /**
+     * @brief 信号：旋钮转动
+     * @param detents 相对上一帧转过的格数，顺时针为正
+     * @param rxNs    收到该帧的时刻，用于统计旋钮到控制包的延迟
+     * @note  在串口线程上发出，接收方应直连并自行合并
+     */
+    void knobRotated(int detents, qint64 rxNs);
 
 
 private slots:
     void onReadyRead(); // 接收串口数据
 
 private:
+    void handleFrame(const ButtonPacket &packet);
+    void setLowLatency();
+
     QSerialPort *serial;
-    QByteArray buffer;
+    FrameParser<ButtonFramePolicy> m_parser;
+    FrameParser<ButtonFramePolicy>::Counters m_reported; // 已同步到指标的计数
+    qint64 m_rxNs;            // 当前这批字节的接收时刻
+    bool m_knobValid;         // 是否已收到过旋钮计数
     uint16_t m_lastKnobVal;   // 记录上一次读到的旋钮值
 };
@@ -0,0 +1,78 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 23:20:14
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 23:20:14
+ * @FilePath: \ele_sti\include\hal\CommandQueue.h
+ * @Description: 采集线程上的下行命令队列：分优先级、停止抢占、参数更新合并、完成回报
+ */
+#pragma once
+
+#include "hal/IBackend.h"
+#include <QEvent>
+#include <QMutex>
+#include <QObject>
+#include <deque>
+#include <functional>
+
+/**
+ * @brief 下行命令队列 (每个采集线程一个，对象本身也住在该线程)
+ * @note  任何线程都可以 submit，只在锁内入队，不碰 SPI；命令只在所属线程上执行，
+ *        与该线程的上行轮询天然串行，后端不再需要为 SPI 加锁。
+ *        优先级：Emergency (停止/中止) > Control (启动/PID/程序/任意波形) > Update (参数更新)，
+ *        同级先进先出。停止类入队时取消所有排队中的会输出电流的命令 (启动、参数更新、
+ *        启动程序/任意波形)，并用高优先级事件唤醒，排在该线程已有的定时器/投递事件前面。
+ *        参数更新、PID 和采集节拍按 (类型, mergeKey) 合并：新命令替换还没执行的旧命令，旧命令回报 Superseded。
+ *        抢占粒度是一条命令：已经开始的传输 (如分块下载程序) 会做完再执行停止。
+ *        同线程提交 (旋钮通道) 直接就地执行，已排队的更高优先级命令先执行，顺序不会乱。
+ */
+class CommandQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority { Emergency, Control, Update, PRIORITY_COUNT };
+
+    // 在所属线程上执行，返回 false 表示下发失败
+    typedef std::function<bool(int &channels)> Task;
+    typedef std::function<void(const CommandResult &)> Completion;
+
+    explicit CommandQueue(QObject *parent = nullptr);
+    ~CommandQueue() override;
+
+    static Priority priorityOf(CommandResult::Kind kind);
+    static bool isMergeable(CommandResult::Kind kind);
+    static bool isEnergising(CommandResult::Kind kind);
+
+    /**
+     * @brief 提交命令
+     * @param mergeKey 可合并命令的目标 (通道号，广播为 -1)
+     * @param done     命令结束时调用：执行完的在所属线程上，被合并/取消的在提交新命令的线程上
+     */
+    void submit(quint64 id, CommandResult::Kind kind, int mergeKey, Task task, Completion done);
+
+    int pending() const;
+
+protected:
+    bool event(QEvent *e) override;
+
+private:
+    struct Command {
+        quint64 id;
+        CommandResult::Kind kind;
+        int mergeKey;
+        qint64 submitNs;
+        Task task;
+        Completion done;
+    };
+
+    void drain();
+    void wake(bool urgent);
+    static void finish(const Command &cmd, CommandResult::Status status, int channels, qint64 queueNs, qint64 execNs);
+
+    mutable QMutex m_lock;
+    std::deque<Command> m_queues[PRIORITY_COUNT];
+    int m_pending;
+    bool m_wakePosted;
+    bool m_urgentPosted;
+    bool m_draining; // 只在所属线程上读写
+};
@@ -0,0 +1,133 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 20:15:37
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 20:15:37
+ * @FilePath: \ele_sti\include\hal\DeviceManager.h
+ * @Description: 多设备/多通道后端管理：持有 N 个后端和采集线程，对上层表现为一个 IBackend
+ */
+#pragma once
+
+#include "hal/IBackend.h"
+#include "hal/CommandQueue.h"
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief 组合后端
+ * @note  每个通道是一个独立的 IBackend (一块 M0 或一个模拟器)。
+ *        采集线程数 = min(通道数, maxThreads)，通道按轮转分到线程上，
+ *        RK3568 四核上默认每核一个线程，通道数不超过核数时吞吐随通道数线性增长。
+ *        IBackend 接口的启动/参数命令广播给所有启用的通道，停止、中止程序、PID、采集节拍发给全部通道
+ *        (通道在刺激中被停用也必须能停下来)：每个采集线程一个 CommandQueue，
+ *        调用方线程只入队，不碰 SPI (界面线程从不阻塞在传输上)；停止类抢占、参数更新合并，
+ *        与通道同线程的调用 (旋钮通道) 就地执行。每次调用分配一个命令号 (lastCommandId)，
+ *        所有线程上的部分都结束后发一次 commandFinished，带各线程中最长的排队/执行时间。
+ *        启动/停止经过同步点：各线程先在同步点会合再同时下发，最多等 SYNC_TIMEOUT_US，
+ *        超时的线程不再等待，停止命令不会因为某个通道卡住而被拖住。
+ *        上行数据：所有通道经 channel* 信号带通道号发出；IBackend 信号只转发主通道 (0)，
+ *        其他通道的故障状态包也转发，保证任一通道出错都会触发服务层急停。
+ *        程序和任意波形只下发到主通道 (采样源按块消费，不能多通道共享)。
+ */
+class DeviceManager : public IBackend
+{
+    Q_OBJECT
+public:
+    static const int PRIMARY_CHANNEL = 0;
+    static const int SYNC_TIMEOUT_US = 2000;
+
+    // maxThreads <= 0 时取 CPU 核数
+    explicit DeviceManager(int maxThreads = 0, QObject *parent = nullptr);
+    ~DeviceManager() override;
+
+    // ---------- 配置 (start 之前调用) ----------
+    // 接管 backend 的所有权；init 在通道线程上执行，返回 false 表示打开设备失败
+    int addDevice(IBackend *backend, std::function<bool()> init);
+    int addSimulator();
+#ifdef Q_OS_LINUX
+    int addSpiDevice(const QString &devicePath);
+#endif
+
+    // 建线程、把后端移过去并初始化，全部初始化完成后发 initFinished
+    void start();
+    // 退出并回收所有线程，后端随线程结束删除
+    void shutdown();
+    // 采集线程 i 绑到 cores[i % n]，start 之后调用；cores 为空时不动
+    void pinThreads(const QVector<int> &cores);
+
+    // ---------- 通道 ----------
+    int channelCount() const { return (int)m_channels.size(); }
+    int threadCount() const { return m_threads.size(); }
+    IBackend *channel(int index) const { return m_channels[index]->backend; }
+    QThread *channelThread(int index) const;
+    void setChannelEnabled(int index, bool enabled);
+    bool isChannelEnabled(int index) const { return m_channels[index]->enabled.load(); }
+
+    // 按通道下发：perChannel 按通道号取参数，不足的通道用最后一个。
+    // 治疗服务目前只持有一组参数、只走广播接口；按通道的接口供基准和多通道调试工具直接调用
+    void startStimulation(const QVector<StimulationParam> &perChannel);
+    void updateChannelParameters(int index, const StimulationParam &param);
+
+    quint64 channelWavePackets(int index) const { return m_channels[index]->waves.load(std::memory_order_relaxed); }
+    quint64 channelStatusPackets(int index) const { return m_channels[index]->statuses.load(std::memory_order_relaxed); }
+    int channelErrorCode(int index) const { return m_channels[index]->lastError.load(std::memory_order_relaxed); }
+
+    // ---------- IBackend ----------
+    void startStimulation(const StimulationParam &param) override;
+    void stopStimulation() override;
+    void updateParameters(const StimulationParam &param) override;
+    void setPIDParameters(const PIDParam &pid) override;
+
+    void uploadProgram(const QVector<ProgramChunkPacket> &chunks) override;
+    void startProgram(uint8_t programId) override;
+    void abortProgram() override;
+
+    void startArbitrary(IArbSampleSource *source, int sampleRateHz) override;
+    void stopArbitrary() override;
+
+    void setAcquisitionInterval(int ms) override;
+
+    quint64 transferErrors() const override;
+    quint64 lastCommandId() const override { return m_lastCommandId.load(std::memory_order_relaxed); }
+
+signals:
+    void channelWaveReceived(int channel, const WaveformPacket &packet);
+    void channelStatusReceived(int channel, const StatusPacket &packet);
+    void channelError(int channel, QString msg);
+    // 所有通道 init 执行完毕，failed 为失败的通道数
+    void initFinished(int failed);
+
+private:
+    struct alignas(64) Channel {
+        IBackend *backend = nullptr;
+        std::function<bool()> init;
+        int worker = 0;
+        std::atomic<bool> enabled{true};
+        std::atomic<quint64> waves{0};
+        std::atomic<quint64> statuses{0};
+        std::atomic<int> lastError{0};
+    };
+    struct SyncPoint;
+    struct PendingCommand;
+
+    void wireChannel(int index);
+    QVector<int> enabledChannels() const;
+    QVector<int> allChannels() const;
+    // 按线程分组，每个线程的命令队列一条命令，依次对本线程上的通道执行 fn；
+    // sync 为 true 时各线程先在同步点会合。返回命令号
+    quint64 submit(CommandResult::Kind kind, int mergeKey, const QVector<int> &channels, bool sync,
+                   std::function<void(int, IBackend *)> fn);
+
+    int m_maxThreads;
+    std::vector<std::unique_ptr<Channel>> m_channels;
+    QVector<QThread *> m_threads;
+    QVector<CommandQueue *> m_queues; // 与 m_threads 一一对应，对象住在各自线程
+    std::atomic<quint64> m_nextCommandId;
+    std::atomic<quint64> m_lastCommandId;
+    std::atomic<int> m_initPending;
+    std::atomic<int> m_initFailed;
+};
@@ -9,6 +9,7 @@
 #pragma once
 # include "common/protocol_data.h"
 # include <QObject>
+# include <QVector>
 
 // 刺激参数结构体
 struct StimulationParam
@@ -36,6 +37,37 @@ struct PIDParam {
     PIDParam() : kp(1.0f), ki(0.0f), kd(0.0f), limit(100.0f) {}
 };
 
+// 命令完成回报：排队时间 = 提交到开始执行，执行时间 = 后端线程上实际下发 (SPI 传输) 的耗时
+struct CommandResult
+{
+    enum Kind { Start, Stop, Update, Pid, ProgramUpload, ProgramStart, ProgramAbort, ArbStart, ArbStop, Acquisition };
+    // 按严重程度排序，多通道合并结果时取最严重的
+    enum Status {
+        Done,       // 已下发到设备
+        Superseded, // 还在排队时被同类的新命令合并掉 (参数更新、PID)
+        Cancelled,  // 还在排队时被停止类命令抢占取消
+        Failed      // 下发时传输出错
+    };
+
+    quint64 id;
+    Kind kind;
+    Status status;
+    int channels;   // 实际执行的通道数
+    qint64 queueNs;
+    qint64 execNs;
+
+    CommandResult() : id(0), kind(Start), status(Done), channels(0), queueNs(0), execNs(0) {}
+};
+
+// 任意波形采样源：由后端线程按 M0 回传的 credits 拉取采样块
+class IArbSampleSource
+{
+public:
+    virtual ~IArbSampleSource() {}
+    // 取出下一块，源暂时没有数据 (欠载) 时返回 false
+    virtual bool takeBlock(ArbWavePacket &out) = 0;
+};
+
 class IBackend : public QObject
 {
     Q_OBJECT
@@ -52,13 +84,34 @@ virtual void updateParameters(const StimulationParam &param)=0;
 // 设置 PID 参数
 virtual void setPIDParameters(const PIDParam &pid) = 0;
 
+// 刺激程序：分块下载，按编号启动，中止
+virtual void uploadProgram(const QVector<ProgramChunkPacket> &chunks) = 0;
+virtual void startProgram(uint8_t programId) = 0;
+virtual void abortProgram() = 0;
+
+// 任意波形：进入/退出任意波形模式，source 的生命周期由调用方保证
+virtual void startArbitrary(IArbSampleSource *source, int sampleRateHz) = 0;
+virtual void stopArbitrary() = 0;
+
+// 采集节拍：ms 为上行轮询/模拟帧的间隔，0 表示恢复后端自己的全速节拍 (空闲省电用)
+virtual void setAcquisitionInterval(int ms) { Q_UNUSED(ms); }
+
+// 累计传输失败次数，命令队列据此判断一次下发是否成功；没有物理链路的后端恒为 0
+virtual quint64 transferErrors() const { return 0; }
+// 最近一次命令的编号 (与 commandFinished 的 id 对应)；不排队的后端为 0
+virtual quint64 lastCommandId() const { return 0; }
+
 signals:
     // 波形数据包接收
     void waveDataReceived(const WaveformPacket &packet);
     // 状态数据包接收
     void statusDataReceived(const StatusPacket &packet);
+    // 程序执行进度包接收
+    void programStatusReceived(const ProgramStatusPacket &packet);
     // 错误发生
     void errorOccurred(QString msg);
+    // 命令执行完/被合并/被取消 (在后端线程上发出)
+    void commandFinished(const CommandResult &result);
 
 
 };
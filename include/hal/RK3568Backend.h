@@ -1,48 +1,78 @@
-// /*
-//  * @Author: takuyasaya 1754944616@qq.com
-//  * @Date: 2025-12-16 17:01:57
-//  * @LastEditors: takuyasaya 1754944616@qq.com
-//  * @LastEditTime: 2025-12-23 14:21:46
-//  * @FilePath: \ele_sti\include\hal\RK3568Backend.h
-//  * @Description: 这是默认设置,请设置`customMade`, 打开koroFileHeader查看配置 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
-//  */
-// #pragma once
-// #include "IBackend.h"
-// #include <QMutex>
-// #include <QThread>
-// #include <QTimer>
-// #define GPIO_PRE  "100"
-// #define GPIO_CLR  "101"
-
-// class RK3568Backend : public IBackend
-// {
-//     Q_OBJECT
-
-// public:
-//     explicit RK3568Backend(QObject *parent = nullptr);
-//             ~RK3568Backend() override;
-
-//     bool init(const QString &devicePath = "/dev/spidev3.0");
-
-//     // 开始/停止刺激
-//     void startStimulation(const StimulationParam &param)override;
-//     void stopStimulation()override;
-//     void updateParameters(const StimulationParam &param)override;
-
-//     // PID 参数设置
-//     void setPIDParameters(const PIDParam &pid) override;
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2025-12-16 17:01:57
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 10:40:12
+ * @FilePath: \ele_sti\include\hal\RK3568Backend.h
+ * @Description: 硬件抽象层：RK3568 真实硬件后端，通过 spidev 与 M0 通信 (仅 Linux 编译)
+ */
+#pragma once
+#include "IBackend.h"
+#include "common/PacketCodec.h"
+#include <QThread>
+#include <QTimer>
+#include <QAtomicPointer>
+#include <atomic>
+#define GPIO_PRE  "100"
+#define GPIO_CLR  "101"
+
+class RK3568Backend : public IBackend
+{
+    Q_OBJECT
+
+public:
+    static const int POLL_INTERVAL_MS = 20; // 全速轮询间隔
+
+    explicit RK3568Backend(QObject *parent = nullptr);
+            ~RK3568Backend() override;
+
+    bool init(const QString &devicePath = "/dev/spidev3.0");
+
+    // 开始/停止刺激
+    void startStimulation(const StimulationParam &param)override;
+    void stopStimulation()override;
+    void updateParameters(const StimulationParam &param)override;
+
+    // PID 参数设置
+    void setPIDParameters(const PIDParam &pid) override;
+
+    // 刺激程序
+    void uploadProgram(const QVector<ProgramChunkPacket> &chunks) override;
+    void startProgram(uint8_t programId) override;
+    void abortProgram() override;
+
+    // 任意波形
+    void startArbitrary(IArbSampleSource *source, int sampleRateHz) override;
+    void stopArbitrary() override;
+
+    void setAcquisitionInterval(int ms) override;
+    quint64 transferErrors() const override { return m_transferErrors.load(std::memory_order_relaxed); }
     
-//     // 硬件使能电路
-//     void setGpio(const char *gpio_Pin , int value);
-//     void enableHardwareSwitch(bool enable);
-// private slots:
-//     void readData();
+    // 硬件使能电路
+    void setGpio(const char *gpio_Pin , int value);
+    void enableHardwareSwitch(bool enable);
+private slots:
+    void readData();
+
+private:
+    // 上行包按帧头查表分发到 onPacket
+    typedef PacketDispatcher<RK3568Backend, WaveformPacket, LegacyWaveformPacket, StatusPacket, ProgramStatusPacket> Uplink;
+    friend Uplink;
+    void onPacket(const WaveformPacket &packet);
+    void onPacket(const LegacyWaveformPacket &packet);
+    void onPacket(const StatusPacket &packet);
+    void onPacket(const ProgramStatusPacket &packet);
+    qint64 m_rxNs; // 本次上行传输完成的时刻
 
-// private:
-//     int m_fd;
-//     QTimer* m_readTimer;
-//     QMutex m_mutex;
-//     bool spiTransfer(const void *tx, void *rx, int len);
+    int m_fd;
+    QTimer* m_readTimer;
+    // 所有传输 (轮询和命令队列下发的命令) 都在本对象所在线程上，不需要锁；
+    // 计数只在本线程写，但 DeviceManager::transferErrors() 会从别的线程读
+    std::atomic<quint64> m_transferErrors;
+    bool spiTransfer(const void *tx, void *rx, int len);
+    void sendControl(uint8_t cmd, const StimulationParam *param);
 
-// };
+    QAtomicPointer<IArbSampleSource> m_arbSource; // 非空表示处于任意波形模式
+    void sendArbBlocks(int credits);
 
+};
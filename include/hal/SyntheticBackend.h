@@ -0,0 +1,66 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 04:02:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 04:02:18
+ * @FilePath: \ele_sti\include\hal\SyntheticBackend.h
+ * @Description: 合成数据后端：按给定速率产生波形包和状态包，用于界面帧时间基准
+ */
+#pragma once
+#include "IBackend.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @brief 合成后端
+ * @note  与 WinBackend 的区别：不跑恒流环仿真，只按参数画出双相脉冲的形状，开销可以忽略；
+ *        波形包和状态包的速率独立可调，可以远高于真实 M0 (用来压测界面)。
+ *        定时器 1ms 一跳，每跳按流逝时间补齐应发的包数，速率超过 1kHz 时一跳发多个包。
+ *        每包带 ±0.05mA 底噪，小于省电过滤的 PowerPolicy::WAVE_DELTA_MA (0.2mA)：空闲时停止态的平线
+ *        照样被当成"波形未变化"压掉，要看满速率的波形得先开始治疗 (FrameBench 就是这样做的)。
+ *        其余命令只缓存状态，不模拟程序和任意波形；采集节拍由本后端自己的速率决定，忽略省电降频。
+ */
+class SyntheticBackend : public IBackend
+{
+    Q_OBJECT
+public:
+    explicit SyntheticBackend(int waveHz, int statusHz, QObject *parent = nullptr);
+    ~SyntheticBackend() override;
+
+    // 在通道线程上调用：定时器要建在所属线程里
+    bool init();
+
+    void startStimulation(const StimulationParam &param) override;
+    void stopStimulation() override;
+    void updateParameters(const StimulationParam &param) override;
+    void setPIDParameters(const PIDParam &pid) override;
+
+    void uploadProgram(const QVector<ProgramChunkPacket> &chunks) override;
+    void startProgram(uint8_t programId) override;
+    void abortProgram() override;
+
+    void startArbitrary(IArbSampleSource *source, int sampleRateHz) override;
+    void stopArbitrary() override;
+
+    int waveHz() const { return m_waveHz; }
+    int statusHz() const { return m_statusHz; }
+
+private slots:
+    void onTick();
+
+private:
+    void emitWave();
+    void emitStatus();
+    float noise();
+
+    int m_waveHz;
+    int m_statusHz;
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_wavesSent;   // 启动以来已发的波形包数
+    qint64 m_statusSent;
+    bool m_isRunning;
+    StimulationParam m_cachedParam;
+    uint32_t m_noiseSeed;
+};
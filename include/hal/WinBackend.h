@@ -1,12 +1,16 @@
 #pragma once
 #include "IBackend.h"
+#include "core/CurrentLoopModel.h"
 #include <QTimer>
 #include <QObject>
+#include <QElapsedTimer>
 
 class WinBackend : public IBackend
 {
     Q_OBJECT
 public:
+    static const int SIM_INTERVAL_MS = 50; // 全速时的模拟帧间隔
+
     explicit WinBackend(QObject *parent = nullptr);
     ~WinBackend() override;
 
@@ -19,6 +23,17 @@ public:
     void stopStimulation() override;
     void setPIDParameters(const PIDParam &pid) override;
     void updateParameters(const StimulationParam &param) override;
+
+    void uploadProgram(const QVector<ProgramChunkPacket> &chunks) override;
+    void startProgram(uint8_t programId) override;
+    void abortProgram() override;
+
+    void startArbitrary(IArbSampleSource *source, int sampleRateHz) override;
+    void stopArbitrary() override;
+    void setAcquisitionInterval(int ms) override;
+
+    // 仅模拟器：设置模拟的电极负载 (调谐工具校验时与仿真用同一负载)
+    void setLoad(const CurrentLoopModel::Load &load) { m_loop.setLoad(load); }
 private slots:
     // 模拟数据生成的槽函数
     void onSimulateTimer();
@@ -26,6 +41,32 @@ private slots:
 private:
     QTimer *m_simTimer; // 模拟定时器
     bool m_isRunning;   // 是否处于"运行"状态
-    double m_phase;     // 用于生成正弦波的相位
+    CurrentLoopModel m_loop; // 模拟 M0 恒流环 (PID + 电极负载)
     StimulationParam m_cachedParam; // 缓存当前的参数
+    QElapsedTimer m_m0Clock;        // 模拟 M0 的 us 时钟
+
+    // --- 模拟 M0 端的程序执行器 ---
+    QVector<ProgramSegment> m_progTable; // 程序表 (按段)
+    uint32_t m_progChunkMask;            // 已收到的分块位图
+    uint8_t  m_progId;
+    uint8_t  m_progState;                // PROG_STATE_*
+    uint8_t  m_progSegment;              // 当前执行的段
+    QElapsedTimer m_progClock;           // 程序执行计时
+
+    void stepProgram(float &amplitude, float &frequency);
+    void emitProgramStatus();
+
+    // --- 模拟 M0 端的任意波形播放 ---
+    IArbSampleSource *m_arbSource;        // 上位机采样源
+    int m_arbRate;                        // 采样率 (Hz)，0 表示未进入任意波形模式
+    QList<ArbWavePacket> m_arbFifo;       // M0 环形缓冲 (最多 ARB_BUFFER_BLOCKS 块)
+    int m_arbPos;                         // 队首块已播放的点数
+    bool m_arbStarved;                    // 当前是否处于播空状态
+    quint64 m_arbM0Underruns;             // M0 端缓冲播空次数
+    qint64 m_arbElapsedMs;                // 进入任意波形模式后的播放时长
+    qint64 m_arbPlayed;                   // 已播出的采样数
+    float m_arbHeld;                      // 最近播出的采样 (DAC 保持到下一个采样)
+
+    void playArbitrary(WaveformPacket &pkt);
+    void refillArbitrary(int credits);
 };
\ No newline at end of file
@@ -18,9 +18,27 @@ ApplicationWindow {
 
     // --- 核心状态管理 ---
     property int activeTabIndex: 0
+    // 分阶段启动：首帧只建参数页 (含启动/停止)，首帧上屏后再后台加载其余页面
+    property bool backgroundPagesEnabled: false
     property bool anyAnimatedWindowOpen: theme.anyAnimatedWindowOpen
     readonly property int resizeMargin: 6
 
+    Component.onCompleted: startupProfiler.mark("Main.qml completed")
+
+    Connections {
+        target: root
+        enabled: !root.backgroundPagesEnabled
+        function onFrameSwapped() {
+            // 留一个事件循环给首帧后的输入处理，再开始后台实例化
+            Qt.callLater(function() {
+                root.backgroundPagesEnabled = true
+                monitorPage.active = true
+                // 监测页已被提前点开过时不会再触发 onLoaded，直接排系统页
+                if (monitorPage.status === Loader.Ready) systemPage.active = true
+            })
+        }
+    }
+
     // 全局字体加载器
     FontLoader {
         id: iconFont
@@ -48,7 +66,8 @@ ApplicationWindow {
         Image {
             id: bgImage
             anchors.fill: parent
-            source: "../fonts/pic/3.jpg"
+            // 预缩放变体，按 sourceSize 选面板尺寸
+            source: "image://assets/3.jpg"
             fillMode: Image.PreserveAspectCrop
             asynchronous: true
             cache: false
@@ -85,7 +104,7 @@ ApplicationWindow {
                     id: avatar
                     Layout.fillWidth: true
                     Layout.topMargin: 20
-                    avatarSource: "../../fonts/pic/ava.png"
+                    avatarSource: "image://assets/ava.png"
                     MouseArea {
                         anchors.fill: parent
                         onClicked: console.log("Avatar Clicked")
@@ -201,11 +220,13 @@ ApplicationWindow {
                     id: paramSetLoader
                     anchors.fill: parent
                     source: "pages/paramSetPage.qml"
+                    // 启动/停止所在页面，同步加载保证首帧即可操作
                     active: true
                     visible: root.activeTabIndex === 0
                     opacity: root.activeTabIndex === 0 ? 1 : 0
                     Behavior on opacity { NumberAnimation { duration: 360 } }
                     onLoaded: {
+                        startupProfiler.mark("paramSetPage loaded")
                         if (item) {
                             if (!item.theme) item.theme = theme
                             if (item.viewportWidth !== undefined) item.viewportWidth = pagesContainer.width
@@ -219,12 +240,17 @@ ApplicationWindow {
                     id: monitorPage
                     anchors.fill: parent
                     source: "pages/monitorPage.qml"
+                    // 首帧后后台异步加载；用户提前点过来则立即开始加载
+                    asynchronous: true
                     active: false
                     onVisibleChanged: if (visible) active = true
                     visible: root.activeTabIndex === 1
                     opacity: root.activeTabIndex === 1 ? 1 : 0
                     Behavior on opacity { NumberAnimation { duration: 360 } }
                     onLoaded: {
+                        startupProfiler.mark("monitorPage loaded")
+                        // 一页一页地排队，避免同时实例化抢占 UI 线程
+                        if (root.backgroundPagesEnabled) systemPage.active = true
                         if (item) {
                             if (!item.theme) item.theme = theme
                             if (item.viewportWidth !== undefined) item.viewportWidth = pagesContainer.width
@@ -238,12 +264,15 @@ ApplicationWindow {
                     id: systemPage
                     anchors.fill: parent
                     source: "pages/systemPage.qml"
-                    active: true // 建议改为懒加载
+                    // 轮播图、系统监控等装饰性组件都在这页，最后加载
+                    asynchronous: true
+                    active: false
                     onVisibleChanged: if (visible) active = true
                     visible: root.activeTabIndex === 2
                     opacity: root.activeTabIndex === 2 ? 1 : 0
                     Behavior on opacity { NumberAnimation { duration: 360 } }
                     onLoaded: {
+                        startupProfiler.mark("systemPage loaded")
                         if (item) {
                             if (!item.theme) item.theme = theme
                         }
@@ -18,6 +18,8 @@ Item {
         width: root.width
         height: root.height
         fillMode: Image.PreserveAspectCrop
+        // 只解码显示尺寸，避免把整张原图留在内存里
+        sourceSize: Qt.size(root.width, root.height)
         visible: false
     }
 
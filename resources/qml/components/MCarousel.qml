@@ -72,6 +72,8 @@ Item {
                             // --- 修改点：直接使用传入的 modelData ---
                             // 删除了原先针对 Bing 的 ?w=... 参数拼接，防止本地图片加载失败
                             source: modelData
+                            // image://assets 按这个尺寸挑变体，其它来源按这个尺寸缩放解码
+                            sourceSize: Qt.size(swipeView.width, swipeView.height)
                         }
 
                         // 加载占位：主题色三点加载动画
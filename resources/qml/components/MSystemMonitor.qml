@@ -23,6 +23,18 @@ Components.EBlurCard {
     property string cpuText: Math.round(cpuUsage * 100) + "%"
     property string memText: Math.round(memUsage * 100) + "%"
 
+    // 每核使用率 [0.0-1.0]；线程负载 [{name, cpu, core}]，cpu 为占一个核的百分比
+    property var cores: []
+    property var threads: []
+    property real rssMb: 0.0
+    // 每秒唤醒次数；空闲省电模式下额外显示空闲期间的平均 CPU (占一个核的百分比) 和唤醒次数
+    property real wakeupsPerSec: -1
+    property bool idle: false
+    property real idleCpuAvg: 0.0
+    property real idleWakeupsAvg: 0.0
+    // 线程列表最多显示几行
+    property int maxThreads: 5
+
     // 样式配置
     blurAmount: 0.6
     borderRadius: 24
@@ -121,6 +133,88 @@ Components.EBlurCard {
                 }
             }
         }
+
+        // 每核负载条：哪个核被打满一眼能看出来
+        RowLayout {
+            Layout.fillWidth: true
+            visible: root.cores.length > 0
+            spacing: 6
+
+            Repeater {
+                model: root.cores
+                delegate: ColumnLayout {
+                    Layout.fillWidth: true
+                    spacing: 2
+                    Rectangle {
+                        Layout.fillWidth: true
+                        Layout.preferredHeight: 6
+                        radius: 3
+                        color: root.trackColor
+                        Rectangle {
+                            width: parent.width * Math.min(1.0, modelData)
+                            height: parent.height
+                            radius: 3
+                            color: modelData > 0.9 ? "#ff5252" : root.cpuColor
+                        }
+                    }
+                    Text {
+                        text: "CPU" + index + " " + Math.round(modelData * 100) + "%"
+                        color: "#88ffffff"; font.pixelSize: 10
+                    }
+                }
+            }
+        }
+
+        // 线程负载：按 CPU 从高到低
+        Repeater {
+            model: root.threads.slice(0, root.maxThreads)
+            delegate: RowLayout {
+                Layout.fillWidth: true
+                spacing: 8
+                Text {
+                    Layout.preferredWidth: 110
+                    text: modelData.name
+                    color: "#cccccc"; font.pixelSize: 11
+                    elide: Text.ElideRight
+                }
+                Rectangle {
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 4
+                    radius: 2
+                    color: root.trackColor
+                    Rectangle {
+                        width: parent.width * Math.min(1.0, modelData.cpu / 100.0)
+                        height: parent.height
+                        radius: 2
+                        color: modelData.cpu > 90 ? "#ff5252" : root.memColor
+                    }
+                }
+                Text {
+                    text: modelData.cpu.toFixed(1) + "% @" + modelData.core
+                    color: "white"; font.pixelSize: 11; font.family: "Roboto Mono"
+                }
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 12
+            Text {
+                visible: root.rssMb > 0
+                text: "RSS " + root.rssMb.toFixed(1) + " MB"
+                color: "#88ffffff"; font.pixelSize: 10
+            }
+            Text {
+                visible: root.wakeupsPerSec >= 0
+                text: "唤醒 " + Math.round(root.wakeupsPerSec) + "/s"
+                color: "#88ffffff"; font.pixelSize: 10
+            }
+            Text {
+                visible: root.idle
+                text: "空闲平均 CPU " + root.idleCpuAvg.toFixed(1) + "% · 唤醒 " + Math.round(root.idleWakeupsAvg) + "/s"
+                color: root.memColor; font.pixelSize: 10
+            }
+        }
     }
 
     // =========================
@@ -0,0 +1,168 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import ELE_Sti 1.0
+import "." as Components
+
+// 状态趋势：阻抗/电量/实际频率的 min-max 带 + 均值线
+// 数据在 C++ 的 TrendStore 环里，每次重绘取一份按像素列合并好的快照
+Components.EBlurCard {
+    id: root
+
+    implicitWidth: 480
+    implicitHeight: 200
+
+    property string title: "趋势 (Trend)"
+    // 三档分辨率对应的模型
+    property var models: [trendSeconds, trend10s, trendMinutes]
+    property var levelNames: ["1 s", "10 s", "1 min"]
+    property int level: 0
+    property var model: models[level]
+
+    property var seriesNames: ["阻抗", "电量", "频率"]
+    property var seriesIds: [TrendModel.Impedance, TrendModel.Battery, TrendModel.RealFreq]
+    property var seriesColors: ["#2979ff", "#00e676", "#ffca28"]
+    property int series: 0
+
+    // 数据每 50ms 一包，重绘限到 2 次/秒
+    property int repaintInterval: 500
+
+    blurAmount: 0.6
+    borderRadius: 24
+    borderWidth: 1
+    borderColor: "#30FFFFFF"
+
+    onLevelChanged: canvas.requestPaint()
+    onSeriesChanged: canvas.requestPaint()
+
+    Connections {
+        target: root.model
+        function onRowsInserted() { repaintTimer.dirty = true }
+        function onDataChanged() { repaintTimer.dirty = true }
+    }
+
+    Timer {
+        id: repaintTimer
+        property bool dirty: false
+        interval: root.repaintInterval
+        repeat: true
+        running: root.visible
+        onTriggered: {
+            if (!dirty) return
+            dirty = false
+            canvas.requestPaint()
+        }
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 16
+        spacing: 8
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 6
+
+            Text {
+                text: root.title
+                color: "#88ffffff"; font.pixelSize: 14; font.bold: true
+            }
+            Item { Layout.fillWidth: true }
+
+            // 序列切换
+            Repeater {
+                model: root.seriesNames
+                delegate: Text {
+                    text: modelData
+                    color: index === root.series ? root.seriesColors[index] : "#66ffffff"
+                    font.pixelSize: 12; font.bold: index === root.series
+                    MouseArea { anchors.fill: parent; onClicked: root.series = index }
+                }
+            }
+            Item { width: 8 }
+            // 分辨率切换
+            Repeater {
+                model: root.levelNames
+                delegate: Text {
+                    text: modelData
+                    color: index === root.level ? "white" : "#66ffffff"
+                    font.pixelSize: 12; font.bold: index === root.level
+                    MouseArea { anchors.fill: parent; onClicked: root.level = index }
+                }
+            }
+        }
+
+        Canvas {
+            id: canvas
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+
+            onPaint: {
+                var ctx = getContext("2d")
+                var w = width
+                var h = height
+                ctx.clearRect(0, 0, w, h)
+
+                var m = root.model
+                var sid = root.seriesIds[root.series]
+                var color = root.seriesColors[root.series]
+
+                // 网格
+                ctx.strokeStyle = "#20ffffff"
+                ctx.lineWidth = 1
+                ctx.beginPath()
+                for (var g = 0; g <= 4; g++) {
+                    ctx.moveTo(0, h / 4 * g)
+                    ctx.lineTo(w, h / 4 * g)
+                }
+                ctx.stroke()
+                if (m.count === 0 || w <= 0) return
+
+                // 一次取回：每像素最多一列，带取 min/max，线取均值
+                var snap = m.snapshot(sid, Math.floor(w))
+                var pts = snap.points
+                var step = snap.step
+
+                // 纵轴按窗口内的范围，留 10% 边
+                var lo = snap.min
+                var hi = snap.max
+                if (hi - lo < 1) { hi += 0.5; lo -= 0.5 }
+                var pad = (hi - lo) * 0.1
+                lo -= pad; hi += pad
+                var scaleY = h / (hi - lo)
+
+                // 横轴固定为整个环的时间跨度，最新的桶贴右边
+                var span = m.spanMs
+                var tEnd = snap.lastTime + span
+                var tStart = tEnd - m.capacity * span
+                var scaleX = w / (tEnd - tStart)
+
+                ctx.fillStyle = Qt.rgba(Qt.color(color).r, Qt.color(color).g, Qt.color(color).b, 0.25)
+                ctx.strokeStyle = color
+                ctx.lineWidth = 2
+                ctx.beginPath()
+                var prevT = -1
+                for (var i = 0; i < pts.length; i += 4) {
+                    var t = pts[i]
+                    var mn = pts[i + 1]
+                    var mx = pts[i + 2]
+                    var x = (t - tStart) * scaleX
+                    var y = h - (pts[i + 3] - lo) * scaleY
+                    // 中间缺桶 (设备断开) 就断线
+                    if (prevT < 0 || t - prevT > span * step * 2) ctx.moveTo(x, y)
+                    else ctx.lineTo(x, y)
+                    prevT = t
+                    ctx.fillRect(x, h - (mx - lo) * scaleY, Math.max(1, step * span * scaleX), (mx - mn) * scaleY + 1)
+                }
+                ctx.stroke()
+
+                // 最新值
+                ctx.fillStyle = "#aaffffff"
+                ctx.font = "10px sans-serif"
+                ctx.textAlign = "right"
+                ctx.textBaseline = "top"
+                ctx.fillText(snap.last.toFixed(0), w - 2, 2)
+            }
+        }
+    }
+}
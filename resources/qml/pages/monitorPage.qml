@@ -46,6 +46,20 @@ Page {
     property int  batteryLevel: 100         // 电池 (%)
     property int  realTimeError: 0          // 错误码
 
+    // --- 触发采集 ---
+    property int  trigMode: Trigger.Off     // Off 时显示实时批次
+    property int  trigType: Trigger.Rising
+    property real trigLevel: 10.0           // 触发电平 (mA)，窗口触发为 ±trigLevel
+    property int  trigIndex: -1             // 当前画面里的触发点下标
+    property bool trigForced: false
+    property int  trigPre: 200              // 预触发/后触发采样数
+    property int  trigPost: 800
+
+    function applyTrigger() {
+        trigIndex = -1
+        treatmentManager.setTrigger(trigMode, trigType, trigLevel, -trigLevel, trigLevel, trigPre, trigPost)
+    }
+
     // ==========================================
     // 2. 增强型数据监听器
     // ==========================================
@@ -86,6 +100,14 @@ Page {
             }
         }
 
+        // C. 触发采到的窗口 (只在触发模式下来，实时批次不再推送)
+        function onCaptureReady(data, triggerIndex, forced) {
+            waveCanvas.points = data
+            monitorPage.trigIndex = triggerIndex
+            monitorPage.trigForced = forced
+            waveCanvas.requestPaint()
+        }
+
         // B. 状态数据监听 (频率慢: ~1s一次)
         function onMonitorDataUpdated(impedance, battery, error) {
             monitorPage.realTimeImpedance = impedance
@@ -112,7 +134,7 @@ Page {
         anchors.margins: 16
         spacing: 16
 
-        // ----------------- 左侧：波形显示 -----------------
+        // ----------------- 左侧：波形显示 + 状态趋势 -----------------
         Components.EBlurCard {
             Layout.fillHeight: true
             Layout.fillWidth: true
@@ -127,6 +149,41 @@ Page {
                     color: "#88ffffff"; font.pixelSize: 18 ; font.bold: true;
                 }
                 Item { Layout.fillWidth: true }
+
+                // 触发模式：实时 / 自动 / 常规 / 单次
+                Repeater {
+                    model: ["LIVE", "AUTO", "NORM", "SINGLE"]
+                    delegate: Text {
+                        text: modelData
+                        color: index === monitorPage.trigMode ? "#651fff" : "#66ffffff"
+                        font.pixelSize: 12; font.bold: index === monitorPage.trigMode
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: { monitorPage.trigMode = index; monitorPage.applyTrigger() }
+                        }
+                    }
+                }
+                Item { width: 8 }
+                // 触发类型：上升沿 / 下降沿 / 窗口
+                Repeater {
+                    model: ["\u2191", "\u2193", "WIN"]
+                    delegate: Text {
+                        visible: monitorPage.trigMode !== Trigger.Off
+                        text: modelData
+                        color: index === monitorPage.trigType ? "white" : "#66ffffff"
+                        font.pixelSize: 12; font.bold: index === monitorPage.trigType
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: { monitorPage.trigType = index; monitorPage.applyTrigger() }
+                        }
+                    }
+                }
+                Text {
+                    visible: monitorPage.trigMode === Trigger.Single
+                    text: "ARM"
+                    color: "#ffca28"; font.pixelSize: 12; font.bold: true
+                    MouseArea { anchors.fill: parent; onClicked: treatmentManager.armTrigger() }
+                }
             }
 
             // Canvas 波形绘制 (保持你之前的逻辑，增加了根据 Current 动态计算 Y 轴)
@@ -137,9 +194,11 @@ Page {
                 // 调整边距，给文字留出一点点空间，防止被切掉
                 anchors.margins: 16
                 anchors.topMargin: 40
+                anchors.bottomMargin: trendChart.height + 32
                 property var points: []
 
                 onPaint: {
+                    var paintStart = Date.now()
                     var ctx = getContext("2d")
                     var w = width
                     var h = height
@@ -234,7 +293,53 @@ Page {
                         ctx.fillStyle = gradient
                         ctx.fill()
                     }
+
+                    // ==========================================
+                    // 4. 触发电平与触发点
+                    // ==========================================
+                    if (monitorPage.trigMode !== Trigger.Off) {
+                        ctx.strokeStyle = "#80ffca28"
+                        ctx.lineWidth = 1
+                        ctx.setLineDash([4, 4])
+                        ctx.beginPath()
+                        var levels = monitorPage.trigType === Trigger.Window
+                                ? [monitorPage.trigLevel, -monitorPage.trigLevel] : [monitorPage.trigLevel]
+                        for (var q = 0; q < levels.length; q++) {
+                            var ly = centerY - levels[q] * scaleY
+                            ctx.moveTo(0, ly); ctx.lineTo(w, ly)
+                        }
+                        ctx.stroke()
+                        if (monitorPage.trigIndex >= 0 && points.length > 0) {
+                            var tx = monitorPage.trigIndex * stepX
+                            ctx.strokeStyle = monitorPage.trigForced ? "#40ffffff" : "#ffca28"
+                            ctx.beginPath()
+                            ctx.moveTo(tx, 0); ctx.lineTo(tx, h)
+                            ctx.stroke()
+                        }
+                        ctx.setLineDash([])
+                    }
+
+                    // 延迟追踪：本帧波形已画完
+                    treatmentManager.markFramePainted(Date.now() - paintStart)
                 }
+
+                // 触发模式下点击波形区设置触发电平 (纵轴 ±50mA)
+                MouseArea {
+                    anchors.fill: parent
+                    enabled: monitorPage.trigMode !== Trigger.Off
+                    onClicked: function(mouse) {
+                        var level = (height / 2 - mouse.y) / (height / 2) * 50.0
+                        monitorPage.trigLevel = monitorPage.trigType === Trigger.Window ? Math.abs(level) : level
+                        monitorPage.applyTrigger()
+                    }
+                }
+            }
+
+            // 阻抗/电量/频率趋势，最长 24 小时，内存固定；贴在卡片底部，波形区让出高度
+            Components.MTrendChart {
+                id: trendChart
+                anchors { left: parent.left; right: parent.right; bottom: parent.bottom; margins: 16 }
+                height: parent.height * 0.3
             }
         }
 
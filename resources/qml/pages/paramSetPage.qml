@@ -381,6 +381,12 @@ Item {
                 Connections {
                         target: treatmentManager
 
+                        // 旋钮已经直接下发给设备，这里只刷新显示，不再调用 syncParamsToCpp
+                        function onAmplitudeAdjusted(posAmp, negAmp) {
+                            paramPosAmp = posAmp
+                            paramNegAmp = negAmp
+                        }
+
                         function onSerialTriggerReceived() {
                             console.log("QML: 收到串口指令，执行切换动作")
 
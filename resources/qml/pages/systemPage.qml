@@ -128,12 +128,67 @@ Item {
 
                 title: "系统状态 (SYSTEM STATUS)"
 
-                // 关闭组件内部模拟，使用页面级的统一模拟数据
+                // 关闭组件内部模拟；有 /proc 时用 systemMonitor 的真实数据，否则用页面级的模拟数据
                 useSimulation: false
+                readonly property bool realStats: typeof systemMonitor !== "undefined" && systemMonitor.available
 
-                // 数据转换：组件需要 0.0-1.0，页面数据是 0-100
-                cpuUsage: pageRoot.cpuUsage / 100.0
-                memUsage: pageRoot.memUsage / 100.0
+                // 数据转换：组件需要 0.0-1.0，页面模拟数据是 0-100
+                cpuUsage: realStats ? systemMonitor.cpuUsage : pageRoot.cpuUsage / 100.0
+                memUsage: realStats ? systemMonitor.memUsage : pageRoot.memUsage / 100.0
+                cores: realStats ? systemMonitor.cores : []
+                threads: realStats ? systemMonitor.threads : []
+                rssMb: realStats ? systemMonitor.rssMb : 0
+                wakeupsPerSec: realStats ? systemMonitor.wakeupsPerSec : -1
+                idle: realStats && systemMonitor.idle
+                idleCpuAvg: realStats ? systemMonitor.idleCpuAvg : 0
+                idleWakeupsAvg: realStats ? systemMonitor.idleWakeupsAvg : 0
+            }
+
+            // 3. 底部：运行指标 (数据来自 metricsController，每秒刷新)
+            Components.EBlurCard {
+                Layout.fillWidth: true
+                Layout.preferredHeight: 200
+                blurSource: bgImage
+                blurAmount: 0.7
+                borderRadius: 24
+                borderWidth: 1
+                borderColor: "#30FFFFFF"
+
+                ColumnLayout {
+                    anchors.fill: parent
+                    anchors.margins: 16
+                    spacing: 6
+
+                    Text {
+                        text: "运行指标 (RUNTIME METRICS)"
+                        color: "#cccccc"; font.pixelSize: 14; font.bold: true
+                    }
+
+                    ListView {
+                        Layout.fillWidth: true
+                        Layout.fillHeight: true
+                        clip: true
+                        model: metricsController.metrics
+                        delegate: RowLayout {
+                            width: ListView.view.width
+                            Text {
+                                Layout.fillWidth: true
+                                text: modelData.name.replace("ele_sti_", "")
+                                color: "#88ffffff"; font.pixelSize: 11
+                                elide: Text.ElideRight
+                            }
+                            Text {
+                                // 计数器显示速率，直方图显示 p50/p99
+                                text: modelData.unit === "ms"
+                                      ? modelData.p50.toFixed(2) + " / " + modelData.p99.toFixed(2) + " ms"
+                                      : (modelData.unit === "/s"
+                                         ? modelData.rate.toFixed(1) + "/s (" + modelData.value + ")"
+                                         : modelData.value)
+                                color: "white"; font.pixelSize: 11; font.family: "Roboto Mono"
+                            }
+                        }
+                    }
+                }
             }
         }
 
@@ -153,11 +208,11 @@ Item {
                 shadowEnabled: true
 
                 model: [
-                    "../../fonts/pic/ca2.jpg",
-                    "../../fonts/pic/ca1.png",
-                    "../../fonts/pic/ca3.jpg",
-                    "../../fonts/pic/ca4.jpg",
-                    "../../fonts/pic/3.jpg"
+                    "image://assets/ca2.jpg",
+                    "image://assets/ca1.png",
+                    "image://assets/ca3.jpg",
+                    "image://assets/ca4.jpg",
+                    "image://assets/3.jpg"
                 ]
             }
 
@@ -0,0 +1,135 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:30:06
+ * @FilePath: \ele_sti\src\common\AllocCounter.cpp
+ * @Description: 堆分配计数：glibc 下接管 malloc 一族，其他平台替换 operator new
+ */
+#include "common/AllocCounter.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<bool> s_armed(false);
+static std::atomic<quint64> s_count(0);
+static std::atomic<quint64> s_bytes(0);
+static std::atomic<long> s_firstTid(0);
+
+static inline void countAlloc(size_t size)
+{
+    if (!s_armed.load(std::memory_order_relaxed)) return;
+    if (s_count.fetch_add(1, std::memory_order_relaxed) == 0) {
+#ifdef Q_OS_LINUX
+        s_firstTid.store((long)syscall(SYS_gettid), std::memory_order_relaxed);
+#else
+        s_firstTid.store(-1, std::memory_order_relaxed);
+#endif
+    }
+    s_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+// glibc：直接接管 malloc 一族。Qt 容器 (QList/QString/QByteArray) 走 malloc 而不是 new，
+// operator new 默认实现也调用 malloc，所以这里一处就能全部计到。
+// 可执行文件里的定义优先于 libc，共享库 (Qt) 里的调用同样会落到这里。
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t align, size_t size);
+
+void *malloc(size_t size)
+{
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    countAlloc(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    countAlloc(size);
+    return __libc_realloc(p, size);
+}
+
+void *memalign(size_t align, size_t size)
+{
+    countAlloc(size);
+    return __libc_memalign(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    countAlloc(size);
+    return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **out, size_t align, size_t size)
+{
+    countAlloc(size);
+    void *p = __libc_memalign(align, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+}
+#else
+// 其他平台只替换 operator new/delete，直接 malloc 的 Qt 容器不计数
+static inline void *allocOrThrow(size_t size)
+{
+    countAlloc(size);
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size) { return allocOrThrow(size); }
+void *operator new[](size_t size) { return allocOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    countAlloc(size);
+    return std::malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    countAlloc(size);
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+#endif
+
+namespace AllocCounter {
+
+void arm()
+{
+    s_count.store(0);
+    s_bytes.store(0);
+    s_firstTid.store(0);
+    s_armed.store(true);
+}
+
+quint64 disarm()
+{
+    s_armed.store(false);
+    return s_count.load();
+}
+
+bool isArmed() { return s_armed.load(); }
+quint64 count() { return s_count.load(); }
+quint64 bytes() { return s_bytes.load(); }
+long firstThreadId() { return s_firstTid.load(); }
+
+} // namespace AllocCounter
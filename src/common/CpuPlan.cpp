@@ -0,0 +1,124 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 02:05:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 02:05:31
+ * @FilePath: \ele_sti\src\common\CpuPlan.cpp
+ * @Description: CPU 核规划
+ */
+#include "common/CpuPlan.h"
+#include <QDebug>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+static QMutex s_lock;
+static bool s_hasCurrent = false;
+static CpuPlan s_current;
+
+static QString joinCores(const QVector<int> &cores)
+{
+    QStringList parts;
+    for (int c : cores) parts.append(QString::number(c));
+    return parts.join(',');
+}
+
+int CpuPlan::onlineCores()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+CpuPlan CpuPlan::detect(int acquisitionThreads)
+{
+    const int n = onlineCores();
+    CpuPlan plan;
+    if (n == 1) {
+        plan.render = plan.realtime = plan.background = { 0 };
+    } else if (n == 2) {
+        plan.render = { 0 };
+        plan.realtime = { 1 };
+        plan.background = { 0 };
+    } else {
+        const int a = qBound(1, acquisitionThreads, n - 2);
+        plan.render = { 0 };
+        for (int c = 1; c < n - a; c++) plan.background.append(c);
+        for (int c = n - a; c < n; c++) plan.realtime.append(c);
+    }
+    const QString spec = qEnvironmentVariable("ELE_STI_CPU_PLAN");
+    if (!spec.isEmpty() && !parse(spec, plan)) {
+        qWarning() << "[CpuPlan] ignoring malformed ELE_STI_CPU_PLAN" << spec;
+    }
+    return plan;
+}
+
+CpuPlan CpuPlan::offline()
+{
+    CpuPlan plan;
+    for (int c = 0; c < onlineCores(); c++) plan.background.append(c);
+    return plan;
+}
+
+bool CpuPlan::parse(const QString &spec, CpuPlan &out)
+{
+    CpuPlan plan = out;
+    for (const QString &item : spec.split(';', Qt::SkipEmptyParts)) {
+        const int eq = item.indexOf('=');
+        if (eq <= 0) return false;
+        const QString key = item.left(eq).trimmed();
+        QVector<int> cores;
+        for (const QString &c : item.mid(eq + 1).split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            const int core = c.trimmed().toInt(&ok);
+            if (!ok || core < 0) return false;
+            cores.append(core);
+        }
+        if (key == "render") plan.render = cores;
+        else if (key == "rt") plan.realtime = cores;
+        else if (key == "bg") plan.background = cores;
+        else return false;
+    }
+    out = plan;
+    return true;
+}
+
+CpuPlan CpuPlan::current()
+{
+    QMutexLocker locker(&s_lock);
+    if (!s_hasCurrent) {
+        s_current = detect(1);
+        s_hasCurrent = true;
+    }
+    return s_current;
+}
+
+void CpuPlan::setCurrent(const CpuPlan &plan)
+{
+    QMutexLocker locker(&s_lock);
+    s_current = plan;
+    s_hasCurrent = true;
+}
+
+bool CpuPlan::pinCurrentThread(const QVector<int> &cores)
+{
+    if (cores.isEmpty()) return false;
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cores) {
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    // pid 0 = 调用线程
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+QString CpuPlan::toString() const
+{
+    return QString("render=%1;rt=%2;bg=%3").arg(joinCores(render), joinCores(realtime), joinCores(background));
+}
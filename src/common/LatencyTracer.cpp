@@ -0,0 +1,345 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 13:05:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 13:05:18
+ * @FilePath: \ele_sti\src\common\LatencyTracer.cpp
+ * @Description: 端到端延迟追踪实现
+ */
+#include "common/LatencyTracer.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <chrono>
+
+// ==========================================
+// LatencyStats
+// ==========================================
+
+LatencyStats::LatencyStats(int window)
+    : m_samples(window, 0), m_next(0), m_count(0)
+{
+}
+
+void LatencyStats::add(qint64 ns)
+{
+    if (ns < 0) return; // 时钟还没同步好时可能出现负值，丢弃
+    QMutexLocker locker(&m_mutex);
+    m_samples[m_next] = ns;
+    m_next = (m_next + 1) % m_samples.size();
+    m_count++;
+}
+
+LatencyStats::Summary LatencyStats::summary() const
+{
+    Summary s;
+    QVector<qint64> copy;
+    {
+        QMutexLocker locker(&m_mutex);
+        s.count = m_count;
+        int valid = (int)qMin<qint64>(m_count, m_samples.size());
+        copy = m_samples.mid(0, valid);
+    }
+    if (copy.isEmpty()) return s;
+
+    auto at = [&copy](double q) {
+        int idx = qMin((int)(q * (copy.size() - 1) + 0.5), copy.size() - 1);
+        std::nth_element(copy.begin(), copy.begin() + idx, copy.end());
+        return copy[idx];
+    };
+    s.max = *std::max_element(copy.begin(), copy.end());
+    s.p99 = at(0.99);
+    s.p50 = at(0.50);
+    return s;
+}
+
+void LatencyStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_samples.fill(0);
+    m_next = 0;
+    m_count = 0;
+}
+
+// ==========================================
+// ClockSync
+// ==========================================
+
+ClockSync::ClockSync()
+{
+    m_points.reserve(MAX_POINTS);
+    reset();
+}
+
+void ClockSync::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_hasTick = false;
+    m_lastRaw = 0;
+    m_lastTick64 = 0;
+    m_windowStart = 0;
+    m_windowMin = {0, 0};
+    m_points.clear();
+    m_slope = 0.0;
+    m_intercept = 0.0;
+    m_refTickNs = 0;
+    m_fitted = false;
+}
+
+/**
+ * @brief 1.记录一次 (M0 时间戳, 上位机接收时刻) 观测
+ * @note  32 位 us 时间戳约 71 分钟回绕一次，这里按有符号差值展开成 64 位
+ */
+void ClockSync::observe(uint32_t tickUs, qint64 hostNs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_hasTick) {
+        m_hasTick = true;
+        m_lastRaw = tickUs;
+        m_lastTick64 = tickUs;
+        m_windowStart = m_lastTick64;
+        m_windowMin = {m_lastTick64 * 1000, hostNs - m_lastTick64 * 1000};
+        return;
+    }
+    m_lastTick64 += (int32_t)(tickUs - m_lastRaw);
+    m_lastRaw = tickUs;
+
+    const qint64 tickNs = m_lastTick64 * 1000;
+    const qint64 offset = hostNs - tickNs;
+    if (offset < m_windowMin.offsetNs) {
+        m_windowMin = {tickNs, offset};
+    }
+
+    if (m_lastTick64 - m_windowStart >= WINDOW_US) {
+        // 定长滑动窗口：容量在构造时预留，稳态不再分配
+        if (m_points.size() >= MAX_POINTS) {
+            std::move(m_points.begin() + 1, m_points.end(), m_points.begin());
+            m_points.last() = m_windowMin;
+        } else {
+            m_points.append(m_windowMin);
+        }
+        m_windowStart = m_lastTick64;
+        m_windowMin = {tickNs, offset};
+        refit();
+    } else if (!m_fitted) {
+        // 第一个窗口还没结束时先用当前最小偏移
+        m_intercept = (double)m_windowMin.offsetNs;
+        m_refTickNs = m_windowMin.tickNs;
+    }
+}
+
+bool ClockSync::isValid() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hasTick;
+}
+
+qint64 ClockSync::toHostNs(uint32_t tickUs) const
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 tickNs = (m_lastTick64 + (int32_t)(tickUs - m_lastRaw)) * 1000;
+    const double offset = m_intercept + m_slope * (double)(tickNs - m_refTickNs);
+    return tickNs + (qint64)offset;
+}
+
+double ClockSync::driftPpm() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_slope * 1e6;
+}
+
+/**
+ * @brief 2.对窗口最小偏移做最小二乘拟合
+ */
+void ClockSync::refit()
+{
+    const int n = m_points.size();
+    m_refTickNs = m_points.last().tickNs;
+    if (n < 2) {
+        m_slope = 0.0;
+        m_intercept = (double)m_points.last().offsetNs;
+        m_fitted = true;
+        return;
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const Point &p : m_points) {
+        const double x = (double)(p.tickNs - m_refTickNs);
+        const double y = (double)p.offsetNs;
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    const double den = n * sxx - sx * sx;
+    m_slope = (den != 0.0) ? (n * sxy - sx * sy) / den : 0.0;
+    m_intercept = (sy - m_slope * sx) / n;
+    m_fitted = true;
+}
+
+// ==========================================
+// LatencyTracer
+// ==========================================
+
+LatencyTracer &LatencyTracer::instance()
+{
+    static LatencyTracer tracer;
+    return tracer;
+}
+
+LatencyTracer::LatencyTracer()
+    : m_rxNext(0), m_frameOriginNs(0), m_frameHandleNs(0), m_frameEmitNs(0),
+      m_cmdIssueNs(0), m_cmdSentNs(0)
+{
+    for (RxStamp &slot : m_rx) {
+        slot.tick.store(0);
+        slot.ns.store(0);
+    }
+}
+
+qint64 LatencyTracer::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *LatencyTracer::hopName(Hop hop)
+{
+    switch (hop) {
+    case HopSpiToService:     return "spi->service";
+    case HopServiceToManager: return "service->manager";
+    case HopManagerToPaint:   return "manager->paint";
+    case HopSampleToPaint:    return "sample->paint";
+    case HopCmdIssueToSent:   return "cmd issue->sent";
+    case HopCmdSentToAck:     return "cmd sent->ack";
+    case HopCmdIssueToAck:    return "cmd issue->ack";
+    default:                  return "?";
+    }
+}
+
+/**
+ * @brief 3.后端：记录一个波形包的 SPI 完成时刻
+ * @note  以 M0 时间戳为键放进小环表，业务层收到同一个包时再取出
+ */
+void LatencyTracer::markReceived(uint32_t tickUs, qint64 rxNs)
+{
+    RxStamp &slot = m_rx[m_rxNext.fetch_add(1, std::memory_order_relaxed) % RX_SLOTS];
+    slot.ns.store(rxNs, std::memory_order_relaxed);
+    slot.tick.store(tickUs, std::memory_order_release);
+}
+
+qint64 LatencyTracer::takeReceived(uint32_t tickUs)
+{
+    // 最近写入的槽最可能命中，从新往旧找
+    const uint32_t newest = m_rxNext.load(std::memory_order_acquire);
+    for (int i = 1; i <= RX_SLOTS; i++) {
+        RxStamp &slot = m_rx[(newest - i) % RX_SLOTS];
+        if (slot.tick.load(std::memory_order_acquire) == tickUs) {
+            return slot.ns.load(std::memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 4.业务层：开始处理一个波形包
+ */
+void LatencyTracer::serviceHandled(uint32_t tickUs, qint64 handleNs)
+{
+    const qint64 rxNs = takeReceived(tickUs);
+    if (rxNs > 0) {
+        record(HopSpiToService, handleNs - rxNs);
+        m_clock.observe(tickUs, rxNs);
+    }
+    m_frameHandleNs = handleNs;
+    m_frameOriginNs = m_clock.isValid() ? m_clock.toHostNs(tickUs) : rxNs;
+}
+
+void LatencyTracer::frameEmitted()
+{
+    m_frameEmitNs = nowNs();
+    if (m_frameHandleNs > 0) {
+        record(HopServiceToManager, m_frameEmitNs - m_frameHandleNs);
+    }
+}
+
+/**
+ * @brief 5.QML 绘制完成
+ * @note  同一帧只统计一次，避免没有新数据的重绘把延迟拉长
+ */
+void LatencyTracer::framePainted()
+{
+    if (m_frameEmitNs == 0) return;
+    const qint64 now = nowNs();
+    record(HopManagerToPaint, now - m_frameEmitNs);
+    if (m_frameOriginNs > 0) {
+        record(HopSampleToPaint, now - m_frameOriginNs);
+    }
+    m_frameEmitNs = 0;
+}
+
+/**
+ * @brief 6.命令链路
+ * @note  只跟踪最近一条命令；上一条还没应答又来新命令时，以新命令为准
+ */
+void LatencyTracer::commandIssued(uint8_t cmd)
+{
+    Q_UNUSED(cmd);
+    m_cmdSentNs.store(0);
+    m_cmdIssueNs.store(nowNs());
+}
+
+void LatencyTracer::commandSent()
+{
+    const qint64 issue = m_cmdIssueNs.load();
+    if (issue == 0) return;
+    qint64 expected = 0;
+    const qint64 now = nowNs();
+    if (m_cmdSentNs.compare_exchange_strong(expected, now)) {
+        record(HopCmdIssueToSent, now - issue);
+    }
+}
+
+void LatencyTracer::uplinkReceived()
+{
+    const qint64 sent = m_cmdSentNs.exchange(0);
+    if (sent == 0) return;
+    const qint64 issue = m_cmdIssueNs.exchange(0);
+    const qint64 now = nowNs();
+    record(HopCmdSentToAck, now - sent);
+    if (issue > 0) {
+        record(HopCmdIssueToAck, now - issue);
+    }
+}
+
+void LatencyTracer::record(Hop hop, qint64 ns)
+{
+    if (hop >= 0 && hop < HopCount) {
+        m_stats[hop].add(ns);
+    }
+}
+
+QVector<LatencyTracer::HopReport> LatencyTracer::report() const
+{
+    QVector<HopReport> out;
+    out.reserve(HopCount);
+    for (int i = 0; i < HopCount; i++) {
+        out.append({(Hop)i, hopName((Hop)i), m_stats[i].summary()});
+    }
+    return out;
+}
+
+QString LatencyTracer::formatReport() const
+{
+    QString text = QString("[Latency] clock drift %1 ppm\n").arg(m_clock.driftPpm(), 0, 'f', 1);
+    for (const HopReport &r : report()) {
+        text += QString("  %1 n=%2 p50=%3us p99=%4us max=%5us\n")
+                    .arg(QString::fromLatin1(r.name), -18)
+                    .arg(r.stats.count)
+                    .arg(r.stats.p50 / 1000.0, 0, 'f', 1)
+                    .arg(r.stats.p99 / 1000.0, 0, 'f', 1)
+                    .arg(r.stats.max / 1000.0, 0, 'f', 1);
+    }
+    return text;
+}
+
+void LatencyTracer::reset()
+{
+    for (LatencyStats &s : m_stats) s.reset();
+    m_clock.reset();
+}
@@ -0,0 +1,369 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\src\common\LiveStream.cpp
+ * @Description: 实时数据共享内存环
+ */
+#include "common/LiveStream.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QDateTime>
+#include <QDebug>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static MetricCounter s_waveRecords("ele_sti_live_wave_records_total", "Waveform records published to the live shared-memory ring");
+static MetricCounter s_statusRecords("ele_sti_live_status_records_total", "Status records published to the live shared-memory ring");
+
+// 槽区从 256 字节边界开始 (波形槽按 cache line 对齐)
+static const uint32_t LIVE_WAVE_OFFSET = 256;
+
+static uint64_t roundUpPow2(int n)
+{
+    uint64_t v = 1;
+    while (v < (uint64_t)qMax(2, n)) v <<= 1;
+    return v;
+}
+
+static QByteArray shmPath(const QString &name)
+{
+    return "/" + name.toUtf8();
+}
+
+// ==========================================
+// 发布端
+// ==========================================
+
+LiveStreamWriter::LiveStreamWriter()
+    : m_header(nullptr), m_waves(nullptr), m_statuses(nullptr), m_waveMask(0), m_statusMask(0), m_size(0)
+{
+}
+
+LiveStreamWriter::~LiveStreamWriter()
+{
+    close();
+}
+
+/**
+ * @brief 1.建共享内存
+ * @note  ftruncate 出来的内存全 0，所有槽的 seq 为 0 (= 还没写过)；各字段填好后最后写 magic
+ */
+bool LiveStreamWriter::create(const QString &name, int waveSlots, int statusSlots)
+{
+    close();
+#ifdef Q_OS_LINUX
+    const uint64_t waves = roundUpPow2(waveSlots);
+    const uint64_t statuses = roundUpPow2(statusSlots);
+    const uint64_t statusOffset = LIVE_WAVE_OFFSET + waves * sizeof(LiveWaveSlot);
+    const qint64 size = (qint64)(statusOffset + statuses * sizeof(LiveStatusSlot));
+
+    const QByteArray path = shmPath(name);
+    // 上次异常退出留下的段：直接删掉重建，还映射着旧段的订阅端会在控制套接字断开时重连
+    shm_unlink(path.constData());
+    const int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        qWarning() << "[LiveStream] shm_open failed:" << path << strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+        qWarning() << "[LiveStream] ftruncate failed:" << strerror(errno);
+        ::close(fd);
+        shm_unlink(path.constData());
+        return false;
+    }
+    void *base = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        qWarning() << "[LiveStream] mmap failed:" << strerror(errno);
+        shm_unlink(path.constData());
+        return false;
+    }
+
+    char *bytes = static_cast<char *>(base);
+    LiveHeader *header = reinterpret_cast<LiveHeader *>(bytes);
+    header->version = ELIV_VERSION;
+    header->header_size = sizeof(LiveHeader);
+    header->wave_offset = LIVE_WAVE_OFFSET;
+    header->wave_slots = (uint32_t)waves;
+    header->wave_slot_size = sizeof(LiveWaveSlot);
+    header->status_offset = (uint32_t)statusOffset;
+    header->status_slots = (uint32_t)statuses;
+    header->status_slot_size = sizeof(LiveStatusSlot);
+    header->samples_per_wave = WAVEFORM_BATCH_SIZE;
+    header->publisher_pid = (uint32_t)getpid();
+    header->start_mono_ns = TraceRecorder::nowNs();
+    header->start_epoch_ms = QDateTime::currentMSecsSinceEpoch();
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ELIV_MAGIC;
+
+    m_name = name;
+    m_waves = reinterpret_cast<LiveWaveSlot *>(bytes + LIVE_WAVE_OFFSET);
+    m_statuses = reinterpret_cast<LiveStatusSlot *>(bytes + statusOffset);
+    m_waveMask = waves - 1;
+    m_statusMask = statuses - 1;
+    m_size = size;
+    m_header = header;
+    qInfo().noquote() << QString("[LiveStream] /dev/shm%1: %2 wave + %3 status slots, %4 KB")
+                             .arg(QString::fromUtf8(path)).arg(waves).arg(statuses).arg(size / 1024);
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(waveSlots);
+    Q_UNUSED(statusSlots);
+    qWarning() << "[LiveStream] shared memory is only available on Linux";
+    return false;
+#endif
+}
+
+void LiveStreamWriter::close()
+{
+    if (!m_header) return;
+#ifdef Q_OS_LINUX
+    munmap(m_header, (size_t)m_size);
+    shm_unlink(shmPath(m_name).constData());
+#endif
+    m_header = nullptr;
+    m_waves = nullptr;
+    m_statuses = nullptr;
+    m_size = 0;
+}
+
+void LiveStreamWriter::unlink()
+{
+#ifdef Q_OS_LINUX
+    if (m_header) shm_unlink(shmPath(m_name).constData());
+#endif
+}
+
+/**
+ * @brief 2.写一条波形
+ * @note  原子加占序号，多个采集线程同时写互不等待；同一个槽只有在环被绕一整圈时才会被两个写端争用
+ */
+void LiveStreamWriter::writeWave(int channel, const WaveformPacket &packet, int64_t hostNs)
+{
+    if (!m_header) return;
+    const uint64_t n = m_header->wave_head.fetch_add(1, std::memory_order_relaxed);
+    LiveWaveSlot &slot = m_waves[n & m_waveMask];
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.host_ns = hostNs;
+    slot.tick_us = packet.tick_us;
+    slot.channel = (uint16_t)channel;
+    slot.count = WAVEFORM_BATCH_SIZE;
+    memcpy(slot.samples, packet.adc_batch, sizeof(slot.samples));
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    s_waveRecords.inc();
+}
+
+void LiveStreamWriter::writeStatus(int channel, const StatusPacket &packet, int64_t hostNs)
+{
+    if (!m_header) return;
+    const uint64_t n = m_header->status_head.fetch_add(1, std::memory_order_relaxed);
+    LiveStatusSlot &slot = m_statuses[n & m_statusMask];
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.host_ns = hostNs;
+    slot.channel = (uint16_t)channel;
+    slot.impedance = packet.impedance;
+    slot.battery_pct = packet.battery_pct;
+    slot.real_freq = packet.real_freq;
+    slot.error_code = packet.error_code;
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    s_statusRecords.inc();
+}
+
+// ==========================================
+// 订阅端
+// ==========================================
+
+LiveStreamReader::LiveStreamReader()
+    : m_header(nullptr), m_waves(nullptr), m_statuses(nullptr), m_waveMask(0), m_statusMask(0),
+      m_waveNext(0), m_statusNext(0), m_waveLost(0), m_statusLost(0), m_overruns(0), m_size(0)
+{
+}
+
+LiveStreamReader::~LiveStreamReader()
+{
+    close();
+}
+
+/**
+ * @brief 3.映射
+ * @note  只读映射；先核对 magic/版本/槽大小，布局对不上的段不读
+ */
+bool LiveStreamReader::open(const QString &name, bool fromOldest)
+{
+    close();
+#ifdef Q_OS_LINUX
+    const QByteArray path = shmPath(name);
+    const int fd = shm_open(path.constData(), O_RDONLY, 0);
+    if (fd < 0) {
+        m_error = QString("shm_open %1: %2").arg(QString::fromUtf8(path), QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(LiveHeader)) {
+        m_error = "shared memory segment too small";
+        ::close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        m_error = QString("mmap: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    const char *bytes = static_cast<const char *>(base);
+    const LiveHeader *header = reinterpret_cast<const LiveHeader *>(bytes);
+    const uint32_t magic = header->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    QString error;
+    if (magic != ELIV_MAGIC) error = "bad magic (publisher not ready?)";
+    else if (header->version != ELIV_VERSION) error = QString("unsupported version %1").arg(header->version);
+    else if (header->header_size != sizeof(LiveHeader) || header->wave_slot_size != sizeof(LiveWaveSlot)
+             || header->status_slot_size != sizeof(LiveStatusSlot) || header->samples_per_wave != WAVEFORM_BATCH_SIZE)
+        error = "layout mismatch";
+    else if ((header->wave_slots & (header->wave_slots - 1)) != 0 || (header->status_slots & (header->status_slots - 1)) != 0
+             || header->wave_slots == 0 || header->status_slots == 0)
+        error = "slot counts must be powers of two";
+    else if ((qint64)header->wave_offset + (qint64)header->wave_slots * sizeof(LiveWaveSlot) > (qint64)st.st_size
+             || (qint64)header->status_offset + (qint64)header->status_slots * sizeof(LiveStatusSlot) > (qint64)st.st_size)
+        error = "segment shorter than its layout";
+    if (!error.isEmpty()) {
+        m_error = error;
+        munmap(base, (size_t)st.st_size);
+        return false;
+    }
+
+    m_header = header;
+    m_waves = reinterpret_cast<const LiveWaveSlot *>(bytes + header->wave_offset);
+    m_statuses = reinterpret_cast<const LiveStatusSlot *>(bytes + header->status_offset);
+    m_waveMask = header->wave_slots - 1;
+    m_statusMask = header->status_slots - 1;
+    m_size = st.st_size;
+    m_waveLost = m_statusLost = m_overruns = 0;
+
+    const uint64_t waveHead = header->wave_head.load(std::memory_order_acquire);
+    const uint64_t statusHead = header->status_head.load(std::memory_order_acquire);
+    if (fromOldest) {
+        // 留 1/8 环的余量，最老的几个槽可能正被覆盖
+        const uint64_t waveKeep = header->wave_slots - header->wave_slots / 8;
+        const uint64_t statusKeep = header->status_slots - header->status_slots / 8;
+        m_waveNext = waveHead > waveKeep ? waveHead - waveKeep : 0;
+        m_statusNext = statusHead > statusKeep ? statusHead - statusKeep : 0;
+    } else {
+        m_waveNext = waveHead;
+        m_statusNext = statusHead;
+    }
+    m_error.clear();
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(fromOldest);
+    m_error = "shared memory is only available on Linux";
+    return false;
+#endif
+}
+
+void LiveStreamReader::close()
+{
+    if (!m_header) return;
+#ifdef Q_OS_LINUX
+    munmap(const_cast<LiveHeader *>(m_header), (size_t)m_size);
+#endif
+    m_header = nullptr;
+    m_waves = nullptr;
+    m_statuses = nullptr;
+    m_size = 0;
+}
+
+uint64_t LiveStreamReader::resync(const std::atomic<uint64_t> &head, uint64_t slots, uint64_t next, quint64 &lost)
+{
+    const uint64_t h = head.load(std::memory_order_acquire);
+    uint64_t target = h > slots / 2 ? h - slots / 2 : 0;
+    if (target < next) target = next + 1; // 至少越过被覆盖的这一条
+    lost += target - next;
+    m_overruns++;
+    return target;
+}
+
+/**
+ * @brief 4.读下一条波形
+ * @note  seq 前后两次一致才算读到完整的一条；不一致说明拷贝期间槽被下一圈覆盖，按套圈处理
+ */
+bool LiveStreamReader::nextWave(LiveWaveRecord &out)
+{
+    if (!m_header) return false;
+    for (int attempt = 0; attempt < 4; attempt++) {
+        const uint64_t n = m_waveNext;
+        const LiveWaveSlot &slot = m_waves[n & m_waveMask];
+        const uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 < 2 * n + 2) return false; // 还没写到或正在写
+        if (s1 == 2 * n + 2) {
+            out.index = n;
+            out.hostNs = slot.host_ns;
+            out.tickUs = slot.tick_us;
+            out.channel = slot.channel;
+            out.count = slot.count;
+            memcpy(out.samples, slot.samples, sizeof(out.samples));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == s1) {
+                m_waveNext = n + 1;
+                return true;
+            }
+        }
+        m_waveNext = resync(m_header->wave_head, m_waveMask + 1, n, m_waveLost);
+    }
+    return false;
+}
+
+bool LiveStreamReader::nextStatus(LiveStatusRecord &out)
+{
+    if (!m_header) return false;
+    for (int attempt = 0; attempt < 4; attempt++) {
+        const uint64_t n = m_statusNext;
+        const LiveStatusSlot &slot = m_statuses[n & m_statusMask];
+        const uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 < 2 * n + 2) return false;
+        if (s1 == 2 * n + 2) {
+            out.index = n;
+            out.hostNs = slot.host_ns;
+            out.channel = slot.channel;
+            out.impedance = slot.impedance;
+            out.batteryPct = slot.battery_pct;
+            out.realFreq = slot.real_freq;
+            out.errorCode = slot.error_code;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == s1) {
+                m_statusNext = n + 1;
+                return true;
+            }
+        }
+        m_statusNext = resync(m_header->status_head, m_statusMask + 1, n, m_statusLost);
+    }
+    return false;
+}
+
+uint64_t LiveStreamReader::waveBacklog() const
+{
+    if (!m_header) return 0;
+    const uint64_t head = m_header->wave_head.load(std::memory_order_acquire);
+    return head > m_waveNext ? head - m_waveNext : 0;
+}
+
+uint64_t LiveStreamReader::statusBacklog() const
+{
+    if (!m_header) return 0;
+    const uint64_t head = m_header->status_head.load(std::memory_order_acquire);
+    return head > m_statusNext ? head - m_statusNext : 0;
+}
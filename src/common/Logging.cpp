@@ -0,0 +1,572 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 03:12:44
+ * @FilePath: \ele_sti\src\common\Logging.cpp
+ * @Description: 异步二进制日志：登记、后台排空与格式化、轮转、崩溃时补写
+ */
+#include "common/Logging.h"
+#include "common/Metrics.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static MetricCounter s_entries("ele_sti_log_entries_total", "Log entries written by the binary logger");
+static MetricCounter s_droppedTotal("ele_sti_log_dropped_total", "Log entries dropped because a thread's ring was full");
+static MetricHistogram s_drainTime("ele_sti_log_drain_seconds", "Time for the log writer to drain and format all rings");
+
+static const int MAX_LINE = 512;
+static const char *const LOG_FILE_NAME = "ele_sti.log";
+
+static int levelFromEnv()
+{
+    const QByteArray v = qgetenv("ELE_STI_LOG_LEVEL").toLower();
+    if (v == "debug") return BinLog::Debug;
+    if (v == "warn") return BinLog::Warn;
+    if (v == "error") return BinLog::Error;
+    return BinLog::Info;
+}
+
+std::atomic<int> BinLog::s_minLevel(levelFromEnv());
+thread_local BinLog::ThreadRing *BinLog::t_ring = nullptr;
+thread_local BinLog::RingOwner BinLog::t_owner;
+BinLog *BinLog::s_instance = nullptr;
+
+// 排空时的输出缓冲，只在持有 m_drainLock 时使用
+static char s_outBuf[64 * 1024];
+
+// ==========================================
+// 底层 I/O：崩溃处理里也要用，只用系统调用
+// ==========================================
+
+static int rawOpen(const QString &path)
+{
+    const QByteArray native = QFile::encodeName(path);
+#ifdef Q_OS_WIN
+    return _open(native.constData(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+    return ::open(native.constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+static void rawWrite(int fd, const char *data, int size)
+{
+    while (size > 0) {
+#ifdef Q_OS_WIN
+        const int n = _write(fd, data, (unsigned)size);
+#else
+        const int n = (int)::write(fd, data, (size_t)size);
+#endif
+        if (n <= 0) return;
+        data += n;
+        size -= n;
+    }
+}
+
+static void rawClose(int fd)
+{
+#ifdef Q_OS_WIN
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+// ==========================================
+// 不分配的格式化
+// ==========================================
+
+namespace {
+
+struct LineWriter {
+    char *out;
+    int cap;
+    int len;
+
+    void put(char c)
+    {
+        if (len < cap) out[len++] = c;
+    }
+    void puts(const char *s)
+    {
+        while (*s && len < cap) out[len++] = *s++;
+    }
+    void putUInt(uint64_t v, int minDigits = 1)
+    {
+        char tmp[24];
+        int n = 0;
+        do {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+        while (n < minDigits) tmp[n++] = '0';
+        while (n > 0) put(tmp[--n]);
+    }
+    void putInt(int64_t v)
+    {
+        if (v < 0) {
+            put('-');
+            putUInt((uint64_t)0 - (uint64_t)v);
+        } else {
+            putUInt((uint64_t)v);
+        }
+    }
+    void putHex(uint64_t v)
+    {
+        static const char digits[] = "0123456789ABCDEF";
+        char tmp[16];
+        int n = 0;
+        do {
+            tmp[n++] = digits[v & 0xF];
+            v >>= 4;
+        } while (v > 0);
+        puts("0x");
+        while (n > 0) put(tmp[--n]);
+    }
+    // prec < 0：3 位小数并去掉末尾的 0
+    void putDouble(double v, int prec)
+    {
+        if (v != v) {
+            puts("nan");
+            return;
+        }
+        if (v < 0) {
+            put('-');
+            v = -v;
+        }
+        if (v > 1e18) {
+            puts("inf");
+            return;
+        }
+        const bool trim = prec < 0;
+        if (trim) prec = 3;
+        prec = qMin(prec, 9);
+        uint64_t scale = 1;
+        for (int i = 0; i < prec; i++) scale *= 10;
+        uint64_t ip = (uint64_t)v;
+        uint64_t frac = (uint64_t)((v - (double)ip) * (double)scale + 0.5);
+        if (frac >= scale) {
+            ip++;
+            frac -= scale;
+        }
+        putUInt(ip);
+        if (prec == 0) return;
+        if (trim) {
+            while (prec > 0 && frac % 10 == 0) {
+                frac /= 10;
+                prec--;
+            }
+            if (prec == 0) return;
+        }
+        put('.');
+        putUInt(frac, prec);
+    }
+};
+
+} // namespace
+
+int BinLog::formatEntry(const Entry &e, char *out, int cap) const
+{
+    static const char levelNames[] = { 'D', 'I', 'W', 'E' };
+    LineWriter w = { out, cap - 1, 0 }; // 留一个字节给换行
+
+    // 时间：启动锚点 + 单调时间差，换算成本地时刻
+    qint64 ms = m_localAnchorMs + (e.tsNs - m_monoAnchorNs) / 1000000;
+    ms %= 86400000;
+    if (ms < 0) ms += 86400000;
+    w.put('[');
+    w.putUInt((uint64_t)(ms / 3600000), 2);
+    w.put(':');
+    w.putUInt((uint64_t)(ms / 60000 % 60), 2);
+    w.put(':');
+    w.putUInt((uint64_t)(ms / 1000 % 60), 2);
+    w.put('.');
+    w.putUInt((uint64_t)(ms % 1000), 3);
+    w.puts("][");
+
+    if (e.formatId >= m_formatCount.load(std::memory_order_acquire)) {
+        w.puts("E][binlog] bad format id ");
+        w.putUInt(e.formatId);
+        out[w.len++] = '\n';
+        return w.len;
+    }
+    const Format &f = m_formats[e.formatId];
+    w.put(levelNames[f.level & 3]);
+    w.puts("][");
+    w.puts(f.tag);
+    w.puts("] ");
+
+    int arg = 0;
+    for (const char *p = f.format; *p; p++) {
+        if (*p != '{') {
+            w.put(*p);
+            continue;
+        }
+        const char *close = p + 1;
+        while (*close && *close != '}') close++;
+        if (!*close) {
+            w.puts(p);
+            break;
+        }
+        if (arg >= e.argc) {
+            w.puts("{?}");
+            p = close;
+            continue;
+        }
+        const int type = (e.types[arg / 2] >> ((arg & 1) * 4)) & 0x0F;
+        const uint64_t raw = e.args[arg];
+        const bool hex = p[1] == 'x';
+        int prec = -1;
+        if (p[1] == '.') {
+            prec = 0;
+            for (const char *d = p + 2; d < close && *d >= '0' && *d <= '9'; d++) prec = prec * 10 + (*d - '0');
+        }
+        switch (type) {
+        case ArgInt:
+            if (hex) w.putHex(raw);
+            else w.putInt((int64_t)raw);
+            break;
+        case ArgUInt:
+            if (hex) w.putHex(raw);
+            else w.putUInt(raw);
+            break;
+        case ArgDouble: {
+            double d;
+            memcpy(&d, &raw, sizeof(d));
+            w.putDouble(d, prec);
+            break;
+        }
+        case ArgStr: {
+            const char *s = (const char *)(uintptr_t)raw;
+            w.puts(s ? s : "(null)");
+            break;
+        }
+        default:
+            w.puts("{?}");
+            break;
+        }
+        arg++;
+        p = close;
+    }
+    out[w.len++] = '\n';
+    return w.len;
+}
+
+// ==========================================
+// 单例与登记
+// ==========================================
+
+BinLog &BinLog::instance()
+{
+    static BinLog *log = new BinLog();
+    return *log;
+}
+
+BinLog::BinLog()
+    : m_formatCount(0), m_ringCount(0), m_dropped(0),
+      m_fd(-1), m_fileBytes(0), m_maxFileBytes(4 * 1024 * 1024), m_maxFiles(3),
+      m_stopping(false), m_crashing(false), m_writer(nullptr)
+{
+    m_monoAnchorNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch()).count();
+    const QDateTime now = QDateTime::currentDateTime();
+    m_localAnchorMs = now.toMSecsSinceEpoch() + (qint64)now.offsetFromUtc() * 1000;
+
+    // 编号 0 留给登记失败 (格式表满)
+    m_formats[0] = { Error, "binlog", "format table full" };
+    m_formatCount.store(1);
+
+    m_overflow = new ThreadRing();
+    m_overflow->head.store(RING_ENTRIES);
+    m_overflow->tail.store(0);
+    m_overflow->dropped.store(0);
+    m_overflow->droppedReported = 0;
+    m_overflow->inUse = true;
+
+    m_dir = qEnvironmentVariable("ELE_STI_LOG_DIR");
+    openFileLocked();
+
+    s_instance = this;
+    std::signal(SIGSEGV, crashHandler);
+    std::signal(SIGABRT, crashHandler);
+    std::signal(SIGFPE, crashHandler);
+    std::signal(SIGILL, crashHandler);
+#ifdef SIGBUS
+    std::signal(SIGBUS, crashHandler);
+#endif
+
+    m_writer = QThread::create([this]() { writerLoop(); });
+    m_writer->setObjectName("binlog");
+    m_writer->start(QThread::LowPriority);
+    std::atexit(shutdown);
+}
+
+uint16_t BinLog::registerFormat(Level level, const char *tag, const char *format)
+{
+    QMutexLocker locker(&m_registerLock);
+    const int id = m_formatCount.load(std::memory_order_relaxed);
+    if (id >= MAX_FORMATS) return 0;
+    m_formats[id] = { level, tag, format };
+    // release：读端先看到计数再读表项
+    m_formatCount.store(id + 1, std::memory_order_release);
+    return (uint16_t)id;
+}
+
+/**
+ * @brief 本线程第一次写日志时取环
+ * @note  先复用已退出线程交还的环：旧线程最后一次写 head 与交还都在锁前，新线程接着写是单生产者；
+ *        head/tail/丢弃数都是累计值，消费者不需要知道换了线程
+ */
+BinLog::ThreadRing *BinLog::createRing()
+{
+    (void)&t_owner; // 首次访问时登记本线程的析构
+    QMutexLocker locker(&m_registerLock);
+    const int n = m_ringCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; i++) {
+        if (!m_rings[i]->inUse) {
+            m_rings[i]->inUse = true;
+            t_ring = m_rings[i];
+            return t_ring;
+        }
+    }
+    if (n >= MAX_THREADS) {
+        t_ring = m_overflow;
+        return m_overflow;
+    }
+    ThreadRing *ring = new ThreadRing();
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->dropped.store(0);
+    ring->droppedReported = 0;
+    ring->inUse = true;
+    m_rings[n] = ring;
+    m_ringCount.store(n + 1, std::memory_order_release);
+    t_ring = ring;
+    return ring;
+}
+
+BinLog::RingOwner::~RingOwner()
+{
+    ThreadRing *ring = t_ring;
+    if (!ring || !s_instance || ring == s_instance->m_overflow) return;
+    QMutexLocker locker(&s_instance->m_registerLock);
+    ring->inUse = false;
+    // 之后析构的线程局部对象如果还写日志，只计丢弃，不再取环
+    t_ring = s_instance->m_overflow;
+}
+
+// ==========================================
+// 后台排空
+// ==========================================
+
+void BinLog::writerLoop()
+{
+    const std::chrono::milliseconds period(+LOG_FLUSH_MS);
+    while (!m_stopping.load()) {
+        {
+            std::unique_lock<std::mutex> lk(m_wakeLock);
+            m_wake.wait_for(lk, period, [this]() { return m_stopping.load(); });
+        }
+        flush();
+    }
+}
+
+void BinLog::flush()
+{
+    std::lock_guard<std::mutex> lk(m_drainLock);
+    drainLocked();
+}
+
+/**
+ * @brief 1.排空
+ * @note  先记下各环当前的 head，只处理这之前的条目；多个环按时间戳归并，输出按时间排序。
+ *        先写出再推进 tail：写到一半崩溃时崩溃处理会重复几行，但不会漏
+ */
+void BinLog::drainLocked()
+{
+    const qint64 t0 = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch()).count();
+    const int rings = m_ringCount.load(std::memory_order_acquire);
+    quint32 pos[MAX_THREADS];
+    quint32 end[MAX_THREADS];
+    int used = 0;
+
+    // 丢弃数 (包括线程数超限的共用环)
+    for (int r = 0; r <= rings; r++) {
+        ThreadRing *ring = r < rings ? m_rings[r] : m_overflow;
+        const quint32 d = ring->dropped.load(std::memory_order_relaxed);
+        if (d == ring->droppedReported) continue;
+        const quint32 delta = d - ring->droppedReported;
+        ring->droppedReported = d;
+        m_dropped.fetch_add(delta, std::memory_order_relaxed);
+        s_droppedTotal.inc(delta);
+        LineWriter w = { s_outBuf + used, MAX_LINE - 1, 0 };
+        w.puts("[binlog] ");
+        w.putUInt(delta);
+        w.puts(r < rings ? " entries dropped (ring full)" : " entries dropped (too many logging threads)");
+        s_outBuf[used + w.len++] = '\n';
+        used += w.len;
+    }
+
+    quint64 total = 0;
+    for (int r = 0; r < rings; r++) {
+        pos[r] = m_rings[r]->tail.load(std::memory_order_relaxed);
+        end[r] = m_rings[r]->head.load(std::memory_order_acquire);
+        total += end[r] - pos[r];
+    }
+    for (quint64 k = 0; k < total; k++) {
+        int best = -1;
+        qint64 bestTs = 0;
+        for (int r = 0; r < rings; r++) {
+            if (pos[r] == end[r]) continue;
+            const qint64 ts = m_rings[r]->entries[pos[r] & (RING_ENTRIES - 1)].tsNs;
+            if (best < 0 || ts < bestTs) {
+                best = r;
+                bestTs = ts;
+            }
+        }
+        if (used + MAX_LINE > (int)sizeof(s_outBuf)) {
+            writeOut(s_outBuf, used);
+            used = 0;
+        }
+        used += formatEntry(m_rings[best]->entries[pos[best] & (RING_ENTRIES - 1)], s_outBuf + used, MAX_LINE);
+        pos[best]++;
+    }
+    if (used > 0) writeOut(s_outBuf, used);
+    for (int r = 0; r < rings; r++) m_rings[r]->tail.store(pos[r], std::memory_order_release);
+
+    if (total > 0) {
+        s_entries.inc(total);
+        s_drainTime.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch()).count() - t0);
+    }
+}
+
+void BinLog::writeOut(const char *data, int size)
+{
+    if (m_fd < 0) {
+        rawWrite(2, data, size);
+        return;
+    }
+    rawWrite(m_fd, data, size);
+    m_fileBytes += size;
+    if (m_fileBytes >= m_maxFileBytes) rotateLocked();
+}
+
+void BinLog::openFileLocked()
+{
+    m_fd = -1;
+    m_path.clear();
+    m_fileBytes = 0;
+    if (m_dir.isEmpty()) return;
+    if (!QDir().mkpath(m_dir)) {
+        qWarning() << "[BinLog] cannot create" << m_dir << ", logging to stderr";
+        return;
+    }
+    const QString path = QDir(m_dir).filePath(LOG_FILE_NAME);
+    const int fd = rawOpen(path);
+    if (fd < 0) {
+        qWarning() << "[BinLog] cannot open" << path << ", logging to stderr";
+        return;
+    }
+    m_fd = fd;
+    m_path = path;
+    m_fileBytes = QFileInfo(path).size();
+}
+
+/**
+ * @brief 2.轮转
+ * @note  ele_sti.log -> ele_sti.log.1 -> ... -> ele_sti.log.<maxFiles>，最旧的删除
+ */
+void BinLog::rotateLocked()
+{
+    const int fd = m_fd;
+    m_fd = -1;
+    rawClose(fd);
+    for (int i = m_maxFiles; i >= 1; i--) {
+        const QString to = QString("%1.%2").arg(m_path).arg(i);
+        const QString from = i == 1 ? m_path : QString("%1.%2").arg(m_path).arg(i - 1);
+        QFile::remove(to);
+        if (QFile::exists(from)) QFile::rename(from, to);
+    }
+    openFileLocked();
+}
+
+void BinLog::setDirectory(const QString &dir)
+{
+    std::lock_guard<std::mutex> lk(m_drainLock);
+    drainLocked();
+    if (m_fd >= 0) rawClose(m_fd);
+    m_dir = dir;
+    openFileLocked();
+}
+
+QString BinLog::currentPath() const
+{
+    std::lock_guard<std::mutex> lk(m_drainLock);
+    return m_path;
+}
+
+void BinLog::setRotation(qint64 maxFileBytes, int maxFiles)
+{
+    std::lock_guard<std::mutex> lk(m_drainLock);
+    m_maxFileBytes = qMax<qint64>(64 * 1024, maxFileBytes);
+    m_maxFiles = qMax(1, maxFiles);
+}
+
+void BinLog::shutdown()
+{
+    BinLog *log = s_instance;
+    if (!log || log->m_stopping.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lk(log->m_wakeLock);
+    }
+    log->m_wake.notify_all();
+    log->m_writer->wait();
+    log->flush();
+}
+
+// ==========================================
+// 崩溃
+// ==========================================
+
+/**
+ * @brief 3.崩溃补写
+ * @note  不加锁 (崩溃可能发生在持锁的线程上)，按环逐个把 tail 之后的条目格式化到栈上直接 write；
+ *        排空线程正在写的那一批可能重复输出
+ */
+void BinLog::crashFlush()
+{
+    if (m_crashing.exchange(true)) return;
+    const int fd = m_fd >= 0 ? m_fd : 2;
+    char line[MAX_LINE];
+    const int rings = m_ringCount.load(std::memory_order_acquire);
+    for (int r = 0; r < rings; r++) {
+        ThreadRing *ring = m_rings[r];
+        const quint32 head = ring->head.load(std::memory_order_acquire);
+        for (quint32 i = ring->tail.load(std::memory_order_acquire); i != head; i++) {
+            rawWrite(fd, line, formatEntry(ring->entries[i & (RING_ENTRIES - 1)], line, MAX_LINE));
+        }
+    }
+    static const char marker[] = "[binlog] fatal signal, pending entries flushed\n";
+    rawWrite(fd, marker, (int)sizeof(marker) - 1);
+}
+
+void BinLog::crashHandler(int sig)
+{
+    if (s_instance) s_instance->crashFlush();
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
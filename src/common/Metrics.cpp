@@ -0,0 +1,180 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 14:02:44
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 14:02:44
+ * @FilePath: \ele_sti\src\common\Metrics.cpp
+ * @Description: 运行指标：注册、线程存储分配、汇总与文本导出
+ */
+#include "common/Metrics.h"
+#include <QMutexLocker>
+#include <QDebug>
+#include <QtAlgorithms>
+#include <limits>
+
+thread_local MetricsRegistry::ThreadSlab *MetricsRegistry::t_slab = nullptr;
+
+MetricsRegistry::ThreadSlab::ThreadSlab()
+{
+    for (auto &c : counters) c.store(0, std::memory_order_relaxed);
+    for (auto &h : histCount)
+        for (auto &b : h) b.store(0, std::memory_order_relaxed);
+    for (auto &s : histSum) s.store(0, std::memory_order_relaxed);
+    for (auto &m : histMax) m.store(0, std::memory_order_relaxed);
+}
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+/**
+ * @brief 1.注册指标
+ * @return 该类型内的下标；容量用完返回 -1 (句柄会忽略写入)
+ * @note  同名指标重复注册时返回已有下标，方便多个文件共用一个指标
+ */
+int MetricsRegistry::registerMetric(Type type, const char *name, const char *help)
+{
+    QMutexLocker locker(&m_mutex);
+    const QString key = QString::fromLatin1(name);
+    for (const Meta &m : m_meta) {
+        if (m.name == key) {
+            return (m.type == type) ? m.slot : -1;
+        }
+    }
+
+    int slot = -1;
+    switch (type) {
+    case Counter:   if (m_counterCount < MAX_COUNTERS)   slot = m_counterCount++; break;
+    case Gauge:     if (m_gaugeCount < MAX_GAUGES)       slot = m_gaugeCount++;   break;
+    case Histogram: if (m_histCount < MAX_HISTOGRAMS)    slot = m_histCount++;    break;
+    }
+    if (slot < 0) {
+        qWarning() << "[Metrics] capacity exhausted, dropping" << key;
+        return -1;
+    }
+    m_meta.append({key, QString::fromUtf8(help), type, slot});
+    return slot;
+}
+
+/**
+ * @brief 2.为当前线程分配私有存储
+ * @note  每个线程只走一次，之后热路径只读 thread_local 指针
+ */
+MetricsRegistry::ThreadSlab *MetricsRegistry::createSlab()
+{
+    ThreadSlab *slab = new ThreadSlab();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_slabs.append(slab);
+    }
+    t_slab = slab;
+    return slab;
+}
+
+int MetricsRegistry::bucketIndex(qint64 ns)
+{
+    if (ns < (qint64(1) << HIST_MIN_EXP)) return 0;
+    const int exp = 63 - (int)qCountLeadingZeroBits((quint64)ns);
+    if (exp > HIST_MAX_EXP) return HIST_BUCKETS - 1;
+    const int sub = (int)((ns >> (exp - 2)) & (HIST_SUB - 1));
+    return 1 + (exp - HIST_MIN_EXP) * HIST_SUB + sub;
+}
+
+qint64 MetricsRegistry::bucketUpperBound(int index)
+{
+    if (index <= 0) return qint64(1) << HIST_MIN_EXP;
+    if (index >= HIST_BUCKETS - 1) return std::numeric_limits<qint64>::max();
+    const int exp = HIST_MIN_EXP + (index - 1) / HIST_SUB;
+    const int sub = (index - 1) % HIST_SUB;
+    return (qint64(1) << exp) + (qint64)(sub + 1) * (qint64(1) << (exp - 2));
+}
+
+/**
+ * @brief 3.汇总所有线程的数据
+ * @note  读到的是各线程某一时刻的值，不保证跨指标一致，对监控足够
+ */
+QVector<MetricsRegistry::Value> MetricsRegistry::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Value> out;
+    out.reserve(m_meta.size());
+
+    for (const Meta &m : m_meta) {
+        Value v;
+        v.name = m.name;
+        v.help = m.help;
+        v.type = m.type;
+        v.value = 0; v.sum = 0; v.p50 = 0; v.p99 = 0; v.max = 0;
+
+        if (m.type == Counter) {
+            quint64 total = 0;
+            for (const ThreadSlab *slab : m_slabs) {
+                total += slab->counters[m.slot].load(std::memory_order_relaxed);
+            }
+            v.value = (double)total;
+        } else if (m.type == Gauge) {
+            v.value = (double)m_gauges[m.slot].load(std::memory_order_relaxed);
+        } else {
+            v.buckets.fill(0, HIST_BUCKETS);
+            quint64 count = 0;
+            for (const ThreadSlab *slab : m_slabs) {
+                for (int b = 0; b < HIST_BUCKETS; b++) {
+                    quint64 c = slab->histCount[m.slot][b].load(std::memory_order_relaxed);
+                    v.buckets[b] += c;
+                    count += c;
+                }
+                v.sum += (double)slab->histSum[m.slot].load(std::memory_order_relaxed);
+                v.max = qMax(v.max, (double)slab->histMax[m.slot].load(std::memory_order_relaxed));
+            }
+            v.value = (double)count;
+
+            // 分位数取所在桶的上界
+            const quint64 r50 = (count + 1) / 2;
+            const quint64 r99 = count - count / 100;
+            quint64 cum = 0;
+            for (int b = 0; b < HIST_BUCKETS && count > 0; b++) {
+                const quint64 prev = cum;
+                cum += v.buckets[b];
+                const double upper = qMin((double)bucketUpperBound(b), v.max);
+                if (prev < r50 && cum >= r50) v.p50 = upper;
+                if (prev < r99 && cum >= r99) { v.p99 = upper; break; }
+            }
+        }
+        out.append(v);
+    }
+    return out;
+}
+
+/**
+ * @brief 4.导出 Prometheus 文本格式
+ * @note  直方图只在 2 的幂边界输出累计桶，单位换算成秒
+ */
+QString MetricsRegistry::exposition() const
+{
+    QString text;
+    for (const Value &v : snapshot()) {
+        const char *type = (v.type == Counter) ? "counter" : (v.type == Gauge ? "gauge" : "histogram");
+        text += QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(v.name, v.help, QString::fromLatin1(type));
+
+        if (v.type != Histogram) {
+            text += QString("%1 %2\n").arg(v.name).arg(v.value, 0, 'f', 0);
+            continue;
+        }
+        quint64 cum = 0;
+        for (int b = 0; b < HIST_BUCKETS - 1; b++) {
+            cum += v.buckets[b];
+            if (b % HIST_SUB == 0) { // 每个 2 的幂区间的上界
+                text += QString("%1_bucket{le=\"%2\"} %3\n")
+                            .arg(v.name)
+                            .arg(bucketUpperBound(b) / 1e9, 0, 'g', 6)
+                            .arg(cum);
+            }
+        }
+        text += QString("%1_bucket{le=\"+Inf\"} %2\n").arg(v.name).arg((quint64)v.value);
+        text += QString("%1_sum %2\n").arg(v.name).arg(v.sum / 1e9, 0, 'g', 9);
+        text += QString("%1_count %2\n").arg(v.name).arg((quint64)v.value);
+    }
+    return text;
+}
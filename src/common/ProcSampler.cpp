@@ -0,0 +1,309 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 20:52:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 20:52:18
+ * @FilePath: \ele_sti\src\common\ProcSampler.cpp
+ * @Description: /proc 采样：持久 fd + pread + 手写数字解析
+ */
+#include "common/ProcSampler.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include <algorithm>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static MetricGauge s_rss("ele_sti_process_rss_bytes", "Resident set size of the process");
+static MetricGauge s_cpu("ele_sti_process_cpu_permille", "Process CPU usage in permille of one core");
+static MetricGauge s_wakeups("ele_sti_process_wakeups_per_second", "Times per second any thread of the process was scheduled onto a CPU");
+
+// ---------------- 手写解析 ----------------
+
+static inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static inline const char *parseU64(const char *p, const char *end, quint64 &out)
+{
+    p = skipSpaces(p, end);
+    quint64 v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (quint64)(*p - '0');
+        p++;
+    }
+    out = v;
+    return p;
+}
+
+static inline const char *skipToken(const char *p, const char *end)
+{
+    p = skipSpaces(p, end);
+    while (p < end && *p != ' ' && *p != '\n') p++;
+    return p;
+}
+
+static inline const char *nextLine(const char *p, const char *end)
+{
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+ProcSampler::ProcSampler()
+    : m_statFd(-1), m_meminfoFd(-1), m_statmFd(-1), m_pid(0),
+      m_clockTicks(100), m_pageSize(4096), m_samples(0), m_lastNs(0)
+{
+}
+
+ProcSampler::~ProcSampler()
+{
+    close();
+}
+
+bool ProcSampler::open()
+{
+#ifdef Q_OS_LINUX
+    if (isOpen()) return true;
+    m_statFd = ::open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    m_meminfoFd = ::open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    m_statmFd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    m_pid = (int)getpid();
+    m_clockTicks = sysconf(_SC_CLK_TCK);
+    m_pageSize = sysconf(_SC_PAGESIZE);
+    if (m_clockTicks <= 0) m_clockTicks = 100;
+    if (m_pageSize <= 0) m_pageSize = 4096;
+    m_samples = 0;
+    return isOpen();
+#else
+    return false;
+#endif
+}
+
+void ProcSampler::close()
+{
+#ifdef Q_OS_LINUX
+    for (int fd : { m_statFd, m_meminfoFd, m_statmFd }) {
+        if (fd >= 0) ::close(fd);
+    }
+#endif
+    for (const Task &t : m_tasks) closeTask(t);
+    m_statFd = m_meminfoFd = m_statmFd = -1;
+    m_tasks.clear();
+    m_lastCpu.clear();
+}
+
+void ProcSampler::closeTask(const Task &task)
+{
+#ifdef Q_OS_LINUX
+    if (task.fd >= 0) ::close(task.fd);
+    if (task.schedFd >= 0) ::close(task.schedFd);
+#else
+    Q_UNUSED(task);
+#endif
+}
+
+// 从偏移 0 读进 m_buf，返回字节数；/proc/stat 只需要开头的 cpu 行，读不全无所谓
+int ProcSampler::readFile(int fd)
+{
+#ifdef Q_OS_LINUX
+    if (fd < 0) return 0;
+    const ssize_t n = pread(fd, m_buf, sizeof(m_buf), 0);
+    return n > 0 ? (int)n : 0;
+#else
+    Q_UNUSED(fd);
+    return 0;
+#endif
+}
+
+/**
+ * @brief 1.采样
+ */
+bool ProcSampler::sample(Snapshot &out)
+{
+    if (!isOpen()) return false;
+    const qint64 now = LatencyTracer::nowNs();
+    const double elapsedSec = m_lastNs > 0 ? (now - m_lastNs) / 1e9 : 0.0;
+    m_lastNs = now;
+
+    if (m_samples % TASK_RESCAN == 0) rescanTasks();
+    m_samples++;
+
+    if (!readCpu(out)) return false;
+    readMemory(out);
+    readThreads(out, elapsedSec);
+
+    s_rss.set((qint64)out.rssBytes);
+    s_cpu.set((qint64)(out.processCpuPct * 10.0));
+    s_wakeups.set((qint64)out.wakeupsPerSec);
+    return true;
+}
+
+/**
+ * @brief 2./proc/stat：cpu 行 (整机) 和 cpuN 行 (每核)
+ * @note  busy = total - idle - iowait
+ */
+bool ProcSampler::readCpu(Snapshot &out)
+{
+    const int len = readFile(m_statFd);
+    if (len <= 0) return false;
+    const char *p = m_buf;
+    const char *end = m_buf + len;
+
+    QVector<CpuTimes> cur;
+    cur.reserve(m_lastCpu.size() > 0 ? m_lastCpu.size() : 9);
+    while (p < end && end - p > 3 && memcmp(p, "cpu", 3) == 0) {
+        p = skipToken(p, end); // "cpu" / "cpuN"
+        quint64 v[8] = {};
+        for (int i = 0; i < 8; i++) p = parseU64(p, end, v[i]);
+        // user nice system idle iowait irq softirq steal
+        CpuTimes t;
+        for (int i = 0; i < 8; i++) t.total += v[i];
+        t.busy = t.total - v[3] - v[4];
+        cur.append(t);
+        p = nextLine(p, end);
+    }
+    if (cur.isEmpty()) return false;
+
+    out.cores.resize(cur.size() - 1);
+    if (m_lastCpu.size() == cur.size()) {
+        for (int i = 0; i < cur.size(); i++) {
+            const quint64 dt = cur[i].total - m_lastCpu[i].total;
+            const double usage = dt > 0 ? (double)(cur[i].busy - m_lastCpu[i].busy) / dt : 0.0;
+            if (i == 0) out.cpuTotal = usage;
+            else out.cores[i - 1] = usage;
+        }
+    }
+    m_lastCpu = cur;
+    return true;
+}
+
+/**
+ * @brief 3./proc/meminfo 和 /proc/self/statm
+ */
+void ProcSampler::readMemory(Snapshot &out)
+{
+    int len = readFile(m_meminfoFd);
+    const char *p = m_buf;
+    const char *end = m_buf + len;
+    int found = 0;
+    while (p < end && found < 2) {
+        if (end - p > 9 && memcmp(p, "MemTotal:", 9) == 0) {
+            parseU64(p + 9, end, out.memTotalKb);
+            found++;
+        } else if (end - p > 13 && memcmp(p, "MemAvailable:", 13) == 0) {
+            parseU64(p + 13, end, out.memAvailableKb);
+            found++;
+        }
+        p = nextLine(p, end);
+    }
+
+    // statm: size resident shared ... (页)
+    len = readFile(m_statmFd);
+    quint64 pages = 0;
+    const char *q = skipToken(m_buf, m_buf + len);
+    parseU64(q, m_buf + len, pages);
+    out.rssBytes = pages * (quint64)m_pageSize;
+}
+
+/**
+ * @brief 4./proc/self/task/<tid>/stat 和 schedstat
+ * @note  comm 可能含空格和括号，从最后一个 ')' 往后数字段：
+ *        state(3) ... utime(14) stime(15) ... processor(39)；
+ *        schedstat 为 "运行 ns 等待 ns 调度次数"，取调度次数的差值当作唤醒次数
+ */
+void ProcSampler::readThreads(Snapshot &out, double elapsedSec)
+{
+    out.threads.clear();
+    out.processCpuPct = 0.0;
+    out.wakeupsPerSec = 0.0;
+    for (auto it = m_tasks.begin(); it != m_tasks.end();) {
+        Task &task = it.value();
+        const int len = readFile(task.fd);
+        if (len <= 0) {
+            // 线程已退出
+            closeTask(task);
+            it = m_tasks.erase(it);
+            continue;
+        }
+        const char *end = m_buf + len;
+        const char *p = end;
+        while (p > m_buf && *(p - 1) != ')') p--;
+        for (int field = 3; field <= 13; field++) p = skipToken(p, end);
+        quint64 utime = 0, stime = 0;
+        p = parseU64(p, end, utime);
+        p = parseU64(p, end, stime);
+        // priority/nice 可能是负数，按 token 跳过
+        for (int field = 16; field <= 38; field++) p = skipToken(p, end);
+        quint64 processor = 0;
+        parseU64(p, end, processor);
+
+        const quint64 ticks = utime + stime;
+        quint64 switches = 0;
+        const int schedLen = readFile(task.schedFd);
+        if (schedLen > 0) {
+            const char *q = skipToken(m_buf, m_buf + schedLen);
+            q = skipToken(q, m_buf + schedLen);
+            parseU64(q, m_buf + schedLen, switches);
+        }
+
+        ThreadLoad load;
+        load.tid = it.key();
+        load.name = task.name;
+        load.cpuPct = (task.seen && elapsedSec > 0.0)
+                          ? 100.0 * (double)(ticks - task.ticks) / ((double)m_clockTicks * elapsedSec)
+                          : 0.0;
+        load.lastCore = (int)processor;
+        load.wakeupsPerSec = (task.seen && elapsedSec > 0.0) ? (double)(switches - task.switches) / elapsedSec : 0.0;
+        task.ticks = ticks;
+        task.switches = switches;
+        task.seen = true;
+        out.processCpuPct += load.cpuPct;
+        out.wakeupsPerSec += load.wakeupsPerSec;
+        out.threads.append(load);
+        ++it;
+    }
+    std::sort(out.threads.begin(), out.threads.end(),
+              [](const ThreadLoad &a, const ThreadLoad &b) { return a.cpuPct > b.cpuPct; });
+}
+
+/**
+ * @brief 5.扫描线程列表，给新线程打开 stat 并读一次名字
+ * @note  线程名取 comm (Qt 在线程启动时把 objectName 写进去)，
+ *        主线程的 comm 是进程名，统一标成 UI；Qt Quick 的渲染线程标成 render
+ */
+void ProcSampler::rescanTasks()
+{
+#ifdef Q_OS_LINUX
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) return;
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+        const int tid = atoi(entry->d_name);
+        if (m_tasks.contains(tid)) continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+        Task task;
+        task.fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (task.fd < 0) continue;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", tid);
+        task.schedFd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+        snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+        const int commFd = ::open(path, O_RDONLY | O_CLOEXEC);
+        const int len = readFile(commFd);
+        if (commFd >= 0) ::close(commFd);
+        task.name = QString::fromLocal8Bit(m_buf, len).trimmed();
+        if (tid == m_pid) task.name = "UI";
+        else if (task.name == "QSGRenderThread") task.name = "render";
+        m_tasks.insert(tid, task);
+    }
+    closedir(dir);
+#endif
+}
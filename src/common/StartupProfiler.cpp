@@ -0,0 +1,96 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 17:20:36
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 17:20:36
+ * @FilePath: \ele_sti\src\common\StartupProfiler.cpp
+ * @Description: 启动耗时剖析
+ */
+#include "common/StartupProfiler.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThread>
+#include <algorithm>
+
+StartupProfiler &StartupProfiler::instance()
+{
+    static StartupProfiler profiler;
+    return profiler;
+}
+
+StartupProfiler::StartupProfiler()
+    : m_finished(false)
+{
+    m_clock.start();
+    m_marks.reserve(32);
+}
+
+void StartupProfiler::mark(const QString &phase)
+{
+    const qint64 ns = m_clock.nsecsElapsed();
+    QThread *thread = QThread::currentThread();
+    QString threadName = thread->objectName();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        threadName = "UI";
+    }
+    bool late = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_marks.append({ phase, threadName, ns });
+        late = m_finished;
+    }
+    // 首帧之后的阶段 (后台页面加载) 逐条打印
+    if (late && qEnvironmentVariable("ELE_STI_STARTUP_PROFILE") != "0") {
+        qInfo().noquote() << QString("[Startup] %1 ms  %2 (after first frame)").arg(ns / 1e6, 0, 'f', 1).arg(phase);
+    }
+    emit marked(phase);
+}
+
+void StartupProfiler::finish(const QString &phase)
+{
+    mark(phase);
+    qint64 total = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_finished) return;
+        m_finished = true;
+        total = m_marks.isEmpty() ? 0 : m_marks.last().ns;
+    }
+    if (qEnvironmentVariable("ELE_STI_STARTUP_PROFILE") != "0") {
+        qInfo().noquote() << formatReport();
+    }
+    emit finished(total);
+}
+
+bool StartupProfiler::isFinished() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_finished;
+}
+
+QVector<StartupProfiler::Mark> StartupProfiler::marks() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_marks;
+}
+
+/**
+ * @brief 时间线：累计时间 / 距上一阶段 / 线程 / 阶段
+ * @note  后端线程与 UI 线程并行，按时间排序后"距上一阶段"只表示相邻两条的间隔
+ */
+QString StartupProfiler::formatReport() const
+{
+    QVector<Mark> sorted = marks();
+    std::sort(sorted.begin(), sorted.end(), [](const Mark &a, const Mark &b) { return a.ns < b.ns; });
+    QString out = "[Startup] timeline (ms):\n";
+    qint64 prev = 0;
+    for (const Mark &m : sorted) {
+        out += QString("  %1  +%2  %3  %4\n")
+                   .arg(m.ns / 1e6, 8, 'f', 1)
+                   .arg((m.ns - prev) / 1e6, 7, 'f', 1)
+                   .arg(m.thread.isEmpty() ? QString("-") : m.thread, -12)
+                   .arg(m.phase);
+        prev = m.ns;
+    }
+    return out;
+}
@@ -0,0 +1,214 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 15:20:37
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 15:20:37
+ * @FilePath: \ele_sti\src\common\TraceRecorder.cpp
+ * @Description: 时间线追踪：名字表、线程环分配、Chrome trace JSON 导出
+ */
+#include "common/TraceRecorder.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+#include <chrono>
+
+thread_local TraceRecorder::ThreadRing *TraceRecorder::t_ring = nullptr;
+
+TraceRecorder &TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_enabled(qEnvironmentVariable("ELE_STI_TRACE") != "0")
+{
+}
+
+qint64 TraceRecorder::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 1.名字 intern
+ * @note  同名返回同一编号；调用方用函数内 static 缓存结果，所以只会加锁一次
+ */
+uint16_t TraceRecorder::intern(const char *name)
+{
+    QMutexLocker locker(&m_mutex);
+    const QString key = QString::fromLatin1(name);
+    int idx = m_names.indexOf(key);
+    if (idx < 0) {
+        if (m_names.size() >= 0xFFFF) return 0;
+        m_names.append(key);
+        idx = m_names.size() - 1;
+    }
+    return (uint16_t)idx;
+}
+
+/**
+ * @brief 2.当前线程第一次记录事件时分配环
+ * @note  线程名取 QThread::objectName，主线程记为 "UI"
+ */
+TraceRecorder::ThreadRing *TraceRecorder::createRing()
+{
+    ThreadRing *ring = new ThreadRing();
+    ring->head.store(0);
+    ring->tid = (qint64)(quintptr)QThread::currentThreadId();
+
+    QThread *thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        ring->threadName = "UI";
+    } else if (thread && !thread->objectName().isEmpty()) {
+        ring->threadName = thread->objectName();
+    } else {
+        ring->threadName = QString("thread-%1").arg(ring->tid);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_rings.append(ring);
+    }
+    t_ring = ring;
+    return ring;
+}
+
+/**
+ * @brief 3.拷贝各线程的环
+ * @note  拷贝期间写线程可能覆盖最旧的事件：拷贝前后各读一次 head，
+ *        只保留两次读之间不可能被覆盖的那一段
+ */
+TraceRecorder::Snapshot TraceRecorder::snapshot() const
+{
+    Snapshot snap;
+    snap.taken = QDateTime::currentDateTime();
+    QVector<ThreadRing *> rings;
+    {
+        QMutexLocker locker(&m_mutex);
+        snap.names = m_names;
+        rings = m_rings;
+    }
+
+    snap.threads.reserve(rings.size());
+    for (ThreadRing *ring : rings) {
+        Snapshot::Thread thread;
+        thread.tid = ring->tid;
+        thread.name = ring->threadName;
+
+        const quint64 before = ring->head.load(std::memory_order_acquire);
+        const quint64 count = qMin<quint64>(before, RING_EVENTS);
+        thread.events.resize((int)count);
+        for (quint64 i = 0; i < count; i++) {
+            thread.events[(int)i] = ring->events[(before - count + i) & (RING_EVENTS - 1)];
+        }
+        const quint64 after = ring->head.load(std::memory_order_acquire);
+        // 拷贝期间新写入了 (after - before) 个事件，覆盖了最旧的那几个；
+        // 环满时写者正在写的 head & mask 槽位就是最旧的一个，即使 after == before 也可能是半写状态，多丢一个
+        const quint64 inFlight = before >= RING_EVENTS ? 1 : 0;
+        const quint64 overwritten = qMin<quint64>(after - before + inFlight, count);
+        thread.events.remove(0, (int)overwritten);
+        snap.threads.append(thread);
+    }
+    return snap;
+}
+
+QString TraceRecorder::dumpChromeJson(const QString &path, const QString &reason)
+{
+    return writeChromeJson(snapshot(), path, reason);
+}
+
+// JSON 字符串转义：名字来自 intern 的字面量和线程名，可能带引号、反斜杠
+static QString jsonEscaped(const QString &text)
+{
+    QString out;
+    out.reserve(text.size());
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c.unicode() < 0x20) out += QString("\\u%1").arg(c.unicode(), 4, 16, QLatin1Char('0'));
+            else out += c;
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief 4.导出 Chrome trace JSON
+ */
+QString TraceRecorder::writeChromeJson(const Snapshot &snap, const QString &path, const QString &reason)
+{
+    QString outPath = path;
+    if (outPath.isEmpty()) {
+        QString dir = qEnvironmentVariable("ELE_STI_TRACE_DIR");
+        if (dir.isEmpty()) dir = QDir::tempPath();
+        outPath = QDir(dir).filePath(QString("ele_sti_trace_%1_%2.json")
+                                         .arg(snap.taken.toString("yyyyMMdd_HHmmss"), reason));
+    }
+
+    QFile file(outPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[Trace] cannot write" << outPath;
+        return QString();
+    }
+
+    QStringList names;
+    names.reserve(snap.names.size());
+    for (const QString &name : snap.names) names.append(jsonEscaped(name));
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out;
+    out.reserve(1 << 20);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto append = [&](const QByteArray &line) {
+        if (!first) out += ",\n";
+        out += line;
+        first = false;
+    };
+
+    for (const Snapshot::Thread &thread : snap.threads) {
+        append(QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":\"%3\"}}")
+                   .arg(pid).arg(thread.tid).arg(jsonEscaped(thread.name)).toUtf8());
+
+        for (const Event &ev : thread.events) {
+            const QString name = (ev.nameId < names.size()) ? names.at(ev.nameId) : QString("?");
+            const double tsUs = ev.tsNs / 1000.0;
+            QString line;
+            switch (ev.type) {
+            case Begin:
+            case End:
+                line = QString("{\"ph\":\"%1\",\"name\":\"%2\",\"pid\":%3,\"tid\":%4,\"ts\":%5}")
+                           .arg(QString(QLatin1Char((char)ev.type))).arg(name).arg(pid).arg(thread.tid).arg(tsUs, 0, 'f', 3);
+                break;
+            case Complete:
+                line = QString("{\"ph\":\"X\",\"name\":\"%1\",\"pid\":%2,\"tid\":%3,\"ts\":%4,\"dur\":%5}")
+                           .arg(name).arg(pid).arg(thread.tid).arg(tsUs, 0, 'f', 3).arg(ev.value / 1000.0, 0, 'f', 3);
+                break;
+            case Counter:
+                line = QString("{\"ph\":\"C\",\"name\":\"%1\",\"pid\":%2,\"tid\":%3,\"ts\":%4,\"args\":{\"value\":%5}}")
+                           .arg(name).arg(pid).arg(thread.tid).arg(tsUs, 0, 'f', 3).arg(ev.value);
+                break;
+            default:
+                continue;
+            }
+            append(line.toUtf8());
+        }
+    }
+    out += "\n]}\n";
+    file.write(out);
+    file.close();
+
+    qInfo() << "[Trace] dumped to" << outPath;
+    return outPath;
+}
@@ -0,0 +1,333 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 04:02:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 04:02:18
+ * @FilePath: \ele_sti\src\controllers\FrameBench.cpp
+ * @Description: 界面帧时间基准
+ */
+#include "controllers/FrameBench.h"
+#include "controllers/TreatmentManager.h"
+#include "common/TraceRecorder.h"
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+
+// 基准期间治疗一直运行 (秒)，与参数页"不定时"一致
+static const int BENCH_TREATMENT_SECONDS = 36000;
+
+static int tabIndex(const QString &page)
+{
+    if (page == "param") return 0;
+    if (page == "monitor") return 1;
+    if (page == "system") return 2;
+    return -1;
+}
+
+// 分位数 (ms)，values 为 ns
+static double percentileMs(QVector<qint64> values, double p)
+{
+    if (values.isEmpty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const int idx = qBound(0, (int)(p * (values.size() - 1) + 0.5), (int)values.size() - 1);
+    return values[idx] / 1e6;
+}
+
+static QJsonObject summaryJson(const QVector<qint64> &values)
+{
+    QJsonObject o;
+    o["count"] = values.size();
+    o["p50"] = percentileMs(values, 0.50);
+    o["p90"] = percentileMs(values, 0.90);
+    o["p99"] = percentileMs(values, 0.99);
+    o["max"] = percentileMs(values, 1.0);
+    return o;
+}
+
+bool FrameBench::requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frame-bench") == 0) {
+            QQuickWindow::setGraphicsApi(QSGRendererInterface::Software);
+            if (qEnvironmentVariableIsEmpty("QSG_RENDER_LOOP")) qputenv("QSG_RENDER_LOOP", "basic");
+            return true;
+        }
+    }
+    return false;
+}
+
+FrameBench::Options FrameBench::parse(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    QCommandLineOption benchOpt("frame-bench", "Run the frame-time benchmark and exit");
+    QCommandLineOption pagesOpt("pages", "Pages to measure in order (monitor,param,system)", "list", "monitor,param");
+    QCommandLineOption secondsOpt("seconds", "Measurement time per page", "s", "10");
+    QCommandLineOption warmupOpt("warmup", "Settle time after switching page", "s", "2");
+    QCommandLineOption waveOpt("wave-hz", "Synthetic waveform packet rate", "hz", "50");
+    QCommandLineOption statusOpt("status-hz", "Synthetic status packet rate", "hz", "10");
+    QCommandLineOption budgetOpt("budget-ms", "Frame budget", "ms", "16.7");
+    QCommandLineOption maxMissedOpt("max-missed", "Exit with code 3 if any page misses more frames", "n", "-1");
+    QCommandLineOption outOpt("out", "Write results as JSON", "file");
+    parser.addOptions({ benchOpt, pagesOpt, secondsOpt, warmupOpt, waveOpt, statusOpt, budgetOpt, maxMissedOpt, outOpt });
+    // 其余参数 (Qt 自己的 -platform 等) 不管
+    parser.parse(arguments);
+
+    Options o;
+    o.pages.clear();
+    for (const QString &p : parser.value(pagesOpt).split(',', Qt::SkipEmptyParts)) {
+        const QString page = p.trimmed();
+        if (tabIndex(page) >= 0) o.pages.append(page);
+        else qWarning() << "[FrameBench] unknown page" << page;
+    }
+    o.measureMs = qMax(1, (int)(parser.value(secondsOpt).toDouble() * 1000));
+    o.warmupMs = qMax(0, (int)(parser.value(warmupOpt).toDouble() * 1000));
+    o.waveHz = qMax(1, parser.value(waveOpt).toInt());
+    o.statusHz = qMax(0, parser.value(statusOpt).toInt());
+    o.budgetMs = qMax(1.0, parser.value(budgetOpt).toDouble());
+    o.maxMissed = parser.value(maxMissedOpt).toInt();
+    o.outPath = parser.value(outOpt);
+    return o;
+}
+
+FrameBench::FrameBench(const Options &options, TreatmentManager *manager, QObject *parent)
+    : QObject(parent), m_options(options), m_manager(manager), m_window(nullptr),
+      m_pageIndex(-1), m_measuring(false), m_measureStartNs(0),
+      m_frameStartNs(0), m_syncStartNs(0), m_syncNs(0), m_renderStartNs(0), m_renderNs(0),
+      m_lastSwapNs(0), m_pendingWaveNs(0), m_paintedWaveNs(0)
+{
+}
+
+/**
+ * @brief 1.挂到窗口
+ * @note  全部直连：basic 渲染循环下这些信号都在界面线程上发出，时间点不经过事件队列
+ */
+void FrameBench::attach(QQuickWindow *window)
+{
+    m_window = window;
+    connect(window, &QQuickWindow::afterAnimating, this, [this]() {
+        m_frameStartNs = TraceRecorder::nowNs();
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::beforeSynchronizing, this, [this]() {
+        m_syncStartNs = TraceRecorder::nowNs();
+        // 某些渲染循环不发 afterAnimating，退化成从同步开始算
+        if (m_frameStartNs == 0) m_frameStartNs = m_syncStartNs;
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterSynchronizing, this, [this]() {
+        m_syncNs = TraceRecorder::nowNs() - m_syncStartNs;
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::beforeRendering, this, [this]() {
+        m_renderStartNs = TraceRecorder::nowNs();
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering, this, [this]() {
+        m_renderNs = TraceRecorder::nowNs() - m_renderStartNs;
+    }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, &FrameBench::onFrameSwapped, Qt::DirectConnection);
+    connect(m_manager, &TreatmentManager::waveformHandled, this, &FrameBench::onWaveformHandled);
+    connect(m_manager, &TreatmentManager::framePainted, this, &FrameBench::onFramePainted);
+
+    qInfo().noquote() << QString("[FrameBench] pages %1, %2 s each (warmup %3 s), wave %4 Hz, status %5 Hz, budget %6 ms")
+                             .arg(m_options.pages.join(','))
+                             .arg(m_options.measureMs / 1000.0)
+                             .arg(m_options.warmupMs / 1000.0)
+                             .arg(m_options.waveHz)
+                             .arg(m_options.statusHz)
+                             .arg(m_options.budgetMs);
+    // 与用户点"开始"走同一条链路，各页显示运行中的状态
+    m_manager->startTreatment(BENCH_TREATMENT_SECONDS, 50, 10.0f, 10.0f, 200, 50, 200);
+    runPage(0);
+}
+
+/**
+ * @brief 2.逐页测量
+ * @note  切页 -> 预热 -> 测量 -> 下一页；用单次定时器串起来，不阻塞事件循环
+ */
+void FrameBench::runPage(int index)
+{
+    m_pageIndex = index;
+    if (index >= m_options.pages.size()) {
+        finish();
+        return;
+    }
+    const QString page = m_options.pages[index];
+    m_window->setProperty("activeTabIndex", tabIndex(page));
+    m_window->requestActivate();
+    QTimer::singleShot(m_options.warmupMs, this, &FrameBench::beginMeasure);
+}
+
+void FrameBench::beginMeasure()
+{
+    m_current = PageStats();
+    m_current.page = m_options.pages[m_pageIndex];
+    m_pendingWaveNs = 0;
+    m_paintedWaveNs = 0;
+    m_lastSwapNs = 0;
+    m_measureStartNs = TraceRecorder::nowNs();
+    m_measuring = true;
+    QTimer::singleShot(m_options.measureMs, this, &FrameBench::endMeasure);
+}
+
+void FrameBench::endMeasure()
+{
+    m_measuring = false;
+    m_current.durationNs = TraceRecorder::nowNs() - m_measureStartNs;
+    m_results.append(m_current);
+    runPage(m_pageIndex + 1);
+}
+
+void FrameBench::onFrameSwapped()
+{
+    const qint64 now = TraceRecorder::nowNs();
+    if (m_measuring && m_frameStartNs > 0) {
+        const qint64 budgetNs = (qint64)(m_options.budgetMs * 1e6);
+        const qint64 frameNs = now - m_frameStartNs;
+        m_current.frame.append(frameNs);
+        m_current.polish.append(qMax<qint64>(0, m_syncStartNs - m_frameStartNs));
+        m_current.sync.append(m_syncNs);
+        m_current.render.append(m_renderNs);
+        if (m_lastSwapNs > 0) m_current.interval.append(now - m_lastSwapNs);
+        if (frameNs > budgetNs) m_current.overBudget++;
+        if (m_paintedWaveNs > 0) {
+            const qint64 latency = now - m_paintedWaveNs;
+            m_current.latency.append(latency);
+            // 到达后的下一个周期内画好、再下一个周期上屏都算准时，超出的每个整周期算掉一帧
+            if (latency > 2 * budgetNs) m_current.missed += latency / budgetNs - 1;
+        }
+    }
+    m_paintedWaveNs = 0;
+    m_lastSwapNs = now;
+    m_frameStartNs = 0;
+    m_syncNs = m_renderNs = 0;
+}
+
+void FrameBench::onWaveformHandled(qint64 handlerNs)
+{
+    if (!m_measuring) return;
+    m_current.handler.append(handlerNs);
+    m_current.wavesDelivered++;
+    if (m_pendingWaveNs == 0) m_pendingWaveNs = TraceRecorder::nowNs();
+}
+
+void FrameBench::onFramePainted(double paintMs)
+{
+    if (!m_measuring) return;
+    if (paintMs >= 0) m_current.paint.append((qint64)(paintMs * 1e6));
+    m_current.wavesPainted++;
+    // 这次绘制包含了之前到达的所有波形，延迟从最早的一包算起
+    if (m_pendingWaveNs > 0) {
+        m_paintedWaveNs = m_pendingWaveNs;
+        m_pendingWaveNs = 0;
+    }
+}
+
+/**
+ * @brief 3.结束
+ * @note  停止治疗、打印表格、写 JSON，再发 finished 由 main 退出事件循环
+ */
+void FrameBench::finish()
+{
+    m_manager->stopTreatment();
+    qInfo().noquote() << formatTable();
+
+    int exitCode = 0;
+    if (!m_options.outPath.isEmpty() && !writeJson(m_options.outPath)) exitCode = 2;
+    if (m_options.maxMissed >= 0) {
+        for (const PageStats &s : m_results) {
+            if (s.missed > m_options.maxMissed) {
+                qWarning().noquote() << QString("[FrameBench] %1 missed %2 frames (limit %3)")
+                                            .arg(s.page).arg(s.missed).arg(m_options.maxMissed);
+                exitCode = 3;
+            }
+        }
+    }
+    emit finished(exitCode);
+}
+
+QString FrameBench::formatTable() const
+{
+    auto row = [](const QString &name, const QVector<qint64> &v) {
+        return QString("  %1 %2 %3 %4 %5 %6\n")
+            .arg(name, -8)
+            .arg(v.size(), 7)
+            .arg(percentileMs(v, 0.50), 8, 'f', 2)
+            .arg(percentileMs(v, 0.90), 8, 'f', 2)
+            .arg(percentileMs(v, 0.99), 8, 'f', 2)
+            .arg(percentileMs(v, 1.0), 8, 'f', 2);
+    };
+    QString out;
+    for (const PageStats &s : m_results) {
+        const double seconds = s.durationNs / 1e9;
+        out += QString("[FrameBench] %1: %2 frames, %3 fps, over budget %4, missed %5, waves delivered %6 / painted %7\n")
+                   .arg(s.page)
+                   .arg(s.frame.size())
+                   .arg(seconds > 0 ? s.frame.size() / seconds : 0.0, 0, 'f', 1)
+                   .arg(s.overBudget)
+                   .arg(s.missed)
+                   .arg(s.wavesDelivered)
+                   .arg(s.wavesPainted);
+        out += QString("  %1 %2 %3 %4 %5 %6\n").arg(QString("(ms)"), -8).arg(QString("count"), 7)
+                   .arg(QString("p50"), 8).arg(QString("p90"), 8).arg(QString("p99"), 8).arg(QString("max"), 8);
+        out += row("frame", s.frame);
+        out += row("polish", s.polish);
+        out += row("sync", s.sync);
+        out += row("render", s.render);
+        out += row("interval", s.interval);
+        out += row("handler", s.handler);
+        out += row("paint", s.paint);
+        out += row("latency", s.latency);
+    }
+    return out.trimmed();
+}
+
+bool FrameBench::writeJson(const QString &path) const
+{
+    QJsonObject options;
+    options["pages"] = QJsonArray::fromStringList(m_options.pages);
+    options["warmup_ms"] = m_options.warmupMs;
+    options["measure_ms"] = m_options.measureMs;
+    options["wave_hz"] = m_options.waveHz;
+    options["status_hz"] = m_options.statusHz;
+    options["budget_ms"] = m_options.budgetMs;
+    options["graphics_api"] = "software";
+
+    QJsonArray pages;
+    for (const PageStats &s : m_results) {
+        const double seconds = s.durationNs / 1e9;
+        QJsonObject o;
+        o["page"] = s.page;
+        o["seconds"] = seconds;
+        o["frames"] = s.frame.size();
+        o["fps"] = seconds > 0 ? s.frame.size() / seconds : 0.0;
+        o["over_budget"] = s.overBudget;
+        o["missed"] = s.missed;
+        o["waves_delivered"] = s.wavesDelivered;
+        o["waves_painted"] = s.wavesPainted;
+        o["frame_ms"] = summaryJson(s.frame);
+        o["polish_ms"] = summaryJson(s.polish);
+        o["sync_ms"] = summaryJson(s.sync);
+        o["render_ms"] = summaryJson(s.render);
+        o["interval_ms"] = summaryJson(s.interval);
+        o["handler_ms"] = summaryJson(s.handler);
+        o["paint_ms"] = summaryJson(s.paint);
+        o["latency_ms"] = summaryJson(s.latency);
+        pages.append(o);
+    }
+    QJsonObject root;
+    root["options"] = options;
+    root["pages"] = pages;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[FrameBench] cannot write" << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    qInfo() << "[FrameBench] results written to" << path;
+    return true;
+}
@@ -0,0 +1,222 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\src\controllers\LivePublisher.cpp
+ * @Description: 实时数据外发：共享内存环 + 本地控制套接字
+ */
+#include "controllers/LivePublisher.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include "hal/DeviceManager.h"
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStringList>
+#include <QTimer>
+
+static MetricGauge s_subscribers("ele_sti_live_subscribers", "Clients connected to the live stream control socket");
+static MetricCounter s_notifySkipped("ele_sti_live_notify_skipped_total", "Live stream notifications skipped for clients with a full send buffer");
+static MetricCounter s_reportedLost("ele_sti_live_reported_lost_total", "Records live stream clients reported as overwritten before they read them");
+
+LivePublisher::LivePublisher(QObject *parent)
+    : QObject(parent), m_devices(nullptr), m_server(nullptr), m_notifyTimer(nullptr), m_notifiedWave(0), m_notifiedStatus(0)
+{
+}
+
+LivePublisher::~LivePublisher()
+{
+    // 共享内存随成员析构解除映射，先断开采集线程的直连
+    if (m_devices) disconnect(m_devices, nullptr, this, nullptr);
+    unpublish();
+}
+
+/**
+ * @brief 1.开始发布
+ * @note  先建好共享内存再连信号：连上之后采集线程随时会调用 writeWave
+ */
+bool LivePublisher::start(const QString &name, DeviceManager *devices)
+{
+    if (!m_writer.create(name)) return false;
+
+    m_devices = devices;
+    LiveStreamWriter *writer = &m_writer;
+    connect(devices, &DeviceManager::channelWaveReceived, this, [writer](int channel, const WaveformPacket &packet) {
+        writer->writeWave(channel, packet, TraceRecorder::nowNs());
+    }, Qt::DirectConnection);
+    connect(devices, &DeviceManager::channelStatusReceived, this, [writer](int channel, const StatusPacket &packet) {
+        writer->writeStatus(channel, packet, TraceRecorder::nowNs());
+    }, Qt::DirectConnection);
+
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &LivePublisher::onNewConnection);
+    // 上次异常退出留下的套接字文件会导致 listen 失败
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        // 共享内存照常写，订阅端可以直接映射轮询
+        qWarning() << "[Live] control socket listen failed:" << m_server->errorString();
+    } else {
+        qInfo().noquote() << "[Live] control socket" << m_server->fullServerName();
+    }
+
+    m_notifyTimer = new QTimer(this);
+    m_notifyTimer->setInterval(NOTIFY_INTERVAL_MS);
+    connect(m_notifyTimer, &QTimer::timeout, this, &LivePublisher::onNotifyTimer);
+    return true;
+}
+
+void LivePublisher::unpublish()
+{
+    if (m_notifyTimer) m_notifyTimer->stop();
+    if (m_server) m_server->close();
+    m_writer.unlink();
+}
+
+int LivePublisher::subscriberCount() const
+{
+    return m_clients.size();
+}
+
+void LivePublisher::updateGauge()
+{
+    s_subscribers.set(m_clients.size());
+    // 没有订阅通知的客户端时不起定时器，空闲时不多一次唤醒
+    bool anyNotify = false;
+    for (const Client &c : m_clients) anyNotify = anyNotify || c.wave || c.status;
+    if (anyNotify && !m_notifyTimer->isActive()) m_notifyTimer->start();
+    else if (!anyNotify) m_notifyTimer->stop();
+}
+
+LivePublisher::Client *LivePublisher::findClient(QLocalSocket *socket)
+{
+    for (Client &c : m_clients) {
+        if (c.socket == socket) return &c;
+    }
+    return nullptr;
+}
+
+void LivePublisher::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_clients.append(Client{ socket, false, false, 0, 0 });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            for (int i = 0; i < m_clients.size(); i++) {
+                if (m_clients[i].socket == socket) {
+                    m_clients.removeAt(i);
+                    break;
+                }
+            }
+            socket->deleteLater();
+            updateGauge();
+        });
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            while (socket->canReadLine()) {
+                const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+                if (line.isEmpty()) continue;
+                Client *client = findClient(socket);
+                if (!client) return;
+                socket->write(execute(*client, line).toUtf8());
+            }
+        });
+        updateGauge();
+    }
+}
+
+/**
+ * @brief 2.通知
+ * @note  只在 head 前进时发，一轮一行；发送缓冲积压的订阅端跳过，不在界面线程上堆内存
+ */
+void LivePublisher::onNotifyTimer()
+{
+    const LiveHeader *header = m_writer.header();
+    if (!header) return;
+    const quint64 waveHead = header->wave_head.load(std::memory_order_acquire);
+    const quint64 statusHead = header->status_head.load(std::memory_order_acquire);
+    const bool waveMoved = waveHead != m_notifiedWave;
+    const bool statusMoved = statusHead != m_notifiedStatus;
+    if (!waveMoved && !statusMoved) return;
+    m_notifiedWave = waveHead;
+    m_notifiedStatus = statusHead;
+
+    QByteArray waveLine;
+    QByteArray statusLine;
+    if (waveMoved) waveLine = "wave " + QByteArray::number(waveHead) + "\n";
+    if (statusMoved) statusLine = "status " + QByteArray::number(statusHead) + "\n";
+    for (Client &c : m_clients) {
+        if (!(c.wave && waveMoved) && !(c.status && statusMoved)) continue;
+        if (c.socket->bytesToWrite() > MAX_PENDING_BYTES) {
+            s_notifySkipped.inc();
+            continue;
+        }
+        if (c.wave && waveMoved) c.socket->write(waveLine);
+        if (c.status && statusMoved) c.socket->write(statusLine);
+    }
+}
+
+QString LivePublisher::infoText() const
+{
+    const LiveHeader *h = m_writer.header();
+    if (!h) return "err not publishing\n";
+    return QString("shm /dev/shm/%1\n"
+                   "version %2\n"
+                   "size %3\n"
+                   "wave_offset %4\n"
+                   "wave_slots %5\n"
+                   "wave_slot_size %6\n"
+                   "status_offset %7\n"
+                   "status_slots %8\n"
+                   "status_slot_size %9\n")
+               .arg(m_writer.name())
+               .arg(h->version)
+               .arg(m_writer.sizeBytes())
+               .arg(h->wave_offset)
+               .arg(h->wave_slots)
+               .arg(h->wave_slot_size)
+               .arg(h->status_offset)
+               .arg(h->status_slots)
+               .arg(h->status_slot_size)
+           + QString("samples_per_wave %1\npid %2\nwave_head %3\nstatus_head %4\nok\n")
+               .arg(h->samples_per_wave)
+               .arg(h->publisher_pid)
+               .arg((quint64)h->wave_head.load())
+               .arg((quint64)h->status_head.load());
+}
+
+QString LivePublisher::execute(Client &client, const QString &line)
+{
+    const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+    const QString cmd = parts.first().toLower();
+    const QStringList args = parts.mid(1);
+
+    if (cmd == "info") return infoText();
+    if (cmd == "subscribe") {
+        const QString what = args.isEmpty() ? QString("all") : args.first().toLower();
+        if (what != "wave" && what != "status" && what != "all") return QString("err unknown stream '%1'\n").arg(what);
+        client.wave = client.wave || what == "wave" || what == "all";
+        client.status = client.status || what == "status" || what == "all";
+        updateGauge();
+        return "ok\n";
+    }
+    if (cmd == "unsubscribe") {
+        client.wave = client.status = false;
+        updateGauge();
+        return "ok\n";
+    }
+    if (cmd == "lost") {
+        if (args.size() != 2) return "err usage: lost <wave> <status>\n";
+        bool ok1 = false, ok2 = false;
+        const quint64 wave = args.at(0).toULongLong(&ok1);
+        const quint64 status = args.at(1).toULongLong(&ok2);
+        if (!ok1 || !ok2) return "err bad count\n";
+        // 上报的是累计值，只记增量
+        if (wave > client.lostWave) s_reportedLost.inc(wave - client.lostWave);
+        if (status > client.lostStatus) s_reportedLost.inc(status - client.lostStatus);
+        client.lostWave = wave;
+        client.lostStatus = status;
+        return "ok\n";
+    }
+    if (cmd == "ping") return "ok\n";
+    return QString("err unknown command '%1'\n").arg(cmd);
+}
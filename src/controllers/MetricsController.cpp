@@ -0,0 +1,101 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 14:40:09
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 14:40:09
+ * @FilePath: \ele_sti\src\controllers\MetricsController.cpp
+ * @Description: ui交互层：运行指标汇总、速率计算、本机抓取接口
+ */
+#include "controllers/MetricsController.h"
+#include "common/Metrics.h"
+#include <QTcpSocket>
+#include <QDateTime>
+#include <QDebug>
+
+MetricsController::MetricsController(QObject *parent)
+    : QObject(parent), m_server(nullptr), m_lastRefreshMs(0)
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(1000);
+    connect(m_timer, &QTimer::timeout, this, &MetricsController::refresh);
+    m_timer->start();
+}
+
+/**
+ * @brief 1.汇总指标给 QML
+ * @note  计数器额外给出每秒速率，直方图给出 p50/p99 (ms)
+ */
+void MetricsController::refresh()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const double dt = (m_lastRefreshMs > 0) ? (now - m_lastRefreshMs) / 1000.0 : 0.0;
+    m_lastRefreshMs = now;
+
+    QVariantList list;
+    for (const MetricsRegistry::Value &v : MetricsRegistry::instance().snapshot()) {
+        QVariantMap item;
+        item["name"] = v.name;
+        item["help"] = v.help;
+        switch (v.type) {
+        case MetricsRegistry::Counter: {
+            const double last = m_lastCounters.value(v.name, v.value);
+            item["value"] = v.value;
+            item["rate"] = (dt > 0.0) ? (v.value - last) / dt : 0.0;
+            item["unit"] = "/s";
+            m_lastCounters[v.name] = v.value;
+            break;
+        }
+        case MetricsRegistry::Gauge:
+            item["value"] = v.value;
+            item["unit"] = "";
+            break;
+        case MetricsRegistry::Histogram:
+            item["value"] = v.value;
+            item["p50"] = v.p50 / 1e6;
+            item["p99"] = v.p99 / 1e6;
+            item["max"] = v.max / 1e6;
+            item["unit"] = "ms";
+            break;
+        }
+        list.append(item);
+    }
+    m_metrics = list;
+    emit metricsChanged();
+}
+
+/**
+ * @brief 2.开启抓取接口
+ * @note  兼容 HTTP GET 和裸 TCP：收到任意请求都回一份 Prometheus 文本
+ */
+bool MetricsController::startScrapeServer(quint16 port)
+{
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, &MetricsController::onNewConnection);
+    }
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "[Metrics] scrape server listen failed:" << m_server->errorString();
+        return false;
+    }
+    qInfo() << "[Metrics] scrape endpoint on 127.0.0.1:" << port;
+    return true;
+}
+
+void MetricsController::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+            socket->readAll(); // 请求内容不关心
+            if (socket->state() != QAbstractSocket::ConnectedState) return; // 已回复过
+            const QByteArray body = MetricsRegistry::instance().exposition().toUtf8();
+            QByteArray resp;
+            resp += "HTTP/1.0 200 OK\r\n";
+            resp += "Content-Type: text/plain; version=0.0.4\r\n";
+            resp += "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+            resp += body;
+            socket->write(resp);
+            socket->disconnectFromHost();
+        });
+    }
+}
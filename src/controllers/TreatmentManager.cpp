@@ -9,6 +9,14 @@
 
 #include "controllers/TreatmentManager.h"
 #include "core/TreatmentService.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+
+static MetricCounter s_framesEmitted("ele_sti_ui_frames_emitted_total", "Waveform frames handed to QML");
+static MetricCounter s_framesPainted("ele_sti_ui_frames_painted_total", "Waveform frames painted by the monitor Canvas");
+static MetricHistogram s_paintTime("ele_sti_ui_paint_seconds", "Monitor Canvas onPaint duration");
+static MetricHistogram s_handlerTime("ele_sti_ui_wave_handler_seconds", "QML waveformReceived handlers run per frame");
 
 TreatmentManager::TreatmentManager(TreatmentService *service, QObject *parent)
     :m_service(service),QObject(parent)
@@ -30,11 +38,37 @@ TreatmentManager::TreatmentManager(TreatmentService *service, QObject *parent)
             
     // 3. 连接波形数据 (Chart显示用)
     connect(m_service, &TreatmentService::waveformReceived,
-            this, &TreatmentManager::waveformReceived);
+            this, [this](const QList<float> &data){
+            // 触发模式下界面只画采到的窗口
+            if (m_service->trigger()->isActive()) return;
+            // QML 的信号处理函数在这里同步执行
+            TRACE_SCOPE("signal.waveformReceived");
+            LatencyTracer::instance().frameEmitted();
+            s_framesEmitted.inc();
+            const qint64 t0 = TraceRecorder::nowNs();
+            emit waveformReceived(data);
+            // 处理函数 (QML JS) 的同步执行时间，帧时间基准据此统计每包的 JS 开销
+            const qint64 handlerNs = TraceRecorder::nowNs() - t0;
+            s_handlerTime.observe(handlerNs);
+            emit waveformHandled(handlerNs);
+        });
             
     // 4. 连接监测数据 (阻抗/电量等)
     connect(m_service, &TreatmentService::monitoringDataReady,
             this, &TreatmentManager::stateChanged);
+
+    // 5. 触发采集的窗口
+    connect(m_service->trigger(), &TriggerEngine::captured,
+            this, [this](const QVector<float> &data, int triggerIndex, bool forced){
+            TRACE_SCOPE("signal.captureReady");
+            emit captureReady(data, triggerIndex, forced);
+        });
+
+    // 6. 旋钮调幅，转发给参数页
+    connect(m_service, &TreatmentService::parametersAdjusted,
+            this, [this](const StimulationParam &param){
+            emit amplitudeAdjusted(param.posAmp, param.negAmp);
+        });
 }
 TreatmentManager::~TreatmentManager()
 {
@@ -79,6 +113,66 @@ void TreatmentManager::setPIDParameters(float kp, float ki, float kd)
     m_service->setPIDParameters(pid);
 }
 
+void TreatmentManager::setTrigger(int mode, int type, float level, float low, float high, int preSamples, int postSamples)
+{
+    if (!m_service) return;
+    TriggerEngine::Config config;
+    config.mode = (TriggerEngine::Mode)qBound(0, mode, (int)TriggerEngine::Single);
+    config.type = (TriggerEngine::Type)qBound(0, type, (int)TriggerEngine::Window);
+    config.level = level;
+    config.low = low;
+    config.high = high;
+    config.preSamples = preSamples;
+    config.postSamples = postSamples;
+    m_service->trigger()->setConfig(config);
+    emit triggerChanged();
+}
+
+void TreatmentManager::armTrigger()
+{
+    if (!m_service) return;
+    m_service->trigger()->arm();
+}
+
+int TreatmentManager::triggerMode() const
+{
+    if (!m_service) return TriggerEngine::Off;
+    return m_service->trigger()->config().mode;
+}
+
+void TreatmentManager::markFramePainted(double paintMs)
+{
+    LatencyTracer::instance().framePainted();
+    s_framesPainted.inc();
+    if (paintMs >= 0) {
+        const qint64 durNs = (qint64)(paintMs * 1e6);
+        s_paintTime.observe(durNs);
+        static const uint16_t paintId = TraceRecorder::instance().intern("qml.paint");
+        TraceRecorder::instance().recordAt(TraceRecorder::Complete, paintId, TraceRecorder::nowNs() - durNs, durNs);
+    }
+    emit framePainted(paintMs);
+}
+
+QString TreatmentManager::dumpTrace()
+{
+    return TraceRecorder::instance().dumpChromeJson();
+}
+
+QVariantList TreatmentManager::latencyReport() const
+{
+    QVariantList list;
+    for (const LatencyTracer::HopReport &r : LatencyTracer::instance().report()) {
+        QVariantMap item;
+        item["name"] = QString::fromLatin1(r.name);
+        item["count"] = r.stats.count;
+        item["p50Us"] = r.stats.p50 / 1000.0;
+        item["p99Us"] = r.stats.p99 / 1000.0;
+        item["maxUs"] = r.stats.max / 1000.0;
+        list.append(item);
+    }
+    return list;
+}
+
 int TreatmentManager::remainingTime() const // 只读
 {
     return m_remainingTime;
@@ -0,0 +1,153 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:40:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:40:06
+ * @FilePath: \ele_sti\src\controllers\TrendModel.cpp
+ * @Description: ui交互层：把 TrendStore 的一个分辨率暴露给 QML 的列表模型
+ */
+#include "controllers/TrendModel.h"
+
+TrendModel::TrendModel(TreatmentService *service, TrendStore::Level level, QObject *parent)
+    : QAbstractListModel(parent), m_store(service->trends()), m_level(level), m_rows(service->trends().size(level))
+{
+    // 服务和模型都在 UI 线程，直连；存储已经更新过，这里只补通知
+    connect(service, &TreatmentService::trendUpdated, this, &TrendModel::onTrendUpdated);
+}
+
+int TrendModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+QVariant TrendModel::data(const QModelIndex &index, int role) const
+{
+    const int row = index.row();
+    if (!index.isValid() || row < 0 || row >= m_rows) return QVariant();
+    const TrendStore::Bucket &bucket = m_store.at(m_level, row);
+    switch (role) {
+    case TimeRole: return (double)bucket.startMs;
+    case CountRole: return bucket.count;
+    case ImpedanceMinRole: return value(row, Impedance, Min);
+    case ImpedanceMaxRole: return value(row, Impedance, Max);
+    case ImpedanceMeanRole: return value(row, Impedance, Mean);
+    case BatteryMinRole: return value(row, Battery, Min);
+    case BatteryMaxRole: return value(row, Battery, Max);
+    case BatteryMeanRole: return value(row, Battery, Mean);
+    case RealFreqMinRole: return value(row, RealFreq, Min);
+    case RealFreqMaxRole: return value(row, RealFreq, Max);
+    case RealFreqMeanRole: return value(row, RealFreq, Mean);
+    case ErrorCodeMaxRole: return value(row, ErrorCode, Max);
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> TrendModel::roleNames() const
+{
+    return {
+        { TimeRole, "time" },
+        { CountRole, "samples" },
+        { ImpedanceMinRole, "impedanceMin" },
+        { ImpedanceMaxRole, "impedanceMax" },
+        { ImpedanceMeanRole, "impedanceMean" },
+        { BatteryMinRole, "batteryMin" },
+        { BatteryMaxRole, "batteryMax" },
+        { BatteryMeanRole, "batteryMean" },
+        { RealFreqMinRole, "realFreqMin" },
+        { RealFreqMaxRole, "realFreqMax" },
+        { RealFreqMeanRole, "realFreqMean" },
+        { ErrorCodeMaxRole, "errorCode" }
+    };
+}
+
+double TrendModel::value(int row, int series, int stat) const
+{
+    if (row < 0 || row >= m_rows || series < 0 || series >= TrendStore::SERIES_COUNT) return 0.0;
+    return m_store.value(m_level, row, (TrendStore::Series)series, (TrendStore::Stat)stat);
+}
+
+double TrendModel::timeAt(int row) const
+{
+    if (row < 0 || row >= m_rows) return 0.0;
+    return (double)m_store.at(m_level, row).startMs;
+}
+
+QVariantMap TrendModel::range(int series) const
+{
+    double lo = 0.0;
+    double hi = 0.0;
+    for (int row = 0; row < m_rows; row++) {
+        const double mn = value(row, series, Min);
+        const double mx = value(row, series, Max);
+        if (row == 0 || mn < lo) lo = mn;
+        if (row == 0 || mx > hi) hi = mx;
+    }
+    return { { "min", lo }, { "max", hi } };
+}
+
+/**
+ * @brief 1.画图快照
+ * @note  每列取若干相邻行：min/max 给带，mean 给线，时间取列首行；
+ *        纵轴范围顺带算出，QML 一次重绘只跨一次 C++ 边界
+ */
+QVariantMap TrendModel::snapshot(int series, int columns) const
+{
+    QVariantMap result;
+    if (m_rows == 0 || columns <= 0 || series < 0 || series >= TrendStore::SERIES_COUNT) return result;
+
+    const TrendStore::Series s = (TrendStore::Series)series;
+    const int step = qMax(1, (m_rows + columns - 1) / columns);
+    QVariantList points;
+    points.reserve((m_rows + step - 1) / step * 4);
+    double lo = 0.0;
+    double hi = 0.0;
+    for (int row = 0; row < m_rows; row += step) {
+        const int end = qMin(m_rows, row + step);
+        double mn = m_store.value(m_level, row, s, TrendStore::Min);
+        double mx = m_store.value(m_level, row, s, TrendStore::Max);
+        double sum = 0.0;
+        for (int j = row; j < end; j++) {
+            mn = qMin(mn, m_store.value(m_level, j, s, TrendStore::Min));
+            mx = qMax(mx, m_store.value(m_level, j, s, TrendStore::Max));
+            sum += m_store.value(m_level, j, s, TrendStore::Mean);
+        }
+        if (row == 0 || mn < lo) lo = mn;
+        if (row == 0 || mx > hi) hi = mx;
+        points << (double)m_store.at(m_level, row).startMs << mn << mx << sum / (end - row);
+    }
+
+    result.insert("step", step);
+    result.insert("min", lo);
+    result.insert("max", hi);
+    result.insert("last", m_store.value(m_level, m_rows - 1, s, TrendStore::Mean));
+    result.insert("lastTime", (double)m_store.at(m_level, m_rows - 1).startMs);
+    result.insert("points", points);
+    return result;
+}
+
+/**
+ * @brief 2.增量通知
+ * @note  环满时先删第一行再追加，行数不变；没开新桶时只有最后一行变了
+ */
+void TrendModel::onTrendUpdated(const TrendStore::Update &update)
+{
+    if (update.evicted[m_level] && m_rows > 0) {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_rows--;
+        endRemoveRows();
+    }
+    if (update.opened[m_level]) {
+        // 空闲时服务只在开新桶时通知，上一行中途的变化在这里补一次
+        if (m_rows > 0) {
+            const QModelIndex prev = index(m_rows - 1);
+            emit dataChanged(prev, prev);
+        }
+        beginInsertRows(QModelIndex(), m_rows, m_rows);
+        m_rows++;
+        endInsertRows();
+    } else if (m_rows > 0) {
+        const QModelIndex last = index(m_rows - 1);
+        emit dataChanged(last, last);
+    }
+    if (update.opened[m_level] != update.evicted[m_level]) emit countChanged();
+}
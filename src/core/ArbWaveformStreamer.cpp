@@ -0,0 +1,206 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 11:26:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 11:26:31
+ * @FilePath: \ele_sti\src\core\ArbWaveformStreamer.cpp
+ * @Description: 任意波形流：采样表量化、分块、预生成与欠载统计
+ */
+#include "core/ArbWaveformStreamer.h"
+#include "common/PacketCodec.h"
+#include <QDebug>
+#include <QtMath>
+#include <cstring>
+
+ArbWaveformStreamer::ArbWaveformStreamer(QObject *parent)
+    : QObject(parent), m_freeSlots((int)QUEUE_BLOCKS), m_thread(nullptr),
+      m_rate(0), m_loop(true), m_cursor(0), m_seq(0),
+      m_running(false), m_taking(0), m_exhausted(false), m_inUnderrun(false),
+      m_underruns(0), m_produced(0), m_consumed(0)
+{
+}
+
+ArbWaveformStreamer::~ArbWaveformStreamer()
+{
+    stop();
+}
+
+/**
+ * @brief 1.启动生成线程
+ * @note  生成线程一直把队列填满，M0 要多少块后端就取多少块，UI 卡顿不影响播放
+ */
+bool ArbWaveformStreamer::start(const QVector<float> &table, int sampleRateHz, bool loop)
+{
+    if (table.isEmpty() || sampleRateHz <= 0 || sampleRateHz > ARB_MAX_RATE_HZ) {
+        qDebug() << "[ARB] Invalid table or sample rate:" << sampleRateHz;
+        return false;
+    }
+    stop();
+
+    m_table = table;
+    m_rate = sampleRateHz;
+    m_loop = loop;
+    m_cursor = 0;
+    m_seq = 0;
+    m_exhausted = false;
+    m_inUnderrun = false;
+    m_underruns = 0;
+    m_produced = 0;
+    m_consumed = 0;
+    m_running = true;
+
+    m_thread = QThread::create([this]() { generatorLoop(); });
+    m_thread->setObjectName("arb-generator");
+    m_thread->start(QThread::HighPriority);
+    return true;
+}
+
+/**
+ * @brief 2.停止生成线程
+ * @note  后端的退出命令是排队执行的，这时后端线程可能还在 takeBlock：
+ *        先清运行标志，等已经进到 takeBlock 里的那一次返回，再复位队列 (之后的调用看到标志直接返回)
+ */
+void ArbWaveformStreamer::stop()
+{
+    if (!m_thread) return;
+
+    m_running = false;
+    m_freeSlots.release(); // 唤醒可能阻塞的生成线程
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    while (m_taking.load() != 0) QThread::yieldCurrentThread();
+
+    // 恢复初始状态
+    m_queue.reset();
+    m_freeSlots.acquire(m_freeSlots.available());
+    m_freeSlots.release((int)QUEUE_BLOCKS);
+}
+
+/**
+ * @brief 3.后端线程取块
+ * @return 队列为空时返回 false；非循环模式播完、出第一块之前都不算欠载
+ */
+bool ArbWaveformStreamer::takeBlock(ArbWavePacket &out)
+{
+    // 与 stop 的标志/计数配对 (都是顺序一致)：要么 stop 等到这次返回，要么这里看到已停止
+    m_taking.fetch_add(1);
+    const bool ok = m_running.load() && popBlock(out);
+    m_taking.fetch_sub(1, std::memory_order_release);
+    return ok;
+}
+
+bool ArbWaveformStreamer::popBlock(ArbWavePacket &out)
+{
+    if (m_queue.pop(out)) {
+        m_freeSlots.release();
+        m_consumed.fetch_add(1, std::memory_order_relaxed);
+        m_inUnderrun.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (m_consumed.load(std::memory_order_relaxed) == 0) {
+        // 启动不等预填：生成线程还没出第一块时后端取空，不算欠载
+        return false;
+    }
+    if (m_exhausted.load(std::memory_order_acquire)) {
+        // 非循环采样表已全部取走
+        if (m_running.exchange(false)) {
+            emit finished();
+        }
+        return false;
+    }
+
+    quint64 total = m_underruns.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (!m_inUnderrun.exchange(true, std::memory_order_relaxed)) {
+        emit underrunDetected(total);
+    }
+    return false;
+}
+
+void ArbWaveformStreamer::generatorLoop()
+{
+    while (m_running.load()) {
+        // 队列满时在这里等待消费端腾出空位
+        if (!m_freeSlots.tryAcquire(1, 20)) {
+            continue;
+        }
+        if (!m_running.load() || m_exhausted.load()) {
+            // 不再生成：把位置还回去
+            m_freeSlots.release();
+            if (m_exhausted.load()) QThread::msleep(5);
+            continue;
+        }
+
+        ArbWavePacket pkt;
+        fillBlock(pkt);
+        m_queue.push(pkt); // 信号量保证一定有空位
+        m_produced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 4.量化并打包一块采样
+ * @note  超量程的采样饱和到 int16 范围；非循环模式不足一块时补 0
+ */
+void ArbWaveformStreamer::fillBlock(ArbWavePacket &pkt)
+{
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.seq = m_seq++;
+
+    const int n = m_table.size();
+    for (int i = 0; i < ARB_BATCH_SIZE; i++) {
+        if (m_cursor >= n) {
+            if (!m_loop) {
+                m_exhausted = true;
+                break;
+            }
+            m_cursor = 0;
+        }
+        float lsb = m_table.at(m_cursor++) / ARB_SAMPLE_LSB_MA;
+        if (lsb > 32767.0f) lsb = 32767.0f;
+        if (lsb < -32768.0f) lsb = -32768.0f;
+        pkt.samples[i] = (int16_t)qRound(lsb);
+    }
+    if (!m_loop && m_cursor >= n) {
+        m_exhausted = true;
+    }
+    encodePacket(pkt);
+}
+
+/**
+ * @brief 5.指数衰减波形
+ * @param tauMs 时间常数 (ms)
+ */
+QVector<float> ArbWaveformStreamer::exponentialDecay(float peakMa, float tauMs, int durationMs, int sampleRateHz)
+{
+    QVector<float> table;
+    const int count = qMax(1, (int)((qint64)durationMs * sampleRateHz / 1000));
+    table.reserve(count);
+    const float dt = 1000.0f / sampleRateHz; // ms
+    for (int i = 0; i < count; i++) {
+        table.append(peakMa * qExp(-(i * dt) / qMax(tauMs, 0.001f)));
+    }
+    return table;
+}
+
+/**
+ * @brief 6.正弦载波脉冲串
+ * @param pulses 一串里的载波周期数
+ * @param gapMs  两串之间的静默时长
+ */
+QVector<float> ArbWaveformStreamer::burst(float ampMa, float carrierHz, int pulses, int gapMs, int sampleRateHz)
+{
+    QVector<float> table;
+    if (carrierHz <= 0.0f) return table;
+    const int onCount = qMax(1, (int)(pulses * sampleRateHz / carrierHz));
+    const int offCount = (int)((qint64)gapMs * sampleRateHz / 1000);
+    table.reserve(onCount + offCount);
+    for (int i = 0; i < onCount; i++) {
+        table.append(ampMa * qSin(2.0 * M_PI * carrierHz * i / sampleRateHz));
+    }
+    for (int i = 0; i < offCount; i++) {
+        table.append(0.0f);
+    }
+    return table;
+}
@@ -0,0 +1,165 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:31:50
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:31:50
+ * @FilePath: \ele_sti\src\core\CurrentLoopModel.cpp
+ * @Description: M0 恒流环仿真
+ */
+#include "core/CurrentLoopModel.h"
+#include <cmath>
+
+CurrentLoopModel::CurrentLoopModel(const Load &load)
+    : m_load(load)
+{
+    reset();
+}
+
+void CurrentLoopModel::reset()
+{
+    m_current = 0.0f;
+    m_drive = 0.0f;
+    m_cap = 0.0f;
+    m_integ = 0.0f;
+    m_prevErr = 0.0f;
+    m_saturated = false;
+}
+
+/**
+ * @brief 1.一个控制周期
+ * @note  先按上一周期末的电流算 PID，再让负载跟着输出走 PLANT_SUBSTEPS 小步
+ */
+float CurrentLoopModel::step(float targetMa)
+{
+    const float dtS = CONTROL_PERIOD_US * 1e-6f;
+    const float err = targetMa - m_current;
+
+    m_integ += m_pid.ki * err * dtS;
+    m_saturated = false;
+    if (m_integ > m_pid.limit) {
+        m_integ = m_pid.limit;
+        m_saturated = true;
+    } else if (m_integ < -m_pid.limit) {
+        m_integ = -m_pid.limit;
+        m_saturated = true;
+    }
+    const float deriv = m_pid.kd * (err - m_prevErr) / dtS;
+    m_prevErr = err;
+
+    float command = m_pid.kp * err + m_integ + deriv;
+    if (command > m_load.complianceV) command = m_load.complianceV;
+    if (command < -m_load.complianceV) command = -m_load.complianceV;
+
+    // 输出级一阶惯性 + Rs 串 (Rct // Cdl)：i = (u - vc) / Rs，dvc = (i - vc / Rct) * dt / Cdl
+    const float dtUs = (float)CONTROL_PERIOD_US / PLANT_SUBSTEPS;
+    const float driveAlpha = m_load.driverTauUs > 0.0f ? qMin(1.0f, dtUs / m_load.driverTauUs) : 1.0f;
+    const float capScale = dtUs / (m_load.cdlUf * 1000.0f);
+    for (int s = 0; s < PLANT_SUBSTEPS; s++) {
+        m_drive += (command - m_drive) * driveAlpha;
+        m_current = (m_drive - m_cap) / m_load.seriesKohm;
+        m_cap += (m_current - m_cap / m_load.chargeKohm) * capScale;
+    }
+    return m_current;
+}
+
+int CurrentLoopModel::pulseWindowUs(const StimulationParam &pulse)
+{
+    const int active = qMax(0, pulse.posW) + qMax(0, pulse.dead) + qMax(0, pulse.negW);
+    const int period = pulse.freq > 0 ? 1000000 / pulse.freq : active + MAX_GAP_US;
+    return active + qBound(0, period - active, (int)MAX_GAP_US);
+}
+
+/**
+ * @brief 2.双相脉冲串
+ * @note  每个控制周期按所处的段取目标：正相 +posAmp、死区 0、负相 -negAmp、间隔 0；
+ *        有效相统计超调/建立时间/跟踪误差，零目标段统计残留电荷
+ */
+CurrentLoopModel::Metrics CurrentLoopModel::runPulses(const StimulationParam &pulse, int pulses, float *trace, int traceLen)
+{
+    Metrics m;
+    reset();
+
+    struct Phase {
+        int start;
+        int end;
+        float target;
+    };
+    const int posEnd = qMax(0, pulse.posW);
+    const int negStart = posEnd + qMax(0, pulse.dead);
+    const int negEnd = negStart + qMax(0, pulse.negW);
+    const int window = pulseWindowUs(pulse);
+    const Phase phases[4] = {
+        { 0, posEnd, pulse.posAmp },
+        { posEnd, negStart, 0.0f },
+        { negStart, negEnd, -pulse.negAmp },
+        { negEnd, window, 0.0f }
+    };
+    const float maxAmp = qMax(std::fabs(pulse.posAmp), std::fabs(pulse.negAmp));
+    const float divergeMa = 10.0f * maxAmp + 1.0f;
+
+    double activeCharge = 0.0;   // 有效相目标电荷 (mA·us)
+    double residualCharge = 0.0;
+    double iae = 0.0;            // 相对幅值归一后的误差积分
+    double activeTime = 0.0;
+    int satSteps = 0;
+    int totalSteps = 0;
+    int activePhases = 0;
+    int settledPhases = 0;
+
+    for (int p = 0; p < pulses && m.stable; p++) {
+        const bool last = p == pulses - 1;
+        int traceNext = 0;
+        for (const Phase &phase : phases) {
+            if (phase.end <= phase.start) continue;
+            const float amp = std::fabs(phase.target);
+            const float sign = phase.target >= 0.0f ? 1.0f : -1.0f;
+            const float band = 0.05f * amp;
+            int lastOutside = 0;
+            float maxOver = 0.0f;
+            for (int t = phase.start; t < phase.end; t += CONTROL_PERIOD_US) {
+                const float i = step(phase.target);
+                totalSteps++;
+                if (m_saturated) satSteps++;
+                if (!std::isfinite(i) || std::fabs(i) > divergeMa) {
+                    m.stable = false;
+                    break;
+                }
+                if (amp > 0.0f) {
+                    const float over = sign * i - amp;
+                    if (over > maxOver) maxOver = over;
+                    const float e = std::fabs(i - phase.target);
+                    if (e > band) lastOutside = t - phase.start + CONTROL_PERIOD_US;
+                    iae += e / amp * CONTROL_PERIOD_US;
+                    activeTime += CONTROL_PERIOD_US;
+                    if (phase.target > 0.0f && i > m.peakMa) m.peakMa = i;
+                } else {
+                    residualCharge += std::fabs(i) * CONTROL_PERIOD_US;
+                }
+                // 最后一个周期抽点给 trace
+                if (last && trace) {
+                    while (traceNext < traceLen && (double)traceNext * window / traceLen <= t) {
+                        trace[traceNext++] = i;
+                    }
+                }
+            }
+            if (!m.stable) break;
+            if (amp > 0.0f) {
+                activePhases++;
+                activeCharge += amp * (phase.end - phase.start);
+                const int width = phase.end - phase.start;
+                if (lastOutside < width) settledPhases++;
+                m.settlingUs = qMax(m.settlingUs, (float)lastOutside);
+                m.overshootPct = qMax(m.overshootPct, 100.0f * maxOver / amp);
+            }
+        }
+        if (last && trace) {
+            for (; traceNext < traceLen; traceNext++) trace[traceNext] = m_current;
+        }
+    }
+
+    if (activePhases > 0) m.settledFrac = (float)settledPhases / activePhases;
+    if (activeCharge > 0.0) m.residualPct = (float)(100.0 * residualCharge / (activeCharge / 2.0));
+    if (activeTime > 0.0) m.iaePct = (float)(100.0 * iae / activeTime);
+    if (totalSteps > 0) m.saturationPct = 100.0f * satSteps / totalSteps;
+    return m;
+}
@@ -0,0 +1,103 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 19:05:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 19:05:12
+ * @FilePath: \ele_sti\src\core\KnobInputHandler.cpp
+ * @Description: 旋钮输入：增量合并、调幅、单击停止与延迟统计
+ */
+#include "core/KnobInputHandler.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QDebug>
+
+static MetricCounter s_knobDetents("ele_sti_knob_detents_total", "Encoder detents received from the panel knob");
+static MetricCounter s_knobApplies("ele_sti_knob_updates_total", "Parameter updates sent for knob input (after coalescing)");
+static MetricCounter s_knobIgnored("ele_sti_knob_ignored_total", "Knob detents dropped because a program or arbitrary waveform is running");
+static MetricCounter s_knobOverBound("ele_sti_knob_over_bound_total", "Knob-to-ControlPacket latencies above KNOB_LATENCY_BOUND_US");
+static MetricHistogram s_knobLatency("ele_sti_knob_to_control_seconds", "Knob frame received to ControlPacket sent");
+
+KnobInputHandler::KnobInputHandler(IBackend *backend, QObject *parent)
+    : QObject(parent), m_backend(backend), m_mode(Stopped), m_stepMa(KNOB_STEP_MA),
+      m_pending(0), m_posted(false), m_firstRxNs(0), m_clickRxNs(0), m_latency(256)
+{
+}
+
+void KnobInputHandler::addDelta(int detents, qint64 rxNs)
+{
+    s_knobDetents.inc((quint64)qAbs(detents));
+    // 先累加再看是否要投递：applyPending 先清 m_posted 再取增量，
+    // 这里累加落在取增量之后时，m_posted 一定已经清掉，会重新投递一次
+    m_pending.fetch_add(detents);
+    if (!m_posted.exchange(true)) {
+        m_firstRxNs.store(rxNs, std::memory_order_relaxed);
+        QMetaObject::invokeMethod(this, &KnobInputHandler::applyPending, Qt::QueuedConnection);
+    }
+}
+
+void KnobInputHandler::click(qint64 rxNs)
+{
+    m_clickRxNs.store(rxNs, std::memory_order_relaxed);
+    QMetaObject::invokeMethod(this, &KnobInputHandler::applyClick, Qt::QueuedConnection);
+}
+
+void KnobInputHandler::setParameters(const StimulationParam &param)
+{
+    m_param = param;
+}
+
+void KnobInputHandler::setMode(int mode)
+{
+    m_mode = (Mode)mode;
+}
+
+/**
+ * @brief 下发合并后的增量
+ * @note  先清 m_posted 再取增量：之后到的帧会重新投递，不会丢
+ */
+void KnobInputHandler::applyPending()
+{
+    TRACE_SCOPE("knob.apply");
+    m_posted.store(false);
+    const int detents = m_pending.exchange(0);
+    const qint64 rxNs = m_firstRxNs.load(std::memory_order_relaxed);
+    if (detents == 0) return;
+    // 程序/任意波形运行中幅值不归缓存参数管，调了只会用旧的固定参数覆盖掉正在执行的内容
+    if (m_mode == Program || m_mode == Arbitrary) {
+        s_knobIgnored.inc((quint64)qAbs(detents));
+        return;
+    }
+
+    // 正负幅值同步调，各自夹在 [0, 上限]
+    const float delta = detents * m_stepMa;
+    m_param.posAmp = qBound(0.0f, m_param.posAmp + delta, KNOB_AMP_MAX_MA);
+    m_param.negAmp = qBound(0.0f, m_param.negAmp + delta, KNOB_AMP_MAX_MA);
+
+    if (m_mode == Fixed) {
+        m_backend->updateParameters(m_param);
+        s_knobApplies.inc();
+        recordLatency(rxNs);
+    }
+    emit parametersAdjusted(m_param);
+}
+
+void KnobInputHandler::applyClick()
+{
+    if (m_mode == Stopped) return;
+    if (m_mode == Program) m_backend->abortProgram();
+    else m_backend->stopStimulation();
+    m_mode = Stopped;
+    recordLatency(m_clickRxNs.load(std::memory_order_relaxed));
+    emit stopRequested();
+}
+
+void KnobInputHandler::recordLatency(qint64 rxNs)
+{
+    const qint64 ns = LatencyTracer::nowNs() - rxNs;
+    m_latency.add(ns);
+    s_knobLatency.observe(ns);
+    if (ns > (qint64)KNOB_LATENCY_BOUND_US * 1000) {
+        s_knobOverBound.inc();
+        qWarning() << "[Knob] knob-to-control latency" << ns / 1000 << "us exceeds" << KNOB_LATENCY_BOUND_US << "us";
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:31:50
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:31:50
+ * @FilePath: \ele_sti\src\core\PidTuner.cpp
+ * @Description: PID 参数离线调谐
+ */
+#include "core/PidTuner.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include "core/TaskExecutor.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+static MetricCounter s_evaluated("ele_sti_tuner_candidates_total", "PID candidates evaluated by the tuner");
+static MetricHistogram s_batchTime("ele_sti_tuner_batch_seconds", "Wall time of one parallel tuner batch");
+
+static const double UNSTABLE_SCORE = 1e9;
+
+PidTuner::PidTuner(const CurrentLoopModel::Load &load, int threads)
+    : m_load(load), m_pulses(3), m_threads(TaskExecutor::instance().threadCount())
+{
+    m_pulse.freq = 100;
+    m_pulse.posAmp = 10.0f;
+    m_pulse.negAmp = 10.0f;
+    m_pulse.posW = 200;
+    m_pulse.dead = 50;
+    m_pulse.negW = 200;
+    if (threads > 0) m_threads = qMin(threads, m_threads);
+}
+
+void PidTuner::setPulse(const StimulationParam &pulse, int pulses)
+{
+    m_pulse = pulse;
+    m_pulses = qMax(1, pulses);
+}
+
+/**
+ * @brief 1.评分
+ * @note  建立时间按较窄的一相归一；不稳定直接给一个很大的分数
+ */
+double PidTuner::score(const CurrentLoopModel::Metrics &m) const
+{
+    if (!m.stable) return UNSTABLE_SCORE;
+    const int width = qMax(1, qMin(m_pulse.posW, m_pulse.negW));
+    double s = 0.0;
+    s += m_weights.overshoot * m.overshootPct / 10.0;
+    s += m_weights.settling * (qMin(1.0, (double)m.settlingUs / width) + (1.0 - m.settledFrac));
+    s += m_weights.residual * m.residualPct / 10.0;
+    s += m_weights.saturation * m.saturationPct / 10.0;
+    s += m_weights.tracking * m.iaePct / 10.0;
+    return s;
+}
+
+/**
+ * @brief 2.并行评估
+ * @note  每 CHUNK 个候选一块；每块只写自己那段结果，不需要加锁
+ */
+QVector<PidTuner::Result> PidTuner::evaluate(const QVector<PIDParam> &candidates)
+{
+    TRACE_SCOPE("tuner.evaluate");
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<Result> results(candidates.size());
+    const PIDParam *in = candidates.constData();
+    Result *out = results.data();
+    const int n = candidates.size();
+    TaskExecutor::instance().parallelFor(n, CHUNK, [this, in, out](int begin, int end) {
+        CurrentLoopModel model(m_load);
+        for (int i = begin; i < end; i++) {
+            model.setPid(in[i]);
+            out[i].pid = in[i];
+            out[i].metrics = model.runPulses(m_pulse, m_pulses);
+            out[i].score = score(out[i].metrics);
+        }
+    }, TaskExecutor::Normal, m_threads);
+
+    s_evaluated.inc(n);
+    s_batchTime.observe(timer.nsecsElapsed());
+    return results;
+}
+
+/**
+ * @brief 3.交叉熵迭代
+ * @note  每轮取当前最好的 elite 个，按各维的均值/标准差采样下一批；
+ *        标准差每轮乘 0.7 收缩，并保留均值 5% 的下限，避免过早塌缩到一点
+ */
+QVector<PidTuner::Result> PidTuner::optimise(const QVector<Result> &seeds, int rounds, int batch, int elite, quint32 seed)
+{
+    QVector<Result> all = seeds;
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    float shrink = 1.0f;
+    for (int round = 0; round < rounds; round++) {
+        const QVector<Result> best = rank(all, elite);
+        if (best.isEmpty() || best.first().score >= UNSTABLE_SCORE) break;
+
+        float mean[4] = {};
+        float sd[4] = {};
+        for (const Result &r : best) {
+            const float v[4] = { r.pid.kp, r.pid.ki, r.pid.kd, r.pid.limit };
+            for (int d = 0; d < 4; d++) mean[d] += v[d] / best.size();
+        }
+        for (const Result &r : best) {
+            const float v[4] = { r.pid.kp, r.pid.ki, r.pid.kd, r.pid.limit };
+            for (int d = 0; d < 4; d++) sd[d] += (v[d] - mean[d]) * (v[d] - mean[d]) / best.size();
+        }
+        for (int d = 0; d < 4; d++) {
+            sd[d] = qMax(std::sqrt(sd[d]) * shrink, 0.05f * std::fabs(mean[d]));
+        }
+
+        QVector<PIDParam> next(batch);
+        for (PIDParam &p : next) {
+            p.kp = qMax(0.0f, mean[0] + sd[0] * normal(rng));
+            p.ki = qMax(0.0f, mean[1] + sd[1] * normal(rng));
+            p.kd = qMax(0.0f, mean[2] + sd[2] * normal(rng));
+            p.limit = qMax(0.1f, mean[3] + sd[3] * normal(rng));
+        }
+        all += evaluate(next);
+        shrink *= 0.7f;
+    }
+    return all;
+}
+
+static float rangeValue(const PidTuner::Range &r, int index)
+{
+    if (r.steps <= 1) return r.min;
+    const float t = (float)index / (r.steps - 1);
+    if (r.log && r.min > 0.0f && r.max > 0.0f) return r.min * std::pow(r.max / r.min, t);
+    return r.min + (r.max - r.min) * t;
+}
+
+QVector<PIDParam> PidTuner::grid(const Range &kp, const Range &ki, const Range &kd, float limit)
+{
+    QVector<PIDParam> out;
+    out.reserve(qMax(1, kp.steps) * qMax(1, ki.steps) * qMax(1, kd.steps));
+    for (int a = 0; a < qMax(1, kp.steps); a++) {
+        for (int b = 0; b < qMax(1, ki.steps); b++) {
+            for (int c = 0; c < qMax(1, kd.steps); c++) {
+                PIDParam p;
+                p.kp = rangeValue(kp, a);
+                p.ki = rangeValue(ki, b);
+                p.kd = rangeValue(kd, c);
+                p.limit = limit;
+                out.append(p);
+            }
+        }
+    }
+    return out;
+}
+
+QVector<PidTuner::Result> PidTuner::rank(QVector<Result> results, int topN)
+{
+    const int n = qMin(qMax(0, topN), results.size());
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                      [](const Result &a, const Result &b) { return a.score < b.score; });
+    results.resize(n);
+    return results;
+}
@@ -0,0 +1,82 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 23:52:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 23:52:40
+ * @FilePath: \ele_sti\src\core\PowerPolicy.cpp
+ * @Description: 电源策略
+ */
+#include "core/PowerPolicy.h"
+#include "common/Metrics.h"
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+
+static MetricGauge s_idle("ele_sti_power_idle", "1 while the power policy holds acquisition at the idle heartbeat");
+static MetricCounter s_wavesSuppressed("ele_sti_power_waves_suppressed_total", "Idle waveform batches not forwarded because nothing changed");
+static MetricCounter s_statusSuppressed("ele_sti_power_status_suppressed_total", "Idle status packets coalesced away");
+
+PowerPolicy::PowerPolicy(IBackend *backend, QObject *parent)
+    : QObject(parent), m_backend(backend), m_mode(Active), m_haveWave(false),
+      m_haveStatus(false), m_lastImpedance(0.0f), m_lastBattery(-1), m_lastFreq(-1), m_lastStatusMs(0)
+{
+}
+
+/**
+ * @brief 1.切换模式
+ * @note  进入空闲时清掉上次推送的记录，停止后的第一帧平线和当前状态一定会送到界面
+ */
+void PowerPolicy::setActive(bool active)
+{
+    const Mode mode = active ? Active : Idle;
+    if (mode == m_mode) return;
+    m_mode = mode;
+    m_haveWave = false;
+    m_haveStatus = false;
+    m_backend->setAcquisitionInterval(active ? 0 : IDLE_POLL_MS);
+    s_idle.set(active ? 0 : 1);
+    qDebug() << "[Power]" << (active ? "active: full-rate acquisition" : "idle: heartbeat");
+    emit modeChanged(m_mode);
+}
+
+/**
+ * @brief 2.波形过滤
+ */
+bool PowerPolicy::passWaveform(const float *samples, int count)
+{
+    if (m_mode == Active) return true;
+    count = qMin(count, (int)WAVEFORM_BATCH_SIZE);
+    bool changed = !m_haveWave;
+    for (int i = 0; i < count && !changed; i++) {
+        changed = std::fabs(samples[i] - m_lastWave[i]) > WAVE_DELTA_MA;
+    }
+    if (!changed) {
+        s_wavesSuppressed.inc();
+        return false;
+    }
+    memcpy(m_lastWave, samples, count * sizeof(float));
+    m_haveWave = true;
+    return true;
+}
+
+/**
+ * @brief 3.状态合并
+ */
+bool PowerPolicy::passStatus(const StatusPacket &packet, qint64 nowMs)
+{
+    if (m_mode == Active) return true;
+    bool pass = !m_haveStatus || packet.error_code != 0 ||
+                packet.battery_pct != m_lastBattery || packet.real_freq != m_lastFreq ||
+                std::fabs(packet.impedance - m_lastImpedance) > IMPEDANCE_DELTA * qMax(1.0f, std::fabs(m_lastImpedance)) ||
+                nowMs - m_lastStatusMs >= STATUS_KEEPALIVE_MS;
+    if (!pass) {
+        s_statusSuppressed.inc();
+        return false;
+    }
+    m_haveStatus = true;
+    m_lastImpedance = packet.impedance;
+    m_lastBattery = packet.battery_pct;
+    m_lastFreq = packet.real_freq;
+    m_lastStatusMs = nowMs;
+    return true;
+}
@@ -0,0 +1,412 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 01:12:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 01:12:40
+ * @FilePath: \ele_sti\src\core\SessionAnalyzer.cpp
+ * @Description: 治疗记录离线分析
+ */
+#include "core/SessionAnalyzer.h"
+#include "core/TaskExecutor.h"
+#include "core/TrendStore.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+static MetricCounter s_sessions("ele_sti_analyze_sessions_total", "Session files analysed");
+static MetricCounter s_records("ele_sti_analyze_records_total", "Session records analysed");
+static MetricHistogram s_chunkTime("ele_sti_analyze_chunk_seconds", "Time spent on one waveform chunk");
+
+namespace {
+
+// 一个块的部分结果，合并时求和/取大
+struct ChunkResult {
+    quint64 waveforms = 0;
+    quint64 pulseBatches = 0;
+    quint64 conforming = 0;
+    quint64 missing = 0;
+    double pulses = 0.0;
+    double posNc = 0.0; // mA x us = nC
+    double negNc = 0.0;
+    double posAmpSum = 0.0;
+    quint64 posAmpN = 0;
+    double negAmpSum = 0.0;
+    quint64 negAmpN = 0;
+    float posErrMax = 0.0f;
+    float negErrMax = 0.0f;
+    float overshootMax = 0.0f;
+};
+
+struct ParamChange {
+    quint32 index; // 从这条记录起生效
+    SessionParam param;
+};
+
+struct Session {
+    QFile file;
+    const uchar *data = nullptr;
+    SessionHeader header = {};
+    quint32 records = 0;
+    QVector<ParamChange> params;
+    int firstChunk = 0;
+    int chunkCount = 0;
+
+    const SessionRecord *record(quint32 i) const
+    {
+        return reinterpret_cast<const SessionRecord *>(data + header.header_size + (qint64)i * header.record_size);
+    }
+};
+
+struct ChunkTask {
+    int session;
+    quint32 begin;
+    quint32 end;
+};
+
+// 一相的平台：超过设定幅值一半的采样 (sign 为 -1 时看负向)
+struct Phase {
+    float mean = 0.0f;
+    float peak = 0.0f;
+    int samples = 0;
+};
+
+Phase measurePhase(const float *samples, int count, float ampMa, float sign)
+{
+    Phase p;
+    const float threshold = 0.5f * ampMa;
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        const float v = samples[i] * sign;
+        if (v >= threshold) {
+            sum += v;
+            p.samples++;
+            if (v > p.peak) p.peak = v;
+        }
+    }
+    if (p.samples > 0) p.mean = (float)(sum / p.samples);
+    return p;
+}
+
+} // namespace
+
+double SessionAnalyzer::Report::chargeImbalancePct() const
+{
+    const double larger = qMax(posChargeUc, negChargeUc);
+    return larger > 0.0 ? 100.0 * std::fabs(posChargeUc - negChargeUc) / larger : 0.0;
+}
+
+SessionAnalyzer::SessionAnalyzer(const Options &options, int threads)
+    : m_options(options), m_threads(0)
+{
+    m_options.chunkRecords = qMax(64, m_options.chunkRecords);
+    setThreadCount(threads);
+}
+
+void SessionAnalyzer::setThreadCount(int threads)
+{
+    const int available = TaskExecutor::instance().threadCount();
+    m_threads = threads > 0 ? qMin(threads, available) : available;
+}
+
+QStringList SessionAnalyzer::collect(const QStringList &inputs)
+{
+    QStringList out;
+    for (const QString &input : inputs) {
+        if (QFileInfo(input).isDir()) {
+            QDirIterator it(input, { QString("*.%1").arg(ESES_SUFFIX) }, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) out.append(it.next());
+        } else {
+            out.append(input);
+        }
+    }
+    out.sort();
+    out.removeDuplicates();
+    return out;
+}
+
+/**
+ * @brief 1.建索引
+ * @note  映射、校验文件头，顺序扫一遍记录：参数变更点、状态包 (趋势/故障)、记录时间
+ */
+static void indexSession(Session &s, SessionAnalyzer::Report &r)
+{
+    TRACE_SCOPE("analyze.index");
+    s.file.setFileName(r.path);
+    if (!s.file.open(QIODevice::ReadOnly)) {
+        r.error = s.file.errorString();
+        return;
+    }
+    r.bytes = s.file.size();
+    if (r.bytes < (qint64)sizeof(SessionHeader)) {
+        r.error = "file shorter than the header";
+        return;
+    }
+    s.data = s.file.map(0, r.bytes);
+    if (!s.data) {
+        r.error = "mmap failed: " + s.file.errorString();
+        return;
+    }
+    memcpy(&s.header, s.data, sizeof(SessionHeader));
+    const SessionHeader &h = s.header;
+    if (h.magic != ESES_MAGIC) {
+        r.error = "not a session file";
+        return;
+    }
+    if (h.version != ESES_VERSION || h.header_size < sizeof(SessionHeader) || h.record_size < sizeof(SessionRecord)) {
+        r.error = QString("unsupported session format v%1").arg(h.version);
+        return;
+    }
+
+    // 异常结束的文件 record_count 为 0，按长度推算；尾部不完整的记录丢弃
+    const quint32 byLength = (quint32)((r.bytes - h.header_size) / h.record_size);
+    s.records = h.record_count > 0 ? qMin(h.record_count, byLength) : byLength;
+    r.closed = h.record_count > 0;
+    r.mode = h.mode;
+    r.startEpochMs = h.start_epoch_ms;
+    r.plannedS = h.planned_s;
+    r.records = s.records;
+    r.param = h.param;
+    ParamChange initial = { 0, h.param };
+    s.params.append(initial);
+
+    // 趋势复用服务的 TrendStore，和界面上看到的同一套分桶
+    std::unique_ptr<TrendStore> trends(new TrendStore());
+    double impedanceSum = 0.0;
+    int lastError = ERR_NONE;
+    quint32 lastMs = 0;
+    for (quint32 i = 0; i < s.records; i++) {
+        const SessionRecord *rec = s.record(i);
+        lastMs = rec->host_ms;
+        switch (rec->type) {
+        case ESES_REC_PARAM: {
+            ParamChange change = { i, rec->param };
+            s.params.append(change);
+            break;
+        }
+        case ESES_REC_STATUS: {
+            const StatusPacket &st = rec->status;
+            trends->addSample(h.start_epoch_ms + rec->host_ms, st);
+            const float impedance = st.impedance;
+            if (r.statuses == 0) {
+                r.impedanceMin = r.impedanceMax = impedance;
+            } else {
+                r.impedanceMin = qMin(r.impedanceMin, impedance);
+                r.impedanceMax = qMax(r.impedanceMax, impedance);
+            }
+            impedanceSum += impedance;
+            r.statuses++;
+            // 按跳变记事件，持续报同一个码只记一次
+            if (st.error_code != lastError && st.error_code != ERR_NONE) {
+                SessionAnalyzer::ErrorEvent event = { rec->host_ms, (int)st.error_code };
+                r.errors.append(event);
+            }
+            lastError = st.error_code;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    r.paramChanges = s.params.size() - 1;
+    r.elapsedMs = r.closed ? h.elapsed_ms : lastMs;
+    if (r.statuses > 0) r.impedanceMean = (float)(impedanceSum / r.statuses);
+    for (int row = 0; row < trends->size(TrendStore::PerMinute); row++) {
+        SessionAnalyzer::TrendPoint point;
+        point.startMs = trends->at(TrendStore::PerMinute, row).startMs;
+        point.min = (float)trends->value(TrendStore::PerMinute, row, TrendStore::Impedance, TrendStore::Min);
+        point.max = (float)trends->value(TrendStore::PerMinute, row, TrendStore::Impedance, TrendStore::Max);
+        point.mean = (float)trends->value(TrendStore::PerMinute, row, TrendStore::Impedance, TrendStore::Mean);
+        r.impedanceTrend.append(point);
+    }
+    r.ok = true;
+}
+
+/**
+ * @brief 2.分析一个块
+ * @note  包间隔取与上一包 M0 时间戳的差 (32 位回绕按无符号减法处理)，块内第一包往前找上一包；
+ *        间隔超过 1 秒 (中间断流) 时这一包不计电荷
+ */
+static void analyzeChunk(const Session &s, quint32 begin, quint32 end, const SessionAnalyzer::Options &opt, ChunkResult &out)
+{
+    TRACE_SCOPE("analyze.chunk");
+    const qint64 t0 = LatencyTracer::nowNs();
+
+    // 块起点生效的参数
+    auto it = std::upper_bound(s.params.begin(), s.params.end(), begin,
+                               [](quint32 index, const ParamChange &c) { return index < c.index; });
+    SessionParam param = (it - 1)->param;
+
+    bool havePrev = false;
+    uint32_t prevTick = 0;
+    for (quint32 i = begin; i > 0 && i + 256 > begin; i--) {
+        const SessionRecord *rec = s.record(i - 1);
+        if (rec->type == ESES_REC_WAVE) {
+            prevTick = rec->wave.tick_us;
+            havePrev = true;
+            break;
+        }
+    }
+
+    const bool checkPulses = s.header.mode == ESES_MODE_STIM;
+    for (quint32 i = begin; i < end; i++) {
+        const SessionRecord *rec = s.record(i);
+        if (rec->type == ESES_REC_PARAM) {
+            param = rec->param;
+            continue;
+        }
+        if (rec->type != ESES_REC_WAVE) continue;
+        out.waveforms++;
+        float samples[WAVEFORM_BATCH_SIZE];
+        memcpy(samples, rec->wave.adc_batch, sizeof(samples));
+        const uint32_t tick = rec->wave.tick_us;
+        const uint32_t dtUs = havePrev ? tick - prevTick : 0;
+        prevTick = tick;
+        havePrev = true;
+        if (!checkPulses) continue;
+
+        const bool wantPos = param.amp_pos >= opt.minAmpMa;
+        const bool wantNeg = param.amp_neg >= opt.minAmpMa;
+        if (!wantPos && !wantNeg) continue;
+        out.pulseBatches++;
+        const Phase pos = wantPos ? measurePhase(samples, WAVEFORM_BATCH_SIZE, param.amp_pos, 1.0f) : Phase();
+        const Phase neg = wantNeg ? measurePhase(samples, WAVEFORM_BATCH_SIZE, param.amp_neg, -1.0f) : Phase();
+        if ((wantPos && pos.samples == 0) || (wantNeg && neg.samples == 0)) {
+            out.missing++;
+            continue;
+        }
+
+        bool conform = true;
+        if (wantPos) {
+            const float err = std::fabs(pos.mean - param.amp_pos) / param.amp_pos;
+            const float over = (pos.peak - param.amp_pos) / param.amp_pos;
+            conform = conform && err <= opt.ampTolerance && over <= opt.overshootLimit;
+            out.posErrMax = qMax(out.posErrMax, err);
+            out.overshootMax = qMax(out.overshootMax, over);
+            out.posAmpSum += pos.mean;
+            out.posAmpN++;
+        }
+        if (wantNeg) {
+            const float err = std::fabs(neg.mean - param.amp_neg) / param.amp_neg;
+            const float over = (neg.peak - param.amp_neg) / param.amp_neg;
+            conform = conform && err <= opt.ampTolerance && over <= opt.overshootLimit;
+            out.negErrMax = qMax(out.negErrMax, err);
+            out.overshootMax = qMax(out.overshootMax, over);
+            out.negAmpSum += neg.mean;
+            out.negAmpN++;
+        }
+        if (conform) out.conforming++;
+
+        if (dtUs > 0 && dtUs < 1000000u) {
+            const double pulses = (double)param.freq * dtUs / 1e6;
+            out.pulses += pulses;
+            out.posNc += pos.mean * param.positive_width * pulses;
+            out.negNc += neg.mean * param.negative_width * pulses;
+        }
+    }
+    s_chunkTime.observe(LatencyTracer::nowNs() - t0);
+}
+
+/**
+ * @brief 3.分析一批文件
+ */
+QVector<SessionAnalyzer::Report> SessionAnalyzer::analyze(const QStringList &paths, Summary *summary)
+{
+    TRACE_SCOPE("analyze.run");
+    const qint64 t0 = LatencyTracer::nowNs();
+    const int n = paths.size();
+    QVector<Report> reports(n);
+    std::vector<std::unique_ptr<Session>> sessions;
+    sessions.reserve(n);
+    for (int i = 0; i < n; i++) {
+        reports[i].path = paths[i];
+        sessions.emplace_back(new Session());
+    }
+
+    // 第 1 步：每个文件一块
+    TaskExecutor &executor = TaskExecutor::instance();
+    executor.parallelFor(n, 1, [&sessions, &reports](int begin, int end) {
+        for (int i = begin; i < end; i++) indexSession(*sessions[i], reports[i]);
+    }, TaskExecutor::Normal, m_threads);
+    const qint64 t1 = LatencyTracer::nowNs();
+
+    // 第 2 步：所有文件的块放进同一个队列，大文件不会拖住一个线程
+    QVector<ChunkTask> tasks;
+    for (int i = 0; i < n; i++) {
+        Session &s = *sessions[i];
+        if (!reports[i].ok) continue;
+        s.firstChunk = tasks.size();
+        for (quint32 begin = 0; begin < s.records; begin += (quint32)m_options.chunkRecords) {
+            ChunkTask task = { i, begin, qMin(s.records, begin + (quint32)m_options.chunkRecords) };
+            tasks.append(task);
+        }
+        s.chunkCount = tasks.size() - s.firstChunk;
+    }
+    QVector<ChunkResult> results(tasks.size());
+    const Options opt = m_options;
+    const ChunkTask *in = tasks.constData();
+    ChunkResult *out = results.data();
+    executor.parallelFor(tasks.size(), 1, [&sessions, in, out, &opt](int begin, int end) {
+        for (int c = begin; c < end; c++) analyzeChunk(*sessions[in[c].session], in[c].begin, in[c].end, opt, out[c]);
+    }, TaskExecutor::Normal, m_threads);
+    const qint64 t2 = LatencyTracer::nowNs();
+
+    // 合并
+    quint64 records = 0;
+    qint64 bytes = 0;
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        Report &r = reports[i];
+        const Session &s = *sessions[i];
+        bytes += r.bytes;
+        if (!r.ok) {
+            failed++;
+            continue;
+        }
+        records += r.records;
+        for (int c = s.firstChunk; c < s.firstChunk + s.chunkCount; c++) {
+            const ChunkResult &part = results[c];
+            r.waveforms += part.waveforms;
+            r.pulseBatches += part.pulseBatches;
+            r.conformingBatches += part.conforming;
+            r.missingPulses += part.missing;
+            r.pulses += part.pulses;
+            r.posChargeUc += part.posNc / 1000.0;
+            r.negChargeUc += part.negNc / 1000.0;
+            r.posAmpMean += part.posAmpSum;
+            r.negAmpMean += part.negAmpSum;
+            r.posAmpErrMaxPct = qMax(r.posAmpErrMaxPct, 100.0f * part.posErrMax);
+            r.negAmpErrMaxPct = qMax(r.negAmpErrMaxPct, 100.0f * part.negErrMax);
+            r.overshootMaxPct = qMax(r.overshootMaxPct, 100.0f * part.overshootMax);
+        }
+        quint64 posN = 0, negN = 0;
+        for (int c = s.firstChunk; c < s.firstChunk + s.chunkCount; c++) {
+            posN += results[c].posAmpN;
+            negN += results[c].negAmpN;
+        }
+        r.posAmpMean = posN > 0 ? r.posAmpMean / posN : 0.0;
+        r.negAmpMean = negN > 0 ? r.negAmpMean / negN : 0.0;
+    }
+    sessions.clear(); // 解除映射
+
+    s_sessions.inc(n);
+    s_records.inc(records);
+    if (summary) {
+        summary->sessions = n;
+        summary->failed = failed;
+        summary->threads = threadCount();
+        summary->chunks = tasks.size();
+        summary->records = records;
+        summary->bytes = bytes;
+        summary->indexNs = t1 - t0;
+        summary->chunkNs = t2 - t1;
+        summary->elapsedNs = LatencyTracer::nowNs() - t0;
+    }
+    return reports;
+}
@@ -0,0 +1,243 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 00:48:25
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 00:48:25
+ * @FilePath: \ele_sti\src\core\SessionRecorder.cpp
+ * @Description: 治疗记录
+ */
+#include "core/SessionRecorder.h"
+#include "common/Metrics.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <cstring>
+
+static MetricCounter s_recorded("ele_sti_session_records_total", "Records appended to treatment session files");
+static MetricCounter s_writeErrors("ele_sti_session_write_errors_total", "Failed writes to a treatment session file");
+
+/**
+ * @brief 后台写者
+ * @note  操作按提交顺序排队；每个后台任务持 fileLock 把队列里已有的操作全部做完，
+ *        任务落在哪个工作线程、谁先拿到锁都不会打乱写入顺序。
+ *        执行器退出时没跑的任务被取消，最后一份引用释放时在析构里补做剩下的操作 (回写文件头)。
+ */
+struct SessionRecorder::Writer
+{
+    struct Op {
+        enum Kind { Open, Append, Finish } kind;
+        SessionHeader header; // Open/Finish
+        QByteArray records;   // Append
+    };
+
+    QString path;
+    QMutex fileLock;
+    QFile file;
+    quint32 written = 0;
+    QMutex queueLock;
+    QVector<Op> queue;
+
+    ~Writer() { drain(); }
+
+    void push(Op op)
+    {
+        QMutexLocker locker(&queueLock);
+        queue.append(std::move(op));
+    }
+
+    void drain()
+    {
+        QMutexLocker fileGuard(&fileLock);
+        QVector<Op> ops;
+        {
+            QMutexLocker queueGuard(&queueLock);
+            ops.swap(queue);
+        }
+        for (Op &op : ops) run(op);
+    }
+
+    void run(Op &op)
+    {
+        switch (op.kind) {
+        case Op::Open: {
+            const QString dir = QFileInfo(path).absolutePath();
+            if (!QDir().mkpath(dir)) {
+                qWarning() << "[Session] cannot create" << dir;
+                return;
+            }
+            file.setFileName(path);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+                qWarning() << "[Session] cannot open" << path << file.errorString();
+                return;
+            }
+            writeHeader(op.header);
+            qDebug() << "[Session] recording to" << path;
+            return;
+        }
+        case Op::Append: {
+            if (!file.isOpen()) return;
+            const qint64 bytes = op.records.size();
+            if (file.write(op.records.constData(), bytes) != bytes) {
+                s_writeErrors.inc();
+            } else {
+                const int count = (int)(bytes / (qint64)sizeof(SessionRecord));
+                written += (quint32)count;
+                s_recorded.inc(count);
+            }
+            return;
+        }
+        case Op::Finish:
+            if (!file.isOpen()) return;
+            op.header.record_count = written;
+            if (!file.seek(0)) s_writeErrors.inc();
+            else writeHeader(op.header);
+            file.close();
+            qDebug() << "[Session] closed" << path << written << "records";
+            return;
+        }
+    }
+
+    void writeHeader(const SessionHeader &header)
+    {
+        if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != (qint64)sizeof(header)) {
+            s_writeErrors.inc();
+        }
+    }
+};
+
+SessionRecorder::SessionRecorder()
+    : m_buffered(0)
+{
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    end();
+}
+
+SessionParam SessionRecorder::toSessionParam(const StimulationParam &param)
+{
+    SessionParam out;
+    memset(&out, 0, sizeof(out));
+    out.freq = (uint16_t)qBound(0, param.freq, 65535);
+    out.positive_width = (uint32_t)qMax(0, param.posW);
+    out.negative_width = (uint32_t)qMax(0, param.negW);
+    out.dead_pulse = (uint32_t)qMax(0, param.dead);
+    out.amp_pos = param.posAmp;
+    out.amp_neg = param.negAmp;
+    return out;
+}
+
+/**
+ * @brief 1.开始一次记录
+ * @note  文件名按开始时刻命名：session-yyyyMMdd-HHmmss-zzz.eses；建目录和打开文件交给后台
+ */
+bool SessionRecorder::begin(int mode, const StimulationParam &param, int plannedSeconds)
+{
+    end();
+    if (m_dir.isEmpty()) return false;
+    const QDateTime now = QDateTime::currentDateTime();
+    m_path = QDir(m_dir).filePath(QString("session-%1.%2").arg(now.toString("yyyyMMdd-HHmmss-zzz"), ESES_SUFFIX));
+
+    memset(&m_header, 0, sizeof(m_header));
+    m_header.magic = ESES_MAGIC;
+    m_header.version = ESES_VERSION;
+    m_header.header_size = sizeof(SessionHeader);
+    m_header.record_size = sizeof(SessionRecord);
+    m_header.mode = (uint8_t)mode;
+    m_header.start_epoch_ms = now.toMSecsSinceEpoch();
+    m_header.planned_s = (uint32_t)qMax(0, plannedSeconds);
+    m_header.param = toSessionParam(param);
+
+    m_writer = std::make_shared<Writer>();
+    m_writer->path = m_path;
+    m_writer->push({ Writer::Op::Open, m_header, QByteArray() });
+    submit();
+    m_buffered = 0;
+    m_clock.start();
+    return true;
+}
+
+/**
+ * @brief 2.结束记录
+ * @note  剩余记录和回写文件头一起交给后台；记录数按实际写成功的条数
+ */
+void SessionRecorder::end()
+{
+    if (!m_writer) return;
+    enqueueBuffer();
+    m_header.elapsed_ms = (uint32_t)m_clock.elapsed();
+    m_writer->push({ Writer::Op::Finish, m_header, QByteArray() });
+    submit();
+    m_writer.reset();
+}
+
+bool SessionRecorder::waitWritten(int timeoutMs)
+{
+    return !m_lastWrite.isValid() || m_lastWrite.wait(timeoutMs);
+}
+
+SessionRecord *SessionRecorder::next(uint8_t type)
+{
+    if (m_buffered == BUFFER_RECORDS) flush();
+    SessionRecord *rec = &m_buffer[m_buffered++];
+    memset(rec, 0, sizeof(SessionRecord));
+    rec->type = type;
+    rec->host_ms = (uint32_t)m_clock.elapsed();
+    return rec;
+}
+
+void SessionRecorder::enqueueBuffer()
+{
+    if (m_buffered == 0) return;
+    const int bytes = m_buffered * (int)sizeof(SessionRecord);
+    m_writer->push({ Writer::Op::Append, SessionHeader(), QByteArray(reinterpret_cast<const char *>(m_buffer), bytes) });
+    m_buffered = 0;
+}
+
+void SessionRecorder::submit()
+{
+    // 最后提交的任务做完时，它之前入队的操作一定都已写出
+    std::shared_ptr<Writer> writer = m_writer;
+    m_lastWrite = TaskExecutor::instance().submit([writer](TaskExecutor::Context &) { writer->drain(); },
+                                                  TaskExecutor::Background);
+}
+
+void SessionRecorder::flush()
+{
+    if (m_buffered == 0) return;
+    enqueueBuffer();
+    submit();
+}
+
+// ---------------- 记录 ----------------
+
+void SessionRecorder::record(const WaveformPacket &packet)
+{
+    if (!m_writer) return;
+    memcpy(&next(ESES_REC_WAVE)->wave, &packet, sizeof(packet));
+}
+
+void SessionRecorder::record(const StatusPacket &packet)
+{
+    if (!m_writer) return;
+    memcpy(&next(ESES_REC_STATUS)->status, &packet, sizeof(packet));
+    // 故障记录不能留在缓冲里，立即交给后台写出，进程随后被拔电也要能查到
+    if (packet.error_code != ERR_NONE) flush();
+}
+
+void SessionRecorder::record(const ProgramStatusPacket &packet)
+{
+    if (!m_writer) return;
+    memcpy(&next(ESES_REC_PROG_STATUS)->program, &packet, sizeof(packet));
+}
+
+void SessionRecorder::recordParam(const StimulationParam &param)
+{
+    if (!m_writer) return;
+    next(ESES_REC_PARAM)->param = toSessionParam(param);
+}
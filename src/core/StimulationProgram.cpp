@@ -0,0 +1,153 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 10:12:40
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 10:12:40
+ * @FilePath: \ele_sti\src\core\StimulationProgram.cpp
+ * @Description: 刺激程序：参数校验、程序表打包与分块
+ */
+#include "core/StimulationProgram.h"
+#include "common/PacketCodec.h"
+#include <QtNumeric>
+#include <cstring>
+#include <climits>
+
+/**
+ * @brief 1.追加恒定段
+ * @param param 段参数
+ * @param durationMs 段时长，单位毫秒
+ */
+bool StimulationProgram::appendSegment(const StimulationParam &param, int durationMs)
+{
+    return appendChecked(param, param.posAmp, param.negAmp, durationMs);
+}
+
+/**
+ * @brief 2.追加斜坡段
+ * @note  幅值在段内由 M0 按时间线性插值，频率与脉宽在段内不变
+ */
+bool StimulationProgram::appendRamp(const StimulationParam &from, float toPosAmp, float toNegAmp, int durationMs)
+{
+    return appendChecked(from, toPosAmp, toNegAmp, durationMs);
+}
+
+/**
+ * @brief 3.缓升/保持/缓降程序
+ * @note  时长为 0 的阶段会被跳过
+ */
+StimulationProgram StimulationProgram::softStart(const StimulationParam &target,
+                                                 int rampUpMs, int holdMs, int rampDownMs)
+{
+    StimulationProgram program;
+    StimulationParam zero = target;
+    zero.posAmp = 0.0f;
+    zero.negAmp = 0.0f;
+
+    if (rampUpMs > 0)   program.appendRamp(zero, target.posAmp, target.negAmp, rampUpMs);
+    if (holdMs > 0)     program.appendSegment(target, holdMs);
+    if (rampDownMs > 0) program.appendRamp(target, 0.0f, 0.0f, rampDownMs);
+    return program;
+}
+
+void StimulationProgram::clear()
+{
+    m_segments.clear();
+    m_lastError.clear();
+}
+
+int StimulationProgram::totalDurationMs() const
+{
+    qint64 total = 0;
+    for (const ProgramSegment &seg : m_segments) {
+        total += seg.duration_ms;
+    }
+    return (int)qMin<qint64>(total, INT_MAX);
+}
+
+uint16_t StimulationProgram::crc() const
+{
+    return calculateCrc16(m_segments.constData(), m_segments.size() * (int)sizeof(ProgramSegment));
+}
+
+/**
+ * @brief 4.分块打包
+ * @param programId 程序编号
+ * @note  每块独立计算累加校验和，块头携带整表 CRC16 供 M0 收齐后校验
+ */
+QVector<ProgramChunkPacket> StimulationProgram::encodeChunks(uint8_t programId) const
+{
+    QVector<ProgramChunkPacket> chunks;
+    if (m_segments.isEmpty()) return chunks;
+
+    const int total = m_segments.size();
+    const int chunkCount = (total + PROGRAM_SEGS_PER_CHUNK - 1) / PROGRAM_SEGS_PER_CHUNK;
+    const uint16_t tableCrc = crc();
+    chunks.reserve(chunkCount);
+
+    for (int c = 0; c < chunkCount; c++) {
+        ProgramChunkPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.program_id = programId;
+        packet.chunk_index = (uint8_t)c;
+        packet.chunk_count = (uint8_t)chunkCount;
+        packet.segment_total = (uint8_t)total;
+        packet.program_crc = tableCrc;
+
+        const int first = c * PROGRAM_SEGS_PER_CHUNK;
+        const int count = qMin(PROGRAM_SEGS_PER_CHUNK, total - first);
+        packet.segment_count = (uint8_t)count;
+        memcpy(packet.segments, m_segments.constData() + first, count * sizeof(ProgramSegment));
+
+        encodePacket(packet);
+        chunks.append(packet);
+    }
+    return chunks;
+}
+
+/**
+ * @brief 5.参数范围检查
+ * @note  协议里脉宽/死区是 16 位，超过范围直接拒绝，避免 M0 端被截断
+ */
+bool StimulationProgram::appendChecked(const StimulationParam &param, float endPos, float endNeg, int durationMs)
+{
+    if (m_segments.size() >= PROGRAM_MAX_SEGMENTS) {
+        m_lastError = QString("program exceeds %1 segments").arg(PROGRAM_MAX_SEGMENTS);
+        return false;
+    }
+    if (durationMs <= 0) {
+        m_lastError = "segment duration must be positive";
+        return false;
+    }
+    if (param.freq <= 0 || param.freq > 0xFFFF) {
+        m_lastError = QString("invalid frequency %1 Hz").arg(param.freq);
+        return false;
+    }
+    if (param.posW < 0 || param.posW > 0xFFFF || param.negW < 0 || param.negW > 0xFFFF
+        || param.dead < 0 || param.dead > 0xFFFF) {
+        m_lastError = "pulse width / dead time out of 16-bit range";
+        return false;
+    }
+    // 幅值原样下发给 M0：非数、负值、超过面板上限的电流都不能进程序表
+    const float amps[4] = { param.posAmp, endPos, param.negAmp, endNeg };
+    static const char *const ampNames[4] = { "positive start", "positive end", "negative start", "negative end" };
+    for (int i = 0; i < 4; i++) {
+        if (!qIsFinite(amps[i]) || amps[i] < 0.0f || amps[i] > KNOB_AMP_MAX_MA) {
+            m_lastError = QString("%1 amplitude %2 mA outside 0..%3 mA").arg(ampNames[i]).arg(amps[i]).arg(KNOB_AMP_MAX_MA);
+            return false;
+        }
+    }
+
+    ProgramSegment seg;
+    memset(&seg, 0, sizeof(seg));
+    seg.duration_ms = (uint32_t)durationMs;
+    seg.freq = (uint16_t)param.freq;
+    seg.positive_width = (uint16_t)param.posW;
+    seg.negative_width = (uint16_t)param.negW;
+    seg.dead_pulse = (uint16_t)param.dead;
+    seg.amp_pos_start = param.posAmp;
+    seg.amp_pos_end = endPos;
+    seg.amp_neg_start = param.negAmp;
+    seg.amp_neg_end = endNeg;
+    m_segments.append(seg);
+    return true;
+}
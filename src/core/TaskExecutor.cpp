@@ -0,0 +1,292 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 02:05:31
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 02:05:31
+ * @FilePath: \ele_sti\src\core\TaskExecutor.cpp
+ * @Description: 共享任务执行器
+ */
+#include "core/TaskExecutor.h"
+#include "common/CpuPlan.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <chrono>
+
+static MetricCounter s_executed("ele_sti_exec_tasks_total", "Tasks run by the shared executor");
+static MetricCounter s_cancelled("ele_sti_exec_cancelled_total", "Executor tasks cancelled before they started");
+static MetricCounter s_stolen("ele_sti_exec_stolen_total", "Executor tasks taken from another worker's queue");
+static MetricGauge s_depth("ele_sti_exec_queue_depth", "Tasks waiting in the shared executor");
+static MetricHistogram s_queueHigh("ele_sti_exec_high_queue_seconds", "Queue latency of high lane executor tasks");
+static MetricHistogram s_queueNormal("ele_sti_exec_normal_queue_seconds", "Queue latency of normal lane executor tasks");
+static MetricHistogram s_queueBackground("ele_sti_exec_background_queue_seconds", "Queue latency of background lane executor tasks");
+static MetricHistogram s_runTime("ele_sti_exec_run_seconds", "Run time of one executor task");
+
+static MetricHistogram *const s_queueTime[TaskExecutor::LANE_COUNT] = { &s_queueHigh, &s_queueNormal, &s_queueBackground };
+
+// 当前线程属于哪个执行器的第几个工作线程
+static thread_local TaskExecutor *t_executor = nullptr;
+static thread_local int t_worker = -1;
+
+TaskExecutor &TaskExecutor::instance()
+{
+    static TaskExecutor executor(CpuPlan::current().background);
+    return executor;
+}
+
+TaskExecutor::TaskExecutor(const QVector<int> &cores, int threads, const QString &name)
+    : m_cores(cores), m_queued(0), m_nextWorker(0), m_stopping(false)
+{
+    for (auto &q : m_laneQueued) q.store(0);
+    if (threads <= 0) threads = cores.isEmpty() ? CpuPlan::onlineCores() : cores.size();
+    m_workers.reserve(threads);
+    for (int i = 0; i < threads; i++) m_workers.emplace_back(new Worker);
+    // 先把所有 Worker 建好再启动线程，窃取时会遍历整个数组
+    for (int i = 0; i < threads; i++) {
+        QThread *t = QThread::create([this, i]() { workerLoop(i); });
+        t->setObjectName(QString("%1%2").arg(name).arg(i));
+        m_workers[i]->thread = t;
+        t->start(QThread::LowPriority);
+    }
+    qInfo() << "[TaskExecutor]" << name << threads << "workers on cores" << cores;
+}
+
+/**
+ * @brief 1.析构
+ * @note  还在排队的任务全部标记为取消并唤醒等待方；正在执行的任务收到取消请求后等它返回
+ */
+TaskExecutor::~TaskExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_sleepLock);
+        m_stopping.store(true);
+    }
+    for (auto &w : m_workers) {
+        QMutexLocker locker(&w->lock);
+        for (auto &lane : w->lanes) {
+            for (Item &item : lane) {
+                finish(item.state.get(), Cancelled);
+                s_cancelled.inc();
+            }
+            lane.clear();
+        }
+    }
+    m_queued.store(0);
+    for (auto &q : m_laneQueued) q.store(0);
+    s_depth.set(0);
+    m_wake.notify_all();
+    for (auto &w : m_workers) {
+        w->thread->wait();
+        delete w->thread;
+    }
+}
+
+bool TaskExecutor::isWorkerThread() const
+{
+    return t_executor == this;
+}
+
+/**
+ * @brief 2.提交
+ * @note  计数先于入队：工作线程看到计数大于 0 却暂时取不到任务时只会多转一圈，不会漏唤醒
+ */
+TaskExecutor::Handle TaskExecutor::submit(Task task, Lane lane)
+{
+    auto state = std::make_shared<TaskState>();
+    if (m_stopping.load()) {
+        state->status.store(Cancelled);
+        s_cancelled.inc();
+        return Handle(this, state);
+    }
+
+    Item item{ std::move(task), state, lane, TraceRecorder::nowNs() };
+    const bool local = isWorkerThread();
+    const int target = local ? t_worker : (int)(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+    s_depth.set(m_queued.fetch_add(1) + 1);
+    m_laneQueued[lane].fetch_add(1);
+    {
+        Worker *w = m_workers[target].get();
+        QMutexLocker locker(&w->lock);
+        if (local) w->lanes[lane].push_front(std::move(item));
+        else w->lanes[lane].push_back(std::move(item));
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_sleepLock);
+    }
+    m_wake.notify_one();
+    return Handle(this, state);
+}
+
+bool TaskExecutor::take(int self, int belowLane, Item &out)
+{
+    const int n = (int)m_workers.size();
+    for (int lane = 0; lane < belowLane; lane++) {
+        if (m_laneQueued[lane].load(std::memory_order_relaxed) <= 0) continue;
+        for (int k = 0; k < n; k++) {
+            const int idx = (self + k) % n;
+            Worker *w = m_workers[idx].get();
+            QMutexLocker locker(&w->lock);
+            std::deque<Item> &q = w->lanes[lane];
+            if (q.empty()) continue;
+            // 自己的从队头取 (最近提交的子任务)，别人的从队尾偷 (最早的外部任务)
+            if (k == 0) {
+                out = std::move(q.front());
+                q.pop_front();
+            } else {
+                out = std::move(q.back());
+                q.pop_back();
+                s_stolen.inc();
+            }
+            locker.unlock();
+            m_laneQueued[lane].fetch_sub(1);
+            s_depth.set(m_queued.fetch_sub(1) - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskExecutor::finish(TaskState *state, Status status)
+{
+    std::lock_guard<std::mutex> lk(state->lock);
+    state->status.store(status);
+    state->finished.notify_all();
+}
+
+void TaskExecutor::run(Item &item)
+{
+    TaskState *state = item.state.get();
+    if (state->cancelRequested.load()) {
+        finish(state, Cancelled);
+        s_cancelled.inc();
+        item.task = nullptr;
+        return;
+    }
+    const qint64 startNs = TraceRecorder::nowNs();
+    s_queueTime[item.lane]->observe(startNs - item.submitNs);
+    state->status.store(Running);
+    {
+        TRACE_SCOPE("exec.task");
+        Context ctx(this, state, item.lane);
+        item.task(ctx);
+    }
+    // 先释放闭包里捕获的资源，等待方醒来时它们已经析构
+    item.task = nullptr;
+    s_runTime.observe(TraceRecorder::nowNs() - startNs);
+    s_executed.inc();
+    finish(state, Done);
+}
+
+bool TaskExecutor::helpOnce(int belowLane)
+{
+    Item item;
+    if (take(t_worker, belowLane, item)) {
+        run(item);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 3.工作线程主循环
+ * @note  绑到整组后台核而不是单个核，组内由内核调度，避免某个核被别的进程占满时任务卡住
+ */
+void TaskExecutor::workerLoop(int index)
+{
+    t_executor = this;
+    t_worker = index;
+    CpuPlan::pinCurrentThread(m_cores);
+    while (true) {
+        if (helpOnce()) continue;
+        std::unique_lock<std::mutex> lk(m_sleepLock);
+        m_wake.wait(lk, [this]() { return m_stopping.load() || m_queued.load() > 0; });
+        if (m_stopping.load()) break;
+    }
+    t_executor = nullptr;
+    t_worker = -1;
+}
+
+/**
+ * @brief 4.并行 for
+ * @note  切块放在一个共享计数器里，每个 runner 任务循环领块，块数多于线程数时自然均衡；
+ *        在工作线程上调用时调用方自己也领块，等待 runner 时继续帮忙执行别的任务，不会死锁
+ */
+void TaskExecutor::parallelFor(int count, int grain, const std::function<void(int, int)> &fn, Lane lane, int maxParallel)
+{
+    if (count <= 0) return;
+    grain = qMax(1, grain);
+    const int chunks = (count + grain - 1) / grain;
+    auto next = std::make_shared<std::atomic<int>>(0);
+    auto body = [next, chunks, count, grain, &fn]() {
+        int c;
+        while ((c = next->fetch_add(1)) < chunks) {
+            const int begin = c * grain;
+            fn(begin, qMin(count, begin + grain));
+        }
+    };
+
+    int runners = qMin(chunks, maxParallel > 0 ? qMin(maxParallel, threadCount()) : threadCount());
+    const bool onWorker = isWorkerThread();
+    if (onWorker) runners--;
+    QVector<Handle> handles;
+    handles.reserve(runners);
+    for (int i = 0; i < runners; i++) handles.append(submit([body](Context &) { body(); }, lane));
+    if (onWorker || runners == 0) body();
+    for (Handle &h : handles) h.wait();
+}
+
+// ==========================================
+// Handle / Context
+// ==========================================
+
+void TaskExecutor::Handle::cancel()
+{
+    if (m_state) m_state->cancelRequested.store(true);
+}
+
+TaskExecutor::Status TaskExecutor::Handle::status() const
+{
+    return m_state ? (Status)m_state->status.load() : Cancelled;
+}
+
+bool TaskExecutor::Handle::wait(int timeoutMs)
+{
+    if (!m_state) return true;
+    auto finished = [this]() {
+        const int s = m_state->status.load();
+        return s == Done || s == Cancelled;
+    };
+    if (m_executor && m_executor->isWorkerThread()) {
+        // 工作线程上等待：先帮忙跑别的任务；取不到任务时短暂睡眠再查
+        QElapsedTimer timer;
+        timer.start();
+        while (!finished()) {
+            if (timeoutMs >= 0 && timer.elapsed() >= timeoutMs) return false;
+            if (m_executor->helpOnce()) continue;
+            std::unique_lock<std::mutex> lk(m_state->lock);
+            m_state->finished.wait_for(lk, std::chrono::microseconds(200), finished);
+        }
+        return true;
+    }
+    std::unique_lock<std::mutex> lk(m_state->lock);
+    if (timeoutMs < 0) {
+        m_state->finished.wait(lk, finished);
+        return true;
+    }
+    return m_state->finished.wait_for(lk, std::chrono::milliseconds(timeoutMs), finished);
+}
+
+bool TaskExecutor::Context::cancelled() const
+{
+    return m_state->cancelRequested.load(std::memory_order_relaxed) || m_executor->m_stopping.load(std::memory_order_relaxed);
+}
+
+bool TaskExecutor::Context::yield()
+{
+    // 只执行比自己高的道，防止同级任务互相嵌套把栈越压越深
+    if (m_lane > High && m_executor->isWorkerThread()) {
+        while (m_executor->helpOnce(m_lane)) {}
+    }
+    return cancelled();
+}
@@ -7,10 +7,23 @@
  * @Description: 核心业务层：负责治疗时长控制、状态管理、参数更新等
  */
 #include "core/TreatmentService.h"
+#include "common/LatencyTracer.h"
+#include "common/Logging.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include "core/TaskExecutor.h"
 #include <QDebug>
 #include <QTimer>
-#include <QDateTime>  // 用于打印精确时间戳
-#define LOG_SIM(msg) qDebug().noquote() << "[" << QDateTime::currentDateTime().toString("HH:mm:ss.zzz") << "][WinBackend]" << msg
+#include <QThread>
+#include <cstring>
+#include <QDateTime>
+static MetricCounter s_waveHandled("ele_sti_service_wave_handled_total", "Waveform packets processed by TreatmentService");
+static MetricCounter s_droppedFrames("ele_sti_service_dropped_frames_total", "Waveform batches missing according to M0 tick gaps");
+static MetricCounter s_statusHandled("ele_sti_service_status_handled_total", "Status packets processed by TreatmentService");
+static MetricCounter s_emergencyStops("ele_sti_service_emergency_stops_total", "Treatments stopped by an M0 error code");
+static MetricHistogram s_waveHandle("ele_sti_service_wave_handle_seconds", "Time spent converting one waveform packet");
+static MetricGauge s_arbBuffered("ele_sti_arb_buffered_blocks", "Arbitrary waveform blocks generated ahead on the host");
+static MetricGauge s_arbUnderruns("ele_sti_arb_host_underruns", "Host-side arbitrary waveform underruns in the current session");
 
 TreatmentService::TreatmentService(IBackend *backend,QObject *parent)
 :m_backend(backend),QObject(parent)
@@ -19,11 +32,45 @@ TreatmentService::TreatmentService(IBackend *backend,QObject *parent)
     m_state=Runstate::Idle;
     // 初始化计时器
     m_remaining_seconds=0;
+    m_programId=0;
+    m_programState=PROG_STATE_EMPTY;
+    m_programActive=false;
+    m_arbStreamer=new ArbWaveformStreamer(this);
+    m_arbActive=false;
+    m_arbPriming=false;
+    m_hasTick=false;
+    m_lastTick=0;
+    m_avgTickDelta=0.0;
     m_timer=new QTimer(this);
     m_timer->setInterval(1000);
     connect(m_timer, &QTimer::timeout, this, &TreatmentService::onTimerTick);
-    connect(m_backend, &IBackend::statusDataReceived,this,&TreatmentService::handleStatusPacket);
-    connect(m_backend,&IBackend::waveDataReceived,this,&TreatmentService::handleWaveformPacket);
+    // 波形缓冲复用：接收方不要持有副本，否则下一包写入时会重新分配
+    m_waveBuffer.resize(WAVEFORM_BATCH_SIZE);
+
+    // 上行包不走排队信号 (每包一次 new)：后端线程上直连拷进预分配槽位，本线程被 eventfd 唤醒后取出处理；
+    // 后端和服务在同一线程时 (基准、单线程工具) 直接处理
+    m_uplink = new UplinkPipe(this);
+    m_trigger = new TriggerEngine(this);
+    // 开机即空闲：采集降到心跳
+    m_power = new PowerPolicy(m_backend, this);
+    m_power->setActive(false);
+    connect(m_uplink, &UplinkPipe::waveformReady, this, &TreatmentService::handleWaveformPacket);
+    connect(m_uplink, &UplinkPipe::statusReady, this, &TreatmentService::handleStatusPacket);
+    connect(m_uplink, &UplinkPipe::programStatusReady, this, &TreatmentService::handleProgramStatus);
+    connect(m_backend, &IBackend::statusDataReceived, this, [this](const StatusPacket &packet) {
+        if (QThread::currentThread() == thread()) handleStatusPacket(packet);
+        else m_uplink->push(packet);
+    }, Qt::DirectConnection);
+    connect(m_backend, &IBackend::waveDataReceived, this, [this](const WaveformPacket &packet) {
+        if (QThread::currentThread() == thread()) handleWaveformPacket(packet);
+        else m_uplink->push(packet);
+    }, Qt::DirectConnection);
+    connect(m_backend, &IBackend::programStatusReceived, this, [this](const ProgramStatusPacket &packet) {
+        if (QThread::currentThread() == thread()) handleProgramStatus(packet);
+        else m_uplink->push(packet);
+    }, Qt::DirectConnection);
+    // 完成回报在后端线程上发出，自动排队到本线程 (每条命令一次，不在上行热路径上)
+    connect(m_backend, &IBackend::commandFinished, this, &TreatmentService::handleCommandResult);
 }
 
 /**
@@ -38,6 +85,10 @@ void TreatmentService:: startTreatment(int duration)
         return;
     }
     m_remaining_seconds = duration;
+    // 先恢复全速采集：节拍命令排在启动命令前面执行
+    m_power->setActive(true);
+    m_recorder.begin(ESES_MODE_STIM, m_currentParam, duration);
+    LatencyTracer::instance().commandIssued(CMD_START);
     m_backend->startStimulation(m_currentParam);
     m_timer->start();
     // 状态机改变并通知controller
@@ -50,6 +101,19 @@ void TreatmentService:: startTreatment(int duration)
  * @brief 2.停止治疗
  */
 void TreatmentService::stopTreatment()
+{
+    finishTreatment(true);
+}
+
+/**
+ * @brief 旋钮单击停止：快速通道已经在后端线程上下发过停止命令，这里只收尾，不再发第二次
+ */
+void TreatmentService::applyKnobStop()
+{
+    finishTreatment(false);
+}
+
+void TreatmentService::finishTreatment(bool sendStop, const StatusPacket *fault)
 {
     if (m_state!=Runstate::Running){
         return;
@@ -58,12 +122,37 @@ void TreatmentService::stopTreatment()
     if (m_timer->isActive()) {
         m_timer->stop();
     }
-    m_backend->stopStimulation();
+    // 先清标志：中止命令会让 M0 回报程序中止，避免重入
+    const bool program = m_programActive;
+    m_programActive = false;
+    if (m_arbActive) {
+        // 先让后端退出任意波形模式，再停生成线程
+        m_arbActive = false;
+        m_arbPriming = false;
+        m_backend->stopArbitrary();
+        m_arbStreamer->stop();
+        qDebug() << "[ARB] stopped, host underruns:" << m_arbStreamer->underruns();
+    }
+    if (sendStop) {
+        // 程序在 M0 上自己执行，要用 CMD_PROG_ABORT 中止 (输出立即关闭，程序状态转 ERROR)
+        if (program) {
+            LatencyTracer::instance().commandIssued(CMD_PROG_ABORT);
+            m_backend->abortProgram();
+        } else {
+            LatencyTracer::instance().commandIssued(CMD_STOP);
+            m_backend->stopStimulation();
+        }
+    }
+    m_power->setActive(false);
+    if (fault) m_recorder.record(*fault);
+    m_recorder.end();
     // 状态机改变并通知controller
     m_state=Runstate::Idle;
     emit stateChanged(Runstate::Idle);
     m_remaining_seconds = 0; // 停止时时间归零
     emit timeUpdated(0);
+    // 急停也走这里：完整的延迟报告只在调试级别打印，平时按需取 (无界面守护进程的 latency 命令)
+    if (BinLog::enabled(BinLog::Debug)) qDebug().noquote() << LatencyTracer::instance().formatReport();
 }
 
 /**
@@ -72,11 +161,26 @@ void TreatmentService::stopTreatment()
  */
 void TreatmentService::updateParameters(const StimulationParam &param)
 {
+    TRACE_SCOPE("updateParameters");
     m_currentParam = param;
     // 运行时更新参数
     if (m_state == Runstate::Running){
+       LatencyTracer::instance().commandIssued(CMD_UPDATE);
        m_backend->updateParameters(m_currentParam);
+       m_recorder.recordParam(m_currentParam);
     }
+    emit parametersChanged(m_currentParam);
+}
+
+/**
+ * @brief 同步旋钮调节后的参数
+ * @note  旋钮在后端线程上已经下发，这里只更新缓存并通知界面
+ */
+void TreatmentService::applyKnobParameters(const StimulationParam &param)
+{
+    m_currentParam = param;
+    m_recorder.recordParam(m_currentParam);
+    emit parametersAdjusted(m_currentParam);
 }
 
 /**
@@ -89,35 +193,243 @@ void TreatmentService::setPIDParameters(const PIDParam &pid)
 }
 
 /**
- * @brief 5.处理波形包
+ * @brief 5.定义刺激程序
+ * @note  只做缓存，治疗进行中不允许替换程序
+ */
+bool TreatmentService::defineProgram(const StimulationProgram &program)
+{
+    if (m_state == Runstate::Running) {
+        qDebug() << "Cannot redefine program while treatment is running!";
+        return false;
+    }
+    if (program.isEmpty()) {
+        qDebug() << "Program is empty!";
+        return false;
+    }
+    m_program = program;
+    m_programState = PROG_STATE_EMPTY;
+    emit programStateChanged(m_programState);
+    return true;
+}
+
+/**
+ * @brief 6.下载刺激程序
+ * @note  一次性分块发送，结果由 M0 的 HEAD_PROG_STATUS 包异步回报
+ */
+bool TreatmentService::uploadProgram()
+{
+    if (m_program.isEmpty() || m_state == Runstate::Running) {
+        return false;
+    }
+    // 每次下载使用新编号，避免 M0 把新旧分块拼在一起
+    m_programId = (uint8_t)(m_programId + 1);
+    if (m_programId == 0) m_programId = 1;
+
+    m_programState = PROG_STATE_LOADING;
+    emit programStateChanged(m_programState);
+    m_backend->uploadProgram(m_program.encodeChunks(m_programId));
+    return true;
+}
+
+/**
+ * @brief 7.启动刺激程序
+ * @note  必须等 M0 回报 READY，倒计时按程序总时长计算
+ */
+bool TreatmentService::startProgram()
+{
+    if (m_state == Runstate::Running) {
+        qDebug() << "Treatment is already running!";
+        return false;
+    }
+    if (m_programState != PROG_STATE_READY && m_programState != PROG_STATE_DONE) {
+        qDebug() << "Program is not ready on M0, state:" << m_programState;
+        return false;
+    }
+    m_programActive = true;
+    m_remaining_seconds = (m_program.totalDurationMs() + 999) / 1000;
+    m_power->setActive(true);
+    m_recorder.begin(ESES_MODE_PROGRAM, m_currentParam, m_remaining_seconds);
+    m_backend->startProgram(m_programId);
+    m_timer->start();
+    m_state = Runstate::Running;
+    emit stateChanged(Runstate::Running);
+    emit timeUpdated(m_remaining_seconds);
+    return true;
+}
+
+/**
+ * @brief 中止正在执行的刺激程序
+ * @note  与停止治疗走同一收尾；当前不是程序驱动的治疗时不做任何事
+ */
+bool TreatmentService::abortProgram()
+{
+    if (m_state != Runstate::Running || !m_programActive) {
+        return false;
+    }
+    finishTreatment(true);
+    return true;
+}
+
+/**
+ * @brief 8.启动任意波形
+ * @note  启动是异步的：生成线程和后端进入任意波形模式同时开始，生成线程出第一块之前后端取空不算欠载
+ */
+bool TreatmentService::startArbitraryWaveform(const QVector<float> &table, int sampleRateHz, int duration)
+{
+    if (m_state == Runstate::Running) {
+        qDebug() << "Treatment is already running!";
+        return false;
+    }
+    if (!m_arbStreamer->start(table, sampleRateHz, true)) {
+        return false;
+    }
+    // 不在这里等预填：后端在自己的线程上取块，M0 第一次回报缓冲已满时发 arbitraryReady
+    m_arbActive = true;
+    m_arbPriming = true;
+    m_remaining_seconds = duration;
+    m_power->setActive(true);
+    m_recorder.begin(ESES_MODE_ARB, m_currentParam, duration);
+    m_backend->startArbitrary(m_arbStreamer, sampleRateHz);
+    m_timer->start();
+    m_state = Runstate::Running;
+    emit stateChanged(Runstate::Running);
+    emit timeUpdated(m_remaining_seconds);
+    return true;
+}
+
+/**
+ * @brief 9.处理波形包
  * @param packet 波形数据包
  */
 void TreatmentService::handleWaveformPacket(const WaveformPacket &packet)
 {
-    QList<float> data;
-    data.reserve(WAVEFORM_BATCH_SIZE);
-    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) {
-        data.append(packet.adc_batch[i]);
+    TRACE_SCOPE("handleWaveformPacket");
+    const qint64 t0 = LatencyTracer::nowNs();
+    LatencyTracer::instance().serviceHandled(packet.tick_us, t0);
+    trackTickGap(packet.tick_us);
+    m_recorder.record(packet);
+    // 写进复用的缓冲，不按包分配
+    float *dst = m_waveBuffer.data();
+    memcpy(dst, packet.adc_batch, sizeof(packet.adc_batch));
+    // 触发扫描在全速流上做，没有触发时只有一次块内 min/max
+    if (m_trigger->isActive()) m_trigger->process(packet.adc_batch, WAVEFORM_BATCH_SIZE);
+    // 任意波形启动后，M0 交齐一整个缓冲且回报里缓冲非空，即预填完成
+    if (m_arbPriming && packet.arb_credits < ARB_BUFFER_BLOCKS &&
+        m_arbStreamer->consumedBlocks() >= (quint64)ARB_BUFFER_BLOCKS) {
+        m_arbPriming = false;
+        emit arbitraryReady();
     }
+    // 空闲时波形没有变化就不往上送，界面也就不重画
+    const bool deliver = m_power->passWaveform(packet.adc_batch, WAVEFORM_BATCH_SIZE);
+    s_waveHandle.observe(LatencyTracer::nowNs() - t0);
+    s_waveHandled.inc();
     // 转发给 UI
-    emit waveformReceived(data);
+    if (deliver) emit waveformReceived(m_waveBuffer);
 } 
 
 /**
- * @brief 6.处理状态包
+ * @brief 按 M0 时间戳间隔估计丢帧
+ * @note  间隔明显大于平均间隔时，按倍数计入丢失的批次
+ */
+void TreatmentService::trackTickGap(uint32_t tickUs)
+{
+    if (m_hasTick) {
+        const double delta = (double)(uint32_t)(tickUs - m_lastTick);
+        if (m_avgTickDelta > 0.0 && delta > 1.5 * m_avgTickDelta) {
+            s_droppedFrames.inc((quint64)qRound(delta / m_avgTickDelta) - 1);
+        } else {
+            m_avgTickDelta = (m_avgTickDelta > 0.0) ? (0.9 * m_avgTickDelta + 0.1 * delta) : delta;
+        }
+    }
+    m_lastTick = tickUs;
+    m_hasTick = true;
+}
+
+/**
+ * @brief 10.处理状态包
  * @param packet 状态数据包
  */
 void TreatmentService::handleStatusPacket(const StatusPacket &packet)
 {
-    if (packet.error_code != 0 && m_state == Runstate::Running) {
-        stopTreatment(); // 触发急停
+    s_statusHandled.inc();
+    const bool fault = packet.error_code != 0 && m_state == Runstate::Running;
+    // 急停时停止命令最先下发，故障包在收尾里补进本次记录；其余状态包照常记录 (只拷进缓冲)
+    if (!fault) m_recorder.record(packet);
+    if (m_arbActive) {
+        TRACE_COUNTER("arb.bufferedBlocks", m_arbStreamer->bufferedBlocks());
+        s_arbBuffered.set(m_arbStreamer->bufferedBlocks());
+        s_arbUnderruns.set((qint64)m_arbStreamer->underruns());
+    }
+    if (fault) {
+        s_emergencyStops.inc();
+        finishTreatment(true, &packet); // 触发急停
+        // 保留故障前的时间线，便于现场分析：这里只拷环，格式化和写文件放到后台核
+        const QString reason = QString("err%1").arg(packet.error_code);
+        TraceRecorder::Snapshot trace = TraceRecorder::instance().snapshot();
+        TaskExecutor::instance().submit([trace, reason](TaskExecutor::Context &) {
+            TraceRecorder::writeChromeJson(trace, QString(), reason);
+        }, TaskExecutor::Background);
+    }
+    // 趋势照常累计；空闲时只在开新桶时通知 (每秒一次)，状态推送按变化合并
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    const TrendStore::Update update = m_trends.addSample(nowMs, packet);
+    if (m_power->mode() == PowerPolicy::Active || update.opened[TrendStore::PerSecond]) {
+        emit trendUpdated(update);
     }
-    emit monitoringDataReady(packet.real_freq, packet.battery_pct, packet.error_code);
+    if (m_power->passStatus(packet, nowMs)) {
+        emit monitoringDataReady(packet.real_freq, packet.battery_pct, packet.error_code);
+    }
+
+}
 
+/**
+ * @brief 11.处理程序进度包
+ * @note  程序执行完毕或被 M0 中止时，结束本次治疗
+ */
+void TreatmentService::handleProgramStatus(const ProgramStatusPacket &packet)
+{
+    if (packet.program_id != m_programId) {
+        return; // 旧程序的残留回报
+    }
+    if (packet.state != m_programState) {
+        m_programState = packet.state;
+        emit programStateChanged(m_programState);
+    }
+    if (!m_programActive) {
+        return;
+    }
+    m_recorder.record(packet);
+    emit programProgress(packet.segment_index, (int)packet.elapsed_ms, m_program.totalDurationMs());
+
+    if (packet.state == PROG_STATE_DONE || packet.state == PROG_STATE_ERROR) {
+        stopTreatment();
+    }
+}
+
+/**
+ * @brief 12.处理命令完成回报
+ * @note  启动类命令下发失败时设备并没有在输出，按停止处理，界面不会停在"治疗中"；
+ *        停止命令失败只能报警
+ */
+void TreatmentService::handleCommandResult(const CommandResult &result)
+{
+    if (result.status == CommandResult::Failed) {
+        if (result.kind == CommandResult::Stop || result.kind == CommandResult::ProgramAbort ||
+            result.kind == CommandResult::ArbStop) {
+            qCritical() << "[Service] stop command" << result.id << "failed to reach the device!";
+        } else {
+            qWarning() << "[Service] command" << result.id << "kind" << (int)result.kind << "failed to reach the device";
+            if (m_state == Runstate::Running && (result.kind == CommandResult::Start ||
+                result.kind == CommandResult::ProgramStart || result.kind == CommandResult::ArbStart)) {
+                stopTreatment();
+            }
+        }
+    }
+    emit commandFinished(result);
 }
 
 /**
- * @brief 7.定时器槽函数
+ * @brief 13.定时器槽函数
  * 每秒调用一次，更新剩余时间
  */
 void TreatmentService::onTimerTick()
@@ -125,8 +437,7 @@ void TreatmentService::onTimerTick()
 
     if (m_remaining_seconds > 0) {
         m_remaining_seconds--; // 倒计时减一
-        LOG_SIM(QString(" remaining_seconds: %1 ")
-                    .arg(m_remaining_seconds)); // 调试输出
+        LOG_DEBUG("TreatmentService", "remaining_seconds: {}", m_remaining_seconds);
         emit timeUpdated(m_remaining_seconds);
     } else {
         stopTreatment(); // 时间为0，停止治疗
@@ -0,0 +1,125 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:40:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:40:06
+ * @FilePath: \ele_sti\src\core\TrendStore.cpp
+ * @Description: 状态趋势存储：固定容量的多分辨率环形缓冲
+ */
+#include "core/TrendStore.h"
+#include "common/Metrics.h"
+
+static MetricCounter s_trendSamples("ele_sti_trend_samples_total", "Status samples folded into the trend store");
+
+// 每秒 1 小时、每 10 秒 6 小时、每分钟 24 小时
+static const qint64 SPAN_MS[TrendStore::LEVEL_COUNT] = { 1000, 10000, 60000 };
+static const int CAPACITY[TrendStore::LEVEL_COUNT] = { 3600, 2160, 1440 };
+
+TrendStore::TrendStore()
+    : m_samples(0)
+{
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        m_rings[level].buckets.resize(CAPACITY[level]);
+    }
+}
+
+qint64 TrendStore::spanMs(Level level)
+{
+    return SPAN_MS[level];
+}
+
+int TrendStore::capacity(Level level)
+{
+    return CAPACITY[level];
+}
+
+void TrendStore::clear()
+{
+    for (Ring &ring : m_rings) {
+        ring.head = 0;
+        ring.size = 0;
+    }
+    m_samples = 0;
+}
+
+TrendStore::Update TrendStore::addSample(qint64 epochMs, const StatusPacket &packet)
+{
+    const float values[SERIES_COUNT] = {
+        (float)packet.impedance,
+        (float)packet.battery_pct,
+        (float)packet.real_freq,
+        (float)packet.error_code
+    };
+    return addSample(epochMs, values);
+}
+
+/**
+ * @brief 1.累计一个样本
+ * @note  时间落在当前桶之后就开新桶 (中间缺的桶不补，图上按时间戳留空)；
+ *        时钟回拨时仍并入当前桶
+ */
+TrendStore::Update TrendStore::addSample(qint64 epochMs, const float values[SERIES_COUNT])
+{
+    Update update = {};
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        Ring &ring = m_rings[level];
+        const int cap = (int)ring.buckets.size();
+        const qint64 start = epochMs - epochMs % SPAN_MS[level];
+
+        Bucket *bucket = nullptr;
+        if (ring.size > 0) {
+            bucket = &ring.buckets[(ring.head + ring.size - 1) % cap];
+            if (start > bucket->startMs) bucket = nullptr;
+        }
+        if (!bucket) {
+            if (ring.size == cap) {
+                ring.head = (ring.head + 1) % cap;
+                update.evicted[level] = true;
+            } else {
+                ring.size++;
+            }
+            update.opened[level] = true;
+            bucket = &ring.buckets[(ring.head + ring.size - 1) % cap];
+            bucket->startMs = start;
+            bucket->count = 0;
+        }
+
+        if (bucket->count == 0) {
+            for (int s = 0; s < SERIES_COUNT; s++) {
+                bucket->series[s].min = values[s];
+                bucket->series[s].max = values[s];
+                bucket->series[s].sum = values[s];
+            }
+        } else {
+            for (int s = 0; s < SERIES_COUNT; s++) {
+                Accum &acc = bucket->series[s];
+                if (values[s] < acc.min) acc.min = values[s];
+                if (values[s] > acc.max) acc.max = values[s];
+                acc.sum += values[s];
+            }
+        }
+        bucket->count++;
+    }
+    m_samples++;
+    s_trendSamples.inc();
+    return update;
+}
+
+const TrendStore::Bucket &TrendStore::at(Level level, int row) const
+{
+    const Ring &ring = m_rings[level];
+    return ring.buckets[(ring.head + row) % (int)ring.buckets.size()];
+}
+
+double TrendStore::value(Level level, int row, Series series, Stat stat) const
+{
+    if (row < 0 || row >= size(level)) return 0.0;
+    const Bucket &bucket = at(level, row);
+    const Accum &acc = bucket.series[series];
+    switch (stat) {
+    case Min: return acc.min;
+    case Max: return acc.max;
+    case Mean: return bucket.count > 0 ? acc.sum / bucket.count : 0.0;
+    }
+    return 0.0;
+}
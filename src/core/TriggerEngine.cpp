@@ -0,0 +1,220 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:05:44
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:05:44
+ * @FilePath: \ele_sti\src\core\TriggerEngine.cpp
+ * @Description: 示波器式触发采集
+ */
+#include "core/TriggerEngine.h"
+#include "common/Metrics.h"
+#include <algorithm>
+#include <cstring>
+
+static MetricCounter s_captures("ele_sti_trigger_captures_total", "Windows captured by the trigger engine");
+static MetricCounter s_forced("ele_sti_trigger_forced_total", "Auto-mode captures forced by timeout");
+static MetricCounter s_scanned("ele_sti_trigger_blocks_scanned_total", "Blocks that needed a per-sample trigger scan");
+
+TriggerEngine::TriggerEngine(QObject *parent)
+    : QObject(parent), m_state(State::Idle), m_ready(false),
+      m_historyHead(0), m_historyFill(0), m_triggerIndex(0), m_collected(0), m_forced(false), m_sinceArm(0),
+      m_captures(0), m_scannedBlocks(0), m_skippedBlocks(0)
+{
+    m_history.resize(MAX_DEPTH);
+    m_capture.reserve(MAX_DEPTH * 2);
+}
+
+void TriggerEngine::setConfig(const Config &config)
+{
+    m_config = config;
+    m_config.preSamples = qBound(0, config.preSamples, MAX_DEPTH);
+    m_config.postSamples = qBound(1, config.postSamples, MAX_DEPTH);
+    m_config.hysteresis = qMax(0.0f, config.hysteresis);
+    if (m_config.low > m_config.high) std::swap(m_config.low, m_config.high);
+    arm();
+}
+
+void TriggerEngine::arm()
+{
+    m_state = m_config.mode == Off ? State::Idle : State::Armed;
+    m_ready = false;
+    m_collected = 0;
+    m_sinceArm = 0;
+    // 停过之后的旧历史和新数据不连续，不拼进预触发段
+    m_historyFill = 0;
+}
+
+/**
+ * @brief 1.块内 min/max
+ * @note  分 LANES 路各自累计再合并，去掉了逐点的循环依赖，GCC/Clang 在 -O2 下会生成
+ *        minps/maxps (x86) 或 fmin/fmax (NEON)；直接写成单个累计变量则不会向量化
+ */
+void TriggerEngine::blockMinMax(const float *samples, int count, float &minOut, float &maxOut)
+{
+    if (count <= 0) {
+        minOut = maxOut = 0.0f;
+        return;
+    }
+    float lo[LANES];
+    float hi[LANES];
+    for (int k = 0; k < LANES; k++) {
+        lo[k] = samples[0];
+        hi[k] = samples[0];
+    }
+    int i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        for (int k = 0; k < LANES; k++) {
+            const float v = samples[i + k];
+            lo[k] = v < lo[k] ? v : lo[k];
+            hi[k] = v > hi[k] ? v : hi[k];
+        }
+    }
+    for (; i < count; i++) {
+        const float v = samples[i];
+        lo[0] = v < lo[0] ? v : lo[0];
+        hi[0] = v > hi[0] ? v : hi[0];
+    }
+    float mn = lo[0];
+    float mx = hi[0];
+    for (int k = 1; k < LANES; k++) {
+        mn = lo[k] < mn ? lo[k] : mn;
+        mx = hi[k] > mx ? hi[k] : mx;
+    }
+    minOut = mn;
+    maxOut = mx;
+}
+
+/**
+ * @brief 2.找触发点
+ * @return 触发点在本块中的下标，没有返回 -1
+ * @note  先用 min/max 判断本块能不能改变迟滞状态或触发，不能就整块跳过
+ */
+int TriggerEngine::scan(const float *samples, int count)
+{
+    const float level = m_config.level;
+    const float hyst = m_config.hysteresis;
+    const float low = m_config.low;
+    const float high = m_config.high;
+
+    float mn, mx;
+    blockMinMax(samples, count, mn, mx);
+    bool skip = false;
+    switch (m_config.type) {
+    case Rising:
+        skip = m_ready ? mx < level : mn >= level - hyst;
+        break;
+    case Falling:
+        skip = m_ready ? mn > level : mx <= level + hyst;
+        break;
+    case Window:
+        skip = m_ready ? (mn >= low && mx <= high) : (mx < low + hyst || mn > high - hyst);
+        break;
+    }
+    if (skip) {
+        m_skippedBlocks++;
+        return -1;
+    }
+    m_scannedBlocks++;
+    s_scanned.inc();
+
+    for (int i = 0; i < count; i++) {
+        const float x = samples[i];
+        switch (m_config.type) {
+        case Rising:
+            if (!m_ready) m_ready = x < level - hyst;
+            else if (x >= level) return i;
+            break;
+        case Falling:
+            if (!m_ready) m_ready = x > level + hyst;
+            else if (x <= level) return i;
+            break;
+        case Window:
+            if (!m_ready) m_ready = x >= low + hyst && x <= high - hyst;
+            else if (x < low || x > high) return i;
+            break;
+        }
+    }
+    return -1;
+}
+
+void TriggerEngine::pushHistory(const float *samples, int count)
+{
+    // 只需要最近 MAX_DEPTH 个
+    if (count > MAX_DEPTH) {
+        samples += count - MAX_DEPTH;
+        count = MAX_DEPTH;
+    }
+    const int first = qMin(count, MAX_DEPTH - m_historyHead);
+    memcpy(m_history.data() + m_historyHead, samples, first * sizeof(float));
+    memcpy(m_history.data(), samples + first, (count - first) * sizeof(float));
+    m_historyHead = (m_historyHead + count) % MAX_DEPTH;
+    m_historyFill = qMin(MAX_DEPTH, m_historyFill + count);
+}
+
+/**
+ * @brief 3.触发：拼上预触发段
+ * @note  刚装填、历史还不够深时，预触发段按已有的长度截短
+ */
+void TriggerEngine::beginCapture(bool forced)
+{
+    const int pre = qMin(m_config.preSamples, m_historyFill);
+    m_capture.resize(pre + m_config.postSamples);
+    float *dst = m_capture.data();
+    int start = m_historyHead - pre;
+    if (start < 0) start += MAX_DEPTH;
+    const int first = qMin(pre, MAX_DEPTH - start);
+    memcpy(dst, m_history.data() + start, first * sizeof(float));
+    memcpy(dst + first, m_history.data(), (pre - first) * sizeof(float));
+
+    m_triggerIndex = pre;
+    m_collected = 0;
+    m_forced = forced;
+    m_state = State::Collecting;
+}
+
+void TriggerEngine::finishCapture()
+{
+    m_captures++;
+    s_captures.inc();
+    if (m_forced) s_forced.inc();
+    // 先改状态再发信号，接收方在槽里 arm()/setConfig() 也不会被覆盖
+    m_state = m_config.mode == Single ? State::Idle : State::Armed;
+    m_ready = false;
+    m_sinceArm = 0;
+    emit captured(m_capture, m_triggerIndex, m_forced);
+}
+
+/**
+ * @brief 4.喂数据
+ * @note  后触发段照样写进历史，下一帧的预触发段是连续的
+ */
+void TriggerEngine::process(const float *samples, int count)
+{
+    int i = 0;
+    while (i < count && m_state != State::Idle) {
+        if (m_state == State::Collecting) {
+            const int take = qMin(count - i, m_config.postSamples - m_collected);
+            memcpy(m_capture.data() + m_triggerIndex + m_collected, samples + i, take * sizeof(float));
+            pushHistory(samples + i, take);
+            m_collected += take;
+            i += take;
+            if (m_collected == m_config.postSamples) finishCapture();
+            continue;
+        }
+
+        const int hit = scan(samples + i, count - i);
+        if (hit >= 0) {
+            pushHistory(samples + i, hit);
+            i += hit;
+            beginCapture(false);
+            continue;
+        }
+        pushHistory(samples + i, count - i);
+        m_sinceArm += count - i;
+        i = count;
+        // Auto：两帧长度内没有触发就强制采一帧，界面不会停在旧画面
+        if (m_config.mode == Auto && m_sinceArm >= 2 * (qint64)(m_config.preSamples + m_config.postSamples)) {
+            beginCapture(true);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 21:30:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 21:30:06
+ * @FilePath: \ele_sti\src\core\UplinkPipe.cpp
+ * @Description: 上行包跨线程交接
+ */
+#include "core/UplinkPipe.h"
+#include "common/Metrics.h"
+#include <QDebug>
+#include <QSocketNotifier>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+static MetricCounter s_pipeDropped("ele_sti_uplink_pipe_dropped_total", "Uplink packets dropped because the service fell behind");
+static MetricCounter s_pipeWakeups("ele_sti_uplink_pipe_wakeups_total", "Times the service thread was woken to drain uplink packets");
+
+UplinkPipe::UplinkPipe(QObject *parent)
+    : QObject(parent), m_armed(false), m_hasFault(false), m_dropped(0),
+      m_eventFd(-1), m_notifier(nullptr)
+{
+    memset(&m_fault, 0, sizeof(m_fault));
+#ifdef Q_OS_LINUX
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd >= 0) {
+        m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, [this]() {
+            uint64_t value = 0;
+            ssize_t n = ::read(m_eventFd, &value, sizeof(value));
+            Q_UNUSED(n);
+            drain();
+        });
+    } else {
+        qWarning() << "[UplinkPipe] eventfd failed, falling back to queued calls";
+    }
+#endif
+}
+
+UplinkPipe::~UplinkPipe()
+{
+#ifdef Q_OS_LINUX
+    if (m_eventFd >= 0) {
+        delete m_notifier;
+        ::close(m_eventFd);
+    }
+#endif
+}
+
+void UplinkPipe::push(const WaveformPacket &packet)
+{
+    Record record;
+    record.kind = KindWave;
+    record.wave = packet;
+    enqueue(record);
+}
+
+void UplinkPipe::push(const StatusPacket &packet)
+{
+    Record record;
+    record.kind = KindStatus;
+    record.status = packet;
+    enqueue(record);
+}
+
+void UplinkPipe::push(const ProgramStatusPacket &packet)
+{
+    Record record;
+    record.kind = KindProgramStatus;
+    record.program = packet;
+    enqueue(record);
+}
+
+void UplinkPipe::enqueue(const Record &record)
+{
+    {
+        QMutexLocker locker(&m_pushMutex);
+        if (!m_ring.push(record)) {
+            if (record.kind == KindStatus && record.status.error_code != 0) {
+                // 故障不能丢：只保留最新一个，消费端最先处理
+                m_fault = record.status;
+                m_hasFault.store(true, std::memory_order_release);
+            } else {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                s_pipeDropped.inc();
+            }
+        }
+    }
+    wake();
+}
+
+/**
+ * @brief 消费端空闲时才真正唤醒，忙的时候新包顺带在同一轮里取走
+ */
+void UplinkPipe::wake()
+{
+    if (m_armed.exchange(true, std::memory_order_acq_rel)) return;
+#ifdef Q_OS_LINUX
+    if (m_eventFd >= 0) {
+        const uint64_t one = 1;
+        ssize_t n = ::write(m_eventFd, &one, sizeof(one));
+        Q_UNUSED(n);
+        return;
+    }
+#endif
+    QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief 消费端：先清唤醒标志再取，取的过程中新来的包会重新唤醒，不会漏
+ * @note  一轮最多取当前已有的包数，生产端持续灌包时也能回到事件循环
+ */
+void UplinkPipe::drain()
+{
+    s_pipeWakeups.inc();
+    m_armed.store(false, std::memory_order_release);
+
+    if (m_hasFault.exchange(false, std::memory_order_acq_rel)) {
+        StatusPacket fault;
+        {
+            QMutexLocker locker(&m_pushMutex);
+            fault = m_fault;
+        }
+        emit statusReady(fault);
+    }
+
+    Record record;
+    size_t budget = m_ring.size();
+    while (budget-- > 0 && m_ring.pop(record)) {
+        switch (record.kind) {
+        case KindWave:
+            emit waveformReady(record.wave);
+            break;
+        case KindStatus:
+            emit statusReady(record.status);
+            break;
+        case KindProgramStatus:
+            emit programStatusReady(record.program);
+            break;
+        }
+    }
+    // 本轮没取完的留给下一轮
+    if (!m_ring.empty()) wake();
+}
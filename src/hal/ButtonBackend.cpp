@@ -1,7 +1,22 @@
 #include "hal/ButtonBackend.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include <QDebug>
+#ifdef Q_OS_LINUX
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+static MetricCounter s_frames("ele_sti_button_frames_total", "Valid frames received from the panel serial link");
+static MetricCounter s_resyncs("ele_sti_button_resyncs_total", "Times the panel serial framer lost and regained frame sync");
+static MetricCounter s_badFrames("ele_sti_button_bad_frames_total", "Panel frames with a bad tail or checksum");
+static MetricCounter s_droppedBytes("ele_sti_button_dropped_bytes_total", "Bytes skipped while resynchronising the panel serial link");
 
 ButtonBackend::ButtonBackend(QObject *parent):QObject(parent)
 {
+    m_rxNs=0;
+    m_knobValid=false;
+    m_lastKnobVal=0;
     serial=new QSerialPort(this);
     connect(serial, &QSerialPort::readyRead, this, &ButtonBackend::onReadyRead);
 }
@@ -17,47 +32,77 @@ bool ButtonBackend::openSerial(const QString &portName)
 
     serial->setPortName(portName);
     serial->setBaudRate(115200);
+    serial->setDataBits(QSerialPort::Data8);
+    serial->setParity(QSerialPort::NoParity);
+    serial->setStopBits(QSerialPort::OneStop);
+    serial->setFlowControl(QSerialPort::NoFlowControl);
     if (serial->open(QIODevice::ReadWrite)){
+        setLowLatency();
         return true;
     }
     else
         return false;
 }
 
-void ButtonBackend::onReadyRead()
+/**
+ * @brief 打开驱动的低延迟模式
+ * @note  USB 转串口 (FTDI/CH340 等) 默认攒满 16ms 才上报一次，
+ *        ASYNC_LOW_LATENCY 让驱动收到就上报；驱动不支持时忽略
+ */
+void ButtonBackend::setLowLatency()
 {
-    buffer.append(serial->readAll());
-    if (buffer.size() > MAX_BUFFER_SIZE) {
-        buffer.clear();
-        return;
-    }
-    while (buffer.size()>=sizeof(ButtonPacket)){
-        if ((uint8_t)buffer.at(0)!= FRAME_HEAD){
-            int headIndex = buffer.indexOf((char)FRAME_HEAD);
-            if (headIndex == -1){
-                buffer.clear();
-                return;
-            }
-            else{
-                buffer.remove(0,headIndex);
-                if (buffer.size()<sizeof(ButtonPacket)){
-                    return;
-                }
-            }
+#ifdef Q_OS_LINUX
+    const int fd = (int)serial->handle();
+    struct serial_struct ss;
+    if (fd >= 0 && ioctl(fd, TIOCGSERIAL, &ss) == 0) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &ss) != 0) {
+            qDebug() << "ButtonSerial: low latency mode not supported";
         }
+    }
+#endif
+}
 
-        const ButtonPacket *packet = reinterpret_cast<const ButtonPacket*>(buffer.constData());
-        if (packet->tail==FRAME_TAIL){
+void ButtonBackend::onReadyRead()
+{
+    processBytes(serial->readAll());
+}
 
-            if (packet->cmd == 0xBB){
-                emit startFromSerial();
-                // 业务逻辑
-            }
-            buffer.remove(0,sizeof(ButtonPacket));
-        }
-        else{
-            // 帧头对，帧尾不对，就删掉当前的帧头，继续找下一个帧头
-            buffer.remove(0,1);
+void ButtonBackend::processBytes(const QByteArray &data)
+{
+    m_rxNs = LatencyTracer::nowNs();
+    m_parser.feed(reinterpret_cast<const uint8_t *>(data.constData()), (size_t)data.size(),
+                  [this](const ButtonPacket &packet) { handleFrame(packet); });
+
+    // 计数增量同步到运行指标
+    const FrameParser<ButtonFramePolicy>::Counters &c = m_parser.counters();
+    s_frames.inc(c.frames - m_reported.frames);
+    s_resyncs.inc(c.resyncs - m_reported.resyncs);
+    s_badFrames.inc(c.badFrames - m_reported.badFrames);
+    s_droppedBytes.inc(c.droppedBytes - m_reported.droppedBytes);
+    m_reported = c;
+}
+
+void ButtonBackend::handleFrame(const ButtonPacket &packet)
+{
+    switch (packet.cmd) {
+    case BTN_CMD_START:
+        emit startFromSerial();
+        break;
+    case BTN_CMD_KNOB: {
+        // 编码器计数 8 位回绕，按有符号差值算转过的格数
+        const int detents = m_knobValid ? (int)(int8_t)(uint8_t)(packet.value - (uint8_t)m_lastKnobVal) : 0;
+        m_lastKnobVal = packet.value;
+        m_knobValid = true;
+        if (detents != 0) {
+            emit knobRotated(detents, m_rxNs);
         }
+        break;
+    }
+    case BTN_CMD_CLICK:
+        emit sigSingleClickStop(m_rxNs);
+        break;
+    default:
+        break;
     }
 }
@@ -0,0 +1,213 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 23:20:14
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 23:20:14
+ * @FilePath: \ele_sti\src\hal\CommandQueue.cpp
+ * @Description: 采集线程上的下行命令队列
+ */
+#include "hal/CommandQueue.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QVector>
+
+static MetricCounter s_executed("ele_sti_command_executed_total", "Downlink commands executed on an acquisition thread");
+static MetricCounter s_failed("ele_sti_command_failed_total", "Downlink commands whose transfer failed");
+static MetricCounter s_superseded("ele_sti_command_superseded_total", "Queued parameter/PID commands merged into a newer one");
+static MetricCounter s_cancelled("ele_sti_command_cancelled_total", "Queued commands cancelled by a stop");
+static MetricGauge s_depth("ele_sti_command_queue_depth", "Commands waiting in the most recently touched queue");
+static MetricHistogram s_queueTime("ele_sti_command_queue_seconds", "Time a command waited before it started executing");
+static MetricHistogram s_execTime("ele_sti_command_exec_seconds", "Time spent executing one command on the acquisition thread");
+
+// 唤醒事件：普通命令按普通优先级投递，停止类用高优先级插队
+static const QEvent::Type WAKE_EVENT = QEvent::Type(QEvent::User + 44);
+
+CommandQueue::CommandQueue(QObject *parent)
+    : QObject(parent), m_pending(0), m_wakePosted(false), m_urgentPosted(false), m_draining(false)
+{
+}
+
+CommandQueue::~CommandQueue()
+{
+    // 线程退出时还没执行的命令按取消回报，调用方不会一直等
+    QVector<Command> left;
+    {
+        QMutexLocker locker(&m_lock);
+        for (std::deque<Command> &q : m_queues) {
+            for (Command &cmd : q) left.append(std::move(cmd));
+            q.clear();
+        }
+        m_pending = 0;
+    }
+    const qint64 now = LatencyTracer::nowNs();
+    for (const Command &cmd : left) finish(cmd, CommandResult::Cancelled, 0, now - cmd.submitNs, 0);
+}
+
+CommandQueue::Priority CommandQueue::priorityOf(CommandResult::Kind kind)
+{
+    switch (kind) {
+    case CommandResult::Stop:
+    case CommandResult::ProgramAbort:
+    case CommandResult::ArbStop:
+        return Emergency;
+    case CommandResult::Update:
+        return Update;
+    default:
+        return Control;
+    }
+}
+
+bool CommandQueue::isMergeable(CommandResult::Kind kind)
+{
+    return kind == CommandResult::Update || kind == CommandResult::Pid || kind == CommandResult::Acquisition;
+}
+
+bool CommandQueue::isEnergising(CommandResult::Kind kind)
+{
+    return kind == CommandResult::Start || kind == CommandResult::Update ||
+           kind == CommandResult::ProgramStart || kind == CommandResult::ArbStart;
+}
+
+/**
+ * @brief 1.提交
+ * @note  锁内只做入队/合并/取消；被合并和被取消的命令在锁外回报
+ */
+void CommandQueue::submit(quint64 id, CommandResult::Kind kind, int mergeKey, Task task, Completion done)
+{
+    const qint64 now = LatencyTracer::nowNs();
+    const Priority priority = priorityOf(kind);
+    const bool sameThread = QThread::currentThread() == thread();
+    QVector<Command> dropped;
+    CommandResult::Status droppedStatus = CommandResult::Superseded;
+    bool post = false;
+    {
+        QMutexLocker locker(&m_lock);
+        if (priority == Emergency) {
+            // 停止抢占：排队中会输出电流的命令全部取消
+            droppedStatus = CommandResult::Cancelled;
+            for (std::deque<Command> &q : m_queues) {
+                for (auto it = q.begin(); it != q.end();) {
+                    if (isEnergising(it->kind)) {
+                        dropped.append(std::move(*it));
+                        it = q.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        } else if (isMergeable(kind)) {
+            std::deque<Command> &q = m_queues[priority];
+            for (auto it = q.begin(); it != q.end(); ++it) {
+                if (it->kind == kind && it->mergeKey == mergeKey) {
+                    dropped.append(std::move(*it));
+                    q.erase(it);
+                    break;
+                }
+            }
+        }
+        m_queues[priority].push_back(Command{ id, kind, mergeKey, now, std::move(task), std::move(done) });
+        m_pending = m_pending - (int)dropped.size() + 1;
+        s_depth.set(m_pending);
+
+        if (!sameThread) {
+            if (priority == Emergency && !m_urgentPosted) {
+                m_urgentPosted = true;
+                post = true;
+            } else if (!m_wakePosted) {
+                m_wakePosted = true;
+                post = true;
+            }
+        }
+    }
+    for (const Command &cmd : dropped) {
+        finish(cmd, droppedStatus, 0, now - cmd.submitNs, 0);
+    }
+
+    if (sameThread) {
+        drain();
+    } else if (post) {
+        QCoreApplication::postEvent(this, new QEvent(WAKE_EVENT),
+                                    priority == Emergency ? Qt::HighEventPriority : Qt::NormalEventPriority);
+    }
+}
+
+int CommandQueue::pending() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_pending;
+}
+
+bool CommandQueue::event(QEvent *e)
+{
+    if (e->type() == WAKE_EVENT) {
+        {
+            QMutexLocker locker(&m_lock);
+            m_wakePosted = false;
+            m_urgentPosted = false;
+        }
+        drain();
+        return true;
+    }
+    return QObject::event(e);
+}
+
+/**
+ * @brief 2.执行
+ * @note  每执行完一条都重新从最高优先级取，执行过程中到达的停止命令排在下一条
+ */
+void CommandQueue::drain()
+{
+    if (m_draining) return; // 命令执行中同线程又提交：外层循环会取到
+    m_draining = true;
+    for (;;) {
+        Command cmd;
+        {
+            QMutexLocker locker(&m_lock);
+            int p = 0;
+            while (p < PRIORITY_COUNT && m_queues[p].empty()) p++;
+            if (p == PRIORITY_COUNT) break;
+            cmd = std::move(m_queues[p].front());
+            m_queues[p].pop_front();
+            m_pending--;
+            s_depth.set(m_pending);
+        }
+        TRACE_SCOPE("command.exec");
+        const qint64 start = LatencyTracer::nowNs();
+        int channels = 0;
+        const bool ok = cmd.task(channels);
+        const qint64 end = LatencyTracer::nowNs();
+        finish(cmd, ok ? CommandResult::Done : CommandResult::Failed, channels, start - cmd.submitNs, end - start);
+    }
+    m_draining = false;
+}
+
+void CommandQueue::finish(const Command &cmd, CommandResult::Status status, int channels, qint64 queueNs, qint64 execNs)
+{
+    switch (status) {
+    case CommandResult::Done:
+    case CommandResult::Failed:
+        s_executed.inc();
+        if (status == CommandResult::Failed) s_failed.inc();
+        s_queueTime.observe(queueNs);
+        s_execTime.observe(execNs);
+        break;
+    case CommandResult::Superseded:
+        s_superseded.inc();
+        break;
+    case CommandResult::Cancelled:
+        s_cancelled.inc();
+        break;
+    }
+    if (!cmd.done) return;
+    CommandResult result;
+    result.id = cmd.id;
+    result.kind = cmd.kind;
+    result.status = status;
+    result.channels = channels;
+    result.queueNs = queueNs;
+    result.execNs = execNs;
+    cmd.done(result);
+}
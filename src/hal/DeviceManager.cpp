@@ -0,0 +1,416 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 20:15:37
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 20:15:37
+ * @FilePath: \ele_sti\src\hal\DeviceManager.cpp
+ * @Description: 多设备/多通道后端管理：线程分配、命令广播、同步启停、上行汇聚
+ */
+#include "hal/DeviceManager.h"
+#include "hal/WinBackend.h"
+#ifdef Q_OS_LINUX
+#include "hal/RK3568Backend.h"
+#endif
+#include "common/CpuPlan.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include <QDebug>
+#include <cstdint>
+
+static MetricGauge s_channels("ele_sti_devices_channels", "Backend channels managed by DeviceManager");
+static MetricGauge s_threads("ele_sti_devices_threads", "Acquisition threads owned by DeviceManager");
+static MetricCounter s_syncTimeouts("ele_sti_devices_sync_timeouts_total", "Synchronised commands where a thread gave up waiting for the others");
+static MetricHistogram s_syncSkew("ele_sti_devices_sync_skew_seconds", "Spread between the first and last thread leaving a synchronised command");
+
+// 同步点：所有参与线程到齐 (或超时) 后同时放行
+struct DeviceManager::SyncPoint {
+    explicit SyncPoint(int n) : remaining(n), done(0), total(n), firstNs(INT64_MAX), lastNs(0) {}
+    std::atomic<int> remaining;
+    std::atomic<int> done;
+    const int total;
+    std::atomic<qint64> firstNs;
+    std::atomic<qint64> lastNs;
+
+    void arriveAndWait()
+    {
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+        const qint64 deadline = LatencyTracer::nowNs() + (qint64)SYNC_TIMEOUT_US * 1000;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (LatencyTracer::nowNs() > deadline) {
+                s_syncTimeouts.inc();
+                break;
+            }
+            QThread::yieldCurrentThread();
+        }
+        const qint64 now = LatencyTracer::nowNs();
+        qint64 v = firstNs.load(std::memory_order_relaxed);
+        while (now < v && !firstNs.compare_exchange_weak(v, now)) {}
+        v = lastNs.load(std::memory_order_relaxed);
+        while (now > v && !lastNs.compare_exchange_weak(v, now)) {}
+        // 最后一个离开的线程记录本次的放行偏差
+        if (done.fetch_add(1) + 1 == total) {
+            s_syncSkew.observe(lastNs.load() - firstNs.load());
+        }
+    }
+};
+
+// 一次调用在各线程上的部分全部结束后合并成一个结果
+struct DeviceManager::PendingCommand {
+    explicit PendingCommand(int parts) : remaining(parts), status(CommandResult::Done), channels(0), queueNs(0), execNs(0) {}
+    std::atomic<int> remaining;
+    std::atomic<int> status;
+    std::atomic<int> channels;
+    std::atomic<qint64> queueNs;
+    std::atomic<qint64> execNs;
+
+    // 返回 true 表示这是最后一部分，out 为合并后的结果
+    bool merge(const CommandResult &part, CommandResult &out)
+    {
+        int st = status.load();
+        while (part.status > st && !status.compare_exchange_weak(st, part.status)) {}
+        channels.fetch_add(part.channels);
+        qint64 v = queueNs.load();
+        while (part.queueNs > v && !queueNs.compare_exchange_weak(v, part.queueNs)) {}
+        v = execNs.load();
+        while (part.execNs > v && !execNs.compare_exchange_weak(v, part.execNs)) {}
+        if (remaining.fetch_sub(1) != 1) return false;
+        out = part;
+        out.status = (CommandResult::Status)status.load();
+        out.channels = channels.load();
+        out.queueNs = queueNs.load();
+        out.execNs = execNs.load();
+        return true;
+    }
+};
+
+DeviceManager::DeviceManager(int maxThreads, QObject *parent)
+    : IBackend(parent), m_maxThreads(maxThreads > 0 ? maxThreads : qMax(1, QThread::idealThreadCount())),
+      m_nextCommandId(0), m_lastCommandId(0), m_initPending(0), m_initFailed(0)
+{
+}
+
+DeviceManager::~DeviceManager()
+{
+    shutdown();
+}
+
+int DeviceManager::addDevice(IBackend *backend, std::function<bool()> init)
+{
+    Q_ASSERT(m_threads.isEmpty());
+    std::unique_ptr<Channel> ch(new Channel);
+    ch->backend = backend;
+    ch->init = std::move(init);
+    m_channels.push_back(std::move(ch));
+    const int index = (int)m_channels.size() - 1;
+    wireChannel(index);
+    return index;
+}
+
+int DeviceManager::addSimulator()
+{
+    WinBackend *backend = new WinBackend();
+    return addDevice(backend, [backend]() { return backend->init(); });
+}
+
+#ifdef Q_OS_LINUX
+int DeviceManager::addSpiDevice(const QString &devicePath)
+{
+    RK3568Backend *backend = new RK3568Backend();
+    return addDevice(backend, [backend, devicePath]() { return backend->init(devicePath); });
+}
+#endif
+
+/**
+ * @brief 1.上行汇聚
+ * @note  直连：在通道线程上计数并转发，接收方按自己所在线程决定是否排队
+ */
+void DeviceManager::wireChannel(int index)
+{
+    Channel *ch = m_channels[index].get();
+    connect(ch->backend, &IBackend::waveDataReceived, this, [this, ch, index](const WaveformPacket &packet) {
+        ch->waves.fetch_add(1, std::memory_order_relaxed);
+        emit channelWaveReceived(index, packet);
+        if (index == PRIMARY_CHANNEL) emit waveDataReceived(packet);
+    }, Qt::DirectConnection);
+    connect(ch->backend, &IBackend::statusDataReceived, this, [this, ch, index](const StatusPacket &packet) {
+        ch->statuses.fetch_add(1, std::memory_order_relaxed);
+        ch->lastError.store(packet.error_code, std::memory_order_relaxed);
+        emit channelStatusReceived(index, packet);
+        // 主通道的状态照常转发；其他通道只转发故障，由服务层统一急停
+        if (index == PRIMARY_CHANNEL || packet.error_code != 0) emit statusDataReceived(packet);
+    }, Qt::DirectConnection);
+    connect(ch->backend, &IBackend::programStatusReceived, this, [this, index](const ProgramStatusPacket &packet) {
+        if (index == PRIMARY_CHANNEL) emit programStatusReceived(packet);
+    }, Qt::DirectConnection);
+    connect(ch->backend, &IBackend::errorOccurred, this, [this, index](QString msg) {
+        emit channelError(index, msg);
+        emit errorOccurred(QString("[ch%1] %2").arg(index).arg(msg));
+    }, Qt::DirectConnection);
+}
+
+/**
+ * @brief 2.建线程并初始化各通道
+ * @note  第一个线程沿用 "acquisition" 的名字，单通道时与原来的线程结构一致
+ */
+void DeviceManager::start()
+{
+    if (!m_threads.isEmpty() || m_channels.empty()) return;
+
+    const int threads = qMin(m_maxThreads, channelCount());
+    for (int i = 0; i < threads; i++) {
+        QThread *thread = new QThread();
+        thread->setObjectName(i == 0 ? QString("acquisition") : QString("acquisition-%1").arg(i));
+        m_threads.append(thread);
+        CommandQueue *queue = new CommandQueue();
+        queue->moveToThread(thread);
+        connect(thread, &QThread::finished, queue, &QObject::deleteLater);
+        m_queues.append(queue);
+    }
+    s_channels.set(channelCount());
+    s_threads.set(threads);
+
+    m_initPending = channelCount();
+    m_initFailed = 0;
+    for (int i = 0; i < channelCount(); i++) {
+        Channel *ch = m_channels[i].get();
+        ch->worker = i % threads;
+        QThread *thread = m_threads[ch->worker];
+        ch->backend->moveToThread(thread);
+        connect(thread, &QThread::finished, ch->backend, &QObject::deleteLater);
+    }
+    for (QThread *thread : m_threads) {
+        thread->start();
+    }
+    for (int i = 0; i < channelCount(); i++) {
+        Channel *ch = m_channels[i].get();
+        QMetaObject::invokeMethod(ch->backend, [this, ch, i]() {
+            if (ch->init && !ch->init()) {
+                qDebug() << "[DeviceManager] channel" << i << "init failed";
+                m_initFailed.fetch_add(1);
+            }
+            if (m_initPending.fetch_sub(1) == 1) {
+                emit initFinished(m_initFailed.load());
+            }
+        });
+    }
+    qDebug() << "[DeviceManager]" << channelCount() << "channel(s) on" << threads << "thread(s)";
+}
+
+/**
+ * @brief 3.采集线程绑核
+ * @note  绑核在线程自己身上执行 (经命令队列对象投递)，一个线程一个核，不和执行器/渲染共享
+ */
+void DeviceManager::pinThreads(const QVector<int> &cores)
+{
+    if (cores.isEmpty()) return;
+    for (int i = 0; i < m_queues.size(); i++) {
+        const int core = cores[i % cores.size()];
+        QMetaObject::invokeMethod(m_queues[i], [i, core]() {
+            if (!CpuPlan::pinCurrentThread({ core })) {
+                qDebug() << "[DeviceManager] thread" << i << "not pinned to core" << core;
+            }
+        });
+    }
+}
+
+void DeviceManager::shutdown()
+{
+    if (m_threads.isEmpty()) {
+        // 没有 start 过，后端还在本线程上
+        for (const std::unique_ptr<Channel> &ch : m_channels) delete ch->backend;
+    }
+    for (QThread *thread : m_threads) {
+        thread->quit();
+    }
+    for (QThread *thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+    m_queues.clear();
+    m_channels.clear();
+}
+
+QThread *DeviceManager::channelThread(int index) const
+{
+    return m_channels[index]->backend->thread();
+}
+
+void DeviceManager::setChannelEnabled(int index, bool enabled)
+{
+    if (index < 0 || index >= channelCount()) return;
+    m_channels[index]->enabled.store(enabled);
+}
+
+QVector<int> DeviceManager::enabledChannels() const
+{
+    QVector<int> out;
+    for (int i = 0; i < channelCount(); i++) {
+        if (m_channels[i]->enabled.load()) out.append(i);
+    }
+    return out;
+}
+
+QVector<int> DeviceManager::allChannels() const
+{
+    QVector<int> out;
+    for (int i = 0; i < channelCount(); i++) out.append(i);
+    return out;
+}
+
+quint64 DeviceManager::transferErrors() const
+{
+    quint64 total = 0;
+    for (const std::unique_ptr<Channel> &ch : m_channels) total += ch->backend->transferErrors();
+    return total;
+}
+
+/**
+ * @brief 4.提交命令
+ * @note  按线程分组，每个线程的队列只放一条命令，同一线程上的通道在命令里依次执行，
+ *        所以同步点只需要等线程而不是等通道。调用方自己是某个通道线程时，
+ *        先把其他线程的部分投出去，最后提交本线程的 (就地执行)，避免自己等自己。
+ *        还没 start 时后端都在调用方线程上，直接执行。
+ */
+quint64 DeviceManager::submit(CommandResult::Kind kind, int mergeKey, const QVector<int> &channels, bool sync,
+                              std::function<void(int, IBackend *)> fn)
+{
+    const quint64 id = m_nextCommandId.fetch_add(1) + 1;
+    m_lastCommandId.store(id, std::memory_order_relaxed);
+
+    QVector<QVector<int>> groups(m_queues.isEmpty() ? 1 : m_queues.size());
+    for (int index : channels) groups[m_queues.isEmpty() ? 0 : m_channels[index]->worker].append(index);
+    int participants = 0;
+    for (const QVector<int> &g : groups) {
+        if (!g.isEmpty()) participants++;
+    }
+    if (participants == 0) return id;
+
+    // 逐通道执行，传输失败计数有变化即视为失败
+    auto run = [this, fn](const QVector<int> &g, int &executed) {
+        bool ok = true;
+        for (int index : g) {
+            IBackend *backend = m_channels[index]->backend;
+            const quint64 errors = backend->transferErrors();
+            fn(index, backend);
+            ok = ok && backend->transferErrors() == errors;
+            executed++;
+        }
+        return ok;
+    };
+
+    if (m_queues.isEmpty()) {
+        const qint64 t0 = LatencyTracer::nowNs();
+        CommandResult result;
+        result.id = id;
+        result.kind = kind;
+        result.status = run(groups[0], result.channels) ? CommandResult::Done : CommandResult::Failed;
+        result.execNs = LatencyTracer::nowNs() - t0;
+        emit commandFinished(result);
+        return id;
+    }
+
+    std::shared_ptr<SyncPoint> syncPoint = sync ? std::make_shared<SyncPoint>(participants) : nullptr;
+    std::shared_ptr<PendingCommand> pending = std::make_shared<PendingCommand>(participants);
+    CommandQueue::Completion done = [this, pending](const CommandResult &part) {
+        CommandResult result;
+        if (pending->merge(part, result)) emit commandFinished(result);
+    };
+    auto post = [&](int worker) {
+        const QVector<int> g = groups[worker];
+        m_queues[worker]->submit(id, kind, mergeKey, [run, g, syncPoint](int &executed) {
+            if (syncPoint) syncPoint->arriveAndWait();
+            return run(g, executed);
+        }, done);
+    };
+    int own = -1;
+    for (int w = 0; w < groups.size(); w++) {
+        if (groups[w].isEmpty()) continue;
+        if (m_threads[w] == QThread::currentThread()) own = w;
+        else post(w);
+    }
+    if (own >= 0) post(own);
+    return id;
+}
+
+// ---------------- IBackend：广播 ----------------
+
+void DeviceManager::startStimulation(const StimulationParam &param)
+{
+    submit(CommandResult::Start, -1, enabledChannels(), true,
+           [param](int, IBackend *backend) { backend->startStimulation(param); });
+}
+
+void DeviceManager::startStimulation(const QVector<StimulationParam> &perChannel)
+{
+    if (perChannel.isEmpty()) return;
+    submit(CommandResult::Start, -1, enabledChannels(), true, [perChannel](int index, IBackend *backend) {
+        backend->startStimulation(perChannel.at(qMin(index, (int)perChannel.size() - 1)));
+    });
+}
+
+// 停止发给全部通道：刺激中被停用的通道也要收到 CMD_STOP (含急停)
+void DeviceManager::stopStimulation()
+{
+    submit(CommandResult::Stop, -1, allChannels(), true,
+           [](int, IBackend *backend) { backend->stopStimulation(); });
+}
+
+void DeviceManager::updateParameters(const StimulationParam &param)
+{
+    submit(CommandResult::Update, -1, enabledChannels(), false,
+           [param](int, IBackend *backend) { backend->updateParameters(param); });
+}
+
+void DeviceManager::updateChannelParameters(int index, const StimulationParam &param)
+{
+    if (index < 0 || index >= channelCount()) return;
+    submit(CommandResult::Update, index, { index }, false,
+           [param](int, IBackend *backend) { backend->updateParameters(param); });
+}
+
+void DeviceManager::setPIDParameters(const PIDParam &pid)
+{
+    submit(CommandResult::Pid, -1, allChannels(), false, [pid](int, IBackend *backend) { backend->setPIDParameters(pid); });
+}
+
+void DeviceManager::uploadProgram(const QVector<ProgramChunkPacket> &chunks)
+{
+    if (m_channels.empty()) return;
+    submit(CommandResult::ProgramUpload, PRIMARY_CHANNEL, { PRIMARY_CHANNEL }, false,
+           [chunks](int, IBackend *backend) { backend->uploadProgram(chunks); });
+}
+
+void DeviceManager::startProgram(uint8_t programId)
+{
+    if (m_channels.empty()) return;
+    submit(CommandResult::ProgramStart, PRIMARY_CHANNEL, { PRIMARY_CHANNEL }, false,
+           [programId](int, IBackend *backend) { backend->startProgram(programId); });
+}
+
+// 程序只在主通道上启动，中止仍发给全部通道，没有程序在跑的后端不做任何事
+void DeviceManager::abortProgram()
+{
+    if (m_channels.empty()) return;
+    submit(CommandResult::ProgramAbort, -1, allChannels(), false,
+           [](int, IBackend *backend) { backend->abortProgram(); });
+}
+
+void DeviceManager::startArbitrary(IArbSampleSource *source, int sampleRateHz)
+{
+    if (m_channels.empty()) return;
+    submit(CommandResult::ArbStart, PRIMARY_CHANNEL, { PRIMARY_CHANNEL }, false,
+           [source, sampleRateHz](int, IBackend *backend) { backend->startArbitrary(source, sampleRateHz); });
+}
+
+void DeviceManager::stopArbitrary()
+{
+    if (m_channels.empty()) return;
+    submit(CommandResult::ArbStop, PRIMARY_CHANNEL, { PRIMARY_CHANNEL }, false,
+           [](int, IBackend *backend) { backend->stopArbitrary(); });
+}
+
+void DeviceManager::setAcquisitionInterval(int ms)
+{
+    submit(CommandResult::Acquisition, -1, allChannels(), false, [ms](int, IBackend *backend) { backend->setAcquisitionInterval(ms); });
+}
@@ -1,222 +1,385 @@
-// /*
-//  * @Author: takuyasaya 1754944616@qq.com
-//  * @Date: 2025-12-16 22:51:29
-//  * @LastEditors: takuyasaya 1754944616@qq.com
-//  * @LastEditTime: 2025-12-23 14:36:42
-//  * @FilePath: \ele_sti\src\hal\RK3568Backend.cpp
-//  * @Description: 硬件抽象层：负责与RK3568的SPI通信，发送控制命令，接收状态和波形数据
-//  */
-// #include "hal/RK3568Backend.h"
-// #include <fcntl.h>
-// #include <unistd.h>
-// #include <QDebug>
-// #include <sys/ioctl.h>
-// #include <sys/types.h>
-// #include <sys/stat.h>
-// #include <cstring>
-// #include <linux/spi/spidev.h>
-
-// // SPI 配置参数
-// static const uint32_t SPI_SPEED = 1000000; // 1MHz
-// static const uint8_t  SPI_BITS  = 8;
-// static const uint8_t  SPI_MODE  = 0;
-
-// RK3568Backend::RK3568Backend(QObject *parent)
-//     : IBackend(parent),m_fd(-1)
-// {
-//     m_readTimer = new QTimer(this);
-//     m_readTimer->setInterval(20);
-//     connect(m_readTimer, &QTimer::timeout, this, &RK3568Backend::readData);
-// }
-
-// RK3568Backend::~RK3568Backend()
-// {
-//     if (m_fd >= 0)
-//     {
-//         close(m_fd);
-//         m_fd = -1;
-//     }
-// }
-// /**
-//  * @brief 1.初始化SPI设备
-//  * @note  打开SPI设备文件，配置SPI参数
-//  */
-// bool RK3568Backend::init(const QString &devicePath)
-// {
-//     m_fd = open(devicePath.toStdString().c_str(), O_RDWR);
-//     if (m_fd < 0) {
-//         qCritical() << "[SPI] Failed to open device:" << devicePath;
-//         return false;
-//     }
-
-//     // 配置 SPI 参数 (Mode, Bits, Speed)
-//     uint8_t mode = SPI_MODE;
-//     uint8_t bits = SPI_BITS;
-//     uint32_t speed = SPI_SPEED;
-
-//     if (ioctl(m_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
-//         ioctl(m_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
-//         ioctl(m_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
-//     {
-//         qCritical() << "[SPI] Failed to configure SPI settings";
-//         close(m_fd);
-//         m_fd = -1;
-//         return false;
-//     }
-
-//     qInfo() << "[SPI] Initialized success" << devicePath;
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2025-12-16 22:51:29
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 10:40:12
+ * @FilePath: \ele_sti\src\hal\RK3568Backend.cpp
+ * @Description: 硬件抽象层：负责与RK3568的SPI通信，发送控制命令，接收状态和波形数据
+ */
+#include "hal/RK3568Backend.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <QDebug>
+#include <QFile>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <linux/spi/spidev.h>
+
+// 运行指标 (与 WinBackend 共用同名指标)
+static MetricCounter s_wavePackets("ele_sti_backend_wave_packets_total", "Waveform packets received from the M0");
+static MetricCounter s_statusPackets("ele_sti_backend_status_packets_total", "Status packets received from the M0");
+static MetricCounter s_commands("ele_sti_backend_commands_total", "Control commands written to the M0");
+static MetricCounter s_checksumErrors("ele_sti_backend_checksum_errors_total", "Uplink packets dropped for bad checksum");
+static MetricCounter s_unknownHeads("ele_sti_backend_unknown_heads_total", "Uplink transfers with an unknown head byte");
+static MetricCounter s_spiErrors("ele_sti_backend_spi_errors_total", "Failed spidev transfers");
+static MetricHistogram s_spiTransfer("ele_sti_backend_spi_transfer_seconds", "Duration of one spidev transfer");
+
+// SPI 配置参数
+static const uint32_t SPI_SPEED = 1000000; // 1MHz
+static const uint8_t  SPI_BITS  = 8;
+static const uint8_t  SPI_MODE  = 0;
+
+RK3568Backend::RK3568Backend(QObject *parent)
+    : IBackend(parent),m_rxNs(0),m_fd(-1),m_transferErrors(0)
+{
+    m_readTimer = new QTimer(this);
+    m_readTimer->setInterval(POLL_INTERVAL_MS);
+    connect(m_readTimer, &QTimer::timeout, this, &RK3568Backend::readData);
+}
+
+RK3568Backend::~RK3568Backend()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+/**
+ * @brief 1.初始化SPI设备
+ * @note  打开SPI设备文件，配置SPI参数
+ */
+bool RK3568Backend::init(const QString &devicePath)
+{
+    m_fd = open(devicePath.toStdString().c_str(), O_RDWR);
+    if (m_fd < 0) {
+        qCritical() << "[SPI] Failed to open device:" << devicePath;
+        return false;
+    }
+
+    // 配置 SPI 参数 (Mode, Bits, Speed)
+    uint8_t mode = SPI_MODE;
+    uint8_t bits = SPI_BITS;
+    uint32_t speed = SPI_SPEED;
+
+    if (ioctl(m_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+        ioctl(m_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+        ioctl(m_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0)
+    {
+        qCritical() << "[SPI] Failed to configure SPI settings";
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    qInfo() << "[SPI] Initialized success" << devicePath;
     
-//     // 启动接收轮询
-//     m_readTimer->start();
-//     return true;
-// }
-// /**
-//  * @brief 1.SPI 数据传输
-//  * @note  使用 ioctl 进行 SPI 数据传输
-//  */
-// bool RK3568Backend::spiTransfer(const void *tx ,void *rx,int len)
-// {
-//     QMutexLocker locker (&m_mutex);
-//     struct spi_ioc_transfer tr;
-//     memset(&tr,0,sizeof(tr));
-//     tr.tx_buf = (unsigned long)tx;
-//     tr.rx_buf = (unsigned long)rx;
-//     tr.len = len;
-//     ssize_t ret =ioctl(m_fd,SPI_IOC_MESSAGE(1),&tr);
-//     if (ret<1)
-//     {
-//         qDebug()<<"[SPI] Failed to transfer data";
-//         return false;
-//     }
-//     return true;
-// }
-// /**
-//  * @brief 2.开始刺激
-//  * @note  通过ioctl发送SPI消息给M0，把prama放到packet里
-//  */
-// void RK3568Backend::startStimulation(const StimulationParam &param)
-// {
-//     ControlPacket packet={0};
-//     packet.head = HEAD_CONTROL;
-//     packet.cmd = CMD_START;
-//     packet.freq = param.freq;
-//     packet.amp_neg= param.negAmp;
-//     packet.amp_pos= param.posAmp;
-//     packet.positive_width= param.posW;
-//     packet.negative_width= param.negW;
-//     packet.dead_pulse= param.dead;
-//     packet.checksum = calculateChecksum(&packet, sizeof(packet) - 1);
-
-//     spiTransfer(&packet,nullptr,sizeof(packet));
-// }
-
-// /**
-//  * @brief 3.停止刺激
-//  * @note  通过ioctl发送SPI消息给M0，cmd设置成stop
-//  */
-// void RK3568Backend::stopStimulation()
-// {
-//     ControlPacket packet={0};
-//     packet.head =HEAD_CONTROL;
-//     packet.cmd =CMD_STOP;
-//     packet.checksum = calculateChecksum(&packet, sizeof(packet) - 1);
-
-//     spiTransfer(&packet,nullptr,sizeof(packet));
-// }
-
-// void RK3568Backend::updateParameters(const StimulationParam &param)
-// {
-//     ControlPacket packet={0};
-//     packet.head = HEAD_CONTROL;
-//     packet.cmd = CMD_UPDATE;
-//     packet.freq = param.freq;
-//     packet.amp_neg= param.negAmp;
-//     packet.amp_pos= param.posAmp;
-//     packet.positive_width= param.posW;
-//     packet.negative_width= param.negW;
-//     packet.dead_pulse= param.dead;
-//     packet.checksum = calculateChecksum(&packet, sizeof(packet) - 1);
-
-//     spiTransfer(&packet,nullptr,sizeof(packet));
-// }
-// /**
-//  * @brief 4.设置PID参数
-//  * @note
-//  */
-// void RK3568Backend::setPIDParameters(const PIDParam &pid)
-// {
-//     PIDPacket packet={0};
-//     packet.head = HEAD_PID;
-//     packet.kp = pid.kp;
-//     packet.ki =pid.ki;
-//     packet.kd = pid.kd;
-//     packet.integ_limit = pid.limit;
-//     packet.checksum = calculateChecksum(&packet, sizeof(packet) - 1);
-
-//     spiTransfer(&packet,nullptr,sizeof(packet));
-// }
-
-// /**
-//  * @brief 5.读取数据
-//  * @note
-//  */
-// void RK3568Backend::readData()
-// {
-//     if (m_fd<0)    return;
-//     uint8_t tx_buf[sizeof(WaveformPacket)]={0};
-//     uint8_t rx_buf[sizeof(WaveformPacket)]={0};
-//     if (spiTransfer(tx_buf,rx_buf,sizeof(WaveformPacket)))
-//     {
-//        uint8_t head=rx_buf[0];
-//        if (head==HEAD_WAVEFORM)
-//        {
-//         WaveformPacket *packet=(WaveformPacket *)rx_buf;
-//         if (calculateChecksum(packet, sizeof(WaveformPacket) - 1) == packet->checksum) {
-//                 emit waveDataReceived(*packet);
-//             }
-//        }
-//        if (head==HEAD_STATUS)
-//        {
-//         StatusPacket *packet=(StatusPacket *)rx_buf;
-//         if (calculateChecksum(packet, sizeof(StatusPacket) - 1) == packet->checksum) {
-//                 emit statusDataReceived(*packet);
-//             }
-//        }
-       
-//     }
-// }
-// void RK3568Backend::setGpio(const char *gpinPin,int value)
-// {
-//     QString path = QString("/sys/class/gpio//gpio%1/value")
-//     QFile file(path);
-//     if (file.open(QIODevice::WriteOnly)){
-//         file.write(value ? "1" : "0");
-//         file.close();
-//     }
-// }
-
-// void RK3568Backend::enableHardwareSwitch(bool enable)
-// {
-//     if (enable) {
-//         // === 开启输出序列 ===
-//         // 1. 确保 PRE 释放 (高)
-//         setGpio(GPIO_PRE, 1);
+    // 启动接收轮询
+    m_readTimer->start();
+    return true;
+}
+
+/**
+ * @brief 轮询节拍
+ * @note  空闲心跳时只是拉长定时器；设备没打开时只记下间隔，init 后生效
+ */
+void RK3568Backend::setAcquisitionInterval(int ms)
+{
+    const int interval = ms > 0 ? ms : POLL_INTERVAL_MS;
+    if (interval == m_readTimer->interval()) return;
+    m_readTimer->setInterval(interval);
+    qInfo() << "[SPI] poll interval" << interval << "ms";
+}
+/**
+ * @brief 1.SPI 数据传输
+ * @note  使用 ioctl 进行 SPI 数据传输
+ */
+bool RK3568Backend::spiTransfer(const void *tx ,void *rx,int len)
+{
+    TRACE_SCOPE("spiTransfer");
+    // 调用方只有读定时器和命令队列，都在本对象所在线程；Q_ASSERT 在 release 下不生效，
+    // 这里保留一次线程比较 (相对 ioctl 可忽略)，跨线程调用直接拒绝，免得和轮询并发读写 fd
+    if (Q_UNLIKELY(QThread::currentThread() != thread())) {
+        m_transferErrors.fetch_add(1, std::memory_order_relaxed);
+        qWarning() << "[SPI] transfer rejected: not on the backend thread";
+        return false;
+    }
+    struct spi_ioc_transfer tr;
+    memset(&tr,0,sizeof(tr));
+    tr.tx_buf = (unsigned long)tx;
+    tr.rx_buf = (unsigned long)rx;
+    tr.len = len;
+    const qint64 t0 = LatencyTracer::nowNs();
+    ssize_t ret =ioctl(m_fd,SPI_IOC_MESSAGE(1),&tr);
+    s_spiTransfer.observe(LatencyTracer::nowNs() - t0);
+    if (ret<1)
+    {
+        s_spiErrors.inc();
+        m_transferErrors.fetch_add(1, std::memory_order_relaxed);
+        qDebug()<<"[SPI] Failed to transfer data";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 控制包打包发送
+ * @param param 为空时只发送命令字 (STOP / PROG_ABORT)
+ */
+void RK3568Backend::sendControl(uint8_t cmd, const StimulationParam *param)
+{
+    ControlPacket packet={0};
+    packet.cmd = cmd;
+    if (param) {
+        packet.freq = param->freq;
+        packet.amp_neg= param->negAmp;
+        packet.amp_pos= param->posAmp;
+        packet.positive_width= param->posW;
+        packet.negative_width= param->negW;
+        packet.dead_pulse= param->dead;
+    }
+    encodePacket(packet);
+
+    if (spiTransfer(&packet,nullptr,sizeof(packet))) {
+        LatencyTracer::instance().commandSent();
+        s_commands.inc();
+    }
+}
+
+/**
+ * @brief 2.开始刺激
+ * @note  通过ioctl发送SPI消息给M0，把prama放到packet里
+ */
+void RK3568Backend::startStimulation(const StimulationParam &param)
+{
+    sendControl(CMD_START, &param);
+}
+
+/**
+ * @brief 3.停止刺激
+ * @note  通过ioctl发送SPI消息给M0，cmd设置成stop
+ */
+void RK3568Backend::stopStimulation()
+{
+    sendControl(CMD_STOP, nullptr);
+}
+
+void RK3568Backend::updateParameters(const StimulationParam &param)
+{
+    sendControl(CMD_UPDATE, &param);
+}
+/**
+ * @brief 4.设置PID参数
+ * @note
+ */
+void RK3568Backend::setPIDParameters(const PIDParam &pid)
+{
+    PIDPacket packet={0};
+    packet.kp = pid.kp;
+    packet.ki =pid.ki;
+    packet.kd = pid.kd;
+    packet.integ_limit = pid.limit;
+    encodePacket(packet);
+
+    spiTransfer(&packet,nullptr,sizeof(packet));
+}
+
+/**
+ * @brief 5.下载刺激程序
+ * @note  分块包已由业务层打包并计算校验，这里按顺序连续发送
+ *        M0 收齐后通过 HEAD_PROG_STATUS 包回报 READY/ERROR
+ */
+void RK3568Backend::uploadProgram(const QVector<ProgramChunkPacket> &chunks)
+{
+    if (m_fd<0)    return;
+    for (const ProgramChunkPacket &chunk : chunks) {
+        if (!spiTransfer(&chunk,nullptr,sizeof(chunk))) {
+            emit errorOccurred(QString("Program chunk %1 transfer failed").arg(chunk.chunk_index));
+            return;
+        }
+    }
+}
+
+void RK3568Backend::startProgram(uint8_t programId)
+{
+    // CMD_PROG_START 时 freq 字段携带 program_id
+    StimulationParam param;
+    param.freq = programId;
+    param.posAmp = 0.0f;
+    param.negAmp = 0.0f;
+    param.posW = 0;
+    param.negW = 0;
+    param.dead = 0;
+    sendControl(CMD_PROG_START, &param);
+}
+
+void RK3568Backend::abortProgram()
+{
+    sendControl(CMD_PROG_ABORT, nullptr);
+}
+
+/**
+ * @brief 6.进入任意波形模式
+ * @note  M0 缓冲初始为空，启动后立即预填满，之后按波形包里的 arb_credits 补块。
+ *        预填和补块都在本线程上取采样源 (单消费者队列)，别的线程调用时投递过来执行
+ */
+void RK3568Backend::startArbitrary(IArbSampleSource *source, int sampleRateHz)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, source, sampleRateHz]() { startArbitrary(source, sampleRateHz); },
+                                  Qt::QueuedConnection);
+        return;
+    }
+    StimulationParam param;
+    param.freq = sampleRateHz;
+    param.posAmp = 0.0f;
+    param.negAmp = 0.0f;
+    param.posW = 0;
+    param.negW = 0;
+    param.dead = 0;
+    sendControl(CMD_ARB_START, &param);
+
+    m_arbSource.storeRelease(source);
+    sendArbBlocks(ARB_BUFFER_BLOCKS);
+}
+
+void RK3568Backend::stopArbitrary()
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this]() { stopArbitrary(); }, Qt::QueuedConnection);
+        return;
+    }
+    m_arbSource.storeRelease(nullptr);
+    sendControl(CMD_ARB_STOP, nullptr);
+}
+
+/**
+ * @brief 7.按 credits 补发采样块
+ * @note  采样源欠载时直接返回，M0 会在下一个波形包里继续要
+ */
+void RK3568Backend::sendArbBlocks(int credits)
+{
+    IArbSampleSource *source = m_arbSource.loadAcquire();
+    if (!source || m_fd<0) return;
+    for (int i = 0; i < credits; i++) {
+        ArbWavePacket block;
+        if (!source->takeBlock(block)) {
+            break;
+        }
+        if (!spiTransfer(&block,nullptr,sizeof(block))) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 8.读取数据
+ * @note
+ */
+void RK3568Backend::readData()
+{
+    if (m_fd<0)    return;
+    TRACE_SCOPE("readData");
+    uint8_t tx_buf[Uplink::MAX_SIZE]={0};
+    uint8_t rx_buf[Uplink::MAX_SIZE]={0};
+    if (spiTransfer(tx_buf,rx_buf,sizeof(rx_buf)))
+    {
+       m_rxNs = LatencyTracer::nowNs();
+       const uint8_t head=rx_buf[0];
+       if (Uplink::knows(head))
+       {
+        // 命令之后的第一个上行包，视为 M0 已应答
+        LatencyTracer::instance().uplinkReceived();
+       }
+       switch (Uplink::dispatch(*this, rx_buf, sizeof(rx_buf)))
+       {
+       case DispatchResult::Ok:
+           break;
+       case DispatchResult::BadPacket:
+           s_checksumErrors.inc();
+           break;
+       case DispatchResult::UnknownHead:
+           // 0x00 是 M0 无数据可发时的空帧
+           if (head!=0x00) s_unknownHeads.inc();
+           break;
+       }
+    }
+}
+
+void RK3568Backend::onPacket(const WaveformPacket &packet)
+{
+    LatencyTracer::instance().markReceived(packet.tick_us, m_rxNs);
+    s_wavePackets.inc();
+    emit waveDataReceived(packet);
+    // 流控信息搭载在波形包上
+    if (packet.arb_credits > 0) {
+        sendArbBlocks(packet.arb_credits);
+    }
+}
+
+/**
+ * @brief 老固件的波形包
+ * @note  没有 M0 时间戳：用接收时刻 (us，32 位回绕) 代替，M0 到接收这一段延迟统计为 0；
+ *        也没有 credits，任意波形模式不会补块
+ */
+void RK3568Backend::onPacket(const LegacyWaveformPacket &packet)
+{
+    WaveformPacket wave;
+    memset(&wave, 0, sizeof(wave));
+    wave.tick_us = (uint32_t)(m_rxNs / 1000);
+    memcpy(wave.adc_batch, packet.adc_batch, sizeof(wave.adc_batch));
+    encodePacket(wave);
+    onPacket(wave);
+}
+
+void RK3568Backend::onPacket(const StatusPacket &packet)
+{
+    s_statusPackets.inc();
+    emit statusDataReceived(packet);
+}
+
+void RK3568Backend::onPacket(const ProgramStatusPacket &packet)
+{
+    emit programStatusReceived(packet);
+}
+
+void RK3568Backend::setGpio(const char *gpioPin,int value)
+{
+    QString path = QString("/sys/class/gpio/gpio%1/value").arg(gpioPin);
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)){
+        file.write(value ? "1" : "0");
+        file.close();
+    }
+}
+
+void RK3568Backend::enableHardwareSwitch(bool enable)
+{
+    if (enable) {
+        // === 开启输出序列 ===
+        // 1. 确保 PRE 释放 (高)
+        setGpio(GPIO_PRE, 1);
         
-//         // 2. 产生 CLR 脉冲 (高 -> 低 -> 高)
-//         // 根据原理图：L=Clear(Q=L, Q#=H)。我们要 Q#=H(导通)，所以要触发 CLR。
-//         setGpio(GPIO_CLR, 1); // 初始状态
-//         QThread::usleep(100); // 稍作延时
-//         setGpio(GPIO_CLR, 0); // 拉低：强制 Q=0, Q#=1 (导通!)
-//         QThread::usleep(100);
-//         setGpio(GPIO_CLR, 1); // 拉高：保持状态
+        // 2. 产生 CLR 脉冲 (高 -> 低 -> 高)
+        // 根据原理图：L=Clear(Q=L, Q#=H)。我们要 Q#=H(导通)，所以要触发 CLR。
+        setGpio(GPIO_CLR, 1); // 初始状态
+        QThread::usleep(100); // 稍作延时
+        setGpio(GPIO_CLR, 0); // 拉低：强制 Q=0, Q#=1 (导通!)
+        QThread::usleep(100);
+        setGpio(GPIO_CLR, 1); // 拉高：保持状态
         
-//         qDebug() << "Hardware Switch: UNLOCKED (Output Enabled)";
-//     } else {
-//         // === 强制关闭序列 (急停) ===
-//         // PRE = 0, CLR = 1 -> Q=1, Q#=0 (关断)
-//         setGpio(GPIO_CLR, 1);
-//         setGpio(GPIO_PRE, 0);
+        qDebug() << "Hardware Switch: UNLOCKED (Output Enabled)";
+    } else {
+        // === 强制关闭序列 (急停) ===
+        // PRE = 0, CLR = 1 -> Q=1, Q#=0 (关断)
+        setGpio(GPIO_CLR, 1);
+        setGpio(GPIO_PRE, 0);
         
-//         qDebug() << "Hardware Switch: LOCKED (Safe Mode)";
-//     }
-// }
+        qDebug() << "Hardware Switch: LOCKED (Safe Mode)";
+    }
+}
@@ -0,0 +1,162 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 04:02:18
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 04:02:18
+ * @FilePath: \ele_sti\src\hal\SyntheticBackend.cpp
+ * @Description: 合成数据后端
+ */
+#include "hal/SyntheticBackend.h"
+#include "common/LatencyTracer.h"
+#include "common/Logging.h"
+#include "common/PacketCodec.h"
+#include "common/TraceRecorder.h"
+#include <cstring>
+
+// 一跳最多补发 100ms 的积压，线程被卡住很久后不会一次灌进成千上万个包
+static const int MAX_BACKLOG_MS = 100;
+
+SyntheticBackend::SyntheticBackend(int waveHz, int statusHz, QObject *parent)
+    : IBackend(parent), m_waveHz(qMax(1, waveHz)), m_statusHz(qMax(0, statusHz)), m_timer(nullptr),
+      m_wavesSent(0), m_statusSent(0), m_isRunning(false), m_noiseSeed(12345)
+{
+}
+
+SyntheticBackend::~SyntheticBackend()
+{
+    LOG_DEBUG("SyntheticBackend", "stopped after {} waves, {} status", m_wavesSent, m_statusSent);
+}
+
+bool SyntheticBackend::init()
+{
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(1);
+    connect(m_timer, &QTimer::timeout, this, &SyntheticBackend::onTick);
+    m_clock.start();
+    m_timer->start();
+    LOG_INFO("SyntheticBackend", "synthetic streams: wave {} Hz, status {} Hz", m_waveHz, m_statusHz);
+    return true;
+}
+
+void SyntheticBackend::startStimulation(const StimulationParam &param)
+{
+    m_isRunning = true;
+    m_cachedParam = param;
+    LatencyTracer::instance().commandSent();
+}
+
+void SyntheticBackend::stopStimulation()
+{
+    m_isRunning = false;
+    LatencyTracer::instance().commandSent();
+}
+
+void SyntheticBackend::updateParameters(const StimulationParam &param)
+{
+    m_cachedParam = param;
+    LatencyTracer::instance().commandSent();
+}
+
+void SyntheticBackend::setPIDParameters(const PIDParam &pid)
+{
+    Q_UNUSED(pid);
+}
+
+void SyntheticBackend::uploadProgram(const QVector<ProgramChunkPacket> &chunks)
+{
+    Q_UNUSED(chunks);
+}
+
+void SyntheticBackend::startProgram(uint8_t programId)
+{
+    Q_UNUSED(programId);
+}
+
+void SyntheticBackend::abortProgram()
+{
+}
+
+void SyntheticBackend::startArbitrary(IArbSampleSource *source, int sampleRateHz)
+{
+    Q_UNUSED(source);
+    Q_UNUSED(sampleRateHz);
+}
+
+void SyntheticBackend::stopArbitrary()
+{
+}
+
+/**
+ * @brief 1.定时器一跳
+ * @note  应发包数 = 流逝时间 x 速率，和已发的差值就是本跳要补的包数
+ */
+void SyntheticBackend::onTick()
+{
+    TRACE_SCOPE("readData");
+    LatencyTracer::instance().uplinkReceived();
+    const qint64 elapsedNs = m_clock.nsecsElapsed();
+
+    const qint64 wavesDue = elapsedNs * m_waveHz / 1000000000LL;
+    const qint64 waveBacklog = qMax<qint64>(1, (qint64)m_waveHz * MAX_BACKLOG_MS / 1000);
+    if (wavesDue - m_wavesSent > waveBacklog) m_wavesSent = wavesDue - waveBacklog;
+    while (m_wavesSent < wavesDue) emitWave();
+
+    if (m_statusHz > 0) {
+        const qint64 statusDue = elapsedNs * m_statusHz / 1000000000LL;
+        const qint64 statusBacklog = qMax<qint64>(1, (qint64)m_statusHz * MAX_BACKLOG_MS / 1000);
+        if (statusDue - m_statusSent > statusBacklog) m_statusSent = statusDue - statusBacklog;
+        while (m_statusSent < statusDue) emitStatus();
+    }
+}
+
+/**
+ * @brief 2.波形包
+ * @note  一包两个脉冲周期，每个周期前一半画双相脉冲 (正相/死区/负相按脉宽比例)，后一半是基线；
+ *        tick_us 按包序号推进，跳过的积压在服务层表现为丢帧
+ */
+void SyntheticBackend::emitWave()
+{
+    WaveformPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.tick_us = (uint32_t)(m_wavesSent * 1000000LL / m_waveHz);
+
+    const StimulationParam &p = m_cachedParam;
+    const float posAmp = m_isRunning ? p.posAmp : 0.0f;
+    const float negAmp = m_isRunning ? p.negAmp : 0.0f;
+    const int pulseUs = qMax(1, p.posW + p.dead + p.negW);
+    const int half = WAVEFORM_BATCH_SIZE / 2;
+    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) {
+        // 周期内位置映射到 [0, 2 x 脉冲宽度)
+        const int t = (i % half) * 2 * pulseUs / half;
+        float v = 0.0f;
+        if (t < p.posW) v = posAmp;
+        else if (t >= p.posW + p.dead && t < pulseUs) v = -negAmp;
+        pkt.adc_batch[i] = v + noise();
+    }
+    encodePacket(pkt);
+    LatencyTracer::instance().markReceived(pkt.tick_us, LatencyTracer::nowNs());
+    m_wavesSent++;
+    emit waveDataReceived(pkt);
+}
+
+void SyntheticBackend::emitStatus()
+{
+    StatusPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.real_freq = (uint16_t)(m_isRunning ? m_cachedParam.freq : 0);
+    pkt.battery_pct = 95;
+    // 状态包每次都带一点变化，界面的状态绑定每次都会刷新
+    pkt.impedance = (uint8_t)(m_isRunning ? 180 + (m_statusSent % 20) : 200);
+    pkt.error_code = 0;
+    encodePacket(pkt);
+    m_statusSent++;
+    emit statusDataReceived(pkt);
+}
+
+// +/- 0.05mA 底噪，线性同余，不用 rand() (多通道线程间不共享状态)
+float SyntheticBackend::noise()
+{
+    m_noiseSeed = m_noiseSeed * 1664525u + 1013904223u;
+    return ((int)(m_noiseSeed >> 16) % 100 - 50) / 1000.0f;
+}
@@ -7,85 +7,335 @@
  * @Description: 硬件抽象层：Windows模拟后端，实现IBackend接口，生成假数据用于测试
  */
 #include "hal/WinBackend.h" // 确保路径正确
+#include "common/LatencyTracer.h"
+#include "common/Logging.h"
+#include "common/Metrics.h"
+#include "common/PacketCodec.h"
+#include "common/TraceRecorder.h"
 #include <QDebug>
-#include <QtMath>     // qSin, M_PI
-#include <QDateTime>  // 用于打印精确时间戳
+#include <QThread>
 #include <cstdlib>    // rand()
 #include <cstring>    // memset
 
-// 辅助宏：打印带时间戳的 Log
-#define LOG_SIM(msg) qDebug().noquote() << "[" << QDateTime::currentDateTime().toString("HH:mm:ss.zzz") << "][WinBackend]" << msg
+// 运行指标 (与 RK3568Backend 共用同名指标)
+static MetricCounter s_wavePackets("ele_sti_backend_wave_packets_total", "Waveform packets received from the M0");
+static MetricCounter s_statusPackets("ele_sti_backend_status_packets_total", "Status packets received from the M0");
+static MetricCounter s_commands("ele_sti_backend_commands_total", "Control commands written to the M0");
 
 WinBackend::WinBackend(QObject *parent)
-    : IBackend(parent), m_isRunning(false), m_phase(0.0)
+    : IBackend(parent), m_isRunning(false),
+      m_progChunkMask(0), m_progId(0), m_progState(PROG_STATE_EMPTY), m_progSegment(0),
+      m_arbSource(nullptr), m_arbRate(0), m_arbPos(0), m_arbStarved(false), m_arbM0Underruns(0),
+      m_arbElapsedMs(0), m_arbPlayed(0), m_arbHeld(0.0f)
 {
     // 模拟 M0 的采样频率
     // 设置为 50ms (20Hz) 刷新率，这也是 UI 图表常见的刷新频率
     m_simTimer = new QTimer(this);
-    m_simTimer->setInterval(50); 
+    m_simTimer->setInterval(SIM_INTERVAL_MS);
     connect(m_simTimer, &QTimer::timeout, this, &WinBackend::onSimulateTimer);
+    m_m0Clock.start();
+
+    // PIDParam 的缺省值只有比例项 (kp=1, ki=0)，默认负载下输出明显跟不上设定幅值；
+    // 上位机下发 PID 之前按 ele_sti_pidtune 在默认负载 (Rs 0.5k, Rct 2k, Cdl 1uF)、
+    // 200us 双相脉冲上的第一名取整作为模拟 M0 的出厂参数，平均跟踪误差约 1%
+    PIDParam pid;
+    pid.kp = 0.7f;
+    pid.ki = 100000.0f;
+    pid.kd = 0.0f;
+    pid.limit = 30.0f;
+    m_loop.setPid(pid);
     
     // 启动模拟器
     m_simTimer->start();
     
-    LOG_SIM("=========================================");
-    LOG_SIM("   PC Simulation Environment Started     ");
-    LOG_SIM("   Timer Interval: 50ms                  ");
-    LOG_SIM("=========================================");
+    LOG_DEBUG("WinBackend", "PC simulation environment started, timer interval {} ms", SIM_INTERVAL_MS);
 }
 
 WinBackend::~WinBackend()
 {
-    LOG_SIM("Simulation Stopped.");
+    LOG_DEBUG("WinBackend", "Simulation stopped");
 }
 
 void WinBackend::startStimulation(const StimulationParam &param)
 {
     m_isRunning = true;
     m_cachedParam = param;
-    
-    // 重置相位，保证每次开始波形都从 0 开始，看起来更舒服
-    m_phase = 0.0; 
 
-    LOG_SIM(">>> CMD_START RECEIVED <<<");
-    LOG_SIM(QString("  Freq       : %1 Hz").arg(param.freq));
-    LOG_SIM(QString("  Pos Amp    : %1 mA").arg(param.posAmp));
-    LOG_SIM(QString("  Neg Amp    : %1 mA").arg(param.negAmp));
-    LOG_SIM(QString("  Pos Width  : %1 us").arg(param.posW));
-    LOG_SIM(QString("  Neg Width  : %1 us").arg(param.negW));
-    LOG_SIM(QString("  Dead Time  : %1 us").arg(param.dead));
+    LatencyTracer::instance().commandSent();
+    s_commands.inc();
+
+    LOG_DEBUG("WinBackend", ">>> CMD_START: freq {} Hz, pos {} mA, neg {} mA, posW {} us, negW {} us, dead {} us",
+              param.freq, param.posAmp, param.negAmp, param.posW, param.negW, param.dead);
 }
 
 void WinBackend::stopStimulation()
 {
     m_isRunning = false;
-    LOG_SIM(">>> CMD_STOP RECEIVED <<<");
-    LOG_SIM("  Output Disabled (Amplitude set to 0)");
+    m_arbRate = 0;
+    m_arbSource = nullptr;
+    LatencyTracer::instance().commandSent();
+    s_commands.inc();
+    // 与 M0 一致：CMD_STOP 同时中止正在执行的程序
+    if (m_progState == PROG_STATE_RUNNING) {
+        m_progState = PROG_STATE_ERROR;
+        emitProgramStatus();
+    }
+    LOG_DEBUG("WinBackend", ">>> CMD_STOP: output disabled (amplitude set to 0)");
 }
 
 void WinBackend::updateParameters(const StimulationParam &param)
 {
+    m_cachedParam = param;
+    LatencyTracer::instance().commandSent();
+    s_commands.inc();
 
-    LOG_SIM(">>> CMD_UPDATE RECEIVED <<<");
-    LOG_SIM(QString("  Freq       : %1 Hz").arg(param.freq));
-    LOG_SIM(QString("  Pos Amp    : %1 mA").arg(param.posAmp));
-    LOG_SIM(QString("  Neg Amp    : %1 mA").arg(param.negAmp));
-    LOG_SIM(QString("  Pos Width  : %1 us").arg(param.posW));
-    LOG_SIM(QString("  Neg Width  : %1 us").arg(param.negW));
-    LOG_SIM(QString("  Dead Time  : %1 us").arg(param.dead));
+    LOG_DEBUG("WinBackend", ">>> CMD_UPDATE: freq {} Hz, pos {} mA, neg {} mA, posW {} us, negW {} us, dead {} us",
+              param.freq, param.posAmp, param.negAmp, param.posW, param.negW, param.dead);
+}
 
+/**
+ * @brief 采集节拍
+ * @note  空闲时由电源策略拉长；setInterval 会让运行中的定时器从现在起重新计时，
+ *        恢复全速后下一帧在一个全速周期内到来
+ */
+void WinBackend::setAcquisitionInterval(int ms)
+{
+    const int interval = ms > 0 ? ms : SIM_INTERVAL_MS;
+    if (interval == m_simTimer->interval()) return;
+    m_simTimer->setInterval(interval);
+    LOG_DEBUG("WinBackend", ">>> ACQUISITION INTERVAL {} ms", interval);
 }
 
 void WinBackend::setPIDParameters(const PIDParam &pid)
 {
-    LOG_SIM(">>> CMD_SET_PID RECEIVED <<<");
-    LOG_SIM(QString("  Kp: %1, Ki: %2, Kd: %3, Limit: %4")
-            .arg(pid.kp).arg(pid.ki).arg(pid.kd).arg(pid.limit));
+    // 模拟 M0：新参数从下一个脉冲开始生效
+    m_loop.setPid(pid);
+    LOG_DEBUG("WinBackend", ">>> CMD_SET_PID: Kp {}, Ki {}, Kd {}, limit {}", pid.kp, pid.ki, pid.kd, pid.limit);
+}
+
+/**
+ * @brief 模拟 M0 接收程序分块
+ * @note  逐块检查校验和，收齐后用 CRC16 校验整张表，通过则进入 READY
+ */
+void WinBackend::uploadProgram(const QVector<ProgramChunkPacket> &chunks)
+{
+    for (const ProgramChunkPacket &chunk : chunks) {
+        // 分块位图只有 32 位：序号越界的块在移位和拷段之前就拒掉
+        if (!packetValid(chunk)
+            || chunk.segment_total > PROGRAM_MAX_SEGMENTS
+            || chunk.segment_count > PROGRAM_SEGS_PER_CHUNK
+            || chunk.chunk_count == 0 || chunk.chunk_count > 32
+            || chunk.chunk_index >= chunk.chunk_count) {
+            LOG_DEBUG("WinBackend", ">>> PROGRAM CHUNK {} REJECTED (bad checksum or index)", chunk.chunk_index);
+            m_progState = PROG_STATE_ERROR;
+            emitProgramStatus();
+            return;
+        }
+
+        // 新程序的第一个分块：重置程序表
+        if (m_progState != PROG_STATE_LOADING || chunk.program_id != m_progId) {
+            m_progId = chunk.program_id;
+            m_progTable.fill(ProgramSegment(), chunk.segment_total);
+            m_progChunkMask = 0;
+            m_progState = PROG_STATE_LOADING;
+        }
+
+        const int first = chunk.chunk_index * PROGRAM_SEGS_PER_CHUNK;
+        for (int i = 0; i < chunk.segment_count && first + i < m_progTable.size(); i++) {
+            m_progTable[first + i] = chunk.segments[i];
+        }
+        m_progChunkMask |= (1u << chunk.chunk_index);
+
+        const uint32_t fullMask = (chunk.chunk_count == 32) ? 0xFFFFFFFFu : ((1u << chunk.chunk_count) - 1);
+        if (m_progChunkMask == fullMask) {
+            uint16_t crc = calculateCrc16(m_progTable.constData(), m_progTable.size() * (int)sizeof(ProgramSegment));
+            m_progState = (crc == chunk.program_crc) ? PROG_STATE_READY : PROG_STATE_ERROR;
+            LOG_DEBUG("WinBackend", ">>> PROGRAM {} LOADED: {} segments, CRC {}",
+                      m_progId, m_progTable.size(), m_progState == PROG_STATE_READY ? "OK" : "MISMATCH");
+            emitProgramStatus();
+        }
+    }
+}
+
+void WinBackend::startProgram(uint8_t programId)
+{
+    if (m_progState != PROG_STATE_READY && m_progState != PROG_STATE_DONE) {
+        LOG_DEBUG("WinBackend", ">>> CMD_PROG_START IGNORED (state {})", m_progState);
+        return;
+    }
+    if (programId != m_progId || m_progTable.isEmpty()) {
+        LOG_DEBUG("WinBackend", ">>> CMD_PROG_START IGNORED (unknown program {})", programId);
+        return;
+    }
+    m_progState = PROG_STATE_RUNNING;
+    m_progSegment = 0;
+    m_progClock.start();
+    m_isRunning = true;
+    LOG_DEBUG("WinBackend", ">>> CMD_PROG_START: program {}", programId);
+    emitProgramStatus();
+}
+
+void WinBackend::abortProgram()
+{
+    if (m_progState == PROG_STATE_RUNNING) {
+        m_isRunning = false;
+        m_progState = PROG_STATE_ERROR;
+        LOG_DEBUG("WinBackend", ">>> CMD_PROG_ABORT");
+        emitProgramStatus();
+    }
+}
+
+/**
+ * @brief 模拟 M0 进入任意波形模式
+ * @note  进入时先按缓冲容量预填充，之后靠波形包里的 credits 补块。
+ *        采样源是单消费者队列，只能由本线程 (onSimulateTimer 所在线程) 取块：别的线程调用时投递过来执行
+ */
+void WinBackend::startArbitrary(IArbSampleSource *source, int sampleRateHz)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, source, sampleRateHz]() { startArbitrary(source, sampleRateHz); },
+                                  Qt::QueuedConnection);
+        return;
+    }
+    m_arbSource = source;
+    m_arbRate = sampleRateHz;
+    m_arbFifo.clear();
+    m_arbPos = 0;
+    m_arbStarved = false;
+    m_arbM0Underruns = 0;
+    m_arbElapsedMs = 0;
+    m_arbPlayed = 0;
+    m_arbHeld = 0.0f;
+    m_isRunning = true;
+    LOG_DEBUG("WinBackend", ">>> CMD_ARB_START: {} Hz", sampleRateHz);
+    refillArbitrary(ARB_BUFFER_BLOCKS);
+}
+
+void WinBackend::stopArbitrary()
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this]() { stopArbitrary(); }, Qt::QueuedConnection);
+        return;
+    }
+    if (m_arbRate == 0) return;
+    LOG_DEBUG("WinBackend", ">>> CMD_ARB_STOP (M0 underruns: {})", m_arbM0Underruns);
+    m_arbRate = 0;
+    m_arbSource = nullptr;
+    m_arbFifo.clear();
+    m_isRunning = false;
+}
+
+/**
+ * @brief 模拟 M0 播放一个定时周期的任意波形采样
+ * @note  按播放时长算到期的采样数 (低采样率时一个周期可能一个点都不到期)，
+ *        显示点 i 取它所在时刻正在输出的采样 (第 t_i * rate / 1000 个)，抽成 WAVEFORM_BATCH_SIZE 个点回传，
+ *        并在包里带上空闲块数
+ */
+void WinBackend::playArbitrary(WaveformPacket &pkt)
+{
+    const int interval = m_simTimer->interval();
+    const qint64 startMs = m_arbElapsedMs;
+    m_arbElapsedMs += interval;
+    const qint64 due = m_arbElapsedMs * m_arbRate / 1000;
+    // 显示点 i 的时刻为 startMs + i * interval / WAVEFORM_BATCH_SIZE
+    auto sampleAt = [&](int i) {
+        return (startMs * WAVEFORM_BATCH_SIZE + (qint64)i * interval) * m_arbRate / (1000LL * WAVEFORM_BATCH_SIZE);
+    };
+
+    int nextPick = 0;
+    // 上一周期最后播出的采样还在保持输出的显示点
+    while (nextPick < WAVEFORM_BATCH_SIZE && sampleAt(nextPick) < m_arbPlayed) {
+        pkt.adc_batch[nextPick++] = m_arbHeld;
+    }
+    for (; m_arbPlayed < due; m_arbPlayed++) {
+        float val = 0.0f;
+        if (m_arbFifo.isEmpty()) {
+            // 缓冲播空：M0 输出保持 0，连续播空只计一次
+            if (!m_arbStarved) m_arbM0Underruns++;
+            m_arbStarved = true;
+        } else {
+            m_arbStarved = false;
+            val = m_arbFifo.first().samples[m_arbPos] * ARB_SAMPLE_LSB_MA;
+            if (++m_arbPos >= ARB_BATCH_SIZE) {
+                m_arbFifo.removeFirst();
+                m_arbPos = 0;
+            }
+        }
+        m_arbHeld = val;
+        while (nextPick < WAVEFORM_BATCH_SIZE && sampleAt(nextPick) <= m_arbPlayed) {
+            pkt.adc_batch[nextPick++] = val;
+        }
+    }
+    while (nextPick < WAVEFORM_BATCH_SIZE) pkt.adc_batch[nextPick++] = m_arbHeld;
+    pkt.arb_credits = (uint8_t)(ARB_BUFFER_BLOCKS - m_arbFifo.size());
+}
+
+/**
+ * @brief 模拟上位机收到 credits 后补块
+ */
+void WinBackend::refillArbitrary(int credits)
+{
+    if (!m_arbSource) return;
+    for (int i = 0; i < credits && m_arbFifo.size() < ARB_BUFFER_BLOCKS; i++) {
+        ArbWavePacket block;
+        if (!m_arbSource->takeBlock(block)) {
+            break; // 上位机欠载，计数在采样源里
+        }
+        if (!packetValid(block)) {
+            continue;
+        }
+        m_arbFifo.append(block);
+    }
+}
+
+/**
+ * @brief 按执行时间定位当前段并插值幅值
+ * @note  与 M0 固件一致：段内幅值线性插值，全部段执行完后关闭输出
+ */
+void WinBackend::stepProgram(float &amplitude, float &frequency)
+{
+    qint64 elapsed = m_progClock.elapsed();
+    qint64 segStart = 0;
+    for (int i = 0; i < m_progTable.size(); i++) {
+        const ProgramSegment &seg = m_progTable.at(i);
+        if (elapsed < segStart + seg.duration_ms) {
+            float t = (float)(elapsed - segStart) / (float)seg.duration_ms;
+            amplitude = seg.amp_pos_start + (seg.amp_pos_end - seg.amp_pos_start) * t;
+            frequency = (float)seg.freq;
+            m_progSegment = (uint8_t)i;
+            return;
+        }
+        segStart += seg.duration_ms;
+    }
+
+    // 全部段执行完毕
+    amplitude = 0.0f;
+    m_isRunning = false;
+    m_progState = PROG_STATE_DONE;
+    m_progSegment = (uint8_t)qMax(0, (int)m_progTable.size() - 1);
+    LOG_DEBUG("WinBackend", ">>> PROGRAM {} FINISHED", m_progId);
+}
+
+void WinBackend::emitProgramStatus()
+{
+    ProgramStatusPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.program_id = m_progId;
+    pkt.state = m_progState;
+    pkt.segment_index = m_progSegment;
+    pkt.elapsed_ms = m_progClock.isValid() ? (uint32_t)m_progClock.elapsed() : 0;
+    encodePacket(pkt);
+    emit programStatusReceived(pkt);
 }
 
 // 核心：造假数据
 void WinBackend::onSimulateTimer()
 {
+    // 对应真实后端的 readData
+    TRACE_SCOPE("readData");
+    // 模拟 M0 的一帧上行：上一条命令视为已应答
+    LatencyTracer::instance().uplinkReceived();
+
     // ==========================================
     // 1. 造波形数据 (WaveformPacket)
     // ==========================================
@@ -93,37 +343,60 @@ void WinBackend::onSimulateTimer()
     
     // 安全起见，先把内存清零 (模拟真实驱动行为)
     memset(&wavePkt, 0, sizeof(wavePkt)); 
+    // 本批第一个采样点的时刻：一个定时周期之前
+    wavePkt.tick_us = (uint32_t)(m_m0Clock.nsecsElapsed() / 1000 - m_simTimer->interval() * 1000);
     
     // 如果是 Running，使用缓存的参数；否则输出 0
     float amplitude = m_isRunning ? m_cachedParam.posAmp : 0.0f;
     float frequency = m_isRunning ? (float)m_cachedParam.freq : 1.0f; 
+
+    // 程序执行中：幅值/频率由程序表决定
+    if (m_progState == PROG_STATE_RUNNING) {
+        stepProgram(amplitude, frequency);
+        emitProgramStatus();
+    }
     
-    // 模拟生成正弦波
-    // 假设 WAVEFORM_BATCH_SIZE 是 50 (根据 ProtocolData.h 定义)
-    // 我们假设这 50 个点是高速采样的结果
-    
-    // 步进值：决定波形的疏密。频率越高，相位走得越快
-    double phaseStep = (2.0 * M_PI * frequency) / 1000.0; // 简单模拟
+    // 任意波形模式：播放上位机下发的采样，按 credits 补块
+    if (m_arbRate > 0) {
+        playArbitrary(wavePkt);
+        encodePacket(wavePkt);
+        LatencyTracer::instance().markReceived(wavePkt.tick_us, LatencyTracer::nowNs());
+        s_wavePackets.inc();
+        emit waveDataReceived(wavePkt);
+        refillArbitrary(wavePkt.arb_credits);
+    }
 
-    for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) {
-        // y = A * sin(phase) + 随机噪声 (模拟真实电路底噪)
+    // 模拟恒流环输出：按当前 PID 和电极负载仿真一个双相脉冲周期，
+    // 电流响应均匀抽成 WAVEFORM_BATCH_SIZE 点，PID 调得好坏直接体现在波形上
+    if (m_arbRate == 0) {
+        StimulationParam pulse = m_cachedParam;
+        pulse.freq = (int)frequency;
+        // 程序执行时幅值由程序表给出，负相按原来的正负比例缩放
+        if (m_cachedParam.posAmp > 0.0f) pulse.negAmp = m_cachedParam.negAmp * amplitude / m_cachedParam.posAmp;
+        if (!m_isRunning) pulse.negAmp = 0.0f;
+        pulse.posAmp = amplitude;
+        m_loop.runPulses(pulse, 2, wavePkt.adc_batch, WAVEFORM_BATCH_SIZE);
+    }
+    for (int i = 0; m_arbRate == 0 && i < WAVEFORM_BATCH_SIZE; i++) {
+        // 叠加随机噪声 (模拟真实电路底噪)
         float noise = (rand() % 100 - 50) / 1000.0f; // +/- 0.05mA 的噪声
-        float val = amplitude * qSin(m_phase) + noise;
-        
-        wavePkt.adc_batch[i] = val;
-        
-        // 更新相位，让波形动起来
-        m_phase += phaseStep; 
-        if (m_phase > 2 * M_PI) m_phase -= 2 * M_PI;
+        wavePkt.adc_batch[i] += noise;
     }
     
     // 发送波形信号
-    emit waveDataReceived(wavePkt);
+    if (m_arbRate == 0) {
+        encodePacket(wavePkt);
+        LatencyTracer::instance().markReceived(wavePkt.tick_us, LatencyTracer::nowNs());
+        s_wavePackets.inc();
+        emit waveDataReceived(wavePkt);
+    }
 
     // ==========================================
     // 2. 造状态数据 (StatusPacket)
     // ==========================================
     StatusPacket statusPkt;
+    memset(&statusPkt, 0, sizeof(statusPkt));
+    statusPkt.real_freq = (uint16_t)(m_isRunning ? m_cachedParam.freq : 0);
     
     // 模拟电池电量波动 (95% - 96% 之间跳变，测试 UI 刷新)
     static int simBattery = 95;
@@ -142,8 +415,10 @@ void WinBackend::onSimulateTimer()
     }
     
     statusPkt.error_code = 0; // 无错误
+    encodePacket(statusPkt);
     
     // 发送状态信号
+    s_statusPackets.inc();
     emit statusDataReceived(statusPkt);
     
     // ==========================================
@@ -152,10 +427,7 @@ void WinBackend::onSimulateTimer()
     static int logCounter = 0;
     if (++logCounter >= 20) { // 20 * 50ms = 1秒打印一次心跳
         logCounter = 0;
-        LOG_SIM(QString("[Heartbeat] State: %1 | Amp: %2 mA | Bat: %3% | Imp: %4 Ohm")
-                .arg(m_isRunning ? "RUNNING" : "IDLE")
-                .arg(amplitude, 0, 'f', 2)
-                .arg(statusPkt.battery_pct)
-                .arg(statusPkt.impedance));
+        LOG_DEBUG("WinBackend", "[Heartbeat] State: {} | Amp: {.2} mA | Bat: {}% | Imp: {} Ohm",
+                  m_isRunning ? "RUNNING" : "IDLE", amplitude, statusPkt.battery_pct, statusPkt.impedance);
     }
 }
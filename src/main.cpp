@@ -15,58 +15,184 @@
 #include "core/TreatmentService.h"
 #include "controllers/TreatmentManager.h"
 
-#include "hal/WinBackend.h"
+#include "hal/DeviceManager.h"
 
 #include "hal/ButtonBackend.h"
-
-//#include "hal/RK3568Backend.h"
+#include "core/KnobInputHandler.h"
+#include "controllers/MetricsController.h"
+#include "controllers/SystemMonitor.h"
+#include "controllers/TrendModel.h"
+#include "common/StartupProfiler.h"
+#include "common/CpuPlan.h"
+#include "controllers/ImageAssetProvider.h"
+#include "controllers/FrameBench.h"
+#include "controllers/LivePublisher.h"
+#include "hal/SyntheticBackend.h"
+#include <QQuickWindow>
 
 int main(int argc, char *argv[]) {
+    // 启动剖析的零点
+    StartupProfiler &profiler = StartupProfiler::instance();
+    // 帧时间基准：图形后端要在建 QGuiApplication 之前选定
+    const bool frameBench = FrameBench::requested(argc, argv);
     QGuiApplication app(argc, argv);
     app.setWindowIcon(QIcon(":/fonts/icon.ico"));
-    QQmlApplicationEngine engine;
-    qmlRegisterUncreatableType<TreatmentManager>("ELE_Sti", 1, 0, "TreatmentManager", "Get state from treatmentManager instance");
-    // 工作线程和后端初始化
-    QThread *workthread =  new QThread();
-    QThread *serialthread =  new QThread();
+    profiler.mark("QGuiApplication created");
+    FrameBench::Options benchOptions;
+    if (frameBench) benchOptions = FrameBench::parse(app.arguments());
 
-    //RK3568Backend * backend= new RK3568Backend();
-    WinBackend * backend= new WinBackend();
+    // 分阶段启动：先起后端和治疗服务 (停止按钮依赖它们)，再建 QML 引擎
+    // 设备管理：每个通道一个后端，按核数分配采集线程
+    // 模拟器通道数可用 ELE_STI_SIM_DEVICES 覆盖 (默认 1)，方便在 PC 上验证多通道
+    auto devices = new DeviceManager();
+    bool simOk = false;
+    int simDevices = qEnvironmentVariableIntValue("ELE_STI_SIM_DEVICES", &simOk);
+    if (!simOk || simDevices <= 0) simDevices = 1;
+    if (frameBench) {
+        // 基准模式：合成数据按给定速率走正常的上行链路
+        auto synthetic = new SyntheticBackend(benchOptions.waveHz, benchOptions.statusHz);
+        devices->addDevice(synthetic, [synthetic]() { return synthetic->init(); });
+    } else {
+        for (int i = 0; i < simDevices; i++) devices->addSimulator();
+    }
+    //devices->addSpiDevice("/dev/spidev1.0");
+    QThread *serialthread =  new QThread();
+    // 线程名会出现在追踪时间线和 /proc 里
+    serialthread->setObjectName("serial");
     ButtonBackend *btnBackend = new ButtonBackend();
-
-    // 把backend放到各自的线程中
-    backend->moveToThread(workthread);
     btnBackend->moveToThread(serialthread);
-    workthread->start();
-    serialthread->start();
-    QObject::connect(workthread,&QThread::finished,backend,&QObject::deleteLater);
+    // 串口线程只做收帧分帧，提高优先级让旋钮在界面繁忙时也能及时响应
+    serialthread->start(QThread::HighPriority);
     QObject::connect(serialthread, &QThread::finished, btnBackend, &QObject::deleteLater);
 
-
-    // 把初始化放到工作线程里执行
-    QMetaObject::invokeMethod(backend,[backend](){
-        if (! backend->init("/dev/spidev1.0"))
-        {
-            qDebug() << "Backend init failed!";
-        }
-       
+    // 初始化在各采集线程里执行，和下面的 QML 加载并行
+    QObject::connect(devices, &DeviceManager::initFinished, &profiler, [](int failed){
+        if (failed > 0) qDebug() << "Backend init failed on" << failed << "channel(s)!";
+        StartupProfiler::instance().mark("backend init done");
     });
+    devices->start();
+    // 核规划：核 0 留给界面和渲染，采集线程各占一个核，共享执行器只用剩下的后台核
+    const CpuPlan cpuPlan = CpuPlan::detect(devices->threadCount());
+    CpuPlan::setCurrent(cpuPlan);
+    devices->pinThreads(cpuPlan.realtime);
+    // 界面线程绑到渲染核；之后由它创建的线程 (场景图、QML 加载) 继承这个掩码，不会落到采集核上
+    if (!CpuPlan::pinCurrentThread(cpuPlan.render)) qDebug() << "[Main] GUI thread not pinned to" << cpuPlan.render;
+    qInfo().noquote() << "[Main] cpu plan" << cpuPlan.toString();
+    IBackend *backend = devices;
     QMetaObject::invokeMethod(btnBackend, [btnBackend](){
         // 注意：这里的端口号 "/dev/ttyUSB0" 根据你的实际情况修改
         if (!btnBackend->openSerial("/dev/ttyUSB0")) {
             qDebug() << "ButtonSerial init failed!";
         }
+        StartupProfiler::instance().mark("button serial open");
     });
     // 服务和管理器初始化
     auto service = new TreatmentService(backend);
+    // 治疗记录：设了 ELE_STI_SESSION_DIR 才记录，文件由 ele_sti_analyze 离线分析
+    service->recorder().setDirectory(qEnvironmentVariable("ELE_STI_SESSION_DIR"));
     auto manager = new TreatmentManager(service);
+
+    // 旋钮快速通道：串口线程收帧 -> 后端线程合并下发，界面只做同步显示
+    // 放在主通道的采集线程上，主通道的下发不用再排队
+    auto knob = new KnobInputHandler(backend);
+    knob->moveToThread(devices->channelThread(DeviceManager::PRIMARY_CHANNEL));
+    QObject::connect(devices->channelThread(DeviceManager::PRIMARY_CHANNEL), &QThread::finished, knob, &QObject::deleteLater);
+    QObject::connect(btnBackend, &ButtonBackend::knobRotated, knob, [knob](int detents, qint64 rxNs){
+        knob->addDelta(detents, rxNs);
+    }, Qt::DirectConnection);
+    QObject::connect(btnBackend, &ButtonBackend::sigSingleClickStop, knob, [knob](qint64 rxNs){
+        knob->click(rxNs);
+    }, Qt::DirectConnection);
+    QObject::connect(service, &TreatmentService::parametersChanged, knob, &KnobInputHandler::setParameters);
+    // 治疗方式在服务线程上读，再排队交给旋钮所在的后端线程
+    QObject::connect(service, &TreatmentService::stateChanged, service, [knob, service](TreatmentService::Runstate state){
+        int mode = KnobInputHandler::Stopped;
+        if (state == TreatmentService::Runstate::Running) {
+            switch (service->mode()) {
+            case TreatmentService::Mode::Fixed: mode = KnobInputHandler::Fixed; break;
+            case TreatmentService::Mode::Program: mode = KnobInputHandler::Program; break;
+            case TreatmentService::Mode::Arbitrary: mode = KnobInputHandler::Arbitrary; break;
+            }
+        }
+        QMetaObject::invokeMethod(knob, [knob, mode]() { knob->setMode(mode); }, Qt::QueuedConnection);
+    });
+    QObject::connect(knob, &KnobInputHandler::parametersAdjusted, service, &TreatmentService::applyKnobParameters);
+    QObject::connect(knob, &KnobInputHandler::stopRequested, service, &TreatmentService::applyKnobStop);
+    profiler.mark("service + manager created");
+
+    QQmlApplicationEngine engine;
+    qmlRegisterUncreatableType<TreatmentManager>("ELE_Sti", 1, 0, "TreatmentManager", "Get state from treatmentManager instance");
+    qmlRegisterUncreatableType<TriggerEngine>("ELE_Sti", 1, 0, "Trigger", "Configure via treatmentManager.setTrigger");
+    qmlRegisterUncreatableType<TrendModel>("ELE_Sti", 1, 0, "TrendModel", "Use the trendSeconds/trend10s/trendMinutes instances");
+    profiler.mark("QML engine created");
     // QML 上下文属性设置
     engine.rootContext()->setContextProperty("treatmentManager", manager);
+    engine.rootContext()->setContextProperty("startupProfiler", &profiler);
+    // 状态趋势：每秒 1 小时 / 每 10 秒 6 小时 / 每分钟 24 小时，内存固定
+    engine.rootContext()->setContextProperty("trendSeconds", new TrendModel(service, TrendStore::PerSecond, manager));
+    engine.rootContext()->setContextProperty("trend10s", new TrendModel(service, TrendStore::Per10Seconds, manager));
+    engine.rootContext()->setContextProperty("trendMinutes", new TrendModel(service, TrendStore::PerMinute, manager));
+    // 图片：预缩放变体 + 解码内存预算 (MB，可用 ELE_STI_IMAGE_BUDGET_MB 覆盖)
+    bool budgetOk = false;
+    int imageBudgetMb = qEnvironmentVariableIntValue("ELE_STI_IMAGE_BUDGET_MB", &budgetOk);
+    if (!budgetOk || imageBudgetMb <= 0) imageBudgetMb = 32;
+    auto images = new ImageAssetProvider((qint64)imageBudgetMb * 1048576);
+    engine.addImageProvider("assets", images); // 引擎接管所有权
+    // 运行指标：QML 展示 + 本机抓取接口 (端口可用 ELE_STI_METRICS_PORT 覆盖，0 表示关闭)
+    auto metrics = new MetricsController(&app);
+    engine.rootContext()->setContextProperty("metricsController", metrics);
+    // 系统资源：每核/每线程 CPU、内存，systemPage 展示
+    auto sysMonitor = new SystemMonitor(&app);
+    engine.rootContext()->setContextProperty("systemMonitor", sysMonitor);
+    // 空闲省电：空闲期间的平均 CPU / 唤醒次数单独统计
+    sysMonitor->setIdle(service->power()->mode() == PowerPolicy::Idle);
+    QObject::connect(service->power(), &PowerPolicy::modeChanged, sysMonitor, [sysMonitor](PowerPolicy::Mode mode){
+        sysMonitor->setIdle(mode == PowerPolicy::Idle);
+    });
+    bool portOk = false;
+    int metricsPort = qEnvironmentVariableIntValue("ELE_STI_METRICS_PORT", &portOk);
+    if (!portOk) metricsPort = 9464;
+    if (metricsPort > 0) metrics->startScrapeServer((quint16)metricsPort);
+    // 实时数据外发：采集线程写共享内存 /dev/shm/<名字>，外部工具经同名本地套接字握手。
+    // 默认关闭 (设备上不对外暴露波形)，调试时设 ELE_STI_LIVE_NAME=ele_sti_live 打开。
+    // 与 devices 同样不析构：采集线程一直在写
+    const QString liveName = qEnvironmentVariable("ELE_STI_LIVE_NAME");
+    if (!liveName.isEmpty()) {
+        auto live = new LivePublisher();
+        if (live->start(liveName, devices)) {
+            QObject::connect(&app, &QCoreApplication::aboutToQuit, live, [live]() { live->unpublish(); });
+        }
+    }
     QObject::connect(btnBackend, &ButtonBackend::startFromSerial,
                      manager, &TreatmentManager::serialTriggerReceived);
     // 
     QObject::connect(&engine, &QQmlApplicationEngine::objectCreationFailed, &app, [](){ QCoreApplication::exit(-1); }, Qt::QueuedConnection);
     engine.loadFromModule("ELE_Sti", "Main");
+    profiler.mark("Main.qml instantiated");
+
+    // 首帧上屏即视为可操作，打印时间线；其余页面由 Main.qml 在首帧后后台加载
+    if (!engine.rootObjects().isEmpty()) {
+        if (auto window = qobject_cast<QQuickWindow *>(engine.rootObjects().first())) {
+            // 场景图渲染线程在窗口第一次上屏时才创建：初始化信号在它自己的线程上发出，直连里绑核
+            // (继承来的掩码已经是渲染核，这里再绑一次，不依赖线程由谁创建)
+            QObject::connect(window, &QQuickWindow::sceneGraphInitialized, window, [render = cpuPlan.render]() {
+                if (!CpuPlan::pinCurrentThread(render)) qDebug() << "[Main] render thread not pinned to" << render;
+            }, Qt::DirectConnection);
+            // 直连：在渲染线程上取时间，不受 UI 线程排队影响
+            QObject::connect(window, &QQuickWindow::frameSwapped, &profiler, [&profiler]() {
+                if (!profiler.isFinished()) profiler.finish("first frame swapped");
+            }, Qt::DirectConnection);
+            // 所有页面加载完后打印图片资源的节省情况
+            QObject::connect(&profiler, &StartupProfiler::marked, &app, [images](const QString &phase) {
+                if (phase == "systemPage loaded") qInfo().noquote() << images->formatReport();
+            }, Qt::QueuedConnection);
+            if (frameBench) {
+                auto bench = new FrameBench(benchOptions, manager, &app);
+                QObject::connect(bench, &FrameBench::finished, &app, [](int code) { QCoreApplication::exit(code); },
+                                 Qt::QueuedConnection);
+                bench->attach(window);
+            }
+        }
+    }
     return app.exec();
 }
-
@@ -0,0 +1,314 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 01:40:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 01:40:12
+ * @FilePath: \ele_sti\tools\analyze\main.cpp
+ * @Description: 治疗记录离线分析工具：不起界面，多核并行分析一批 .eses 文件并输出报告
+ *
+ * 记录由 GUI (环境变量 ELE_STI_SESSION_DIR) 或 ele_sti_headless --record-dir 生成。
+ * 分析一个目录，每个文件一份 JSON 报告加一份汇总:
+ *   ele_sti_analyze --out reports/ /data/sessions
+ * 看吞吐随线程数的变化 (1, 2, 4 ... 每核一个):
+ *   ele_sti_analyze --scaling /data/sessions
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QDebug>
+#include <cstdio>
+#include "common/CpuPlan.h"
+#include "core/SessionAnalyzer.h"
+#include "core/TaskExecutor.h"
+
+static const char *modeName(int mode)
+{
+    switch (mode) {
+    case ESES_MODE_STIM: return "stim";
+    case ESES_MODE_PROGRAM: return "program";
+    case ESES_MODE_ARB: return "arb";
+    default: return "?";
+    }
+}
+
+static QJsonObject paramJson(const SessionParam &p)
+{
+    QJsonObject o;
+    o["freq"] = p.freq;
+    o["posAmp"] = p.amp_pos;
+    o["negAmp"] = p.amp_neg;
+    o["posWidth"] = (int)p.positive_width;
+    o["negWidth"] = (int)p.negative_width;
+    o["dead"] = (int)p.dead_pulse;
+    return o;
+}
+
+static QJsonObject reportJson(const SessionAnalyzer::Report &r)
+{
+    QJsonObject o;
+    o["file"] = r.path;
+    o["ok"] = r.ok;
+    if (!r.ok) {
+        o["error"] = r.error;
+        return o;
+    }
+    o["mode"] = modeName(r.mode);
+    o["start"] = QDateTime::fromMSecsSinceEpoch(r.startEpochMs).toString(Qt::ISODateWithMs);
+    o["plannedS"] = (int)r.plannedS;
+    o["elapsedMs"] = (qint64)r.elapsedMs;
+    o["closed"] = r.closed;
+    o["records"] = (qint64)r.records;
+    o["param"] = paramJson(r.param);
+    o["paramChanges"] = r.paramChanges;
+
+    QJsonObject charge;
+    charge["pulses"] = r.pulses;
+    charge["positiveUc"] = r.posChargeUc;
+    charge["negativeUc"] = r.negChargeUc;
+    charge["imbalancePct"] = r.chargeImbalancePct();
+    o["charge"] = charge;
+
+    QJsonObject pulses;
+    pulses["waveforms"] = (qint64)r.waveforms;
+    pulses["checked"] = (qint64)r.pulseBatches;
+    pulses["conforming"] = (qint64)r.conformingBatches;
+    pulses["missing"] = (qint64)r.missingPulses;
+    pulses["conformityPct"] = r.conformityPct();
+    pulses["posAmpMean"] = r.posAmpMean;
+    pulses["negAmpMean"] = r.negAmpMean;
+    pulses["posAmpErrMaxPct"] = r.posAmpErrMaxPct;
+    pulses["negAmpErrMaxPct"] = r.negAmpErrMaxPct;
+    pulses["overshootMaxPct"] = r.overshootMaxPct;
+    o["conformity"] = pulses;
+
+    QJsonObject impedance;
+    impedance["samples"] = (qint64)r.statuses;
+    impedance["min"] = r.impedanceMin;
+    impedance["max"] = r.impedanceMax;
+    impedance["mean"] = r.impedanceMean;
+    QJsonArray trend;
+    for (const SessionAnalyzer::TrendPoint &p : r.impedanceTrend) {
+        trend.append(QJsonArray{ p.startMs, p.min, p.max, p.mean });
+    }
+    impedance["perMinute"] = trend; // [startMs, min, max, mean]
+    o["impedance"] = impedance;
+
+    QJsonArray errors;
+    for (const SessionAnalyzer::ErrorEvent &e : r.errors) {
+        errors.append(QJsonObject{ { "ms", (qint64)e.hostMs }, { "code", e.code } });
+    }
+    o["errors"] = errors;
+    return o;
+}
+
+static QJsonObject throughputJson(const SessionAnalyzer::Summary &s)
+{
+    QJsonObject o;
+    o["threads"] = s.threads;
+    o["chunks"] = s.chunks;
+    o["sessions"] = s.sessions;
+    o["records"] = (qint64)s.records;
+    o["bytes"] = s.bytes;
+    o["indexMs"] = s.indexNs / 1e6;
+    o["chunkMs"] = s.chunkNs / 1e6;
+    o["elapsedMs"] = s.elapsedNs / 1e6;
+    o["mbPerSec"] = s.mbPerSec();
+    o["recordsPerSec"] = s.recordsPerSec();
+    return o;
+}
+
+/**
+ * @brief 汇总：总时长、总电荷、总体符合度、按错误码统计
+ */
+static QJsonObject aggregateJson(const QVector<SessionAnalyzer::Report> &reports, const SessionAnalyzer::Summary &summary)
+{
+    int ok = 0, withErrors = 0, unclosed = 0;
+    double hours = 0.0, posUc = 0.0, negUc = 0.0, pulses = 0.0;
+    quint64 checked = 0, conforming = 0, missing = 0;
+    QMap<int, int> errorCodes;
+    QJsonArray failed;
+    for (const SessionAnalyzer::Report &r : reports) {
+        if (!r.ok) {
+            failed.append(QJsonObject{ { "file", r.path }, { "error", r.error } });
+            continue;
+        }
+        ok++;
+        if (!r.closed) unclosed++;
+        if (!r.errors.isEmpty()) withErrors++;
+        for (const SessionAnalyzer::ErrorEvent &e : r.errors) errorCodes[e.code]++;
+        hours += r.elapsedMs / 3600000.0;
+        posUc += r.posChargeUc;
+        negUc += r.negChargeUc;
+        pulses += r.pulses;
+        checked += r.pulseBatches;
+        conforming += r.conformingBatches;
+        missing += r.missingPulses;
+    }
+    QJsonObject o;
+    o["sessions"] = (int)reports.size();
+    o["analysed"] = ok;
+    o["unclosed"] = unclosed;
+    o["failed"] = failed;
+    o["treatmentHours"] = hours;
+    o["pulses"] = pulses;
+    o["positiveUc"] = posUc;
+    o["negativeUc"] = negUc;
+    o["checkedWaveforms"] = (qint64)checked;
+    o["conformityPct"] = checked > 0 ? 100.0 * conforming / checked : 100.0;
+    o["missingPulses"] = (qint64)missing;
+    o["sessionsWithErrors"] = withErrors;
+    QJsonObject codes;
+    for (auto it = errorCodes.constBegin(); it != errorCodes.constEnd(); ++it) codes[QString::number(it.key())] = it.value();
+    o["errorEvents"] = codes;
+    o["throughput"] = throughputJson(summary);
+    return o;
+}
+
+static void printReports(const QVector<SessionAnalyzer::Report> &reports)
+{
+    std::printf("%-36s %-7s %8s %9s %10s %10s %7s %8s %7s %15s %4s\n",
+                "session", "mode", "time_s", "pulses", "Q+ uC", "Q- uC", "imbal%", "conform%", "missing", "impedance", "err");
+    for (const SessionAnalyzer::Report &r : reports) {
+        const QByteArray name = QFileInfo(r.path).fileName().left(36).toLocal8Bit();
+        if (!r.ok) {
+            std::printf("%-36s FAILED: %s\n", name.constData(), r.error.toLocal8Bit().constData());
+            continue;
+        }
+        const QByteArray imp = QString("%1 (%2-%3)").arg(r.impedanceMean, 0, 'f', 1)
+                                   .arg(r.impedanceMin, 0, 'f', 0).arg(r.impedanceMax, 0, 'f', 0).toLocal8Bit();
+        std::printf("%-36s %-7s %8.1f %9.0f %10.2f %10.2f %7.2f %8.2f %7llu %15s %4d%s\n",
+                    name.constData(), modeName(r.mode), r.elapsedMs / 1000.0, r.pulses, r.posChargeUc, r.negChargeUc,
+                    r.chargeImbalancePct(), r.conformityPct(), (unsigned long long)r.missingPulses, imp.constData(),
+                    (int)r.errors.size(), r.closed ? "" : "  (unclosed)");
+    }
+}
+
+static void printThroughput(const SessionAnalyzer::Summary &s)
+{
+    std::printf("analysed %d sessions (%d failed), %.1f MB, %llu records on %d threads in %.1f ms "
+                "(index %.1f ms, %d chunks %.1f ms): %.1f MB/s, %.2f M records/s\n",
+                s.sessions, s.failed, s.bytes / 1048576.0, (unsigned long long)s.records, s.threads,
+                s.elapsedNs / 1e6, s.indexNs / 1e6, s.chunks, s.chunkNs / 1e6, s.mbPerSec(), s.recordsPerSec() / 1e6);
+}
+
+static bool writeJson(const QString &path, const QJsonObject &o)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCritical() << "Cannot write" << path << f.errorString();
+        return false;
+    }
+    f.write(QJsonDocument(o).toJson(QJsonDocument::Indented));
+    return true;
+}
+
+/**
+ * @brief 线程数扫描
+ * @note  先用满线程跑一遍把文件读进页缓存，之后每档都是热缓存下的计算吞吐
+ */
+static QJsonArray runScaling(SessionAnalyzer &analyzer, const QStringList &files)
+{
+    const int maxThreads = TaskExecutor::instance().threadCount();
+    QVector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.append(t);
+    counts.append(maxThreads);
+
+    analyzer.setThreadCount(maxThreads);
+    analyzer.analyze(files);
+
+    QJsonArray rows;
+    double base = 0.0;
+    std::printf("%8s %10s %12s %8s\n", "threads", "MB/s", "Mrecords/s", "speedup");
+    for (int t : counts) {
+        analyzer.setThreadCount(t);
+        SessionAnalyzer::Summary s;
+        analyzer.analyze(files, &s);
+        if (base <= 0.0) base = s.recordsPerSec();
+        const double speedup = base > 0.0 ? s.recordsPerSec() / base : 0.0;
+        std::printf("%8d %10.1f %12.2f %7.2fx\n", t, s.mbPerSec(), s.recordsPerSec() / 1e6, speedup);
+        QJsonObject row = throughputJson(s);
+        row["speedup"] = speedup;
+        rows.append(row);
+    }
+    return rows;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ele_sti_analyze");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offline analysis of recorded treatment sessions (.eses)");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Session files or directories (searched recursively).", "<path>...");
+    QCommandLineOption outOpt("out", "Write one JSON report per session plus summary.json into <dir>.", "dir");
+    QCommandLineOption threadsOpt("threads", "Worker threads (0 = one per core).", "n", "0");
+    QCommandLineOption chunkOpt("chunk", "Records per work chunk.", "n", "8192");
+    QCommandLineOption tolOpt("tolerance", "Allowed plateau amplitude deviation (%).", "pct", "15");
+    QCommandLineOption overOpt("overshoot", "Allowed peak overshoot (%).", "pct", "25");
+    QCommandLineOption jsonOpt("json", "Print the aggregate report as JSON instead of tables.");
+    QCommandLineOption scalingOpt("scaling", "Measure throughput at 1, 2, 4 ... threads up to one per core.");
+    parser.addOptions({ outOpt, threadsOpt, chunkOpt, tolOpt, overOpt, jsonOpt, scalingOpt });
+    parser.process(app);
+
+    const QStringList files = SessionAnalyzer::collect(parser.positionalArguments());
+    if (files.isEmpty()) {
+        qCritical() << "No session files given";
+        parser.showHelp(1);
+    }
+
+    SessionAnalyzer::Options options;
+    options.chunkRecords = parser.value(chunkOpt).toInt();
+    options.ampTolerance = parser.value(tolOpt).toFloat() / 100.0f;
+    options.overshootLimit = parser.value(overOpt).toFloat() / 100.0f;
+    // 离线工具没有采集和界面，全部核给执行器
+    CpuPlan::setCurrent(CpuPlan::offline());
+    SessionAnalyzer analyzer(options, parser.value(threadsOpt).toInt());
+
+    if (parser.isSet(scalingOpt)) {
+        const QJsonArray rows = runScaling(analyzer, files);
+        if (parser.isSet(outOpt)) {
+            QDir().mkpath(parser.value(outOpt));
+            QJsonObject root;
+            root["scaling"] = rows;
+            writeJson(QDir(parser.value(outOpt)).filePath("scaling.json"), root);
+        }
+        return 0;
+    }
+
+    SessionAnalyzer::Summary summary;
+    const QVector<SessionAnalyzer::Report> reports = analyzer.analyze(files, &summary);
+    const QJsonObject aggregate = aggregateJson(reports, summary);
+
+    if (parser.isSet(outOpt)) {
+        const QDir out(parser.value(outOpt));
+        if (!QDir().mkpath(out.path())) {
+            qCritical() << "Cannot create" << out.path();
+            return 1;
+        }
+        for (const SessionAnalyzer::Report &r : reports) {
+            writeJson(out.filePath(QFileInfo(r.path).completeBaseName() + ".json"), reportJson(r));
+        }
+        writeJson(out.filePath("summary.json"), aggregate);
+    }
+
+    if (parser.isSet(jsonOpt)) {
+        std::printf("%s\n", QJsonDocument(aggregate).toJson(QJsonDocument::Indented).constData());
+    } else {
+        printReports(reports);
+        std::printf("\ntotal: %.2f h of treatment, %.0f pulses, Q+ %.1f uC, Q- %.1f uC, conformity %.2f%%, "
+                    "%d session(s) with error events\n",
+                    aggregate["treatmentHours"].toDouble(), aggregate["pulses"].toDouble(),
+                    aggregate["positiveUc"].toDouble(), aggregate["negativeUc"].toDouble(),
+                    aggregate["conformityPct"].toDouble(), aggregate["sessionsWithErrors"].toInt());
+        printThroughput(summary);
+    }
+    return summary.failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:48:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:48:12
+ * @FilePath: \ele_sti\tools\headless\HeadlessDaemon.cpp
+ * @Description: 无界面守护进程：命令解析与本地控制套接字
+ */
+#include "HeadlessDaemon.h"
+#include "common/LatencyTracer.h"
+#include "common/Metrics.h"
+#include "common/TraceRecorder.h"
+#include <QDebug>
+#include <QLocalSocket>
+#include <QMetaEnum>
+
+static QString stateName(TreatmentService::Runstate state)
+{
+    return QString::fromLatin1(QMetaEnum::fromType<TreatmentService::Runstate>().valueToKey((int)state));
+}
+
+HeadlessDaemon::HeadlessDaemon(TreatmentService *service, QObject *parent)
+    : QObject(parent), m_service(service), m_devices(nullptr), m_server(nullptr),
+      m_waveBatches(0), m_impedance(0.0f), m_battery(0), m_errorCode(0)
+{
+    connect(m_service, &TreatmentService::waveformReceived, this, [this]() { m_waveBatches++; });
+    connect(m_service, &TreatmentService::monitoringDataReady, this,
+            [this](float impedance, int battery, int error) {
+                m_impedance = impedance;
+                m_battery = battery;
+                m_errorCode = error;
+            });
+}
+
+bool HeadlessDaemon::listen(const QString &name)
+{
+    if (!m_server) {
+        m_server = new QLocalServer(this);
+        m_server->setSocketOptions(QLocalServer::UserAccessOption);
+        connect(m_server, &QLocalServer::newConnection, this, &HeadlessDaemon::onNewConnection);
+    }
+    // 上次异常退出留下的套接字文件会导致 listen 失败
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        qWarning() << "[Headless] control socket listen failed:" << m_server->errorString();
+        return false;
+    }
+    qInfo().noquote() << "[Headless] control socket" << m_server->fullServerName();
+    return true;
+}
+
+void HeadlessDaemon::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, socket, [this, socket]() {
+            while (socket->canReadLine()) {
+                const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+                if (line.isEmpty()) continue;
+                socket->write(execute(line).toUtf8());
+            }
+        });
+    }
+}
+
+QString HeadlessDaemon::statusLine() const
+{
+    return QString("state=%1 remaining=%2 waves=%3 impedance=%4 battery=%5 error=%6 program=%7")
+        .arg(stateName(m_service->currentState()))
+        .arg(m_service->remainingTime())
+        .arg(m_waveBatches)
+        .arg(m_impedance, 0, 'f', 1)
+        .arg(m_battery)
+        .arg(m_errorCode)
+        .arg(m_service->programState());
+}
+
+QString HeadlessDaemon::execute(const QString &line)
+{
+    const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+    if (parts.isEmpty()) return "err empty command\n";
+    const QString cmd = parts.first().toLower();
+    const QStringList args = parts.mid(1);
+
+    if (cmd == "start") {
+        int duration = 60;
+        if (!args.isEmpty()) {
+            bool ok = false;
+            duration = args.first().toInt(&ok);
+            if (!ok || duration <= 0) return "err bad duration\n";
+        }
+        if (m_service->currentState() == TreatmentService::Runstate::Running) return "err already running\n";
+        m_service->startTreatment(duration);
+        return "ok\n";
+    }
+    if (cmd == "stop") {
+        m_service->stopTreatment();
+        return "ok\n";
+    }
+    if (cmd == "set") return cmdSet(args);
+    if (cmd == "pid") return cmdPid(args);
+    if (cmd == "status") return statusLine() + "\nok\n";
+    if (cmd == "metrics") return MetricsRegistry::instance().exposition() + "ok\n";
+    if (cmd == "latency") return LatencyTracer::instance().formatReport() + "\nok\n";
+    if (cmd == "channels") return cmdChannels();
+    if (cmd == "sys") return cmdSys();
+    if (cmd == "trace") {
+        const QString path = TraceRecorder::instance().dumpChromeJson(QString(), "headless");
+        if (path.isEmpty()) return "err trace dump failed\n";
+        return path + "\nok\n";
+    }
+    if (cmd == "quit") {
+        emit quitRequested();
+        return "ok\n";
+    }
+    return QString("err unknown command '%1'\n").arg(cmd);
+}
+
+/**
+ * @brief set key=value ...
+ * @note  先拷贝当前参数，只改给出的字段，全部解析成功才下发
+ */
+QString HeadlessDaemon::cmdSet(const QStringList &args)
+{
+    if (args.isEmpty()) return "err usage: set key=value ...\n";
+    StimulationParam param = m_service->m_currentParam;
+    for (const QString &arg : args) {
+        const int eq = arg.indexOf('=');
+        if (eq <= 0) return QString("err bad field '%1'\n").arg(arg);
+        const QString key = arg.left(eq).toLower();
+        const QString value = arg.mid(eq + 1);
+        bool ok = false;
+        if (key == "freq") param.freq = value.toInt(&ok);
+        else if (key == "pos") param.posAmp = value.toFloat(&ok);
+        else if (key == "neg") param.negAmp = value.toFloat(&ok);
+        else if (key == "posw") param.posW = value.toInt(&ok);
+        else if (key == "negw") param.negW = value.toInt(&ok);
+        else if (key == "dead") param.dead = value.toInt(&ok);
+        else return QString("err unknown field '%1'\n").arg(key);
+        if (!ok) return QString("err bad value for '%1'\n").arg(key);
+    }
+    m_service->updateParameters(param);
+    return "ok\n";
+}
+
+QString HeadlessDaemon::cmdPid(const QStringList &args)
+{
+    if (args.size() != 3) return "err usage: pid <kp> <ki> <kd>\n";
+    PIDParam pid;
+    bool ok1 = false, ok2 = false, ok3 = false;
+    pid.kp = args.at(0).toFloat(&ok1);
+    pid.ki = args.at(1).toFloat(&ok2);
+    pid.kd = args.at(2).toFloat(&ok3);
+    if (!ok1 || !ok2 || !ok3) return "err bad pid value\n";
+    m_service->setPIDParameters(pid);
+    return "ok\n";
+}
+
+QString HeadlessDaemon::cmdChannels() const
+{
+    if (!m_devices) return "err no device manager\n";
+    QString reply;
+    for (int i = 0; i < m_devices->channelCount(); i++) {
+        reply += QString("ch%1 thread=%2 enabled=%3 waves=%4 status=%5 error=%6\n")
+                     .arg(i)
+                     .arg(m_devices->channelThread(i)->objectName())
+                     .arg(m_devices->isChannelEnabled(i) ? 1 : 0)
+                     .arg(m_devices->channelWavePackets(i))
+                     .arg(m_devices->channelStatusPackets(i))
+                     .arg(m_devices->channelErrorCode(i));
+    }
+    return reply + "ok\n";
+}
+
+QString HeadlessDaemon::cmdSys()
+{
+    if (!m_sampler.isOpen() && !m_sampler.open()) return "err /proc not available\n";
+    ProcSampler::Snapshot snapshot;
+    if (!m_sampler.sample(snapshot)) return "err sample failed\n";
+    QString reply = QString("cpu=%1% rss=%2MB mem=%3/%4MB\n")
+                        .arg(snapshot.cpuTotal * 100.0, 0, 'f', 1)
+                        .arg(snapshot.rssBytes / 1048576.0, 0, 'f', 1)
+                        .arg((snapshot.memTotalKb - snapshot.memAvailableKb) / 1024)
+                        .arg(snapshot.memTotalKb / 1024);
+    for (int i = 0; i < snapshot.cores.size(); i++) {
+        reply += QString("cpu%1 %2%\n").arg(i).arg(snapshot.cores.at(i) * 100.0, 0, 'f', 1);
+    }
+    for (const ProcSampler::ThreadLoad &t : snapshot.threads) {
+        reply += QString("thread %1 tid=%2 cpu=%3% core=%4\n")
+                     .arg(t.name).arg(t.tid).arg(t.cpuPct, 0, 'f', 1).arg(t.lastCore);
+    }
+    return reply + "ok\n";
+}
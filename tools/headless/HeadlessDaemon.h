@@ -0,0 +1,75 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:48:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:48:12
+ * @FilePath: \ele_sti\tools\headless\HeadlessDaemon.h
+ * @Description: 无界面守护进程：把 TreatmentService 暴露成一行一条的文本命令
+ */
+#pragma once
+
+#include <QObject>
+#include <QLocalServer>
+#include <QStringList>
+#include "core/TreatmentService.h"
+#include "hal/DeviceManager.h"
+#include "common/ProcSampler.h"
+
+/**
+ * @brief 文本控制协议 (每条命令一行，UTF-8)
+ *        start [秒]                    开始治疗，默认 60 秒
+ *        stop                          停止治疗
+ *        set freq=.. pos=.. neg=.. posw=.. negw=.. dead=..   更新参数，未给出的字段保持原值
+ *        pid <kp> <ki> <kd>            设置 PID
+ *        status                        当前状态、剩余时间、最近一次监测值
+ *        metrics                       Prometheus 文本
+ *        latency                       端到端延迟报告
+ *        channels                      各通道的线程、收包数和最近错误码
+ *        sys                           每核/每线程 CPU (自上一次 sys 起的平均值) 和内存
+ *        trace                         导出追踪文件并返回路径
+ *        quit                          退出守护进程
+ * 回复：若干行正文，最后一行是 "ok" 或 "err <原因>"
+ */
+class HeadlessDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessDaemon(TreatmentService *service, QObject *parent = nullptr);
+
+    /**
+     * @brief 开始监听本地控制套接字
+     * @param name 套接字名 (Linux 下在 /tmp 或 $XDG_RUNTIME_DIR 下建文件)
+     */
+    bool listen(const QString &name);
+
+    // 执行一条命令，返回完整回复文本
+    QString execute(const QString &line);
+
+    // 多通道时提供 channels 命令
+    void setDevices(DeviceManager *devices) { m_devices = devices; }
+
+    // 单行状态摘要，也用于 --status-interval 周期输出
+    QString statusLine() const;
+
+signals:
+    void quitRequested();
+
+private slots:
+    void onNewConnection();
+
+private:
+    QString cmdSet(const QStringList &args);
+    QString cmdPid(const QStringList &args);
+
+    QString cmdChannels() const;
+    QString cmdSys();
+
+    TreatmentService *m_service;
+    DeviceManager *m_devices;
+    ProcSampler m_sampler;
+    QLocalServer *m_server;
+    quint64 m_waveBatches;
+    float m_impedance;
+    int m_battery;
+    int m_errorCode;
+};
@@ -0,0 +1,173 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 16:48:12
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 16:48:12
+ * @FilePath: \ele_sti\tools\headless\main.cpp
+ * @Description: 无界面守护进程入口：不起 QML 引擎，只跑后端 + 治疗服务
+ *
+ * 一次性运行 (跑完即退出，适合浸泡测试脚本):
+ *   ele_sti_headless --freq 100 --pos-amp 2 --neg-amp 2 --duration 600 --once
+ * 多设备 (4 个模拟器同步启停；真机用 --backend spi --device /dev/spidev1.0,/dev/spidev3.0):
+ *   ele_sti_headless --devices 4 --duration 60 --once
+ * 稳态零分配检查 (预热 5 秒后计数 30 秒，有分配则退出码为 3):
+ *   ele_sti_headless --socket "" --duration 40 --once --alloc-check 30
+ * 记录每次治疗 (ele_sti_analyze 离线分析):
+ *   ele_sti_headless --pos-amp 2 --neg-amp 2 --duration 600 --once --record-dir /data/sessions
+ * 实时数据外发 (共享内存 /dev/shm/ele_sti_live，ele_sti_livetap 或 Python 工具订阅):
+ *   ele_sti_headless --live ele_sti_live
+ * 常驻 (通过本地套接字控制):
+ *   ele_sti_headless --socket ele_sti
+ *   echo status | socat - UNIX-CONNECT:/tmp/ele_sti
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include "HeadlessDaemon.h"
+#include "controllers/LivePublisher.h"
+#include "common/AllocCounter.h"
+#include "common/CpuPlan.h"
+#include "common/LatencyTracer.h"
+#include "core/TreatmentService.h"
+#include "hal/DeviceManager.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ele_sti_headless");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ele_sti treatment daemon without the QML front end");
+    parser.addHelpOption();
+    QCommandLineOption backendOpt("backend", "Backend: sim (default) or spi.", "name", "sim");
+    QCommandLineOption deviceOpt("device", "SPI device(s) for the spi backend, comma separated.", "path", "/dev/spidev3.0");
+    QCommandLineOption devicesOpt("devices", "Number of simulated devices for the sim backend.", "n", "1");
+    QCommandLineOption threadsOpt("threads", "Max acquisition threads (0 = one per core).", "n", "0");
+    QCommandLineOption freqOpt("freq", "Stimulation frequency (Hz).", "hz", "50");
+    QCommandLineOption posAmpOpt("pos-amp", "Positive amplitude (mA).", "ma", "0");
+    QCommandLineOption negAmpOpt("neg-amp", "Negative amplitude (mA).", "ma", "0");
+    QCommandLineOption posWOpt("pos-width", "Positive pulse width (us).", "us", "10");
+    QCommandLineOption negWOpt("neg-width", "Negative pulse width (us).", "us", "10");
+    QCommandLineOption deadOpt("dead", "Inter-pulse dead time (us).", "us", "20");
+    QCommandLineOption durationOpt("duration", "Start a treatment of <s> seconds right away.", "s", "0");
+    QCommandLineOption onceOpt("once", "Exit when the treatment started by --duration ends.");
+    QCommandLineOption socketOpt("socket", "Local control socket name (empty disables).", "name", "ele_sti");
+    QCommandLineOption statusOpt("status-interval", "Print a status line every <s> seconds (0 = off).", "s", "0");
+    QCommandLineOption recordOpt("record-dir", "Record every treatment as a .eses session file in <dir>.", "dir");
+    QCommandLineOption liveOpt("live", "Publish waveforms/status to shared memory + control socket <name>.", "name");
+    QCommandLineOption allocOpt("alloc-check", "After a 5 s warm-up, count heap allocations for <s> seconds; exit code 3 if any.", "s", "0");
+    parser.addOptions({ backendOpt, deviceOpt, devicesOpt, threadsOpt, freqOpt, posAmpOpt, negAmpOpt, posWOpt, negWOpt,
+                        deadOpt, durationOpt, onceOpt, socketOpt, statusOpt, recordOpt, liveOpt, allocOpt });
+    parser.process(app);
+
+    // 后端放在采集线程，和 GUI 版本保持同样的线程结构；多设备时每核一个采集线程
+    DeviceManager devices(parser.value(threadsOpt).toInt());
+    const QString backendName = parser.value(backendOpt);
+    if (backendName == "sim") {
+        const int count = qMax(1, parser.value(devicesOpt).toInt());
+        for (int i = 0; i < count; i++) devices.addSimulator();
+    }
+#ifdef Q_OS_LINUX
+    else if (backendName == "spi") {
+        for (const QString &device : parser.value(deviceOpt).split(',', Qt::SkipEmptyParts)) {
+            devices.addSpiDevice(device.trimmed());
+        }
+    }
+#endif
+    else {
+        qCritical() << "Unknown backend" << backendName;
+        return 1;
+    }
+    QObject::connect(&devices, &DeviceManager::initFinished, &app, [](int failed) {
+        if (failed > 0) qCritical() << "Backend init failed on" << failed << "channel(s)!";
+    });
+    devices.start();
+    // 核规划：采集线程各占一个核，共享执行器只用剩下的后台核
+    const CpuPlan plan = CpuPlan::detect(devices.threadCount());
+    CpuPlan::setCurrent(plan);
+    devices.pinThreads(plan.realtime);
+    qInfo().noquote() << "[Headless] cpu plan" << plan.toString();
+    IBackend *backend = &devices;
+
+    TreatmentService service(backend);
+    if (parser.isSet(recordOpt)) service.recorder().setDirectory(parser.value(recordOpt));
+    HeadlessDaemon daemon(&service);
+    daemon.setDevices(&devices);
+
+    StimulationParam param;
+    param.freq = parser.value(freqOpt).toInt();
+    param.posAmp = parser.value(posAmpOpt).toFloat();
+    param.negAmp = parser.value(negAmpOpt).toFloat();
+    param.posW = parser.value(posWOpt).toInt();
+    param.negW = parser.value(negWOpt).toInt();
+    param.dead = parser.value(deadOpt).toInt();
+    service.updateParameters(param);
+
+    const QString socketName = parser.value(socketOpt);
+    if (!socketName.isEmpty() && !daemon.listen(socketName)) {
+        return 1;
+    }
+    // 析构在 devices.shutdown() 之后，采集线程已经不再写共享内存
+    LivePublisher live;
+    if (parser.isSet(liveOpt) && !live.start(parser.value(liveOpt), &devices)) {
+        return 1;
+    }
+    QObject::connect(&daemon, &HeadlessDaemon::quitRequested, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+
+    const int statusInterval = parser.value(statusOpt).toInt();
+    QTimer statusTimer;
+    if (statusInterval > 0) {
+        QObject::connect(&statusTimer, &QTimer::timeout, &daemon, [&daemon]() {
+            qInfo().noquote() << "[Headless]" << daemon.statusLine();
+        });
+        statusTimer.start(statusInterval * 1000);
+    }
+
+    // 稳态零分配检查：两个定时器都在计数开始前建好，触发本身不分配；
+    // 计数窗口内不要用控制套接字或 --status-interval，它们本身会分配
+    const int allocWindow = parser.value(allocOpt).toInt();
+    quint64 allocations = 0;
+    QTimer armTimer;
+    QTimer disarmTimer;
+    if (allocWindow > 0) {
+        const int warmupMs = 5000;
+        armTimer.setSingleShot(true);
+        disarmTimer.setSingleShot(true);
+        QObject::connect(&armTimer, &QTimer::timeout, &app, []() { AllocCounter::arm(); });
+        QObject::connect(&disarmTimer, &QTimer::timeout, &app, [&allocations]() {
+            allocations = AllocCounter::disarm();
+            qInfo().noquote() << QString("[Headless] alloc-check: %1 allocation(s), %2 bytes, first on tid %3")
+                                     .arg(allocations).arg(AllocCounter::bytes()).arg(AllocCounter::firstThreadId());
+        });
+        armTimer.start(warmupMs);
+        disarmTimer.start(warmupMs + allocWindow * 1000);
+    }
+
+    const int duration = parser.value(durationOpt).toInt();
+    if (duration > 0) {
+        if (parser.isSet(onceOpt)) {
+            QObject::connect(&service, &TreatmentService::stateChanged, &app,
+                             [](TreatmentService::Runstate state) {
+                                 if (state != TreatmentService::Runstate::Running) QCoreApplication::quit();
+                             }, Qt::QueuedConnection);
+        }
+        service.startTreatment(duration);
+    }
+
+    int ret = app.exec();
+    if (AllocCounter::isArmed()) {
+        // 窗口没结束就退出了，按已计到的算
+        allocations = AllocCounter::disarm();
+    }
+    if (allocWindow > 0 && allocations > 0 && ret == 0) ret = 3;
+
+    if (service.currentState() == TreatmentService::Runstate::Running) {
+        service.stopTreatment();
+    }
+    qInfo().noquote() << "[Headless]" << daemon.statusLine();
+    qInfo().noquote() << LatencyTracer::instance().formatReport();
+    devices.shutdown();
+    return ret;
+}
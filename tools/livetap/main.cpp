@@ -0,0 +1,158 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-20 05:10:42
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-20 05:10:42
+ * @FilePath: \ele_sti\tools\livetap\main.cpp
+ * @Description: 实时数据订阅参考客户端：握手、映射共享内存、按通知读取，统计速率和丢失
+ *
+ * 发布端是 GUI (默认不发布，设环境变量 ELE_STI_LIVE_NAME=ele_sti_live 打开) 或 ele_sti_headless --live <name>。
+ * 每秒打印一行速率/丢失:
+ *   ele_sti_livetap
+ * 把波形写成 CSV (host_ns,channel,tick_us,s0..s49)，跑 60 秒:
+ *   ele_sti_livetap --csv wave.csv --seconds 60
+ * 不用控制套接字，直接轮询共享内存:
+ *   ele_sti_livetap --poll 5
+ *
+ * 其他语言的订阅端按 common/LiveFormat.h 的布局读即可，例如 Python:
+ *   buf = mmap.mmap(os.open("/dev/shm/ele_sti_live", os.O_RDONLY), 0, prot=mmap.PROT_READ)
+ *   头部 wave_head 在偏移 64 (uint64)；第 n 条波形在 wave_offset + (n % wave_slots) * 256，
+ *   先读槽首的 seq (uint64)，等于 2n+2 时 samples = numpy.frombuffer(buf, '<f4', 50, 槽偏移 + 24)，
+ *   拷出后再读一次 seq，仍相等才有效，大于 2n+2 说明读慢了被覆盖。
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+#include "common/LiveStream.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ele_sti_livetap");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Reference subscriber for the ele_sti live shared-memory stream");
+    parser.addHelpOption();
+    QCommandLineOption nameOpt("name", "Publisher name (shared memory and control socket).", "name", "ele_sti_live");
+    QCommandLineOption secondsOpt("seconds", "Exit after <s> seconds (0 = run until the publisher goes away).", "s", "0");
+    QCommandLineOption csvOpt("csv", "Write every waveform record to <file>.", "file");
+    QCommandLineOption pollOpt("poll", "Poll the ring every <ms> instead of using socket notifications.", "ms", "0");
+    QCommandLineOption oldestOpt("from-oldest", "Start with the history still held in the ring.");
+    parser.addOptions({ nameOpt, secondsOpt, csvOpt, pollOpt, oldestOpt });
+    parser.process(app);
+
+    const QString name = parser.value(nameOpt);
+    LiveStreamReader reader;
+    if (!reader.open(name, parser.isSet(oldestOpt))) {
+        fprintf(stderr, "cannot map live stream '%s': %s\n", qPrintable(name), qPrintable(reader.errorString()));
+        return 1;
+    }
+    const LiveHeader *h = reader.header();
+    fprintf(stderr, "mapped /dev/shm/%s: publisher pid %u, %u wave slots, %u status slots\n",
+            qPrintable(name), h->publisher_pid, h->wave_slots, h->status_slots);
+
+    QFile csvFile;
+    QTextStream csv;
+    if (parser.isSet(csvOpt)) {
+        csvFile.setFileName(parser.value(csvOpt));
+        if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            fprintf(stderr, "cannot write %s\n", qPrintable(csvFile.fileName()));
+            return 1;
+        }
+        csv.setDevice(&csvFile);
+        csv << "host_ns,channel,tick_us";
+        for (int i = 0; i < WAVEFORM_BATCH_SIZE; i++) csv << ",s" << i;
+        csv << "\n";
+    }
+
+    quint64 waves = 0, statuses = 0;
+    LiveStatusRecord lastStatus;
+    memset(&lastStatus, 0, sizeof(lastStatus));
+    auto drain = [&]() {
+        LiveWaveRecord wave;
+        while (reader.nextWave(wave)) {
+            waves++;
+            if (csvFile.isOpen()) {
+                csv << wave.hostNs << ',' << wave.channel << ',' << wave.tickUs;
+                for (int i = 0; i < wave.count; i++) csv << ',' << wave.samples[i];
+                csv << '\n';
+            }
+        }
+        LiveStatusRecord status;
+        while (reader.nextStatus(status)) {
+            statuses++;
+            lastStatus = status;
+        }
+    };
+
+    // 控制套接字：订阅通知；发布端退出时套接字断开，旧映射不会再更新
+    QLocalSocket socket;
+    const int pollMs = parser.value(pollOpt).toInt();
+    QTimer pollTimer;
+    if (pollMs > 0) {
+        QObject::connect(&pollTimer, &QTimer::timeout, &app, drain);
+        pollTimer.start(pollMs);
+    } else {
+        QObject::connect(&socket, &QLocalSocket::readyRead, &app, [&]() {
+            while (socket.canReadLine()) {
+                const QByteArray line = socket.readLine().trimmed();
+                if (line.startsWith("err")) fprintf(stderr, "publisher: %s\n", line.constData());
+            }
+            drain();
+        });
+        QObject::connect(&socket, &QLocalSocket::disconnected, &app, []() {
+            fprintf(stderr, "publisher went away\n");
+            QCoreApplication::exit(2);
+        });
+        socket.connectToServer(name);
+        if (!socket.waitForConnected(1000)) {
+            fprintf(stderr, "cannot connect to control socket '%s': %s\n", qPrintable(name), qPrintable(socket.errorString()));
+            return 1;
+        }
+        socket.write("subscribe all\n");
+    }
+
+    // 每秒一行：速率、积压、丢失 (同时上报给发布端，进它的指标)
+    QElapsedTimer clock;
+    clock.start();
+    quint64 lastWaves = 0, lastStatuses = 0;
+    qint64 lastMs = 0;
+    QTimer reportTimer;
+    QObject::connect(&reportTimer, &QTimer::timeout, &app, [&]() {
+        drain();
+        const qint64 now = clock.elapsed();
+        const double dt = qMax<qint64>(1, now - lastMs) / 1000.0;
+        printf("wave %8.1f/s  status %6.1f/s  backlog %4llu  lost %llu/%llu  overruns %llu  imp %u bat %u%% freq %u err %u\n",
+               (waves - lastWaves) / dt, (statuses - lastStatuses) / dt,
+               (unsigned long long)reader.waveBacklog(),
+               (unsigned long long)reader.waveLost(), (unsigned long long)reader.statusLost(),
+               (unsigned long long)reader.overruns(),
+               lastStatus.impedance, lastStatus.batteryPct, lastStatus.realFreq, lastStatus.errorCode);
+        fflush(stdout);
+        lastWaves = waves;
+        lastStatuses = statuses;
+        lastMs = now;
+        if (socket.state() == QLocalSocket::ConnectedState) {
+            socket.write(QString("lost %1 %2\n").arg(reader.waveLost()).arg(reader.statusLost()).toUtf8());
+        }
+    });
+    reportTimer.start(1000);
+
+    const int seconds = parser.value(secondsOpt).toInt();
+    if (seconds > 0) QTimer::singleShot(seconds * 1000, &app, &QCoreApplication::quit);
+
+    const int ret = app.exec();
+    drain();
+    fprintf(stderr, "read %llu waves, %llu status; lost %llu waves, %llu status in %llu overruns\n",
+            (unsigned long long)waves, (unsigned long long)statuses,
+            (unsigned long long)reader.waveLost(), (unsigned long long)reader.statusLost(),
+            (unsigned long long)reader.overruns());
+    return ret;
+}
@@ -0,0 +1,171 @@
+/*
+ * @Author: takuyasaya 1754944616@qq.com
+ * @Date: 2026-10-19 22:58:06
+ * @LastEditors: takuyasaya 1754944616@qq.com
+ * @LastEditTime: 2026-10-19 22:58:06
+ * @FilePath: \ele_sti\tools\pidtune\main.cpp
+ * @Description: PID 离线调谐工具：网格 + 交叉熵迭代，在恒流环仿真上并行评估
+ *
+ * 默认网格 (kp 对数 24 点 x ki 对数 24 点 x kd 4 点)，再迭代 6 轮:
+ *   ele_sti_pidtune --freq 100 --pos-amp 10 --neg-amp 10 --pos-width 200 --neg-width 200
+ * 换电极负载 (Rs,Rct kΩ，Cdl uF):
+ *   ele_sti_pidtune --load 1.0,5.0,0.5
+ * 结果只在仿真模型上成立，上机前仍需用实测波形确认
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <cstdio>
+#include "common/CpuPlan.h"
+#include "core/PidTuner.h"
+
+// "min:max:steps"，前缀 log: 表示对数取点
+static bool parseRange(const QString &text, PidTuner::Range &out)
+{
+    QString spec = text;
+    const bool log = spec.startsWith("log:");
+    if (log) spec = spec.mid(4);
+    const QStringList parts = spec.split(':');
+    bool ok1 = true, ok2 = true, ok3 = true;
+    if (parts.size() == 1) {
+        out = PidTuner::Range(parts[0].toFloat(&ok1), parts[0].toFloat(&ok2), 1);
+        return ok1 && ok2;
+    }
+    if (parts.size() != 3) return false;
+    out = PidTuner::Range(parts[0].toFloat(&ok1), parts[1].toFloat(&ok2), parts[2].toInt(&ok3), log);
+    return ok1 && ok2 && ok3 && out.steps > 0 && (!log || (out.min > 0.0f && out.max > 0.0f));
+}
+
+static void printResults(const QVector<PidTuner::Result> &results)
+{
+    std::printf("%4s %10s %12s %10s %8s | %7s %8s %7s %7s %7s %7s %8s\n",
+                "#", "kp", "ki", "kd", "limit", "score", "over%", "settle", "resid%", "sat%", "iae%", "peak");
+    for (int i = 0; i < results.size(); i++) {
+        const PidTuner::Result &r = results[i];
+        const CurrentLoopModel::Metrics &m = r.metrics;
+        std::printf("%4d %10.4g %12.5g %10.4g %8.3g | %7.3f %8.2f %6.0fus %7.2f %7.2f %7.2f %8.3f\n",
+                    i + 1, r.pid.kp, r.pid.ki, r.pid.kd, r.pid.limit, r.score,
+                    m.overshootPct, m.settlingUs, m.residualPct, m.saturationPct, m.iaePct, m.peakMa);
+    }
+}
+
+static QJsonObject toJson(const PidTuner::Result &r)
+{
+    QJsonObject o;
+    o["kp"] = r.pid.kp;
+    o["ki"] = r.pid.ki;
+    o["kd"] = r.pid.kd;
+    o["limit"] = r.pid.limit;
+    o["score"] = r.score;
+    o["overshootPct"] = r.metrics.overshootPct;
+    o["settlingUs"] = r.metrics.settlingUs;
+    o["residualPct"] = r.metrics.residualPct;
+    o["saturationPct"] = r.metrics.saturationPct;
+    o["iaePct"] = r.metrics.iaePct;
+    o["peakMa"] = r.metrics.peakMa;
+    return o;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ele_sti_pidtune");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offline PID tuning against the simulated M0 current loop");
+    parser.addHelpOption();
+    QCommandLineOption freqOpt("freq", "Stimulation frequency (Hz).", "hz", "100");
+    QCommandLineOption posAmpOpt("pos-amp", "Positive amplitude (mA).", "ma", "10");
+    QCommandLineOption negAmpOpt("neg-amp", "Negative amplitude (mA).", "ma", "10");
+    QCommandLineOption posWOpt("pos-width", "Positive pulse width (us).", "us", "200");
+    QCommandLineOption negWOpt("neg-width", "Negative pulse width (us).", "us", "200");
+    QCommandLineOption deadOpt("dead", "Inter-pulse dead time (us).", "us", "50");
+    QCommandLineOption pulsesOpt("pulses", "Consecutive pulses simulated per candidate.", "n", "3");
+    QCommandLineOption loadOpt("load", "Electrode load Rs,Rct,Cdl (kOhm,kOhm,uF).", "rs,rct,cdl", "0.5,2.0,1.0");
+    QCommandLineOption complianceOpt("compliance", "Compliance voltage (V).", "v", "60");
+    QCommandLineOption kpOpt("kp", "Kp range: [log:]min:max:steps or a fixed value.", "range", "log:0.05:20:24");
+    QCommandLineOption kiOpt("ki", "Ki range (per second).", "range", "log:100:1000000:24");
+    QCommandLineOption kdOpt("kd", "Kd range (seconds).", "range", "0:0.000002:4");
+    QCommandLineOption limitOpt("limit", "Integral limit (V).", "v", "30");
+    QCommandLineOption roundsOpt("rounds", "Cross-entropy refinement rounds after the grid.", "n", "6");
+    QCommandLineOption batchOpt("batch", "Candidates per refinement round.", "n", "512");
+    QCommandLineOption topOpt("top", "Number of candidates to print.", "n", "10");
+    QCommandLineOption threadsOpt("threads", "Worker threads (0 = one per core).", "n", "0");
+    QCommandLineOption jsonOpt("json", "Print the shortlist as JSON instead of a table.");
+    parser.addOptions({ freqOpt, posAmpOpt, negAmpOpt, posWOpt, negWOpt, deadOpt, pulsesOpt, loadOpt, complianceOpt,
+                        kpOpt, kiOpt, kdOpt, limitOpt, roundsOpt, batchOpt, topOpt, threadsOpt, jsonOpt });
+    parser.process(app);
+
+    CurrentLoopModel::Load load;
+    const QStringList loadParts = parser.value(loadOpt).split(',');
+    if (loadParts.size() != 3) {
+        qCritical() << "--load expects rs,rct,cdl";
+        return 1;
+    }
+    load.seriesKohm = loadParts[0].toFloat();
+    load.chargeKohm = loadParts[1].toFloat();
+    load.cdlUf = loadParts[2].toFloat();
+    load.complianceV = parser.value(complianceOpt).toFloat();
+    if (load.seriesKohm <= 0.0f || load.chargeKohm <= 0.0f || load.cdlUf <= 0.0f) {
+        qCritical() << "Load values must be positive";
+        return 1;
+    }
+
+    PidTuner::Range kp, ki, kd;
+    if (!parseRange(parser.value(kpOpt), kp) || !parseRange(parser.value(kiOpt), ki) || !parseRange(parser.value(kdOpt), kd)) {
+        qCritical() << "Bad --kp/--ki/--kd range, expected [log:]min:max:steps";
+        return 1;
+    }
+
+    StimulationParam pulse;
+    pulse.freq = parser.value(freqOpt).toInt();
+    pulse.posAmp = parser.value(posAmpOpt).toFloat();
+    pulse.negAmp = parser.value(negAmpOpt).toFloat();
+    pulse.posW = parser.value(posWOpt).toInt();
+    pulse.negW = parser.value(negWOpt).toInt();
+    pulse.dead = parser.value(deadOpt).toInt();
+
+    // 离线工具没有采集和界面，全部核给执行器
+    CpuPlan::setCurrent(CpuPlan::offline());
+    PidTuner tuner(load, parser.value(threadsOpt).toInt());
+    tuner.setPulse(pulse, parser.value(pulsesOpt).toInt());
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<PIDParam> candidates = PidTuner::grid(kp, ki, kd, parser.value(limitOpt).toFloat());
+    QVector<PidTuner::Result> results = tuner.evaluate(candidates);
+    const qint64 gridMs = timer.elapsed();
+    results = tuner.optimise(results, parser.value(roundsOpt).toInt(), qMax(1, parser.value(batchOpt).toInt()));
+    const qint64 totalMs = timer.elapsed();
+
+    const QVector<PidTuner::Result> best = PidTuner::rank(results, qMax(1, parser.value(topOpt).toInt()));
+    if (parser.isSet(jsonOpt)) {
+        QJsonArray arr;
+        for (const PidTuner::Result &r : best) arr.append(toJson(r));
+        QJsonObject root;
+        root["evaluated"] = (int)results.size();
+        root["threads"] = tuner.threadCount();
+        root["elapsedMs"] = totalMs;
+        root["candidates"] = arr;
+        std::printf("%s\n", QJsonDocument(root).toJson(QJsonDocument::Indented).constData());
+    } else {
+        std::printf("load: Rs %.3g kOhm, Rct %.3g kOhm, Cdl %.3g uF, compliance %.3g V\n",
+                    load.seriesKohm, load.chargeKohm, load.cdlUf, load.complianceV);
+        std::printf("pulse: %d Hz, +%.3g/-%.3g mA, %d/%d/%d us\n",
+                    pulse.freq, pulse.posAmp, pulse.negAmp, pulse.posW, pulse.dead, pulse.negW);
+        std::printf("evaluated %d candidates on %d threads: grid %d in %lld ms, total %lld ms (%.1f us/candidate)\n\n",
+                    (int)results.size(), tuner.threadCount(), (int)candidates.size(), gridMs, totalMs,
+                    results.isEmpty() ? 0.0 : 1000.0 * totalMs / results.size());
+        printResults(best);
+    }
+
+    if (best.isEmpty() || best.first().score >= 1e9) {
+        qCritical() << "No stable candidate found";
+        return 2;
+    }
+    return 0;
+}